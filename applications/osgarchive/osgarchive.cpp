@@ -12,15 +12,259 @@
 #include <osg/Timer>
 #include <osg/ArgumentParser>
 #include <osg/ApplicationUsage>
+#include <osg/Shader>
 
 #include <osgDB/Archive>
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
 #include <osgDB/FileUtils>
+#include <osgDB/FileNameUtils>
+#include <osgDB/Registry>
+
+#include <OpenThreads/Thread>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Condition>
+#include <OpenThreads/ScopedLock>
 
 #include <iostream>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
 #include <algorithm>
+#include <map>
+
+typedef std::vector<std::string> FileNameList;
+typedef unsigned long long HashValue;
+typedef std::map<std::string, HashValue> HashMap;
+
+// 64bit FNV-1a hash of the bytes stored for an entry.
+static HashValue computeHash(const std::string& data)
+{
+    HashValue hash = 14695981039346656037ULL;
+    for(std::string::const_iterator itr=data.begin(); itr!=data.end(); ++itr)
+    {
+        hash ^= static_cast<unsigned char>(*itr);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// serialize an object into memory with the plugin that the archive would use for the entry's file extension, so that the
+// bytes hashed are the bytes written to the archive, and the serialization can be done on the worker threads.
+static bool serializeObject(const osg::Object& obj, const std::string& fileName, const osgDB::Options* options, std::string& data)
+{
+    osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension(osgDB::getLowerCaseFileExtension(fileName));
+    if (!rw) return false;
+
+    std::stringstream sstream(std::ios_base::out | std::ios_base::binary);
+    osgDB::ReaderWriter::WriteResult result;
+
+    const osg::Image* image = dynamic_cast<const osg::Image*>(&obj);
+    const osg::HeightField* hf = dynamic_cast<const osg::HeightField*>(&obj);
+    const osg::Node* node = dynamic_cast<const osg::Node*>(&obj);
+    const osg::Shader* shader = dynamic_cast<const osg::Shader*>(&obj);
+    if (image) result = rw->writeImage(*image, sstream, options);
+    else if (hf) result = rw->writeHeightField(*hf, sstream, options);
+    else if (node) result = rw->writeNode(*node, sstream, options);
+    else if (shader) result = rw->writeShader(*shader, sstream, options);
+    else result = rw->writeObject(obj, sstream, options);
+
+    if (!result.success()) return false;
+
+    data = sstream.str();
+    return true;
+}
+
+static std::string hashToString(HashValue hash)
+{
+    std::ostringstream str;
+    str<<std::hex<<std::setw(16)<<std::setfill('0')<<hash;
+    return str.str();
+}
+
+// The manifest is a text file kept alongside the archive, one "<hash> <filename>" line per entry. It is only ever
+// appended to, so when an interrupted build is resumed the last line recorded for a file name is the valid one.
+static void readManifest(const std::string& manifestFilename, HashMap& hashes)
+{
+    std::ifstream fin(manifestFilename.c_str());
+    std::string line;
+    while(std::getline(fin, line))
+    {
+        std::string::size_type space = line.find(' ');
+        if (space==std::string::npos) continue;
+
+        HashValue hash = 0;
+        std::istringstream hstr(line.substr(0, space));
+        hstr>>std::hex>>hash;
+        if (!hstr.fail()) hashes[line.substr(space+1)] = hash;
+    }
+}
+
+struct ArchiveEntry
+{
+    ArchiveEntry():
+        index(0),
+        hashed(false),
+        hash(0) {}
+
+    unsigned int                index;
+    std::string                 fileName;
+    osg::ref_ptr<osg::Object>   object;
+    std::string                 data;
+    bool                        hashed;
+    HashValue                   hash;
+};
+
+// Hands out file names to the worker threads in order and hands completed entries back to the single consumer thread
+// in the same order, so the resulting archive is identical to one built sequentially. The number of entries in flight
+// is bounded to keep memory use down when the consumer falls behind.
+class EntryQueue
+{
+public:
+
+    EntryQueue(const FileNameList& files, unsigned int maxPending):
+        _files(files),
+        _maxPending(std::max(maxPending, 1u)),
+        _nextToProcess(0),
+        _nextToConsume(0) {}
+
+    bool takeNextFile(unsigned int& index, std::string& fileName)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        while(_nextToProcess<_files.size() && (_nextToProcess-_nextToConsume)>=_maxPending)
+        {
+            _condition.wait(&_mutex);
+        }
+
+        if (_nextToProcess>=_files.size()) return false;
+
+        index = _nextToProcess++;
+        fileName = _files[index];
+        return true;
+    }
+
+    void addCompletedEntry(const ArchiveEntry& entry)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _completed[entry.index] = entry;
+        _condition.broadcast();
+    }
+
+    bool takeNextCompletedEntry(ArchiveEntry& entry)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        if (_nextToConsume>=_files.size()) return false;
+
+        CompletedEntries::iterator itr;
+        while((itr=_completed.find(_nextToConsume))==_completed.end())
+        {
+            _condition.wait(&_mutex);
+        }
 
+        entry = itr->second;
+        _completed.erase(itr);
+        ++_nextToConsume;
+        _condition.broadcast();
+        return true;
+    }
+
+    // stop handing out files, so that the worker threads exit once they have completed the entries they are reading
+    void cancel()
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _nextToProcess = _files.size();
+        _condition.broadcast();
+    }
+
+protected:
+
+    typedef std::map<unsigned int, ArchiveEntry> CompletedEntries;
+
+    const FileNameList&     _files;
+    unsigned int            _maxPending;
+    unsigned int            _nextToProcess;
+    unsigned int            _nextToConsume;
+    CompletedEntries        _completed;
+    OpenThreads::Mutex      _mutex;
+    OpenThreads::Condition  _condition;
+};
+
+// Worker thread that reads entries, either from the file system when inserting or from the archive when verifying, and
+// hashes the bytes stored for them. When inserting the entries are serialized here, ready for the archive to store as is.
+class EntryReadThread : public osg::Referenced, public OpenThreads::Thread
+{
+public:
+
+    EntryReadThread(EntryQueue& queue, osgDB::Archive* archive, const osgDB::Options* writeOptions):
+        _queue(queue),
+        _archive(archive),
+        _writeOptions(writeOptions) {}
+
+    virtual void run()
+    {
+        ArchiveEntry entry;
+        while(_queue.takeNextFile(entry.index, entry.fileName))
+        {
+            entry.hashed = false;
+            entry.data.clear();
+
+            if (_archive.valid())
+            {
+                entry.object = _archive->readObject(entry.fileName).getObject();
+                entry.hashed = _archive->readFileData(entry.fileName, entry.data);
+            }
+            else
+            {
+                // the object is still passed on for archives that can't store the serialized entry
+                entry.object = osgDB::readRefObjectFile(entry.fileName);
+                entry.hashed = entry.object.valid() && serializeObject(*entry.object, entry.fileName, _writeOptions.get(), entry.data);
+            }
+
+            if (entry.hashed)
+            {
+                entry.hash = computeHash(entry.data);
+            }
+
+            _queue.addCompletedEntry(entry);
+            entry.object = 0;
+        }
+    }
+
+protected:
+
+    EntryQueue&                             _queue;
+    osg::ref_ptr<osgDB::Archive>            _archive;
+    osg::ref_ptr<const osgDB::Options>      _writeOptions;
+};
+
+typedef std::vector< osg::ref_ptr<EntryReadThread> > EntryReadThreads;
+
+static void startThreads(EntryReadThreads& threads, unsigned int numThreads, EntryQueue& queue, osgDB::Archive* archive, const osgDB::Options* writeOptions)
+{
+    for(unsigned int i=0; i<numThreads; ++i)
+    {
+        threads.push_back(new EntryReadThread(queue, archive, writeOptions));
+        threads.back()->startThread();
+    }
+}
+
+static void joinThreads(EntryReadThreads& threads)
+{
+    for(EntryReadThreads::iterator itr=threads.begin(); itr!=threads.end(); ++itr)
+    {
+        (*itr)->join();
+    }
+    threads.clear();
+}
+
+static osg::ref_ptr<osgDB::Archive> openUncachedArchive(const std::string& archiveFilename, osgDB::ReaderWriter::ArchiveStatus status)
+{
+    // keep the archive out of the registry's archive cache so that the archive being written and the one read to resume
+    // are separate objects.
+    osg::ref_ptr<osgDB::Options> options = new osgDB::Options;
+    options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+    return osgDB::openArchive(archiveFilename, status, 4096, options.get());
+}
 
 int main( int argc, char **argv )
 {
@@ -39,6 +283,12 @@ int main( int argc, char **argv )
         return 1;
     }
 
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <num>","Number of threads used to read and hash entries while a single thread writes the archive.");
+    arguments.getApplicationUsage()->addCommandLineOption("--compressor <name>","Compressor passed to the plugins writing the archive entries, i.e. zlib for .osgb/.osgt entries.");
+    arguments.getApplicationUsage()->addCommandLineOption("--checkpoint <num>","Write out the archive index and manifest after every <num> entries inserted, 0 to only write at the end.");
+    arguments.getApplicationUsage()->addCommandLineOption("--resume","Skip files already recorded in the archive index, continuing an interrupted --insert.");
+    arguments.getApplicationUsage()->addCommandLineOption("--verify","Read back every entry and check it against the hash recorded in the archive manifest.");
+
     std::string archiveFilename;
     while (arguments.read("-a",archiveFilename) || arguments.read("--archive",archiveFilename))
     {
@@ -62,7 +312,32 @@ int main( int argc, char **argv )
         list = true;
     }
 
-    typedef std::vector<std::string> FileNameList;
+    bool verify = false;
+    while (arguments.read("--verify"))
+    {
+        verify = true;
+    }
+
+    bool resume = false;
+    while (arguments.read("--resume"))
+    {
+        resume = true;
+    }
+
+    unsigned int numThreads = 1;
+    while (arguments.read("--threads",numThreads)) {}
+    numThreads = std::max(numThreads, 1u);
+
+    unsigned int checkpointInterval = 1000;
+    while (arguments.read("--checkpoint",checkpointInterval)) {}
+
+    osg::ref_ptr<osgDB::Options> writeOptions;
+    std::string compressor;
+    while (arguments.read("--compressor",compressor))
+    {
+        writeOptions = new osgDB::Options(std::string("Compressor=")+compressor);
+    }
+
     FileNameList files;
     for(int pos=1;pos<arguments.argc();++pos)
     {
@@ -82,7 +357,7 @@ int main( int argc, char **argv )
                     osgDB::DirectoryContents::iterator it = directory.begin();
                     while( it != directory.end())
                     {
-                        files.push_back(filePath + "/" + (*it));
+                        if (*it!="." && *it!="..") files.push_back(filePath + "/" + (*it));
                         ++it;
                     }
                 }
@@ -110,9 +385,9 @@ int main( int argc, char **argv )
         return 1;
     }
 
-    if (!insert && !extract && !list)
+    if (!insert && !extract && !list && !verify)
     {
-        std::cout<<"Please specify an operation on the archive, either --insert, --extract or --list"<<std::endl;
+        std::cout<<"Please specify an operation on the archive, either --insert, --extract, --list or --verify"<<std::endl;
         return 1;
     }
 
@@ -124,38 +399,161 @@ int main( int argc, char **argv )
 
     osg::ref_ptr<osgDB::Archive> archive;
 
+    std::string manifestFilename = archiveFilename+".manifest";
+
     if (insert)
     {
-        archive = osgDB::openArchive(archiveFilename, osgDB::Archive::WRITE);
+        archive = openUncachedArchive(archiveFilename, osgDB::Archive::WRITE);
 
         if (archive.valid())
         {
-            for (FileNameList::iterator itr=files.begin();
-                itr!=files.end();
-                ++itr)
+            if (resume)
             {
-                std::cout<<"reading "<<*itr<<std::endl;
-                osg::ref_ptr<osg::Object> obj = osgDB::readRefObjectFile(*itr);
-                if (obj.valid())
+                // the index recorded by the last checkpoint tells us which entries made it into the archive.
+                osg::ref_ptr<osgDB::Archive> existingArchive = openUncachedArchive(archiveFilename, osgDB::Archive::READ);
+                if (existingArchive.valid())
                 {
-                    std::cout<<"  write to archive "<<*itr<<std::endl;
-                    osg::Image* image = dynamic_cast<osg::Image*>(obj.get());
-                    osg::HeightField* hf = dynamic_cast<osg::HeightField*>(obj.get());
-                    osg::Node* node = dynamic_cast<osg::Node*>(obj.get());
-                    osg::Shader* shader = dynamic_cast<osg::Shader*>(obj.get());
-                    if (image) archive->writeImage(*image, *itr);
-                    else if (hf) archive->writeHeightField(*hf, *itr);
-                    else if (node) archive->writeNode(*node, *itr);
-                    else if (shader) archive->writeShader(*shader, *itr);
-                    else archive->writeObject(*obj, *itr);
+                    FileNameList remainingFiles;
+                    for(FileNameList::iterator itr=files.begin();
+                        itr!=files.end();
+                        ++itr)
+                    {
+                        if (!existingArchive->fileExists(osgDB::convertFileNameToUnixStyle(*itr))) remainingFiles.push_back(*itr);
+                    }
+                    std::cout<<"resuming, "<<files.size()-remainingFiles.size()<<" of "<<files.size()<<" files already in archive"<<std::endl;
+                    files.swap(remainingFiles);
+                    existingArchive->close();
                 }
             }
+
+            // entries added to an existing archive are appended to it, so the manifest is appended to as well.
+            std::ofstream manifest(manifestFilename.c_str(), std::ios_base::out|std::ios_base::app);
+
+            EntryQueue queue(files, numThreads*4);
+            EntryReadThreads threads;
+            startThreads(threads, numThreads, queue, 0, writeOptions.get());
+
+            unsigned int numSinceCheckpoint = 0;
+            ArchiveEntry entry;
+            while(queue.takeNextCompletedEntry(entry))
+            {
+                std::cout<<"reading "<<entry.fileName<<std::endl;
+                osg::Object* obj = entry.object.get();
+                if (obj)
+                {
+                    std::cout<<"  write to archive "<<entry.fileName<<std::endl;
+
+                    osgDB::ReaderWriter::WriteResult result(osgDB::ReaderWriter::WriteResult::FILE_NOT_HANDLED);
+                    if (entry.hashed) result = archive->writeFileData(entry.data, entry.fileName);
+
+                    if (result.status()==osgDB::ReaderWriter::WriteResult::FILE_NOT_HANDLED)
+                    {
+                        // the archive can't store the serialized entry so has to serialize it again, and there are no bytes to hash
+                        entry.hashed = false;
+
+                        osg::Image* image = dynamic_cast<osg::Image*>(obj);
+                        osg::HeightField* hf = dynamic_cast<osg::HeightField*>(obj);
+                        osg::Node* node = dynamic_cast<osg::Node*>(obj);
+                        osg::Shader* shader = dynamic_cast<osg::Shader*>(obj);
+                        if (image) result = archive->writeImage(*image, entry.fileName, writeOptions.get());
+                        else if (hf) result = archive->writeHeightField(*hf, entry.fileName, writeOptions.get());
+                        else if (node) result = archive->writeNode(*node, entry.fileName, writeOptions.get());
+                        else if (shader) result = archive->writeShader(*shader, entry.fileName, writeOptions.get());
+                        else result = archive->writeObject(*obj, entry.fileName, writeOptions.get());
+                    }
+
+                    if (!result.success())
+                    {
+                        std::cout<<"  failed to write "<<entry.fileName<<" to archive"<<std::endl;
+                        continue;
+                    }
+
+                    if (entry.hashed) manifest<<hashToString(entry.hash)<<" "<<osgDB::convertFileNameToUnixStyle(entry.fileName)<<"\n";
+
+                    if (checkpointInterval>0 && ++numSinceCheckpoint>=checkpointInterval)
+                    {
+                        // flush the manifest before the index so that every indexed entry always has its hash recorded.
+                        manifest.flush();
+                        if (!archive->flush())
+                        {
+                            std::cout<<"Error: unable to write the index of archive "<<archiveFilename<<" at checkpoint."<<std::endl;
+                            queue.cancel();
+                            joinThreads(threads);
+                            return 1;
+                        }
+                        numSinceCheckpoint = 0;
+                    }
+                }
+            }
+
+            joinThreads(threads);
+
+            manifest.flush();
+            archive->close();
+
+            archive = list ? openUncachedArchive(archiveFilename, osgDB::Archive::READ) : 0;
         }
     }
     else
     {
         archive = osgDB::openArchive(archiveFilename, osgDB::Archive::READ);
 
+        if (verify && archive.valid())
+        {
+            HashMap hashes;
+            readManifest(manifestFilename, hashes);
+
+            osgDB::Archive::FileNameList fileNames;
+            archive->getFileNames(fileNames);
+            FileNameList entries(fileNames.begin(), fileNames.end());
+
+            EntryQueue queue(entries, numThreads*4);
+            EntryReadThreads threads;
+            startThreads(threads, numThreads, queue, archive.get(), 0);
+
+            unsigned int numFailed = 0;
+            unsigned int numUnhashed = 0;
+            ArchiveEntry entry;
+            while(queue.takeNextCompletedEntry(entry))
+            {
+                HashMap::iterator hitr = hashes.find(entry.fileName);
+                if (!entry.object)
+                {
+                    std::cout<<"FAILED  "<<entry.fileName<<" : unable to read entry"<<std::endl;
+                    ++numFailed;
+                }
+                else if (hitr==hashes.end())
+                {
+                    std::cout<<"NO HASH "<<entry.fileName<<std::endl;
+                    ++numUnhashed;
+                }
+                else if (!entry.hashed || entry.hash!=hitr->second)
+                {
+                    std::cout<<"FAILED  "<<entry.fileName<<" : hash mismatch"<<std::endl;
+                    ++numFailed;
+                }
+            }
+
+            joinThreads(threads);
+
+            // entries recorded in the manifest but missing from the index didn't make it into the archive
+            unsigned int numMissing = 0;
+            for(HashMap::iterator hitr = hashes.begin();
+                hitr != hashes.end();
+                ++hitr)
+            {
+                if (!archive->fileExists(hitr->first))
+                {
+                    std::cout<<"MISSING "<<hitr->first<<std::endl;
+                    ++numMissing;
+                }
+            }
+            numFailed += numMissing;
+
+            std::cout<<"Verified "<<entries.size()<<" entries, "<<numFailed<<" failed, "<<numMissing<<" missing, "<<numUnhashed<<" without a recorded hash."<<std::endl;
+            if (numFailed>0) return 1;
+        }
+
         if (extract && archive.valid())
         {
             for (FileNameList::iterator itr=files.begin();
@@ -0,0 +1,170 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This application is open source and may be redistributed and/or modified
+ * freely and without restriction, both in commercial and non commercial applications,
+ * as long as this copyright notice is maintained.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*/
+
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
+#include <osg/Timer>
+
+#include <osgDB/ReadFile>
+#include <osgDB/WriteFile>
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
+
+#include <osgUtil/TileBuilder>
+
+#include <OpenThreads/Thread>
+
+#include <iostream>
+
+class WriteTileCallback : public osgUtil::TileBuilder::WriteTileCallback
+{
+public:
+
+    WriteTileCallback(osgDB::Options* options):
+        _options(options) {}
+
+    virtual bool writeTile(const osg::Node& node, const std::string& fileName)
+    {
+        if (osgDB::writeNodeFile(node, fileName, _options.get())) return true;
+
+        std::cout<<"Error: unable to write tile "<<fileName<<std::endl;
+        return false;
+    }
+
+protected:
+
+    osg::ref_ptr<osgDB::Options> _options;
+};
+
+int main( int argc, char **argv )
+{
+    // use an ArgumentParser object to manage the program arguments.
+    osg::ArgumentParser arguments(&argc,argv);
+
+    // set up the usage document, in case we need to print out how to use this program.
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" is an application for splitting large models into a hierarchy of PagedLOD tiles that can be paged in by the osgDB::DatabasePager.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options] infile1 [infile2 ...] outfile");
+    arguments.getApplicationUsage()->addCommandLineOption("-h or --help","Display command line parameters");
+    arguments.getApplicationUsage()->addCommandLineOption("--octree","Subdivide tiles in x, y and z rather than just x and y.");
+    arguments.getApplicationUsage()->addCommandLineOption("--max-triangles <num>","Number of triangles above which a tile is subdivided, and coarser tiles are simplified down to. Default is 20000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--max-level <num>","Maximum depth of the tile hierarchy. Default is 16.");
+    arguments.getApplicationUsage()->addCommandLineOption("--range-multiplier <value>","Multiple of a tile's radius at which its children are paged in. Default is 4.");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <num>","Number of threads used to build the tiles. Default is the number of processors.");
+    arguments.getApplicationUsage()->addCommandLineOption("--temp-dir <directory>","Directory of the temporary files holding the triangles while they are tiled. Default is the directory of outfile.");
+    arguments.getApplicationUsage()->addCommandLineOption("-O <option>","Option string passed to the plugins writing the tiles, i.e. -O Compressor=zlib");
+
+    // if user request help write it out to cout.
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    osg::ref_ptr<osgUtil::TileBuilder> tileBuilder = new osgUtil::TileBuilder;
+    tileBuilder->setNumThreads(OpenThreads::GetNumberOfProcessors());
+
+    while (arguments.read("--octree")) tileBuilder->setSubdivision(osgUtil::TileBuilder::OCTREE);
+
+    unsigned int num;
+    while (arguments.read("--max-triangles",num)) tileBuilder->setMaximumNumTrianglesPerTile(num);
+    while (arguments.read("--max-level",num)) tileBuilder->setMaximumLevel(num);
+    while (arguments.read("--threads",num)) tileBuilder->setNumThreads(num);
+
+    float value;
+    while (arguments.read("--range-multiplier",value)) tileBuilder->setRangeMultiplier(value);
+
+    std::string temporaryDirectory;
+    while (arguments.read("--temp-dir",temporaryDirectory)) {}
+
+    osg::ref_ptr<osgDB::Options> options = new osgDB::Options;
+    std::string str;
+    while (arguments.read("-O",str))
+    {
+        options->setOptionString(options->getOptionString().empty() ? str : options->getOptionString()+" "+str);
+    }
+
+    // any option left unread are converted into errors to write out later.
+    arguments.reportRemainingOptionsAsUnrecognized();
+
+    // report any errors if they have occurred when parsing the program arguments.
+    if (arguments.errors())
+    {
+        arguments.writeErrorMessages(std::cout);
+        return 1;
+    }
+
+    typedef std::vector<std::string> FileNameList;
+    FileNameList fileNames;
+    for(int pos=1;pos<arguments.argc();++pos)
+    {
+        if (!arguments.isOption(pos)) fileNames.push_back(arguments[pos]);
+    }
+
+    if (fileNames.size()<2)
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    std::string outputFileName = fileNames.back();
+    fileNames.pop_back();
+
+    tileBuilder->setTileExtension(std::string(".")+osgDB::getFileExtension(outputFileName));
+
+    std::string outputPath = osgDB::getFilePath(outputFileName);
+    if (!outputPath.empty() && !osgDB::makeDirectory(outputPath))
+    {
+        std::cout<<"Error: unable to create directory "<<outputPath<<std::endl;
+        return 1;
+    }
+
+    if (temporaryDirectory.empty()) temporaryDirectory = outputPath;
+    if (!temporaryDirectory.empty() && !osgDB::makeDirectory(temporaryDirectory))
+    {
+        std::cout<<"Error: unable to create directory "<<temporaryDirectory<<std::endl;
+        return 1;
+    }
+    tileBuilder->setTemporaryDirectory(temporaryDirectory);
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+
+    // each input model is only held in memory while its triangles are written out to the temporary directory.
+    for(FileNameList::iterator itr = fileNames.begin(); itr != fileNames.end(); ++itr)
+    {
+        osg::ref_ptr<osg::Node> model = osgDB::readRefNodeFile(*itr);
+        if (!model)
+        {
+            std::cout<<"Error: unable to read "<<*itr<<std::endl;
+            return 1;
+        }
+
+        tileBuilder->addModel(*model);
+        std::cout<<"Read "<<*itr<<", "<<tileBuilder->getNumTriangles()<<" triangles collected"<<std::endl;
+    }
+
+    tileBuilder->setWriteTileCallback(new WriteTileCallback(options.get()));
+
+    osg::ref_ptr<osg::Node> root = tileBuilder->build(outputFileName);
+    if (!root || !osgDB::writeNodeFile(*root, outputFileName, options.get()))
+    {
+        std::cout<<"Error: failed to build tiles for "<<outputFileName<<std::endl;
+        return 1;
+    }
+
+    std::cout<<"Wrote "<<tileBuilder->getNumTilesWritten()+1<<" tiles in "<<osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick())<<" seconds"<<std::endl;
+    if (tileBuilder->getNumTrianglesDropped()>0)
+    {
+        std::cout<<"Warning: "<<tileBuilder->getNumTrianglesDropped()<<" triangles were dropped from the coarse tiles"<<std::endl;
+    }
+
+    return 0;
+}
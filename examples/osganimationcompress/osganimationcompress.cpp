@@ -0,0 +1,82 @@
+/*  -*-c++-*-
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+// Converts the linear Vec3 and Quat channels of the animations in a file, such as an .osgb exported
+// with osgAnimation, to quantized channels with osgAnimation::AnimationCompressor and writes the result.
+
+#include <iostream>
+#include <osg/ArgumentParser>
+#include <osgDB/ReadFile>
+#include <osgDB/WriteFile>
+#include <osgAnimation/AnimationCompressor>
+#include <osgAnimation/AnimationManagerBase>
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" compresses the keyframes of the animations in a file.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options] input output");
+    arguments.getApplicationUsage()->addCommandLineOption("-h or --help", "Display this information.");
+    arguments.getApplicationUsage()->addCommandLineOption("--translation-tolerance <distance>", "Largest error allowed on Vec3 channels, defaults to 0.001.");
+    arguments.getApplicationUsage()->addCommandLineOption("--rotation-tolerance <radians>", "Largest error allowed on rotation channels, defaults to 0.001.");
+
+    if (arguments.read("-h") || arguments.read("--help") || arguments.argc()<3)
+    {
+        arguments.getApplicationUsage()->write(std::cout, osg::ApplicationUsage::COMMAND_LINE_OPTION);
+        return 1;
+    }
+
+    osgAnimation::AnimationCompressor compressor;
+
+    float tolerance;
+    while (arguments.read("--translation-tolerance", tolerance)) compressor.setTranslationTolerance(tolerance);
+    while (arguments.read("--rotation-tolerance", tolerance)) compressor.setRotationTolerance(tolerance);
+
+    std::string input = arguments[1];
+    std::string output = arguments[2];
+
+    osg::ref_ptr<osg::Object> object = osgDB::readRefObjectFile(input);
+    if (!object)
+    {
+        std::cout << arguments.getApplicationName() << ": unable to read " << input << std::endl;
+        return 1;
+    }
+
+    if (osg::Node* node = dynamic_cast<osg::Node*>(object.get()))
+    {
+        node->accept(compressor);
+    }
+    else if (osgAnimation::AnimationManagerBase* manager = dynamic_cast<osgAnimation::AnimationManagerBase*>(object.get()))
+    {
+        osgAnimation::AnimationList& animations = manager->getAnimationList();
+        for (osgAnimation::AnimationList::iterator itr = animations.begin(); itr != animations.end(); ++itr)
+            compressor.compress(**itr);
+    }
+    else if (osgAnimation::Animation* animation = dynamic_cast<osgAnimation::Animation*>(object.get()))
+    {
+        compressor.compress(*animation);
+    }
+
+    std::cout << "compressed " << compressor.getNumChannels() << " channels, "
+              << compressor.getNumKeyframesIn() << " keyframes to " << compressor.getNumKeyframesOut() << ", "
+              << compressor.getNumBytesIn() << " bytes to " << compressor.getNumBytesOut() << std::endl;
+
+    if (!osgDB::writeObjectFile(*object, output))
+    {
+        std::cout << arguments.getApplicationName() << ": unable to write " << output << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
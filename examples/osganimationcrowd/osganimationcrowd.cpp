@@ -0,0 +1,340 @@
+/*  -*-c++-*-
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+// A crowd of software skinned characters, based on osganimationskinning, for benchmarking
+// RigTransformSoftware and ParallelSkinningCallback. Each character is a tube skinned over a
+// chain of bones with each vertex blended between its two nearest bones.
+
+#include <iostream>
+#include <sstream>
+#include <cmath>
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
+#include <osg/Geode>
+#include <osg/Timer>
+#include <osgViewer/Viewer>
+#include <osgViewer/ViewerEventHandlers>
+#include <osgGA/TrackballManipulator>
+#include <osgUtil/UpdateVisitor>
+
+#include <osgAnimation/Bone>
+#include <osgAnimation/Skeleton>
+#include <osgAnimation/RigGeometry>
+#include <osgAnimation/RigTransformSoftware>
+#include <osgAnimation/ParallelSkinningCallback>
+#include <osgAnimation/BasicAnimationManager>
+#include <osgAnimation/SkeletonUpdatePolicy>
+#include <osgAnimation/UpdateBone>
+#include <osgAnimation/StackedTransform>
+#include <osgAnimation/StackedTranslateElement>
+#include <osgAnimation/StackedRotateAxisElement>
+
+// animation channels link to bones by name, so each character's bones need their own names
+static std::string boneName(unsigned int character, unsigned int i)
+{
+    std::ostringstream str;
+    str << "character" << character << "_bone" << i;
+    return str.str();
+}
+
+osgAnimation::Animation* createAnimation(unsigned int character, unsigned int numBones)
+{
+    osgAnimation::Animation* anim = new osgAnimation::Animation;
+    for(unsigned int i=1; i<numBones; ++i)
+    {
+        osgAnimation::FloatKeyframeContainer* keys = new osgAnimation::FloatKeyframeContainer;
+        keys->push_back(osgAnimation::FloatKeyframe(0.0, 0.0f));
+        keys->push_back(osgAnimation::FloatKeyframe(1.0 + 0.1*i, 0.3f));
+        keys->push_back(osgAnimation::FloatKeyframe(2.0 + 0.2*i, -0.3f));
+        keys->push_back(osgAnimation::FloatKeyframe(4.0, 0.0f));
+        osgAnimation::FloatLinearSampler* sampler = new osgAnimation::FloatLinearSampler;
+        sampler->setKeyframeContainer(keys);
+        osgAnimation::FloatLinearChannel* channel = new osgAnimation::FloatLinearChannel(sampler);
+        channel->setName("rotate");
+        channel->setTargetName(boneName(character, i));
+        anim->addChannel(channel);
+    }
+    anim->setPlayMode(osgAnimation::Animation::LOOP);
+    return anim;
+}
+
+osg::Node* createCharacter(unsigned int character, unsigned int numBones, unsigned int numRings, unsigned int numSegments)
+{
+    const float boneLength = 1.0f;
+    const float radius = 0.25f;
+
+    osg::ref_ptr<osgAnimation::Skeleton> skeleton = new osgAnimation::Skeleton;
+    skeleton->setDefaultUpdateCallback();
+
+    osgAnimation::Bone* parent = 0;
+    for(unsigned int i=0; i<numBones; ++i)
+    {
+        osgAnimation::Bone* bone = new osgAnimation::Bone(boneName(character, i));
+        bone->setInvBindMatrixInSkeletonSpace(osg::Matrix::translate(0.0, 0.0, -boneLength*i));
+
+        osgAnimation::UpdateBone* update = new osgAnimation::UpdateBone(boneName(character, i));
+        update->getStackedTransforms().push_back(new osgAnimation::StackedTranslateElement("translate", osg::Vec3(0.0f, 0.0f, i>0 ? boneLength : 0.0f)));
+        update->getStackedTransforms().push_back(new osgAnimation::StackedRotateAxisElement("rotate", osg::Vec3(1.0f, 0.0f, 0.0f), 0.0));
+        bone->setUpdateCallback(update);
+        bone->setDataVariance(osg::Object::DYNAMIC);
+
+        if (parent) parent->addChild(bone);
+        else skeleton->addChild(bone);
+        parent = bone;
+    }
+
+    // a tube along z, each ring of vertices blended between the two bones nearest to it
+    osg::Geometry* geometry = new osg::Geometry;
+    osg::Vec3Array* vertices = new osg::Vec3Array;
+    osg::Vec3Array* normals = new osg::Vec3Array;
+    osgAnimation::VertexInfluenceMap* influences = new osgAnimation::VertexInfluenceMap;
+    float height = boneLength*numBones;
+    for(unsigned int r=0; r<numRings; ++r)
+    {
+        float z = height*static_cast<float>(r)/static_cast<float>(numRings-1);
+        float b = osg::clampBetween(z/boneLength - 0.5f, 0.0f, static_cast<float>(numBones-1));
+        unsigned int b0 = static_cast<unsigned int>(b);
+        unsigned int b1 = osg::minimum(b0+1, numBones-1);
+        float w1 = b - static_cast<float>(b0);
+
+        for(unsigned int s=0; s<numSegments; ++s)
+        {
+            float angle = 2.0f*osg::PIf*static_cast<float>(s)/static_cast<float>(numSegments);
+            osg::Vec3 n(cosf(angle), sinf(angle), 0.0f);
+            unsigned int index = static_cast<unsigned int>(vertices->size());
+            vertices->push_back(n*radius + osg::Vec3(0.0f, 0.0f, z));
+            normals->push_back(n);
+
+            (*influences)[boneName(character, b0)].push_back(osgAnimation::VertexIndexWeight(index, 1.0f-w1));
+            if (b1!=b0 && w1>0.0f) (*influences)[boneName(character, b1)].push_back(osgAnimation::VertexIndexWeight(index, w1));
+        }
+    }
+    for(osgAnimation::VertexInfluenceMap::iterator itr = influences->begin(); itr != influences->end(); ++itr)
+    {
+        itr->second.setName(itr->first);
+    }
+
+    osg::DrawElementsUInt* triangles = new osg::DrawElementsUInt(GL_TRIANGLES);
+    for(unsigned int r=0; r+1<numRings; ++r)
+    {
+        for(unsigned int s=0; s<numSegments; ++s)
+        {
+            unsigned int i0 = r*numSegments + s;
+            unsigned int i1 = r*numSegments + (s+1)%numSegments;
+            triangles->push_back(i0); triangles->push_back(i1); triangles->push_back(i0+numSegments);
+            triangles->push_back(i1); triangles->push_back(i1+numSegments); triangles->push_back(i0+numSegments);
+        }
+    }
+
+    geometry->setVertexArray(vertices);
+    geometry->setNormalArray(normals, osg::Array::BIND_PER_VERTEX);
+    geometry->addPrimitiveSet(triangles);
+
+    osgAnimation::RigGeometry* rig = new osgAnimation::RigGeometry;
+    rig->setSourceGeometry(geometry);
+    rig->setInfluenceMap(influences);
+    rig->setRigTransformImplementation(new osgAnimation::RigTransformSoftware);
+    rig->setDataVariance(osg::Object::DYNAMIC);
+    rig->setUseDisplayList(false);
+
+    osg::Geode* geode = new osg::Geode;
+    geode->addDrawable(rig);
+    skeleton->addChild(geode);
+
+    return skeleton.release();
+}
+
+// collect the RigGeometry of the scene, for checking the skinned vertices against the reference path
+struct CollectRigGeometries : public osg::NodeVisitor
+{
+    CollectRigGeometries() : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN) {}
+
+    void apply(osg::Geometry& geometry)
+    {
+        osgAnimation::RigGeometry* rig = dynamic_cast<osgAnimation::RigGeometry*>(&geometry);
+        if (rig) _rigs.push_back(rig);
+    }
+
+    std::vector<osgAnimation::RigGeometry*> _rigs;
+};
+
+// skin with the original per VertexGroup path and return the largest difference from the current vertices
+float compareWithReference(const std::vector<osgAnimation::RigGeometry*>& rigs)
+{
+    float maxError = 0.0f;
+    for(std::vector<osgAnimation::RigGeometry*>::const_iterator itr = rigs.begin(); itr != rigs.end(); ++itr)
+    {
+        osgAnimation::RigGeometry* rig = *itr;
+        osgAnimation::RigTransformSoftware* rts = dynamic_cast<osgAnimation::RigTransformSoftware*>(rig->getRigTransformImplementation());
+        osg::Vec3Array* src = dynamic_cast<osg::Vec3Array*>(rig->getSourceGeometry()->getVertexArray());
+        osg::Vec3Array* dst = dynamic_cast<osg::Vec3Array*>(rig->getVertexArray());
+        osg::Vec3Array* normalSrc = dynamic_cast<osg::Vec3Array*>(rig->getSourceGeometry()->getNormalArray());
+        osg::Vec3Array* normalDst = dynamic_cast<osg::Vec3Array*>(rig->getNormalArray());
+        if (!rts || !src || !dst || src==dst) continue;
+
+        osg::ref_ptr<osg::Vec3Array> reference = new osg::Vec3Array(src->size());
+        rts->compute<osg::Vec3>(rig->getMatrixFromSkeletonToGeometry(), rig->getInvMatrixFromSkeletonToGeometry(), &src->front(), &reference->front());
+        for(unsigned int i=0; i<src->size(); ++i)
+        {
+            maxError = osg::maximum(maxError, ((*reference)[i]-(*dst)[i]).length());
+        }
+
+        if (normalSrc && normalDst && normalSrc!=normalDst)
+        {
+            rts->computeNormal<osg::Vec3>(rig->getMatrixFromSkeletonToGeometry(), rig->getInvMatrixFromSkeletonToGeometry(), &normalSrc->front(), &reference->front());
+            for(unsigned int i=0; i<normalSrc->size(); ++i)
+            {
+                maxError = osg::maximum(maxError, ((*reference)[i]-(*normalDst)[i]).length());
+            }
+        }
+    }
+    return maxError;
+}
+
+osg::Group* createCrowd(unsigned int numCharacters, unsigned int numBones, unsigned int numRings, unsigned int numSegments)
+{
+    osg::Group* scene = new osg::Group;
+
+    osgAnimation::BasicAnimationManager* manager = new osgAnimation::BasicAnimationManager;
+    scene->setUpdateCallback(manager);
+
+    unsigned int numColumns = static_cast<unsigned int>(ceil(sqrt(static_cast<double>(numCharacters))));
+    for(unsigned int i=0; i<numCharacters; ++i)
+    {
+        osg::MatrixTransform* transform = new osg::MatrixTransform;
+        transform->setMatrix(osg::Matrix::translate(2.0*(i%numColumns), 2.0*(i/numColumns), 0.0));
+        transform->addChild(createCharacter(i, numBones, numRings, numSegments));
+        scene->addChild(transform);
+
+        osgAnimation::Animation* anim = createAnimation(i, numBones);
+        manager->getAnimationList().push_back(anim);
+        manager->playAnimation(anim);
+    }
+    manager->dirty();
+    manager->buildTargetReference();
+
+    return scene;
+}
+
+double runBenchmark(osg::Group* scene, unsigned int numFrames, float& maxError)
+{
+    osg::ref_ptr<osgUtil::UpdateVisitor> updateVisitor = new osgUtil::UpdateVisitor;
+    osg::ref_ptr<osg::FrameStamp> frameStamp = new osg::FrameStamp;
+    updateVisitor->setFrameStamp(frameStamp.get());
+
+    CollectRigGeometries collect;
+    scene->accept(collect);
+
+    // the first frames find the skeletons and set up the rigs
+    unsigned int frameNumber = 0;
+    for(; frameNumber<3; ++frameNumber)
+    {
+        frameStamp->setFrameNumber(frameNumber);
+        frameStamp->setSimulationTime(frameNumber/60.0);
+        updateVisitor->setTraversalNumber(frameNumber);
+        scene->accept(*updateVisitor);
+    }
+
+    maxError = 0.0f;
+    double time = 0.0;
+    for(unsigned int i=0; i<numFrames; ++i, ++frameNumber)
+    {
+        frameStamp->setFrameNumber(frameNumber);
+        frameStamp->setSimulationTime(frameNumber/60.0);
+        updateVisitor->setTraversalNumber(frameNumber);
+
+        osg::Timer_t start = osg::Timer::instance()->tick();
+        scene->accept(*updateVisitor);
+        time += osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick());
+
+        if (i%16==0) maxError = osg::maximum(maxError, compareWithReference(collect._rigs));
+    }
+
+    return time/static_cast<double>(numFrames);
+}
+
+int main (int argc, char* argv[])
+{
+    osg::ArgumentParser arguments(&argc, argv);
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options]");
+    arguments.getApplicationUsage()->addCommandLineOption("--characters <num>","Number of characters in the crowd, defaults to 500.");
+    arguments.getApplicationUsage()->addCommandLineOption("--bones <num>","Number of bones of each character, defaults to 16.");
+    arguments.getApplicationUsage()->addCommandLineOption("--rings <num>","Number of rings of vertices of each character, defaults to 64.");
+    arguments.getApplicationUsage()->addCommandLineOption("--segments <num>","Number of vertices per ring, defaults to 32.");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <num>","Skin with a ParallelSkinningCallback using num threads, 0 for one per processor.");
+    arguments.getApplicationUsage()->addCommandLineOption("--lod","Update off screen and distant characters less often, skinning distant ones with fewer bones.");
+    arguments.getApplicationUsage()->addCommandLineOption("--benchmark <frames>","Time the update traversal without a viewer, serially and with the ParallelSkinningCallback.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout, osg::ApplicationUsage::COMMAND_LINE_OPTION);
+        return 1;
+    }
+
+    unsigned int numCharacters = 500;
+    unsigned int numBones = 16;
+    unsigned int numRings = 64;
+    unsigned int numSegments = 32;
+    while(arguments.read("--characters", numCharacters)) {}
+    while(arguments.read("--bones", numBones)) {}
+    while(arguments.read("--rings", numRings)) {}
+    while(arguments.read("--segments", numSegments)) {}
+
+    numBones = osg::maximum(numBones, 2u);
+    numRings = osg::maximum(numRings, 2u);
+    numSegments = osg::maximum(numSegments, 3u);
+
+    int numThreads = -1;
+    while(arguments.read("--threads", numThreads)) {}
+
+    unsigned int numFrames = 0;
+    if (arguments.read("--benchmark", numFrames))
+    {
+        std::cout << numCharacters << " characters of " << numRings*numSegments << " vertices and " << numBones << " bones" << std::endl;
+
+        float maxError = 0.0f;
+        osg::ref_ptr<osg::Group> serial = createCrowd(numCharacters, numBones, numRings, numSegments);
+        double serialTime = runBenchmark(serial.get(), numFrames, maxError);
+        std::cout << "  serial update   " << serialTime << " ms per frame, max difference from reference " << maxError << std::endl;
+
+        osg::ref_ptr<osgAnimation::ParallelSkinningCallback> parallelSkinning = new osgAnimation::ParallelSkinningCallback(numThreads>0 ? numThreads : 0);
+        osg::ref_ptr<osg::Group> parallel = createCrowd(numCharacters, numBones, numRings, numSegments);
+        parallel->addUpdateCallback(parallelSkinning.get());
+        double parallelTime = runBenchmark(parallel.get(), numFrames, maxError);
+        std::cout << "  parallel update " << parallelTime << " ms per frame with " << parallelSkinning->getNumThreads() << " threads, max difference from reference " << maxError << std::endl;
+
+        return 0;
+    }
+
+    osgViewer::Viewer viewer(arguments);
+    viewer.setCameraManipulator(new osgGA::TrackballManipulator());
+    viewer.addEventHandler(new osgViewer::StatsHandler);
+
+    osg::ref_ptr<osg::Group> scene = createCrowd(numCharacters, numBones, numRings, numSegments);
+    if (arguments.read("--lod"))
+    {
+        osg::ref_ptr<osgAnimation::SkeletonUpdatePolicy> policy = new osgAnimation::SkeletonUpdatePolicy;
+        policy->addLevel(200.0f, 1);
+        policy->addLevel(60.0f, 2, 2);
+        policy->addLevel(0.0f, 4, 1);
+        dynamic_cast<osgAnimation::AnimationManagerBase*>(scene->getUpdateCallback())->setSkeletonUpdatePolicy(policy.get());
+    }
+    if (numThreads>=0)
+    {
+        scene->addUpdateCallback(new osgAnimation::ParallelSkinningCallback(numThreads));
+    }
+
+    viewer.setSceneData(scene.get());
+    return viewer.run();
+}
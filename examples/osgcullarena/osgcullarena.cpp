@@ -0,0 +1,255 @@
+/* OpenSceneGraph example, osgcullarena.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+// Benchmark of the cull traversal of a scene made up of many drawables spread over many StateSets, reporting
+// the average cull time and the number of heap allocations made per frame. The StateGraphs and RenderLeaves
+// are allocated from the CullVisitor's StateGraphArena (see osgUtil::StateGraphArena) so once the first frame
+// has grown the arena the cull traversal should make no further allocations. Passing --heap-graph allocates
+// the StateGraphs on the heap instead and discards them at the end of each frame, for comparison. Afterwards it
+// checks that a drawable removed from the scene is no longer referenced by the arena once the next cull completes.
+//
+// No graphics context is required as only the cull traversal is run, i.e.
+//
+//     osgcullarena --drawables 20000 --statesets 500 --frames 200
+
+#include <osg/ArgumentParser>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Group>
+#include <osg/MatrixTransform>
+#include <osg/Material>
+#include <osg/Timer>
+#include <osg/Viewport>
+
+#include <osgUtil/CullVisitor>
+#include <osgUtil/RenderStage>
+#include <osgUtil/StateGraph>
+
+#include <iostream>
+#include <cstdlib>
+#include <new>
+
+static unsigned long s_numAllocations = 0;
+
+void* operator new(std::size_t size)
+{
+    ++s_numAllocations;
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) throw()
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) throw()
+{
+    std::free(ptr);
+}
+
+osg::Node* createScene(unsigned int numDrawables, unsigned int numStateSets)
+{
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    vertices->push_back(osg::Vec3(0.0f,0.0f,0.0f));
+    vertices->push_back(osg::Vec3(0.8f,0.0f,0.0f));
+    vertices->push_back(osg::Vec3(0.8f,0.0f,0.8f));
+    vertices->push_back(osg::Vec3(0.0f,0.0f,0.8f));
+    geometry->setVertexArray(vertices.get());
+    geometry->addPrimitiveSet(new osg::DrawArrays(GL_QUADS,0,4));
+
+    std::vector< osg::ref_ptr<osg::StateSet> > statesets;
+    for(unsigned int i=0; i<numStateSets; ++i)
+    {
+        osg::ref_ptr<osg::StateSet> stateset = new osg::StateSet;
+        osg::ref_ptr<osg::Material> material = new osg::Material;
+        material->setDiffuse(osg::Material::FRONT_AND_BACK, osg::Vec4(float(i%7)/7.0f, float(i%5)/5.0f, float(i%3)/3.0f, 1.0f));
+        stateset->setAttributeAndModes(material.get());
+        statesets.push_back(stateset);
+    }
+
+    osg::ref_ptr<osg::Group> root = new osg::Group;
+
+    unsigned int numColumns = static_cast<unsigned int>(sqrtf(float(numDrawables)))+1;
+    for(unsigned int i=0; i<numDrawables; ++i)
+    {
+        osg::ref_ptr<osg::MatrixTransform> transform = new osg::MatrixTransform;
+        transform->setMatrix(osg::Matrix::translate(float(i%numColumns), 0.0f, float(i/numColumns)));
+
+        osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+        geode->setStateSet(statesets[(i*7919)%numStateSets].get());
+        geode->addDrawable(geometry.get());
+
+        transform->addChild(geode.get());
+        root->addChild(transform.get());
+    }
+
+    return root.release();
+}
+
+struct CullContext
+{
+    osg::ref_ptr<osgUtil::CullVisitor>  cullVisitor;
+    osg::ref_ptr<osgUtil::StateGraph>   stateGraph;
+    osg::ref_ptr<osgUtil::RenderStage>  renderStage;
+    osg::ref_ptr<osg::Viewport>         viewport;
+    osg::ref_ptr<osg::RefMatrix>        projectionMatrix;
+    osg::ref_ptr<osg::RefMatrix>        viewMatrix;
+    bool                                heapGraph;
+};
+
+// Cull the scene the same way as osgUtil::SceneView::cullStage() does.
+void cullFrame(CullContext& context, osg::Node* scene)
+{
+    osgUtil::CullVisitor* cullVisitor = context.cullVisitor.get();
+
+    cullVisitor->reset();
+    cullVisitor->setStateGraph(context.stateGraph.get());
+    if (context.heapGraph) context.stateGraph->setArena(0);
+    cullVisitor->setRenderStage(context.renderStage.get());
+    context.renderStage->reset();
+    context.stateGraph->clean();
+
+    cullVisitor->pushViewport(context.viewport.get());
+    cullVisitor->pushProjectionMatrix(context.projectionMatrix.get());
+    cullVisitor->pushModelViewMatrix(context.viewMatrix.get(), osg::Transform::ABSOLUTE_RF);
+
+    scene->accept(*cullVisitor);
+
+    cullVisitor->popModelViewMatrix();
+    cullVisitor->popProjectionMatrix();
+    cullVisitor->popViewport();
+
+    context.renderStage->sort();
+    context.stateGraph->prune();
+    cullVisitor->getStateGraphArena()->releaseUnused();
+
+    if (context.heapGraph) context.stateGraph->reset();
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc,argv);
+
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" benchmarks the cull traversal and its allocations per frame.");
+    arguments.getApplicationUsage()->addCommandLineOption("--drawables <num>","Number of drawables in the scene.");
+    arguments.getApplicationUsage()->addCommandLineOption("--statesets <num>","Number of StateSets the drawables are spread over.");
+    arguments.getApplicationUsage()->addCommandLineOption("--frames <num>","Number of frames to cull.");
+    arguments.getApplicationUsage()->addCommandLineOption("--heap-graph","Allocate the StateGraphs on the heap and discard them at the end of every frame.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    unsigned int numDrawables = 20000;
+    unsigned int numStateSets = 500;
+    unsigned int numFrames = 200;
+    while(arguments.read("--drawables",numDrawables)) {}
+    while(arguments.read("--statesets",numStateSets)) {}
+    while(arguments.read("--frames",numFrames)) {}
+    bool heapGraph = arguments.read("--heap-graph");
+
+    if (numDrawables==0 || numStateSets==0 || numFrames==0)
+    {
+        std::cout<<"Nothing to do."<<std::endl;
+        return 1;
+    }
+
+    osg::ref_ptr<osg::Node> scene = createScene(numDrawables, numStateSets);
+
+    unsigned int numColumns = static_cast<unsigned int>(sqrtf(float(numDrawables)))+1;
+    osg::Vec3 centre(float(numColumns)*0.5f, 0.0f, float(numColumns)*0.5f);
+    osg::Matrix view = osg::Matrix::lookAt(centre+osg::Vec3(0.0f,-float(numColumns),0.0f), centre, osg::Vec3(0.0f,0.0f,1.0f));
+    osg::Matrix projection = osg::Matrix::perspective(60.0, 4.0/3.0, 1.0, float(numColumns)*4.0f);
+
+    CullContext context;
+    context.viewport = new osg::Viewport(0,0,1280,960);
+    context.cullVisitor = osgUtil::CullVisitor::create();
+    context.stateGraph = new osgUtil::StateGraph;
+    context.renderStage = new osgUtil::RenderStage;
+    context.renderStage->setViewport(context.viewport.get());
+    context.projectionMatrix = new osg::RefMatrix(projection);
+    context.viewMatrix = new osg::RefMatrix(view);
+    context.heapGraph = heapGraph;
+
+    double totalTime = 0.0;
+    unsigned long totalAllocations = 0;
+    unsigned int numFramesTimed = 0;
+
+    for(unsigned int frame=0; frame<numFrames; ++frame)
+    {
+        unsigned long startAllocations = s_numAllocations;
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+
+        cullFrame(context, scene.get());
+
+        osg::Timer_t endTick = osg::Timer::instance()->tick();
+
+        // skip the first frame as it populates the arena.
+        if (frame>0)
+        {
+            totalTime += osg::Timer::instance()->delta_m(startTick, endTick);
+            totalAllocations += s_numAllocations - startAllocations;
+            ++numFramesTimed;
+        }
+    }
+
+    const osgUtil::StateGraphArena* arena = context.cullVisitor->getStateGraphArena();
+
+    std::cout<<"Culled "<<numDrawables<<" drawables with "<<numStateSets<<" StateSets over "<<numFrames<<" frames."<<std::endl;
+    std::cout<<"  RenderLeaves in last frame   : "<<arena->getNumRenderLeavesUsed()<<std::endl;
+    std::cout<<"  StateGraphs in last frame    : "<<arena->getNumStateGraphsUsed()<<" ("<<arena->getNumStateGraphsAllocated()<<" allocated)"<<std::endl;
+    if (numFramesTimed>0)
+    {
+        std::cout<<"  Average cull time            : "<<totalTime/double(numFramesTimed)<<"ms"<<std::endl;
+        std::cout<<"  Average allocations per frame: "<<double(totalAllocations)/double(numFramesTimed)<<std::endl;
+    }
+
+    // check that once a drawable is removed from the scene the arena no longer references it after the next cull.
+    osg::ref_ptr<osg::Geometry> removed = new osg::Geometry;
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    vertices->push_back(centre);
+    vertices->push_back(centre+osg::Vec3(0.8f,0.0f,0.0f));
+    vertices->push_back(centre+osg::Vec3(0.8f,0.0f,0.8f));
+    vertices->push_back(centre+osg::Vec3(0.0f,0.0f,0.8f));
+    removed->setVertexArray(vertices.get());
+    removed->addPrimitiveSet(new osg::DrawArrays(GL_QUADS,0,4));
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->setStateSet(new osg::StateSet);
+    geode->addDrawable(removed.get());
+    scene->asGroup()->addChild(geode.get());
+    cullFrame(context, scene.get());
+
+    scene->asGroup()->removeChild(geode.get());
+    geode = 0;
+    cullFrame(context, scene.get());
+
+    if (removed->referenceCount()!=1)
+    {
+        std::cout<<"  Removed drawable is still referenced "<<removed->referenceCount()-1<<" times after the next cull."<<std::endl;
+        return 1;
+    }
+    std::cout<<"  Removed drawable released by the next cull."<<std::endl;
+
+    return 0;
+}
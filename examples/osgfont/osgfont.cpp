@@ -99,6 +99,7 @@ struct TextSettings
 
         if (arguments.read("--GREYSCALE")) { shaderTechnique = osgText::GREYSCALE; }
         if (arguments.read("--SIGNED_DISTANCE_FIELD")) { shaderTechnique = osgText::SIGNED_DISTANCE_FIELD; }
+        if (arguments.read("--MULTI_CHANNEL_SIGNED_DISTANCE_FIELD") || arguments.read("--MSDF")) { shaderTechnique = osgText::MULTI_CHANNEL_SIGNED_DISTANCE_FIELD; }
         if (arguments.read("--ALL_FEATURES")) { shaderTechnique = osgText::ALL_FEATURES; }
 
         if (arguments.read("--font",fontFilename)) {}
@@ -0,0 +1,218 @@
+/*  -*-c++-*-
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+// Times the update of a particle system by a ModularProgram applying an acceleration, fluid friction and damping,
+// with the particles stored as Particle objects, then in particle arrays with one and several threads, followed by
+// the depth sort of the particles and the filling of the instance data drawn by instanced billboards.
+
+#include <iostream>
+#include <sstream>
+#include <osg/ArgumentParser>
+#include <osg/FrameStamp>
+#include <osg/io_utils>
+#include <osg/NodeVisitor>
+#include <osg/Timer>
+#include <osg/Viewport>
+#include <OpenThreads/Thread>
+#include <osgParticle/AccelOperator>
+#include <osgParticle/DampingOperator>
+#include <osgParticle/FluidFrictionOperator>
+#include <osgParticle/ModularProgram>
+#include <osgParticle/ParticleSystem>
+#include <osgParticle/ParticleSystemUpdater>
+#include <osgUtil/CullVisitor>
+
+#include <algorithm>
+#include <vector>
+
+struct Timings
+{
+    double programTime;
+    double updateTime;
+    osg::Vec3d checksum;
+};
+
+Timings run(unsigned int numParticles, unsigned int numFrames, bool useParticleArrays, unsigned int numThreads)
+{
+    osg::ref_ptr<osgParticle::ParticleSystem> ps = new osgParticle::ParticleSystem;
+    ps->setUseParticleArrays(useParticleArrays);
+    ps->getDefaultParticleTemplate().setLifeTime(0.0);
+
+    // a deterministic spread of particles so that every run gives the same checksum
+    for(unsigned int i=0; i<numParticles; ++i)
+    {
+        osgParticle::Particle* particle = ps->createParticle(0);
+        float x = static_cast<float>(i % 1000);
+        float y = static_cast<float>((i / 1000) % 1000);
+        particle->setPosition(osg::Vec3(x, y, 0.0f));
+        particle->setVelocity(osg::Vec3(x*0.01f - 5.0f, y*0.01f - 5.0f, 10.0f + static_cast<float>(i % 7)));
+        particle->setRadius(0.05f + static_cast<float>(i % 5)*0.01f);
+    }
+
+    osg::ref_ptr<osgParticle::ModularProgram> program = new osgParticle::ModularProgram;
+    program->setParticleSystem(ps.get());
+    program->setReferenceFrame(osgParticle::ParticleProcessor::ABSOLUTE_RF);
+    program->setNumThreads(numThreads);
+
+    osg::ref_ptr<osgParticle::AccelOperator> accel = new osgParticle::AccelOperator;
+    accel->setToGravity();
+    program->addOperator(accel.get());
+
+    osg::ref_ptr<osgParticle::FluidFrictionOperator> friction = new osgParticle::FluidFrictionOperator;
+    friction->setFluidToAir();
+    friction->setWind(osg::Vec3(2.0f, 0.0f, 0.0f));
+    program->addOperator(friction.get());
+
+    osg::ref_ptr<osgParticle::DampingOperator> damping = new osgParticle::DampingOperator;
+    damping->setDamping(0.9f);
+    program->addOperator(damping.get());
+
+    osg::ref_ptr<osgParticle::ParticleSystemUpdater> updater = new osgParticle::ParticleSystemUpdater;
+    updater->addParticleSystem(ps.get());
+
+    osg::ref_ptr<osg::FrameStamp> frameStamp = new osg::FrameStamp;
+    osg::NodeVisitor nv(osg::NodeVisitor::CULL_VISITOR, osg::NodeVisitor::TRAVERSE_ALL_CHILDREN);
+    nv.setFrameStamp(frameStamp.get());
+
+    Timings timings = { 0.0, 0.0, osg::Vec3d() };
+    osg::Timer timer;
+
+    // the first frame only initializes the processors
+    for(unsigned int frame=0; frame<=numFrames; ++frame)
+    {
+        frameStamp->setFrameNumber(frame);
+        frameStamp->setSimulationTime(frame/60.0);
+
+        osg::Timer_t start = timer.tick();
+        program->accept(nv);
+        osg::Timer_t middle = timer.tick();
+        updater->accept(nv);
+        osg::Timer_t end = timer.tick();
+
+        if (frame>0)
+        {
+            timings.programTime += timer.delta_m(start, middle);
+            timings.updateTime += timer.delta_m(middle, end);
+        }
+    }
+
+    timings.programTime /= numFrames;
+    timings.updateTime /= numFrames;
+
+    for(int i=0; i<ps->numParticles(); ++i)
+    {
+        timings.checksum += osg::Vec3d(ps->getParticle(i)->getPosition());
+    }
+    timings.checksum /= static_cast<double>(numParticles);
+
+    return timings;
+}
+
+void runSort(unsigned int numParticles, unsigned int numFrames)
+{
+    osg::ref_ptr<osgParticle::ParticleSystem> ps = new osgParticle::ParticleSystem;
+    ps->setSortMode(osgParticle::ParticleSystem::SORT_BACK_TO_FRONT);
+    for(unsigned int i=0; i<numParticles; ++i)
+    {
+        osgParticle::Particle* particle = ps->createParticle(0);
+        particle->setPosition(osg::Vec3(static_cast<float>(i % 1000), static_cast<float>((i * 7919) % 1000), -static_cast<float>((i * 104729) % 1000)));
+    }
+
+    // the cull visitor only provides the model view matrix the depth is computed with
+    osg::ref_ptr<osgUtil::CullVisitor> cv = new osgUtil::CullVisitor;
+    osg::ref_ptr<osg::Viewport> viewport = new osg::Viewport(0, 0, 1024, 1024);
+    cv->pushViewport(viewport.get());
+    cv->pushProjectionMatrix(new osg::RefMatrix(osg::Matrix::perspective(45.0, 1.0, 1.0, 10000.0)));
+    cv->pushModelViewMatrix(new osg::RefMatrix(osg::Matrix::lookAt(osg::Vec3(500.0f, -1000.0f, 500.0f), osg::Vec3(500.0f, 500.0f, -500.0f), osg::Vec3(0.0f, 0.0f, 1.0f))), osg::Transform::ABSOLUTE_RF);
+
+    osg::ref_ptr<osg::Vec4Array> positionSizes = new osg::Vec4Array;
+    osg::ref_ptr<osg::Vec4ubArray> colors = new osg::Vec4ubArray;
+    osg::ref_ptr<osg::FloatArray> angles = new osg::FloatArray;
+
+    double sortTime = 0.0;
+    double fillTime = 0.0;
+    double particleSortTime = 0.0;
+    unsigned int numInstances = 0;
+    std::vector<osgParticle::Particle> particles;
+    osg::Timer timer;
+
+    for(unsigned int frame=0; frame<numFrames; ++frame)
+    {
+        osg::Timer_t start = timer.tick();
+        ps->update(0.0, *cv);
+        osg::Timer_t middle = timer.tick();
+        numInstances = ps->fillInstanceArrays(*positionSizes, *colors, *angles);
+        osg::Timer_t end = timer.tick();
+
+        sortTime += timer.delta_m(start, middle);
+        fillTime += timer.delta_m(middle, end);
+
+        // sorting the particles themselves on the depths just computed, as the particle system used to
+        particles.clear();
+        for(int i=0; i<ps->numParticles(); ++i) particles.push_back(*ps->getParticle(i));
+        start = timer.tick();
+        std::sort(particles.begin(), particles.end());
+        particleSortTime += timer.delta_m(start, timer.tick());
+    }
+
+    std::cout << "radix sort of particle indices: " << sortTime/numFrames << " ms per frame, "
+              << "sorting the particles: " << particleSortTime/numFrames << " ms" << std::endl;
+    std::cout << "instance data: " << fillTime/numFrames << " ms per frame, "
+              << numInstances * (sizeof(osg::Vec4) + sizeof(osg::Vec4ub) + sizeof(float)) << " bytes rather than "
+              << numInstances * 6 * (sizeof(osg::Vec3) + sizeof(osg::Vec4) + sizeof(osg::Vec2)) << " bytes of quads" << std::endl;
+}
+
+void report(const std::string& name, const Timings& timings)
+{
+    std::cout << name << ": program " << timings.programTime << " ms, update " << timings.updateTime
+              << " ms per frame, mean position " << timings.checksum << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" times the update of a particle system with and without particle arrays.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options]");
+    arguments.getApplicationUsage()->addCommandLineOption("-h or --help", "Display this information.");
+    arguments.getApplicationUsage()->addCommandLineOption("--particles <num>", "Number of particles, defaults to 1000000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--frames <num>", "Number of frames timed, defaults to 20.");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <num>", "Number of threads of the threaded run, defaults to one per processor.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout, osg::ApplicationUsage::COMMAND_LINE_OPTION);
+        return 1;
+    }
+
+    unsigned int numParticles = 1000000;
+    while (arguments.read("--particles", numParticles)) {}
+
+    unsigned int numFrames = 20;
+    while (arguments.read("--frames", numFrames)) {}
+    if (numFrames==0) numFrames = 1;
+
+    unsigned int numThreads = OpenThreads::GetNumberOfProcessors();
+    while (arguments.read("--threads", numThreads)) {}
+
+    report("particles", run(numParticles, numFrames, false, 1));
+    report("particle arrays", run(numParticles, numFrames, true, 1));
+
+    std::ostringstream name;
+    name << "particle arrays, " << numThreads << " threads";
+    report(name.str(), run(numParticles, numFrames, true, numThreads));
+
+    runSort(numParticles, numFrames);
+
+    return 0;
+}
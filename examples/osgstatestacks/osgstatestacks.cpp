@@ -0,0 +1,439 @@
+/* OpenSceneGraph example, osgstatestacks.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+// Benchmark of the draw traversal of a scene made up of many small drawables that each carry their own
+// modes, attributes and uniforms, so the cost is dominated by osg::State pushing, popping and applying
+// state. The scene is drawn with the map based state stacks and then with the flat state stacks
+// (see osg::State::setUseFlatStateStacks()) and the average draw traversal time of each reported.
+//
+// Runs offscreen via a pbuffer so can be used on headless machines with Mesa, i.e.
+//
+//     xvfb-run osgstatestacks --frames 500
+//
+// With --check-order it instead applies random stacks of StateSets to an osg::State with each kind of stack,
+// without a graphics context, and checks that their StateAttributes are applied in the same order.
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Group>
+#include <osg/MatrixTransform>
+#include <osg/Math>
+#include <osg/Material>
+#include <osg/PolygonMode>
+#include <osg/PolygonOffset>
+#include <osg/BlendFunc>
+#include <osg/LineWidth>
+#include <osg/Program>
+#include <osg/Uniform>
+#include <osg/Timer>
+
+#include <osgViewer/Viewer>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+static const char* vertexShaderSource =
+    "uniform vec4 tint;\n"
+    "uniform float scale;\n"
+    "varying vec4 color;\n"
+    "void main(void)\n"
+    "{\n"
+    "    color = tint * gl_Color;\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * vec4(gl_Vertex.xyz*scale, 1.0);\n"
+    "}\n";
+
+static const char* fragmentShaderSource =
+    "uniform float brightness;\n"
+    "varying vec4 color;\n"
+    "void main(void)\n"
+    "{\n"
+    "    gl_FragColor = color * brightness;\n"
+    "}\n";
+
+static const GLenum s_modes[] =
+{
+    GL_BLEND, GL_CULL_FACE, GL_LIGHTING, GL_POLYGON_OFFSET_FILL, GL_NORMALIZE,
+    GL_LIGHT1, GL_LIGHT2, GL_LIGHT3, GL_CLIP_PLANE0, GL_CLIP_PLANE1, GL_CLIP_PLANE2, GL_DITHER
+};
+
+static const unsigned int s_numModes = sizeof(s_modes)/sizeof(GLenum);
+
+osg::Geometry* createQuad()
+{
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    vertices->push_back(osg::Vec3(0.0f,0.0f,0.0f));
+    vertices->push_back(osg::Vec3(0.8f,0.0f,0.0f));
+    vertices->push_back(osg::Vec3(0.8f,0.0f,0.8f));
+    vertices->push_back(osg::Vec3(0.0f,0.0f,0.8f));
+    geometry->setVertexArray(vertices.get());
+
+    osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array(osg::Array::BIND_OVERALL);
+    colors->push_back(osg::Vec4(1.0f,1.0f,1.0f,1.0f));
+    geometry->setColorArray(colors.get());
+
+    geometry->addPrimitiveSet(new osg::DrawArrays(GL_QUADS,0,4));
+
+    return geometry.release();
+}
+
+osg::StateSet* createStateSet(unsigned int i, unsigned int numUniforms)
+{
+    osg::ref_ptr<osg::StateSet> stateset = new osg::StateSet;
+
+    // toggle a different combination of modes for each drawable.
+    for(unsigned int m=0; m<s_numModes; ++m)
+    {
+        stateset->setMode(s_modes[m], ((i>>(m%8))&1) ? osg::StateAttribute::ON : osg::StateAttribute::OFF);
+    }
+
+    osg::ref_ptr<osg::Material> material = new osg::Material;
+    material->setDiffuse(osg::Material::FRONT_AND_BACK, osg::Vec4(float(i%7)/7.0f, float(i%5)/5.0f, float(i%3)/3.0f, 1.0f));
+    stateset->setAttribute(material.get());
+
+    if (i%2) stateset->setAttribute(new osg::PolygonMode(osg::PolygonMode::FRONT_AND_BACK, osg::PolygonMode::LINE));
+    if (i%3) stateset->setAttribute(new osg::LineWidth(float(1+i%3)));
+    if (i%4) stateset->setAttribute(new osg::BlendFunc(osg::BlendFunc::SRC_ALPHA, osg::BlendFunc::ONE_MINUS_SRC_ALPHA));
+    if (i%5) stateset->setAttribute(new osg::PolygonOffset(1.0f, float(i%5)));
+
+    if (numUniforms>0) stateset->addUniform(new osg::Uniform("tint", osg::Vec4(float(i%11)/11.0f, 1.0f, 1.0f, 1.0f)));
+    if (numUniforms>1) stateset->addUniform(new osg::Uniform("scale", 1.0f-float(i%4)*0.1f));
+    if (numUniforms>2) stateset->addUniform(new osg::Uniform("brightness", 0.5f+float(i%2)*0.5f));
+    for(unsigned int u=3; u<numUniforms; ++u)
+    {
+        // extra uniforms that the program doesn't use, these still have to be pushed, popped and applied.
+        std::ostringstream name;
+        name<<"unused"<<u;
+        stateset->addUniform(new osg::Uniform(name.str().c_str(), float(i)));
+    }
+
+    return stateset.release();
+}
+
+osg::Node* createScene(unsigned int numDrawables, unsigned int numUniforms, bool useShaders)
+{
+    osg::ref_ptr<osg::Group> root = new osg::Group;
+
+    if (useShaders)
+    {
+        osg::ref_ptr<osg::Program> program = new osg::Program;
+        program->addShader(new osg::Shader(osg::Shader::VERTEX, vertexShaderSource));
+        program->addShader(new osg::Shader(osg::Shader::FRAGMENT, fragmentShaderSource));
+        root->getOrCreateStateSet()->setAttributeAndModes(program.get());
+        root->getOrCreateStateSet()->addUniform(new osg::Uniform("tint", osg::Vec4(1.0f,1.0f,1.0f,1.0f)));
+        root->getOrCreateStateSet()->addUniform(new osg::Uniform("scale", 1.0f));
+        root->getOrCreateStateSet()->addUniform(new osg::Uniform("brightness", 1.0f));
+    }
+
+    osg::ref_ptr<osg::Geometry> quad = createQuad();
+
+    unsigned int numColumns = static_cast<unsigned int>(sqrtf(float(numDrawables)))+1;
+
+    // group the drawables in rows so that the state of the rows is pushed and popped as well.
+    osg::ref_ptr<osg::Group> row;
+    for(unsigned int i=0; i<numDrawables; ++i)
+    {
+        if (i%numColumns==0)
+        {
+            row = new osg::Group;
+            row->getOrCreateStateSet()->setMode(GL_DEPTH_TEST, ((i/numColumns)%2) ? osg::StateAttribute::ON : osg::StateAttribute::OFF);
+            root->addChild(row.get());
+        }
+
+        osg::ref_ptr<osg::MatrixTransform> transform = new osg::MatrixTransform;
+        transform->setMatrix(osg::Matrix::translate(float(i%numColumns), 0.0f, float(i/numColumns)));
+
+        osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+        geode->addDrawable(quad.get());
+        geode->setStateSet(createStateSet(i, numUniforms));
+
+        transform->addChild(geode.get());
+        row->addChild(transform.get());
+    }
+
+    return root.release();
+}
+
+// StateAttribute of any type that records when it is applied in place of making OpenGL calls.
+class RecordingAttribute : public osg::StateAttribute
+{
+    public:
+
+        typedef std::vector<std::string> Log;
+
+        RecordingAttribute(Type type, unsigned int member, unsigned int id, Log* log):
+            _type(type), _member(member), _id(id), _log(log) {}
+
+        RecordingAttribute(const RecordingAttribute& rhs, const osg::CopyOp& copyop=osg::CopyOp::SHALLOW_COPY):
+            osg::StateAttribute(rhs, copyop), _type(rhs._type), _member(rhs._member), _id(rhs._id), _log(rhs._log) {}
+
+        virtual osg::Object* cloneType() const { return new RecordingAttribute(_type, _member, 0, _log); }
+        virtual osg::Object* clone(const osg::CopyOp& copyop) const { return new RecordingAttribute(*this, copyop); }
+        virtual bool isSameKindAs(const osg::Object* obj) const { return dynamic_cast<const RecordingAttribute*>(obj)!=0; }
+        virtual const char* libraryName() const { return "osgstatestacks"; }
+        virtual const char* className() const { return "RecordingAttribute"; }
+
+        virtual Type getType() const { return _type; }
+        virtual unsigned int getMember() const { return _member; }
+
+        virtual int compare(const osg::StateAttribute& sa) const
+        {
+            COMPARE_StateAttribute_Types(RecordingAttribute,sa)
+            COMPARE_StateAttribute_Parameter(_id)
+            return 0;
+        }
+
+        virtual void apply(osg::State&) const
+        {
+            std::ostringstream str;
+            str<<_type<<"/"<<_member<<"/"<<_id;
+            _log->push_back(str.str());
+        }
+
+    protected:
+
+        Type            _type;
+        unsigned int    _member;
+        unsigned int    _id;
+        Log*            _log;
+};
+
+// Apply the same random stacks of StateSets to a State with map based and with flat stacks, returning true
+// if the StateAttributes were applied in the same order.
+bool checkApplyOrder(unsigned int numApplies)
+{
+    RecordingAttribute::Log logs[2];
+    osg::ref_ptr<osg::State> states[2];
+    for(unsigned int i=0; i<2; ++i)
+    {
+        states[i] = new osg::State;
+        states[i]->setUseFlatStateStacks(i==1);
+    }
+
+    static const osg::StateAttribute::Type s_types[] =
+    {
+        osg::StateAttribute::PROGRAM, osg::StateAttribute::MATERIAL, osg::StateAttribute::BLENDFUNC,
+        osg::StateAttribute::POLYGONMODE, osg::StateAttribute::LINEWIDTH, osg::StateAttribute::DEPTH,
+        osg::StateAttribute::VIEWPORT, osg::StateAttribute::CLIPPLANE
+    };
+    const unsigned int numTypes = sizeof(s_types)/sizeof(osg::StateAttribute::Type);
+
+    // the State keeps pointers to the last StateAttributes applied, so all of the StateSets are kept until the end.
+    std::vector< osg::ref_ptr<osg::StateSet> > statesets[2];
+
+    unsigned int seed = 12345;
+    unsigned int nextId = 1;
+    for(unsigned int n=0; n<numApplies; ++n)
+    {
+        // a few StateSets pushed as the StateGraph would, and the StateSet of the leaf applied on top of them.
+        unsigned int numStateSets = 1 + n%4;
+        unsigned int first = statesets[0].size();
+        for(unsigned int s=0; s<numStateSets; ++s)
+        {
+            statesets[0].push_back(new osg::StateSet);
+            statesets[1].push_back(new osg::StateSet);
+            for(unsigned int t=0; t<numTypes; ++t)
+            {
+                seed = seed*1103515245u + 12345u;
+                if ((seed>>16)%3!=0) continue;
+
+                osg::StateAttribute::Type type = s_types[t];
+                unsigned int member = (type==osg::StateAttribute::CLIPPLANE) ? (seed>>20)%3 : 0;
+                unsigned int value = ((seed>>24)%4==0) ? osg::StateAttribute::OVERRIDE : osg::StateAttribute::ON;
+                for(unsigned int i=0; i<2; ++i)
+                {
+                    statesets[i].back()->setAttribute(new RecordingAttribute(type, member, nextId, &logs[i]), value);
+                }
+                ++nextId;
+            }
+        }
+
+        for(unsigned int i=0; i<2; ++i)
+        {
+            for(unsigned int s=0; s+1<numStateSets; ++s) states[i]->pushStateSet(statesets[i][first+s].get());
+            states[i]->apply(statesets[i].back().get());
+            for(unsigned int s=0; s+1<numStateSets; ++s) states[i]->popStateSet();
+            if (n%5==0) states[i]->apply();
+        }
+    }
+
+    if (logs[0]!=logs[1])
+    {
+        for(unsigned int i=0; i<logs[0].size() && i<logs[1].size(); ++i)
+        {
+            if (logs[0][i]!=logs[1][i])
+            {
+                std::cout<<"Apply order differs at call "<<i<<": map state stacks applied "<<logs[0][i]<<", flat state stacks "<<logs[1][i]<<std::endl;
+                break;
+            }
+        }
+        std::cout<<"map state stacks made "<<logs[0].size()<<" applies, flat state stacks "<<logs[1].size()<<std::endl;
+        return false;
+    }
+
+    std::cout<<"map and flat state stacks applied "<<logs[0].size()<<" StateAttributes in the same order."<<std::endl;
+    return true;
+}
+
+void setUseFlatStateStacks(osgViewer::Viewer& viewer, bool flag)
+{
+    osgViewer::Viewer::Contexts contexts;
+    viewer.getContexts(contexts);
+    for(osgViewer::Viewer::Contexts::iterator itr = contexts.begin();
+        itr != contexts.end();
+        ++itr)
+    {
+        (*itr)->getState()->setUseFlatStateStacks(flag);
+    }
+}
+
+double runFrames(osgViewer::Viewer& viewer, unsigned int numFrames, double& averageDrawTime)
+{
+    osg::Stats* stats = viewer.getCamera()->getStats();
+
+    double totalDrawTime = 0.0;
+    unsigned int numDrawTimes = 0;
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    for(unsigned int i=0; i<numFrames && !viewer.done(); ++i)
+    {
+        viewer.frame();
+
+        double drawTime = 0.0;
+        if (stats && stats->getAttribute(viewer.getFrameStamp()->getFrameNumber(), "Draw traversal time taken", drawTime))
+        {
+            totalDrawTime += drawTime;
+            ++numDrawTimes;
+        }
+    }
+    osg::Timer_t endTick = osg::Timer::instance()->tick();
+
+    averageDrawTime = numDrawTimes>0 ? totalDrawTime/double(numDrawTimes) : 0.0;
+
+    return osg::Timer::instance()->delta_s(startTick, endTick)/double(numFrames);
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" benchmarks the draw traversal with the map based and the flat osg::State stacks.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options]");
+    arguments.getApplicationUsage()->addCommandLineOption("--drawables <num>", "Number of drawables, each with its own StateSet. Default is 4000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--uniforms <num>", "Number of uniforms per StateSet. Default is 6.");
+    arguments.getApplicationUsage()->addCommandLineOption("--frames <num>", "Number of frames timed for each of the state stack modes. Default is 200.");
+    arguments.getApplicationUsage()->addCommandLineOption("--no-shaders", "Draw with fixed function, uniforms aren't applied without a Program.");
+    arguments.getApplicationUsage()->addCommandLineOption("--window", "Draw in a window rather than a pbuffer.");
+    arguments.getApplicationUsage()->addCommandLineOption("--check-order", "Check that both kinds of stacks apply StateAttributes in the same order, without drawing.");
+    arguments.getApplicationUsage()->addCommandLineOption("-h or --help", "Display this information.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    if (arguments.read("--check-order"))
+    {
+        return checkApplyOrder(2000) ? 0 : 1;
+    }
+
+    unsigned int numDrawables = 4000;
+    while(arguments.read("--drawables", numDrawables)) {}
+
+    unsigned int numUniforms = 6;
+    while(arguments.read("--uniforms", numUniforms)) {}
+
+    unsigned int numFrames = 200;
+    while(arguments.read("--frames", numFrames)) {}
+    if (numFrames==0) numFrames = 1;
+
+    bool useShaders = !arguments.read("--no-shaders");
+    bool usePBuffer = !arguments.read("--window");
+
+    osgViewer::Viewer viewer(arguments);
+    viewer.setThreadingModel(osgViewer::Viewer::SingleThreaded);
+    viewer.setSceneData(createScene(numDrawables, numUniforms, useShaders));
+
+    if (usePBuffer)
+    {
+        osg::ref_ptr<osg::GraphicsContext::Traits> traits = new osg::GraphicsContext::Traits;
+        traits->width = 512;
+        traits->height = 512;
+        traits->pbuffer = true;
+        traits->readDISPLAY();
+        traits->setUndefinedScreenDetailsToDefaultScreen();
+
+        osg::ref_ptr<osg::GraphicsContext> pbuffer = osg::GraphicsContext::createGraphicsContext(traits.get());
+        if (!pbuffer.valid())
+        {
+            std::cout<<"Unable to create pbuffer, try --window."<<std::endl;
+            return 1;
+        }
+
+        viewer.getCamera()->setGraphicsContext(pbuffer.get());
+        viewer.getCamera()->setViewport(new osg::Viewport(0,0,traits->width,traits->height));
+        GLenum buffer = pbuffer->getTraits()->doubleBuffer ? GL_BACK : GL_FRONT;
+        viewer.getCamera()->setDrawBuffer(buffer);
+        viewer.getCamera()->setReadBuffer(buffer);
+    }
+    else
+    {
+        viewer.setUpViewInWindow(0, 0, 512, 512);
+    }
+
+    viewer.getCamera()->getStats()->collectStats("rendering", true);
+    viewer.realize();
+
+    if (!viewer.isRealized())
+    {
+        std::cout<<"Unable to realize viewer."<<std::endl;
+        return 1;
+    }
+
+    // compile the scene and settle the caches before timing.
+    unsigned int numWarmUpFrames = 10;
+
+    std::cout<<"Drawing "<<numDrawables<<" drawables with "<<numUniforms<<" uniforms each, "<<numFrames<<" frames per mode."<<std::endl;
+
+    double drawTime[2];
+    double frameTime[2];
+    for(unsigned int pass=0; pass<2; ++pass)
+    {
+        bool flat = (pass==1);
+        setUseFlatStateStacks(viewer, flat);
+
+        double warmUpDrawTime;
+        runFrames(viewer, numWarmUpFrames, warmUpDrawTime);
+
+        frameTime[pass] = runFrames(viewer, numFrames, drawTime[pass]);
+
+        std::cout<<(flat ? "flat state stacks : " : "map state stacks  : ")
+                 <<"draw "<<drawTime[pass]*1000.0<<"ms, frame "<<frameTime[pass]*1000.0<<"ms"<<std::endl;
+    }
+
+    if (drawTime[1]>0.0)
+    {
+        std::cout<<"draw traversal speed up "<<drawTime[0]/drawTime[1]<<"x"<<std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,352 @@
+/* OpenSceneGraph example, osgtextbatch.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+// Draws thousands of labels with an osgText::TextBatch and changes a few of them every frame, the way map labels
+// showing counters and IDs do, so that the batch's update copies only the changed labels into its vertex pool.
+// Each frame a few labels have one digit of their counter changed, which rewrites just their texture coordinates,
+// a few have a character appended or removed, which changes their number of glyphs so the batch lays its pool out
+// again, and a few are recolored. One label in three is drawn with a per character color gradient rather than
+// a solid color. The mutations and batch updates are timed, and afterwards the incrementally updated batch is
+// checked against a batch built from scratch with the same labels.
+//
+// No graphics context is required unless --viewer is passed, in which case the labels are shown while they
+// are being changed, i.e.
+//
+//     osgtextbatch --labels 5000 --changes 20 --frames 200
+//     osgtextbatch --labels 5000 --viewer
+
+#include <osg/ArgumentParser>
+#include <osg/Geode>
+#include <osg/NodeCallback>
+#include <osg/Timer>
+
+#include <osgText/TextBatch>
+
+#include <osgViewer/Viewer>
+#include <osgViewer/ViewerEventHandlers>
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+
+struct Label
+{
+    Label(): counter(0), suffix(false), gradient(false), colorIndex(0) {}
+
+    osg::ref_ptr<osgText::Text> text;
+    unsigned int                counter;
+    bool                        suffix;
+    bool                        gradient;
+    unsigned int                colorIndex;
+};
+
+typedef std::vector<Label> Labels;
+
+static const osg::Vec4 s_colors[] =
+{
+    osg::Vec4(1.0f,1.0f,1.0f,1.0f),
+    osg::Vec4(1.0f,1.0f,0.0f,1.0f),
+    osg::Vec4(0.0f,1.0f,1.0f,1.0f),
+    osg::Vec4(1.0f,0.5f,0.5f,1.0f)
+};
+static const unsigned int s_numColors = sizeof(s_colors)/sizeof(s_colors[0]);
+
+std::string labelString(unsigned int i, const Label& label)
+{
+    std::ostringstream str;
+    str<<"ID"<<std::setw(5)<<std::setfill('0')<<i<<" "<<std::setw(4)<<label.counter;
+    if (label.suffix) str<<"!";
+    return str.str();
+}
+
+void setLabelColor(Label& label)
+{
+    const osg::Vec4& color = s_colors[label.colorIndex%s_numColors];
+    if (label.gradient)
+    {
+        const osg::Vec4& next = s_colors[(label.colorIndex+1)%s_numColors];
+        label.text->setColorGradientCorners(color, next, next, color);
+    }
+    else
+    {
+        label.text->setColor(color);
+    }
+}
+
+void createLabels(Labels& labels, unsigned int numLabels, osgText::TextBatch* batch)
+{
+    unsigned int numColumns = static_cast<unsigned int>(sqrtf(float(numLabels)*0.1f))+1;
+
+    labels.resize(numLabels);
+    for(unsigned int i=0; i<numLabels; ++i)
+    {
+        Label& label = labels[i];
+        label.counter = (i*7919)%10000;
+        label.gradient = (i%3)==0;
+        label.colorIndex = i;
+
+        label.text = new osgText::Text;
+        label.text->setCharacterSize(1.0f);
+        label.text->setPosition(osg::Vec3(float(i%numColumns)*10.0f, float(i/numColumns)*1.5f, 0.0f));
+        if (label.gradient) label.text->setColorGradientMode(osgText::Text::PER_CHARACTER);
+        setLabelColor(label);
+        label.text->setText(labelString(i, label));
+
+        batch->addText(label.text.get());
+    }
+}
+
+struct ChangeCounts
+{
+    ChangeCounts(): numDigitChanges(0), numLengthChanges(0), numColorChanges(0) {}
+
+    unsigned int numDigitChanges;
+    unsigned int numLengthChanges;
+    unsigned int numColorChanges;
+};
+
+// Change numChanges labels picked deterministically from the frame number, cycling through the kinds of change.
+void changeLabels(Labels& labels, unsigned int numChanges, unsigned int frameNumber, ChangeCounts& counts)
+{
+    for(unsigned int c=0; c<numChanges; ++c)
+    {
+        unsigned int i = ((frameNumber*numChanges+c)*7919)%labels.size();
+        Label& label = labels[i];
+
+        switch((frameNumber+c)%3)
+        {
+            case(0):
+                label.counter = (label.counter+1)%10000;
+                label.text->setText(labelString(i, label));
+                ++counts.numDigitChanges;
+                break;
+            case(1):
+                label.suffix = !label.suffix;
+                label.text->setText(labelString(i, label));
+                ++counts.numLengthChanges;
+                break;
+            default:
+                ++label.colorIndex;
+                setLabelColor(label);
+                ++counts.numColorChanges;
+                break;
+        }
+    }
+}
+
+class ChangeLabelsCallback : public osg::NodeCallback
+{
+public:
+
+    ChangeLabelsCallback(Labels& labels, unsigned int numChanges): _labels(labels), _numChanges(numChanges) {}
+
+    virtual void operator()(osg::Node* node, osg::NodeVisitor* nv)
+    {
+        // change the labels before the batch's own update callback is called while traversing the Geode
+        unsigned int frameNumber = nv->getFrameStamp() ? nv->getFrameStamp()->getFrameNumber() : 0;
+        changeLabels(_labels, _numChanges, frameNumber, _counts);
+
+        traverse(node, nv);
+    }
+
+protected:
+
+    Labels&         _labels;
+    unsigned int    _numChanges;
+    ChangeCounts    _counts;
+};
+
+struct CollectArrays : public osg::Drawable::ConstAttributeFunctor
+{
+    virtual void apply(osg::Drawable::AttributeType type, unsigned int size, const osg::Vec3* front)
+    {
+        if (type==osg::Drawable::VERTICES) vertices.assign(front, front+size);
+    }
+
+    virtual void apply(osg::Drawable::AttributeType type, unsigned int size, const osg::Vec2* front)
+    {
+        if (type==osg::Drawable::TEXTURE_COORDS_0) texcoords.assign(front, front+size);
+    }
+
+    virtual void apply(osg::Drawable::AttributeType type, unsigned int size, const osg::Vec4* front)
+    {
+        if (type==osg::Drawable::COLORS) colors.assign(front, front+size);
+    }
+
+    std::vector<osg::Vec3> vertices;
+    std::vector<osg::Vec2> texcoords;
+    std::vector<osg::Vec4> colors;
+};
+
+// Check that the batch holds the same vertex pool and triangles as a batch built from scratch with its labels.
+bool checkBatch(osgText::TextBatch* batch)
+{
+    osg::ref_ptr<osgText::TextBatch> reference = new osgText::TextBatch;
+    for(unsigned int i=0; i<batch->getNumTexts(); ++i)
+    {
+        reference->addText(batch->getText(i));
+    }
+    reference->update();
+
+    CollectArrays arrays, referenceArrays;
+    batch->accept(arrays);
+    reference->accept(referenceArrays);
+
+    bool matches = true;
+    if (arrays.vertices!=referenceArrays.vertices)
+    {
+        std::cout<<"  Vertices differ from a batch built from scratch."<<std::endl;
+        matches = false;
+    }
+    if (arrays.texcoords!=referenceArrays.texcoords)
+    {
+        std::cout<<"  Texture coordinates differ from a batch built from scratch."<<std::endl;
+        matches = false;
+    }
+    if (arrays.colors!=referenceArrays.colors)
+    {
+        std::cout<<"  Colors differ from a batch built from scratch."<<std::endl;
+        matches = false;
+    }
+
+    const osgText::TextBatch::TexturePrimitivesMap& primitives = batch->getTexturePrimitivesMap();
+    const osgText::TextBatch::TexturePrimitivesMap& referencePrimitives = reference->getTexturePrimitivesMap();
+    bool primitivesMatch = primitives.size()==referencePrimitives.size();
+    for(osgText::TextBatch::TexturePrimitivesMap::const_iterator itr = primitives.begin();
+        itr != primitives.end() && primitivesMatch;
+        ++itr)
+    {
+        osgText::TextBatch::TexturePrimitivesMap::const_iterator ritr = referencePrimitives.find(itr->first);
+        primitivesMatch = ritr!=referencePrimitives.end() && static_cast<const osg::VectorGLuint&>(*itr->second)==static_cast<const osg::VectorGLuint&>(*ritr->second);
+    }
+    if (!primitivesMatch)
+    {
+        std::cout<<"  Triangles differ from a batch built from scratch."<<std::endl;
+        matches = false;
+    }
+
+    // the labels are drawn by the batch, so release them before the reference batch goes
+    reference->removeAllText();
+
+    return matches;
+}
+
+unsigned int numTriangles(const osgText::TextBatch* batch)
+{
+    unsigned int numIndices = 0;
+    const osgText::TextBatch::TexturePrimitivesMap& primitives = batch->getTexturePrimitivesMap();
+    for(osgText::TextBatch::TexturePrimitivesMap::const_iterator itr = primitives.begin();
+        itr != primitives.end();
+        ++itr)
+    {
+        numIndices += itr->second->getNumIndices();
+    }
+    return numIndices/3;
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc,argv);
+
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" draws many labels with a TextBatch, changing a few of them every frame.");
+    arguments.getApplicationUsage()->addCommandLineOption("--labels <num>","Number of labels in the batch.");
+    arguments.getApplicationUsage()->addCommandLineOption("--changes <num>","Number of labels changed per frame.");
+    arguments.getApplicationUsage()->addCommandLineOption("--frames <num>","Number of frames to time.");
+    arguments.getApplicationUsage()->addCommandLineOption("--viewer","Show the labels in a viewer rather than timing the updates.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    unsigned int numLabels = 5000;
+    unsigned int numChanges = 20;
+    unsigned int numFrames = 200;
+    while(arguments.read("--labels",numLabels)) {}
+    while(arguments.read("--changes",numChanges)) {}
+    while(arguments.read("--frames",numFrames)) {}
+    bool useViewer = arguments.read("--viewer");
+
+    if (numLabels==0)
+    {
+        std::cout<<"Nothing to do."<<std::endl;
+        return 1;
+    }
+
+    osg::ref_ptr<osgText::TextBatch> batch = new osgText::TextBatch;
+    Labels labels;
+    createLabels(labels, numLabels, batch.get());
+    batch->update();
+
+    if (useViewer)
+    {
+        osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+        geode->addDrawable(batch.get());
+        geode->setUpdateCallback(new ChangeLabelsCallback(labels, numChanges));
+
+        osgViewer::Viewer viewer(arguments);
+        viewer.addEventHandler(new osgViewer::StatsHandler);
+        viewer.setSceneData(geode.get());
+        return viewer.run();
+    }
+
+    ChangeCounts counts;
+    unsigned int numRelayouts = 0;
+    double changeTime = 0.0;
+    double updateTime = 0.0;
+
+    for(unsigned int frame=0; frame<numFrames; ++frame)
+    {
+        unsigned int numVertices = batch->getNumVertices();
+
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+
+        changeLabels(labels, numChanges, frame, counts);
+
+        osg::Timer_t changedTick = osg::Timer::instance()->tick();
+
+        batch->update();
+
+        osg::Timer_t endTick = osg::Timer::instance()->tick();
+
+        changeTime += osg::Timer::instance()->delta_m(startTick, changedTick);
+        updateTime += osg::Timer::instance()->delta_m(changedTick, endTick);
+        if (batch->getNumVertices()!=numVertices) ++numRelayouts;
+    }
+
+    std::cout<<"Changed "<<numChanges<<" of "<<numLabels<<" labels per frame over "<<numFrames<<" frames."<<std::endl;
+    std::cout<<"  Digit changes                : "<<counts.numDigitChanges<<std::endl;
+    std::cout<<"  Length changes               : "<<counts.numLengthChanges<<" (pool resized in "<<numRelayouts<<" frames)"<<std::endl;
+    std::cout<<"  Color changes                : "<<counts.numColorChanges<<std::endl;
+    std::cout<<"  Vertices in pool             : "<<batch->getNumVertices()<<std::endl;
+    std::cout<<"  Draw calls                   : "<<batch->getTexturePrimitivesMap().size()<<std::endl;
+    std::cout<<"  Triangles                    : "<<numTriangles(batch.get())<<std::endl;
+    if (numFrames>0)
+    {
+        std::cout<<"  Average label change time    : "<<changeTime/double(numFrames)<<"ms"<<std::endl;
+        std::cout<<"  Average batch update time    : "<<updateTime/double(numFrames)<<"ms"<<std::endl;
+    }
+
+    if (!checkBatch(batch.get())) return 1;
+
+    std::cout<<"  Batch matches one built from scratch."<<std::endl;
+
+    return 0;
+}
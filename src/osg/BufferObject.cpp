@@ -25,6 +25,7 @@
 #include <osg/PrimitiveSet>
 #include <osg/Array>
 #include <osg/ContextData>
+#include <osg/ApplicationUsage>
 
 #include <OpenThreads/ScopedLock>
 #include <OpenThreads/Mutex>
@@ -46,11 +47,49 @@ unsigned int GLBufferObject::BufferEntry::getNumClients() const
     return dataSource->getNumClients();
 }
 
+namespace
+{
+    const unsigned int NUM_STREAMING_SEGMENTS = 3;
+    const unsigned int STREAMING_SEGMENT_ALIGNMENT = 256;
+
+    bool supportsStreamingRing(const GLExtensions* extensions)
+    {
+        return extensions->glBufferStorage && extensions->glMapBufferRange && extensions->glUnmapBuffer &&
+               extensions->glFenceSync && extensions->glClientWaitSync && extensions->glDeleteSync;
+    }
+
+    unsigned int computeStreamingRingSize(const BufferObject* bufferObject)
+    {
+        unsigned int size = 0;
+        for(unsigned int i=0; i<bufferObject->getNumBufferData(); ++i)
+        {
+            const BufferData* bd = bufferObject->getBufferData(i);
+            size += osg::computeBufferAlignment(bd ? bd->getTotalDataSize() : 0, STREAMING_SEGMENT_ALIGNMENT)*NUM_STREAMING_SEGMENTS;
+        }
+        return size;
+    }
+
+    bool requiresStreaming(const BufferObject* bufferObject)
+    {
+        if (bufferObject->getStreaming()) return true;
+        if (!BufferObject::getStreamDynamicData()) return false;
+        if (bufferObject->getDataVariance()==osg::Object::DYNAMIC) return true;
+
+        for(unsigned int i=0; i<bufferObject->getNumBufferData(); ++i)
+        {
+            const BufferData* bd = bufferObject->getBufferData(i);
+            if (bd && bd->getDataVariance()==osg::Object::DYNAMIC) return true;
+        }
+        return false;
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 // GLBufferObject
 //
 GLBufferObject::GLBufferObject(unsigned int contextID, BufferObject* bufferObject, unsigned int glObjectID):
+    _streamingRingFailed(false),
     _contextID(contextID),
     _glObjectID(glObjectID),
     _profile(0,0,0),
@@ -99,6 +138,7 @@ void GLBufferObject::assign(BufferObject* bufferObject)
         _profile = bufferObject->getProfile();
 
         _dirty = true;
+        _streamingRingFailed = false;
 
         _bufferEntries.clear();
     }
@@ -119,6 +159,14 @@ void GLBufferObject::clear()
 
 void GLBufferObject::compileBuffer()
 {
+    if (_profile._streaming && !_streamingRingFailed && supportsStreamingRing(_extensions))
+    {
+        compileStreamingBuffer();
+        return;
+    }
+
+    if (_streamingRing.valid()) releaseStreamingRing();
+
     _dirty = false;
 
     _bufferEntries.reserve(_bufferObject->getNumBufferData());
@@ -207,8 +255,9 @@ void GLBufferObject::compileBuffer()
 
     }
 
-    if (_allocatedSize != _profile._size)
+    if (_allocatedSize != _profile._size || _profile._streaming)
     {
+        // streamed buffers are orphaned on every update so the driver needn't wait for the GPU to finish with the previous contents.
         _allocatedSize = _profile._size;
         OSG_INFO<<"    Allocating new glBufferData(), _allocatedSize="<<_allocatedSize<<std::endl;
         _extensions->glBufferData(_profile._target, _profile._size, NULL, _profile._usage);
@@ -244,9 +293,266 @@ void GLBufferObject::compileBuffer()
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// GLBufferObject streaming ring
+//
+#ifndef GL_MAP_PERSISTENT_BIT
+    #define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+
+#ifndef GL_MAP_COHERENT_BIT
+    #define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+namespace
+{
+    // fence inserted after the draws that read a segment, shared by all the BufferData vacating their segments in the same update.
+    class StreamingFence : public osg::Referenced
+    {
+        public:
+            StreamingFence(GLExtensions* extensions):
+                _extensions(extensions),
+                _sync(extensions->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)) {}
+
+            void wait()
+            {
+                if (!_sync) return;
+
+                GLenum result = _extensions->glClientWaitSync(_sync, 0, 0);
+                while(result==GL_TIMEOUT_EXPIRED)
+                {
+                    result = _extensions->glClientWaitSync(_sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+                }
+
+                _extensions->glDeleteSync(_sync);
+                _sync = 0;
+            }
+
+        protected:
+
+            virtual ~StreamingFence()
+            {
+                if (_sync) _extensions->glDeleteSync(_sync);
+            }
+
+            GLExtensions*   _extensions;
+            GLsync          _sync;
+    };
+}
+
+struct GLBufferObject::StreamingRing : public osg::Referenced
+{
+    struct Entry
+    {
+        Entry(): base(0), segmentSize(0), segment(0), written(false) {}
+
+        unsigned int                base;
+        unsigned int                segmentSize;
+        unsigned int                segment;
+        bool                        written;
+        ref_ptr<StreamingFence>     fences[NUM_STREAMING_SEGMENTS];
+    };
+
+    StreamingRing(): mappedData(0), storageAllocated(false) {}
+
+    std::vector<Entry>  entries;
+    unsigned char*      mappedData;
+    bool                storageAllocated;
+};
+
+void GLBufferObject::releaseStreamingRing()
+{
+    if (!_streamingRing) return;
+
+    if (_streamingRing->storageAllocated && _glObjectID!=0)
+    {
+        if (_streamingRing->mappedData)
+        {
+            _extensions->glBindBuffer(_profile._target, _glObjectID);
+            _extensions->glUnmapBuffer(_profile._target);
+            _extensions->glBindBuffer(_profile._target, 0);
+        }
+
+        // buffer storage is immutable, even when mapping it failed, so replace it with a new buffer for future use.
+        _extensions->glDeleteBuffers(1, &_glObjectID);
+        _extensions->glGenBuffers(1, &_glObjectID);
+    }
+
+    _streamingRing = 0;
+    _allocatedSize = 0;
+    _bufferEntries.clear();
+}
+
+void GLBufferObject::compileStreamingBuffer()
+{
+    if (!_streamingRing) _streamingRing = new StreamingRing;
+    StreamingRing& ring = *_streamingRing;
+
+    // lay out NUM_STREAMING_SEGMENTS segments for each BufferData, so that only modified BufferData move to new segments.
+    unsigned int numBufferData = _bufferObject->getNumBufferData();
+    bool layoutChanged = (numBufferData!=_bufferEntries.size());
+    for(unsigned int i=0; i<numBufferData && !layoutChanged; ++i)
+    {
+        BufferData* bd = _bufferObject->getBufferData(i);
+        layoutChanged = (_bufferEntries[i].dataSource!=bd || _bufferEntries[i].dataSize!=(bd ? bd->getTotalDataSize() : 0));
+    }
+
+    if (layoutChanged)
+    {
+        _bufferEntries.resize(numBufferData);
+        ring.entries.resize(numBufferData);
+
+        unsigned int totalSize = 0;
+        for(unsigned int i=0; i<numBufferData; ++i)
+        {
+            BufferData* bd = _bufferObject->getBufferData(i);
+            BufferEntry& entry = _bufferEntries[i];
+            entry.numRead = 0;
+            entry.modifiedCount = 0xffffff;
+            entry.dataSource = bd;
+            entry.dataSize = bd ? bd->getTotalDataSize() : 0;
+
+            StreamingRing::Entry& ringEntry = ring.entries[i];
+            ringEntry.base = totalSize;
+            ringEntry.segmentSize = osg::computeBufferAlignment(entry.dataSize, STREAMING_SEGMENT_ALIGNMENT);
+            ringEntry.segment = 0;
+            ringEntry.written = false;
+            entry.offset = ringEntry.base;
+
+            totalSize += ringEntry.segmentSize*NUM_STREAMING_SEGMENTS;
+        }
+
+        if (totalSize > _profile._size)
+        {
+            unsigned int sizeDifference = totalSize - _profile._size;
+            _profile._size = totalSize;
+
+            if (_set)
+            {
+                _set->moveToSet(this, _set->getParent()->getGLBufferObjectSet(_profile));
+                _set->getParent()->getCurrGLBufferObjectPoolSize() += sizeDifference;
+            }
+        }
+    }
+
+    if (layoutChanged || _allocatedSize!=_profile._size || !ring.mappedData)
+    {
+        if (ring.mappedData)
+        {
+            // buffer storage is immutable so the new layout goes into a new buffer, GL deletes the old one once the GPU is done with it.
+            _extensions->glBindBuffer(_profile._target, _glObjectID);
+            _extensions->glUnmapBuffer(_profile._target);
+            _extensions->glBindBuffer(_profile._target, 0);
+            _extensions->glDeleteBuffers(1, &_glObjectID);
+            _extensions->glGenBuffers(1, &_glObjectID);
+            ring.mappedData = 0;
+            ring.storageAllocated = false;
+
+            // arrays already dispatched still point into the old buffer, bump their modified counts so that VertexArrayState dispatches them again.
+            for(BufferEntries::iterator itr = _bufferEntries.begin(); itr != _bufferEntries.end(); ++itr)
+            {
+                if (itr->dataSource) itr->dataSource->setModifiedCount(itr->dataSource->getModifiedCount()+1);
+            }
+        }
+
+        for(std::vector<StreamingRing::Entry>::iterator itr = ring.entries.begin();
+            itr != ring.entries.end();
+            ++itr)
+        {
+            for(unsigned int s=0; s<NUM_STREAMING_SEGMENTS; ++s) itr->fences[s] = 0;
+            itr->written = false;
+        }
+
+        _allocatedSize = _profile._size;
+
+        _extensions->glBindBuffer(_profile._target, _glObjectID);
+        _extensions->debugObjectLabel(GL_BUFFER, _glObjectID, _bufferObject->getName());
+
+        if (_allocatedSize==0)
+        {
+            _dirty = false;
+            return;
+        }
+
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        _extensions->glBufferStorage(_profile._target, _allocatedSize, NULL, flags);
+        ring.storageAllocated = true;
+        ring.mappedData = static_cast<unsigned char*>(_extensions->glMapBufferRange(_profile._target, 0, _allocatedSize, flags));
+
+        if (!ring.mappedData)
+        {
+            OSG_NOTICE<<"Warning: GLBufferObject::compileStreamingBuffer() unable to map buffer storage, falling back to glBufferData."<<std::endl;
+            _streamingRingFailed = true;
+            _extensions->glBindBuffer(_profile._target, 0);
+            releaseStreamingRing();
+            compileBuffer();
+            return;
+        }
+
+        for(BufferEntries::iterator itr = _bufferEntries.begin(); itr != _bufferEntries.end(); ++itr) itr->modifiedCount = 0xffffff;
+    }
+    else
+    {
+        _extensions->glBindBuffer(_profile._target, _glObjectID);
+    }
+
+    osg::ref_ptr<StreamingFence> fence;
+    for(unsigned int i=0; i<_bufferEntries.size(); ++i)
+    {
+        BufferEntry& entry = _bufferEntries[i];
+        if (!entry.dataSource || entry.modifiedCount==entry.dataSource->getModifiedCount()) continue;
+
+        StreamingRing::Entry& ringEntry = ring.entries[i];
+        if (ringEntry.written)
+        {
+            // fence the segment the previous draws read from, and move on to the next, waiting if the GPU is still reading it.
+            if (!fence) fence = new StreamingFence(_extensions);
+            ringEntry.fences[ringEntry.segment] = fence;
+
+            ringEntry.segment = (ringEntry.segment+1)%NUM_STREAMING_SEGMENTS;
+            if (ringEntry.fences[ringEntry.segment].valid())
+            {
+                ringEntry.fences[ringEntry.segment]->wait();
+                ringEntry.fences[ringEntry.segment] = 0;
+            }
+        }
+
+        entry.numRead = 0;
+        entry.modifiedCount = entry.dataSource->getModifiedCount();
+        entry.offset = ringEntry.base + ringEntry.segment*ringEntry.segmentSize;
+        ringEntry.written = true;
+
+        unsigned char* destination = ring.mappedData + entry.offset;
+        const osg::Image* image = entry.dataSource->asImage();
+        if (image && !(image->isDataContiguous()))
+        {
+            for(osg::Image::DataIterator img_itr(image); img_itr.valid(); ++img_itr)
+            {
+                memcpy(destination, img_itr.data(), img_itr.size());
+                destination += img_itr.size();
+            }
+        }
+        else if (entry.dataSize>0)
+        {
+            memcpy(destination, entry.dataSource->getDataPointer(), entry.dataSize);
+        }
+    }
+
+    _dirty = false;
+}
+
 void GLBufferObject::deleteGLObject()
 {
     OSG_DEBUG<<"GLBufferObject::deleteGLObject() "<<_glObjectID<<std::endl;
+    if (_streamingRing.valid() && _streamingRing->mappedData && _glObjectID!=0)
+    {
+        _extensions->glBindBuffer(_profile._target, _glObjectID);
+        _extensions->glUnmapBuffer(_profile._target);
+        _extensions->glBindBuffer(_profile._target, 0);
+    }
+    _streamingRing = 0;
+
     if (_glObjectID!=0)
     {
         _extensions->glDeleteBuffers(1, &_glObjectID);
@@ -906,7 +1212,14 @@ osg::ref_ptr<GLBufferObject> GLBufferObjectManager::generateGLBufferObject(const
 
     unsigned int requiredBufferSize = osg::maximum(bufferObject->computeRequiredBufferSize(), bufferObject->getProfile()._size);
 
-    BufferObjectProfile profile(bufferObject->getTarget(), bufferObject->getUsage(), requiredBufferSize);
+    // streaming is decided once here so that the profile, and with it the GLBufferObjectSet, stays fixed for the GLBufferObject's lifetime.
+    bool streaming = requiresStreaming(bufferObject);
+    if (streaming && supportsStreamingRing(GLExtensions::Get(_contextID, true)))
+    {
+        requiredBufferSize = osg::maximum(computeStreamingRingSize(bufferObject), requiredBufferSize);
+    }
+
+    BufferObjectProfile profile(bufferObject->getTarget(), bufferObject->getUsage(), requiredBufferSize, streaming);
 
     // OSG_NOTICE<<"GLBufferObjectManager::generateGLBufferObject size="<<requiredBufferSize<<std::endl;
 
@@ -1055,6 +1368,33 @@ void GLBufferObjectManager::recomputeStats(std::ostream& out) const
 //
 // BufferObject
 //
+static osg::ApplicationUsageProxy BufferObject_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_STREAM_DYNAMIC_BUFFERS <mode>","ON | OFF - stream the vertex buffer objects of DYNAMIC Geometry and Text through a persistently mapped ring buffer");
+
+static bool& streamDynamicData()
+{
+    struct EnvVar
+    {
+        static bool read()
+        {
+            const char* str = getenv("OSG_STREAM_DYNAMIC_BUFFERS");
+            return str && (strcmp(str,"ON")==0 || strcmp(str,"on")==0);
+        }
+    };
+
+    static bool s_streamDynamicData = EnvVar::read();
+    return s_streamDynamicData;
+}
+
+void BufferObject::setStreamDynamicData(bool flag)
+{
+    streamDynamicData() = flag;
+}
+
+bool BufferObject::getStreamDynamicData()
+{
+    return streamDynamicData();
+}
+
 BufferObject::BufferObject():
     _copyDataAndReleaseGLBufferObject(false)
 {
@@ -402,7 +402,7 @@ static ApplicationUsageProxy DisplaySetting_e35(ApplicationUsage::ENVIRONMENTAL_
         "Specifiy number of texture units Shader Pipeline shaders support");
 static ApplicationUsageProxy DisplaySetting_e36(ApplicationUsage::ENVIRONMENTAL_VARIABLE,
         "OSG_TEXT_SHADER_TECHNIQUE <value>",
-        "Set the defafult osgText::ShaderTechnique. ALL_FEATURES | ALL | GREYSCALE | SIGNED_DISTANCE_FIELD | SDF | NO_TEXT_SHADER | NONE");
+        "Set the defafult osgText::ShaderTechnique. ALL_FEATURES | ALL | GREYSCALE | SIGNED_DISTANCE_FIELD | SDF | MULTI_CHANNEL_SIGNED_DISTANCE_FIELD | MSDF | NO_TEXT_SHADER | NONE");
 
 void DisplaySettings::readEnvironmentalVariables()
 {
@@ -17,6 +17,24 @@
 
 using namespace osg;
 
+// mark the vertex buffer objects of a DYNAMIC Geometry DYNAMIC, so that they are streamed when their GLBufferObjects are created.
+static void markVertexBufferObjectsDynamic(const Geometry& geometry)
+{
+    if (!BufferObject::getStreamDynamicData()) return;
+
+    const Array* vertices = geometry.getVertexArray();
+    if (vertices && vertices->getBufferObject() && vertices->getBufferObject()->getDataVariance()==Object::DYNAMIC) return;
+
+    Geometry::ArrayList arrays;
+    geometry.getArrayList(arrays);
+    for(Geometry::ArrayList::iterator itr = arrays.begin();
+        itr != arrays.end();
+        ++itr)
+    {
+        BufferObject* bo = (*itr)->getBufferObject();
+        if (bo) bo->setDataVariance(Object::DYNAMIC);
+    }
+}
 
 Geometry::Geometry():
     _containsDeprecatedData(false)
@@ -802,6 +820,8 @@ VertexArrayState* Geometry::createVertexArrayStateImplementation(RenderInfo& ren
 void Geometry::compileGLObjects(RenderInfo& renderInfo) const
 {
     State& state = *renderInfo.getState();
+    if (_dataVariance==DYNAMIC) markVertexBufferObjectsDynamic(*this);
+
     if (renderInfo.getState()->useVertexBufferObject(_supportsVertexBufferObjects && _useVertexBufferObjects))
     {
         unsigned int contextID = state.getContextID();
@@ -902,6 +922,8 @@ void Geometry::drawImplementation(RenderInfo& renderInfo) const
     osg::VertexArrayState* vas = state.getCurrentVertexArrayState();
     vas->setVertexBufferObjectSupported(usingVertexBufferObjects);
 
+    if (usingVertexBufferObjects && _dataVariance==DYNAMIC) markVertexBufferObjectsDynamic(*this);
+
     bool checkForGLErrors = state.getCheckForGLErrors()==osg::State::ONCE_PER_ATTRIBUTE;
     if (checkForGLErrors) state.checkGLErrors("start of Geometry::drawImplementation()");
 
@@ -1098,6 +1120,7 @@ void Geometry::accept(PrimitiveFunctor& functor) const
         return;
     }
 
+    ref_ptr<Vec3Array> floatVertices;
     switch(vertices->getType())
     {
     case(Array::Vec2ArrayType):
@@ -1118,6 +1141,19 @@ void Geometry::accept(PrimitiveFunctor& functor) const
     case(Array::Vec4dArrayType):
         functor.setVertexArray(vertices->getNumElements(),static_cast<const Vec4d*>(vertices->getDataPointer()));
         break;
+    case(Array::Vec3sArrayType):
+    {
+        // quantized vertices, as created by osgUtil::VertexAttributeCompressionVisitor, are converted for the duration of the traversal.
+        const Vec3sArray* quantized = static_cast<const Vec3sArray*>(vertices);
+        floatVertices = new Vec3Array(quantized->size());
+        for(unsigned int i=0; i<quantized->size(); ++i)
+        {
+            const Vec3s& v = (*quantized)[i];
+            (*floatVertices)[i].set(v.x(), v.y(), v.z());
+        }
+        functor.setVertexArray(floatVertices->getNumElements(),static_cast<const Vec3*>(floatVertices->getDataPointer()));
+        break;
+    }
     default:
         OSG_WARN<<"Warning: Geometry::accept(PrimitiveFunctor&) cannot handle Vertex Array type"<<vertices->getType()<<std::endl;
         return;
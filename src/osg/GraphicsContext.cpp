@@ -14,6 +14,7 @@
 #include <stdlib.h>
 
 #include <osg/GraphicsContext>
+#include <osg/Profiler>
 #include <osg/Camera>
 #include <osg/View>
 #include <osg/GLObjects>
@@ -476,6 +477,9 @@ void GraphicsContext::close(bool callCloseImplementation)
 
         if (makeCurrent())
         {
+            // the profiler's timer queries are never shared, so are deleted whether or not other contexts remain
+            if (_state->getProfiler()) _state->getProfiler()->releaseGLObjects(_state.get());
+
             if ( !sharedContextExists )
             {
                 OSG_INFO<<"Doing delete of GL objects"<<std::endl;
@@ -0,0 +1,156 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osg/ParallelFor>
+#include <osg/OperationThread>
+
+#include <OpenThreads/Atomic>
+#include <OpenThreads/ScopedLock>
+
+#include <vector>
+
+using namespace osg;
+
+namespace
+{
+    class ParallelForJob : public osg::Referenced
+    {
+        public:
+
+            ParallelForJob(ParallelForFunctor& functor, unsigned int size, unsigned int chunkSize):
+                _functor(functor),
+                _size(size),
+                _chunkSize(chunkSize),
+                _numChunks((size + chunkSize - 1)/chunkSize),
+                _completed(new RefBlockCount(_numChunks))
+            {
+                // a BlockCount only blocks once reset to its block count
+                _completed->reset();
+            }
+
+            void run()
+            {
+                // operations that run once all the chunks have been taken return without touching the functor,
+                // which may no longer exist.
+                for(;;)
+                {
+                    unsigned int chunk = ++_nextChunk - 1;
+                    if (chunk>=_numChunks) break;
+
+                    unsigned int begin = chunk*_chunkSize;
+                    unsigned int end = (_size-begin > _chunkSize) ? begin+_chunkSize : _size;
+                    _functor(begin, end);
+
+                    _completed->completed();
+                }
+            }
+
+            void block() { _completed->block(); }
+
+        protected:
+
+            ParallelForFunctor&         _functor;
+            unsigned int                _size;
+            unsigned int                _chunkSize;
+            unsigned int                _numChunks;
+            OpenThreads::Atomic         _nextChunk;
+            ref_ptr<RefBlockCount>      _completed;
+    };
+
+    class ParallelForOperation : public osg::Operation
+    {
+        public:
+
+            ParallelForOperation(ParallelForJob* job):
+                osg::Operation("ParallelFor", false),
+                _job(job) {}
+
+            virtual void operator () (osg::Object*) { _job->run(); }
+
+        protected:
+
+            ref_ptr<ParallelForJob> _job;
+    };
+
+    class ParallelForPool : public osg::Referenced
+    {
+        public:
+
+            ParallelForPool():
+                _operationQueue(new OperationQueue) {}
+
+            void run(ParallelForJob* job, unsigned int numOperations)
+            {
+                {
+                    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+                    while(_threads.size()<numOperations)
+                    {
+                        ref_ptr<OperationThread> thread = new OperationThread;
+                        thread->setOperationQueue(_operationQueue.get());
+                        thread->startThread();
+                        _threads.push_back(thread);
+                    }
+                }
+
+                for(unsigned int i=0; i<numOperations; ++i)
+                {
+                    _operationQueue->add(new ParallelForOperation(job));
+                }
+            }
+
+        protected:
+
+            virtual ~ParallelForPool()
+            {
+                for(OperationThreads::iterator itr = _threads.begin(); itr != _threads.end(); ++itr)
+                {
+                    (*itr)->cancel();
+                }
+            }
+
+            typedef std::vector< ref_ptr<OperationThread> > OperationThreads;
+
+            OpenThreads::Mutex          _mutex;
+            ref_ptr<OperationQueue>     _operationQueue;
+            OperationThreads            _threads;
+    };
+
+    ParallelForPool* getParallelForPool()
+    {
+        static ref_ptr<ParallelForPool> s_pool = new ParallelForPool;
+        return s_pool.get();
+    }
+}
+
+OSG_INIT_SINGLETON_PROXY(ParallelForPoolSingletonProxy, getParallelForPool())
+
+void osg::parallelFor(unsigned int size, unsigned int chunkSize, ParallelForFunctor& functor, unsigned int numThreads)
+{
+    if (size==0) return;
+    if (chunkSize==0) chunkSize = 1;
+    if (numThreads==0) numThreads = OpenThreads::GetNumberOfProcessors();
+
+    unsigned int numChunks = (size + chunkSize - 1)/chunkSize;
+    unsigned int numWorkers = numThreads<numChunks ? numThreads : numChunks;
+    if (numWorkers<=1)
+    {
+        functor(0, size);
+        return;
+    }
+
+    // the calling thread works through the job alongside the pool.
+    ref_ptr<ParallelForJob> job = new ParallelForJob(functor, size, chunkSize);
+    getParallelForPool()->run(job.get(), numWorkers-1);
+    job->run();
+    job->block();
+}
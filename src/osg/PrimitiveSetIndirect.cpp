@@ -420,8 +420,47 @@ void MultiDrawElementsIndirectUInt::draw(State& state, bool /*useVertexBufferObj
 }
 
 #ifndef PRIMFUNCTORBASEVERTEX
-void MultiDrawElementsIndirectUInt::accept(PrimitiveFunctor&) const {}
-void MultiDrawElementsIndirectUInt::accept(PrimitiveIndexFunctor&) const {}
+// PrimitiveFunctor and PrimitiveIndexFunctor have no base vertex parameter, so pass on the
+// indices of commands with a base vertex offset by it.
+template<class Functor>
+static void acceptMultiDrawElementsIndirectUInt(const MultiDrawElementsIndirectUInt& primitiveSet, const IndirectCommandDrawElements& constCommands, Functor& functor)
+{
+    if (primitiveSet.empty()) return;
+
+    IndirectCommandDrawElements& commands = const_cast<IndirectCommandDrawElements&>(constCommands);
+    unsigned int firstCommand = primitiveSet.getFirstCommandToDraw();
+    unsigned int maxindex = (primitiveSet.getNumCommandsToDraw()>0) ? firstCommand + primitiveSet.getNumCommandsToDraw() : commands.getNumElements();
+    if (maxindex>commands.getNumElements()) maxindex = commands.getNumElements();
+
+    std::vector<GLuint> rebased;
+    for(unsigned int i = firstCommand; i<maxindex; ++i)
+    {
+        unsigned int count = commands.count(i);
+        unsigned int firstIndex = commands.firstIndex(i);
+        unsigned int baseVertex = commands.baseVertex(i);
+        if (count==0 || firstIndex+count>primitiveSet.size()) continue;
+
+        const GLuint* indices = &primitiveSet[firstIndex];
+        if (baseVertex!=0)
+        {
+            rebased.resize(count);
+            for(unsigned int j=0; j<count; ++j) rebased[j] = indices[j]+baseVertex;
+            indices = &rebased.front();
+        }
+
+        functor.drawElements(primitiveSet.getMode(), count, indices);
+    }
+}
+
+void MultiDrawElementsIndirectUInt::accept(PrimitiveFunctor& functor) const
+{
+    acceptMultiDrawElementsIndirectUInt(*this, *_indirectCommandArray, functor);
+}
+
+void MultiDrawElementsIndirectUInt::accept(PrimitiveIndexFunctor& functor) const
+{
+    acceptMultiDrawElementsIndirectUInt(*this, *_indirectCommandArray, functor);
+}
 #else
 void MultiDrawElementsIndirectUInt::accept(PrimitiveFunctor& functor) const
 {
@@ -0,0 +1,453 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osg/Profiler>
+#include <osg/State>
+#include <osg/GLExtensions>
+#include <osg/ApplicationUsage>
+#include <osg/Notify>
+#include <osg/Timer>
+
+#include <map>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace osg;
+
+static osg::ApplicationUsageProxy Profiler_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_PROFILER <mode>","ON | GPU | CPU | OFF - enable the osg::Profiler of each graphics context, CPU records only CPU times.");
+
+struct ProfilerDefaults
+{
+    ProfilerDefaults():
+        enabled(false),
+        useGPUTimers(true)
+    {
+        const char* str = getenv("OSG_PROFILER");
+        if (str)
+        {
+            if (strcmp(str,"ON")==0 || strcmp(str,"on")==0 || strcmp(str,"GPU")==0 || strcmp(str,"gpu")==0)
+            {
+                enabled = true;
+                useGPUTimers = true;
+            }
+            else if (strcmp(str,"CPU")==0 || strcmp(str,"cpu")==0)
+            {
+                enabled = true;
+                useGPUTimers = false;
+            }
+            else if (strcmp(str,"OFF")==0 || strcmp(str,"off")==0)
+            {
+                enabled = false;
+            }
+        }
+    }
+
+    bool enabled;
+    bool useGPUTimers;
+};
+
+// initialized on first use, which may be from several graphics threads creating their State at once.
+static ProfilerDefaults& getProfilerDefaults()
+{
+    static ProfilerDefaults s_defaults;
+    return s_defaults;
+}
+
+void Profiler::setDefaultEnabled(bool enabled)
+{
+    getProfilerDefaults().enabled = enabled;
+}
+
+bool Profiler::getDefaultEnabled()
+{
+    return getProfilerDefaults().enabled;
+}
+
+void Profiler::setDefaultUseGPUTimers(bool useGPUTimers)
+{
+    getProfilerDefaults().useGPUTimers = useGPUTimers;
+}
+
+bool Profiler::getDefaultUseGPUTimers()
+{
+    return getProfilerDefaults().useGPUTimers;
+}
+
+// number of frames a frame may wait for its queries before it is completed without GPU times
+static const unsigned int s_maxNumPendingFrames = 8;
+
+Profiler::Profiler():
+    _enabled(getDefaultEnabled()),
+    _useGPUTimers(getDefaultUseGPUTimers()),
+    _maxNumCompletedFrames(300),
+    _frameOpen(false),
+    _numOpenScopes(0),
+    _numFramesCompleted(0)
+{
+}
+
+Profiler::~Profiler()
+{
+    // any query objects left are deleted along with the graphics context, releaseGLObjects() deletes them beforehand.
+}
+
+static bool timerQueriesSupported(State& state)
+{
+    const GLExtensions* extensions = state.get<GLExtensions>();
+    return extensions && extensions->isARBTimerQuerySupported && state.getTimestampBits()>0;
+}
+
+static double currentTime(State& state)
+{
+    return osg::Timer::instance()->delta_s(state.getStartTick(), osg::Timer::instance()->tick());
+}
+
+GLuint Profiler::createQuery(State& state)
+{
+    if (!_availableQueries.empty())
+    {
+        GLuint query = _availableQueries.back();
+        _availableQueries.pop_back();
+        return query;
+    }
+
+    GLuint query = 0;
+    state.get<GLExtensions>()->glGenQueries(1, &query);
+    return query;
+}
+
+unsigned int Profiler::beginScope(State& state, const std::string& name)
+{
+    const FrameStamp* fs = state.getFrameStamp();
+    unsigned int frameNumber = fs ? fs->getFrameNumber() : _currentFrame.frameNumber;
+
+    if (_frameOpen && _numOpenScopes==0 && frameNumber!=_currentFrame.frameNumber)
+    {
+        closeCurrentFrame();
+    }
+
+    if (!_frameOpen)
+    {
+        _frameOpen = true;
+        _currentFrame.frameNumber = frameNumber;
+    }
+
+    unsigned int index = static_cast<unsigned int>(_currentFrame.scopes.size());
+    _currentFrame.scopes.push_back(Scope());
+
+    Scope& scope = _currentFrame.scopes.back();
+    scope.name = name;
+    scope.depth = _numOpenScopes++;
+
+    if (_useGPUTimers && timerQueriesSupported(state))
+    {
+        scope.beginQuery = createQuery(state);
+        scope.endQuery = createQuery(state);
+        state.get<GLExtensions>()->glQueryCounter(scope.beginQuery, GL_TIMESTAMP);
+    }
+
+    scope.cpuBegin = currentTime(state);
+
+    return index;
+}
+
+void Profiler::endScope(State& state, unsigned int index)
+{
+    if (index>=_currentFrame.scopes.size()) return;
+
+    Scope& scope = _currentFrame.scopes[index];
+    scope.cpuEnd = currentTime(state);
+
+    if (scope.endQuery)
+    {
+        state.get<GLExtensions>()->glQueryCounter(scope.endQuery, GL_TIMESTAMP);
+        _currentFrame.lastQuery = scope.endQuery;
+    }
+
+    if (_numOpenScopes>0) --_numOpenScopes;
+}
+
+void Profiler::closeCurrentFrame()
+{
+    if (!_frameOpen) return;
+
+    _pendingFrames.push_back(_currentFrame);
+
+    _frameOpen = false;
+    _numOpenScopes = 0;
+    _currentFrame.scopes.clear();
+    _currentFrame.lastQuery = 0;
+}
+
+static double timestampToTime(State& state, GLuint64 timestamp)
+{
+    // map the GPU timestamp onto the CPU timeline using the synchronization point recorded by State::frameCompleted().
+    GLuint64 gpuTimestamp = state.getGpuTimestamp();
+    if (timestamp>gpuTimestamp) return state.getGpuTime() + double(timestamp - gpuTimestamp)*1e-9;
+    else return state.getGpuTime() - double(gpuTimestamp - timestamp)*1e-9;
+}
+
+void Profiler::collectFrames(State& state, bool closeFrame)
+{
+    if (closeFrame && _numOpenScopes==0) closeCurrentFrame();
+
+    if (_pendingFrames.empty()) return;
+
+    GLExtensions* extensions = state.get<GLExtensions>();
+
+    Frames completed;
+    while(!_pendingFrames.empty())
+    {
+        Frame& frame = _pendingFrames.front();
+
+        if (frame.lastQuery)
+        {
+            // queries complete in order, so once the last query of a frame is available all its queries are.
+            GLint available = 0;
+            extensions->glGetQueryObjectiv(frame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+
+            if (available)
+            {
+                for(Scopes::iterator itr = frame.scopes.begin(); itr != frame.scopes.end(); ++itr)
+                {
+                    Scope& scope = *itr;
+                    if (!scope.beginQuery) continue;
+
+                    GLuint64 beginTimestamp = 0;
+                    GLuint64 endTimestamp = 0;
+                    extensions->glGetQueryObjectui64v(scope.beginQuery, GL_QUERY_RESULT, &beginTimestamp);
+                    extensions->glGetQueryObjectui64v(scope.endQuery, GL_QUERY_RESULT, &endTimestamp);
+
+                    if (endTimestamp>=beginTimestamp)
+                    {
+                        scope.gpuBegin = timestampToTime(state, beginTimestamp);
+                        scope.gpuEnd = scope.gpuBegin + double(endTimestamp - beginTimestamp)*1e-9;
+                        scope.gpuValid = true;
+                    }
+                }
+            }
+            else if (_pendingFrames.size()<=s_maxNumPendingFrames)
+            {
+                break;
+            }
+            else
+            {
+                OSG_INFO<<"Profiler: timer queries of frame "<<frame.frameNumber<<" not available, dropping GPU times."<<std::endl;
+            }
+
+            for(Scopes::iterator itr = frame.scopes.begin(); itr != frame.scopes.end(); ++itr)
+            {
+                if (itr->beginQuery) _availableQueries.push_back(itr->beginQuery);
+                if (itr->endQuery) _availableQueries.push_back(itr->endQuery);
+                itr->beginQuery = 0;
+                itr->endQuery = 0;
+            }
+            frame.lastQuery = 0;
+        }
+
+        completed.push_back(frame);
+        _pendingFrames.pop_front();
+    }
+
+    if (completed.empty()) return;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    _completedFrames.insert(_completedFrames.end(), completed.begin(), completed.end());
+    _numFramesCompleted += static_cast<unsigned int>(completed.size());
+
+    while(_completedFrames.size()>_maxNumCompletedFrames)
+    {
+        _completedFrames.pop_front();
+    }
+}
+
+void Profiler::getCompletedFrames(Frames& frames) const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    frames = _completedFrames;
+}
+
+bool Profiler::getLatestCompletedFrame(Frame& frame) const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    if (_completedFrames.empty()) return false;
+
+    frame = _completedFrames.back();
+    return true;
+}
+
+void Profiler::reportStats(Stats* stats)
+{
+    if (!stats) return;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    // several Renderers sharing a graphics context share its Profiler, so the frames reported are tracked per Stats,
+    // forgetting those of Stats that have since been deleted.
+    for(NumFramesReportedMap::iterator itr = _numFramesReported.begin(); itr != _numFramesReported.end();)
+    {
+        if (itr->second.stats.valid()) ++itr;
+        else _numFramesReported.erase(itr++);
+    }
+
+    NumFramesReported& numFramesReported = _numFramesReported[stats];
+    numFramesReported.stats = stats;
+
+    unsigned int numUnreportedFrames = osg::minimum(_numFramesCompleted - numFramesReported.numFrames, static_cast<unsigned int>(_completedFrames.size()));
+    numFramesReported.numFrames = _numFramesCompleted;
+
+    for(Frames::const_iterator fitr = _completedFrames.end() - numUnreportedFrames;
+        fitr != _completedFrames.end();
+        ++fitr)
+    {
+        typedef std::map<std::string, std::pair<double, double> > TimeMap;
+        TimeMap times;
+        bool gpuValid = false;
+
+        for(Scopes::const_iterator itr = fitr->scopes.begin(); itr != fitr->scopes.end(); ++itr)
+        {
+            std::pair<double, double>& time = times[itr->name];
+            time.first += itr->cpuDuration();
+            time.second += itr->gpuDuration();
+            gpuValid = gpuValid || itr->gpuValid;
+        }
+
+        for(TimeMap::iterator itr = times.begin(); itr != times.end(); ++itr)
+        {
+            stats->setAttribute(fitr->frameNumber, itr->first + " CPU time taken", itr->second.first);
+            if (gpuValid) stats->setAttribute(fitr->frameNumber, itr->first + " GPU time taken", itr->second.second);
+        }
+    }
+}
+
+static void writeEscaped(std::ostream& out, const std::string& str)
+{
+    for(std::string::const_iterator itr = str.begin(); itr != str.end(); ++itr)
+    {
+        switch(*itr)
+        {
+            case '"': out<<"\\\""; break;
+            case '\\': out<<"\\\\"; break;
+            case '\n': out<<"\\n"; break;
+            case '\t': out<<"\\t"; break;
+            default: if (static_cast<unsigned char>(*itr)>=0x20) out<<*itr; break;
+        }
+    }
+}
+
+static void writeEvent(std::ostream& out, const std::string& name, const char* category, double begin, double end, unsigned int pid, unsigned int tid, unsigned int frameNumber, bool& first)
+{
+    if (!first) out<<",\n";
+    first = false;
+
+    out<<"{\"name\":\"";
+    writeEscaped(out, name);
+    out<<"\",\"cat\":\""<<category<<"\",\"ph\":\"X\",\"ts\":"<<begin*1.0e6<<",\"dur\":"<<(end-begin)*1.0e6
+       <<",\"pid\":"<<pid<<",\"tid\":"<<tid<<",\"args\":{\"frame\":"<<frameNumber<<"}}";
+}
+
+void Profiler::writeChromeTraceEvents(std::ostream& out, unsigned int pid, bool& first) const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    std::streamsize precision = out.precision(15);
+
+    for(Frames::const_iterator fitr = _completedFrames.begin(); fitr != _completedFrames.end(); ++fitr)
+    {
+        for(Scopes::const_iterator itr = fitr->scopes.begin(); itr != fitr->scopes.end(); ++itr)
+        {
+            writeEvent(out, itr->name, "cpu", itr->cpuBegin, itr->cpuEnd, pid, 0, fitr->frameNumber, first);
+            if (itr->gpuValid) writeEvent(out, itr->name, "gpu", itr->gpuBegin, itr->gpuEnd, pid, 1, fitr->frameNumber, first);
+        }
+    }
+
+    out.precision(precision);
+}
+
+void Profiler::writeChromeTrace(std::ostream& out, unsigned int pid) const
+{
+    bool first = true;
+    out<<"{\"traceEvents\":[\n";
+    writeChromeTraceEvents(out, pid, first);
+    out<<"\n],\"displayTimeUnit\":\"ms\"}"<<std::endl;
+}
+
+void Profiler::clear()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    _completedFrames.clear();
+    _numFramesReported.clear();
+    _numFramesCompleted = 0;
+}
+
+void Profiler::releaseGLObjects(State* state)
+{
+    if (_frameOpen) closeCurrentFrame();
+
+    std::vector<GLuint> queries;
+    queries.swap(_availableQueries);
+
+    Frames completed;
+    for(Frames::iterator fitr = _pendingFrames.begin(); fitr != _pendingFrames.end(); ++fitr)
+    {
+        for(Scopes::iterator itr = fitr->scopes.begin(); itr != fitr->scopes.end(); ++itr)
+        {
+            if (itr->beginQuery) queries.push_back(itr->beginQuery);
+            if (itr->endQuery) queries.push_back(itr->endQuery);
+            itr->beginQuery = 0;
+            itr->endQuery = 0;
+        }
+        fitr->lastQuery = 0;
+        completed.push_back(*fitr);
+    }
+    _pendingFrames.clear();
+
+    GLExtensions* extensions = state ? state->get<GLExtensions>() : 0;
+    if (extensions && !queries.empty())
+    {
+        extensions->glDeleteQueries(static_cast<GLsizei>(queries.size()), &queries.front());
+    }
+
+    if (completed.empty()) return;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    _completedFrames.insert(_completedFrames.end(), completed.begin(), completed.end());
+    _numFramesCompleted += static_cast<unsigned int>(completed.size());
+
+    while(_completedFrames.size()>_maxNumCompletedFrames)
+    {
+        _completedFrames.pop_front();
+    }
+}
+
+void Profiler::DrawCallback::drawImplementation(RenderInfo& renderInfo, const Drawable* drawable) const
+{
+    ProfileScope scope(*renderInfo.getState(), drawable->getName().empty() ? drawable->className() : drawable->getName());
+    drawable->drawImplementation(renderInfo);
+}
+
+ProfileScope::ProfileScope(State& state, const std::string& name):
+    _state(state),
+    _profiler(state.getProfiler()),
+    _scope(0)
+{
+    if (_profiler && _profiler->getEnabled()) _scope = _profiler->beginScope(_state, name);
+    else _profiler = 0;
+}
+
+ProfileScope::~ProfileScope()
+{
+    if (_profiler) _profiler->endScope(_state, _scope);
+}
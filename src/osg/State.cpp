@@ -19,6 +19,7 @@
 #include <osg/ApplicationUsage>
 #include <osg/ContextData>
 #include <osg/os_utils>
+#include <osg/Profiler>
 
 // for includes for GLES
 #include <osg/Fog>
@@ -59,6 +60,8 @@ using namespace osg;
 #endif
 
 static ApplicationUsageProxy State_e0(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_GL_ERROR_CHECKING <type>","ONCE_PER_ATTRIBUTE | ON | on enables fine grained checking,  ONCE_PER_FRAME enables coarse grained checking");
+static ApplicationUsageProxy State_e1(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_FLAT_STATE_STACKS <mode>","ON | OFF - enable or disable the flat, slot indexed mode, attribute and uniform stacks in osg::State.");
+static ApplicationUsageProxy State_e2(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DEDUPLICATE_STATE_ATTRIBUTES <mode>","ON | OFF - enable or disable skipping StateAttributes that compare equal to the last applied attribute of their type.");
 
 State::State():
     Referenced(true)
@@ -116,6 +119,23 @@ State::State():
         }
     }
 
+    _useFlatStateStacks = false;
+    if (getEnvVar("OSG_FLAT_STATE_STACKS", str))
+    {
+        _useFlatStateStacks = (str=="ON" || str=="on");
+    }
+
+    _deduplicateStateAttributes = false;
+    if (getEnvVar("OSG_DEDUPLICATE_STATE_ATTRIBUTES", str))
+    {
+        _deduplicateStateAttributes = (str=="ON" || str=="on");
+    }
+
+    _numStateAttributesApplied = 0;
+    _numStateAttributesSkipped = 0;
+
+    _profiler = new Profiler;
+
     _currentActiveTextureUnit=0;
     _currentClientActiveTextureUnit=0;
 
@@ -194,6 +214,11 @@ State::~State()
     //_vertexAttribArrayList.clear();
 }
 
+void State::setProfiler(Profiler* profiler)
+{
+    _profiler = profiler;
+}
+
 
 void State::setUseStateAttributeShaders(bool flag)
 {
@@ -501,6 +526,8 @@ void State::releaseGLObjects()
     }
 
     _textureAttributeMapList.clear();
+
+    rebuildStateSlots();
 }
 
 void State::reset()
@@ -533,6 +560,7 @@ void State::reset()
         AttributeStack& as = aitr->second;
         as.attributeVec.clear();
         as.last_applied_attribute = NULL;
+        as.last_applied_reference = NULL;
         as.last_applied_shadercomponent = NULL;
         as.changed = true;
     }
@@ -559,6 +587,7 @@ void State::reset()
             AttributeStack& as = aitr->second;
             as.attributeVec.clear();
             as.last_applied_attribute = NULL;
+            as.last_applied_reference = NULL;
             as.last_applied_shadercomponent = NULL;
             as.changed = true;
         }
@@ -599,6 +628,7 @@ void State::reset()
         us.uniformVec.clear();
     }
 
+    dirtyAllStateSlots();
 }
 
 void State::glDrawBuffer(GLenum buffer)
@@ -679,7 +709,8 @@ void State::pushStateSet(const StateSet* dstate)
     if (dstate)
     {
 
-        pushModeList(_modeMap,dstate->getModeList());
+        if (_useFlatStateStacks) pushModeSlots(dstate->getModeList());
+        else pushModeList(_modeMap,dstate->getModeList());
 
         // iterator through texture modes.
         unsigned int unit;
@@ -689,7 +720,8 @@ void State::pushStateSet(const StateSet* dstate)
             pushModeList(getOrCreateTextureModeMap(unit),ds_textureModeList[unit]);
         }
 
-        pushAttributeList(_attributeMap,dstate->getAttributeList());
+        if (_useFlatStateStacks) pushAttributeSlots(dstate->getAttributeList());
+        else pushAttributeList(_attributeMap,dstate->getAttributeList());
 
         // iterator through texture attributes.
         const StateSet::TextureAttributeList& ds_textureAttributeList = dstate->getTextureAttributeList();
@@ -698,7 +730,8 @@ void State::pushStateSet(const StateSet* dstate)
             pushAttributeList(getOrCreateTextureAttributeMap(unit),ds_textureAttributeList[unit]);
         }
 
-        pushUniformList(_uniformMap,dstate->getUniformList());
+        if (_useFlatStateStacks) pushUniformSlots(dstate->getUniformList());
+        else pushUniformList(_uniformMap,dstate->getUniformList());
 
         pushDefineList(_defineMap,dstate->getDefineList());
     }
@@ -738,7 +771,8 @@ void State::popStateSet()
     if (dstate)
     {
 
-        popModeList(_modeMap,dstate->getModeList());
+        if (_useFlatStateStacks) popModeSlots(dstate->getModeList());
+        else popModeList(_modeMap,dstate->getModeList());
 
         // iterator through texture modes.
         unsigned int unit;
@@ -748,7 +782,8 @@ void State::popStateSet()
             popModeList(getOrCreateTextureModeMap(unit),ds_textureModeList[unit]);
         }
 
-        popAttributeList(_attributeMap,dstate->getAttributeList());
+        if (_useFlatStateStacks) popAttributeSlots(dstate->getAttributeList());
+        else popAttributeList(_attributeMap,dstate->getAttributeList());
 
         // iterator through texture attributes.
         const StateSet::TextureAttributeList& ds_textureAttributeList = dstate->getTextureAttributeList();
@@ -757,7 +792,8 @@ void State::popStateSet()
             popAttributeList(getOrCreateTextureAttributeMap(unit),ds_textureAttributeList[unit]);
         }
 
-        popUniformList(_uniformMap,dstate->getUniformList());
+        if (_useFlatStateStacks) popUniformSlots(dstate->getUniformList());
+        else popUniformList(_uniformMap,dstate->getUniformList());
 
         popDefineList(_defineMap,dstate->getDefineList());
 
@@ -887,14 +923,16 @@ void State::apply(const StateSet* dstate)
 
         const Program::PerContextProgram* previousLastAppliedProgramObject = _lastAppliedProgramObject;
 
-        applyModeList(_modeMap,dstate->getModeList());
+        if (_useFlatStateStacks) applyModeSlots(dstate->getModeList());
+        else applyModeList(_modeMap,dstate->getModeList());
 #if 1
         pushDefineList(_defineMap, dstate->getDefineList());
 #else
         applyDefineList(_defineMap, dstate->getDefineList());
 #endif
 
-        applyAttributeList(_attributeMap,dstate->getAttributeList());
+        if (_useFlatStateStacks) applyAttributeSlots(dstate->getAttributeList());
+        else applyAttributeList(_attributeMap,dstate->getAttributeList());
 
         if ((_lastAppliedProgramObject!=0) && (previousLastAppliedProgramObject==_lastAppliedProgramObject) && _defineMap.changed)
         {
@@ -915,17 +953,17 @@ void State::apply(const StateSet* dstate)
 
         if (dstate->getUniformList().empty())
         {
-            if (_currentShaderCompositionUniformList.empty()) applyUniformMap(_uniformMap);
-            else applyUniformList(_uniformMap, _currentShaderCompositionUniformList);
+            if (_currentShaderCompositionUniformList.empty()) applyUniforms();
+            else applyUniforms(_currentShaderCompositionUniformList);
         }
         else
         {
-            if (_currentShaderCompositionUniformList.empty()) applyUniformList(_uniformMap, dstate->getUniformList());
+            if (_currentShaderCompositionUniformList.empty()) applyUniforms(dstate->getUniformList());
             else
             {
                 // need top merge uniforms lists, but cheat for now by just applying both.
                 _currentShaderCompositionUniformList.insert(dstate->getUniformList().begin(), dstate->getUniformList().end());
-                applyUniformList(_uniformMap, _currentShaderCompositionUniformList);
+                applyUniforms(_currentShaderCompositionUniformList);
             }
         }
 
@@ -965,12 +1003,14 @@ void State::apply()
 
     // go through all active OpenGL modes, enabling/disable where
     // appropriate.
-    applyModeMap(_modeMap);
+    if (_useFlatStateStacks) applyDirtyModeSlots();
+    else applyModeMap(_modeMap);
 
     const Program::PerContextProgram* previousLastAppliedProgramObject = _lastAppliedProgramObject;
 
     // go through all active StateAttribute's, applying where appropriate.
-    applyAttributeMap(_attributeMap);
+    if (_useFlatStateStacks) applyDirtyAttributeSlots();
+    else applyAttributeMap(_attributeMap);
 
 
     if ((_lastAppliedProgramObject!=0) && (previousLastAppliedProgramObject==_lastAppliedProgramObject) && _defineMap.changed)
@@ -987,8 +1027,8 @@ void State::apply()
 
     if (_checkGLErrors==ONCE_PER_ATTRIBUTE) checkGLErrors("after attributes State::apply()");
 
-    if (_currentShaderCompositionUniformList.empty()) applyUniformMap(_uniformMap);
-    else applyUniformList(_uniformMap, _currentShaderCompositionUniformList);
+    if (_currentShaderCompositionUniformList.empty()) applyUniforms();
+    else applyUniforms(_currentShaderCompositionUniformList);
 
     if (_checkGLErrors==ONCE_PER_ATTRIBUTE) checkGLErrors("end of State::apply()");
 }
@@ -1035,21 +1075,25 @@ void State::applyShaderComposition()
 void State::haveAppliedMode(StateAttribute::GLMode mode,StateAttribute::GLModeValue value)
 {
     haveAppliedMode(_modeMap,mode,value);
+    if (_useFlatStateStacks) _dirtyModeSlots.set(getOrCreateModeSlot(mode));
 }
 
 void State::haveAppliedMode(StateAttribute::GLMode mode)
 {
     haveAppliedMode(_modeMap,mode);
+    if (_useFlatStateStacks) _dirtyModeSlots.set(getOrCreateModeSlot(mode));
 }
 
 void State::haveAppliedAttribute(const StateAttribute* attribute)
 {
     haveAppliedAttribute(_attributeMap,attribute);
+    if (_useFlatStateStacks && attribute) _dirtyAttributeSlots.set(getOrCreateAttributeSlot(attribute->getType(), attribute->getMember()));
 }
 
 void State::haveAppliedAttribute(StateAttribute::Type type, unsigned int member)
 {
     haveAppliedAttribute(_attributeMap,type,member);
+    if (_useFlatStateStacks && _attributeMap.count(StateAttribute::TypeMemberPair(type,member))!=0) _dirtyAttributeSlots.set(getOrCreateAttributeSlot(type, member));
 }
 
 bool State::getLastAppliedMode(StateAttribute::GLMode mode) const
@@ -1201,6 +1245,8 @@ void State::dirtyAllModes()
 
         }
     }
+
+    dirtyAllStateSlots();
 }
 
 void State::dirtyAllAttributes()
@@ -1230,6 +1276,135 @@ void State::dirtyAllAttributes()
         }
     }
 
+    dirtyAllStateSlots();
+}
+
+void State::setUseFlatStateStacks(bool flag)
+{
+    if (_useFlatStateStacks==flag) return;
+
+    _useFlatStateStacks = flag;
+
+    rebuildStateSlots();
+}
+
+unsigned int State::createModeSlot(StateAttribute::GLMode mode)
+{
+    // GLenum values are small so are looked up via pages of 256 entries, the odd large value is kept in a map.
+    unsigned int page = mode>>8;
+    bool paged = page<256;
+    if (paged)
+    {
+        if (page>=_modeSlotTables.size()) _modeSlotTables.resize(page+1);
+        if (_modeSlotTables[page].empty()) _modeSlotTables[page].resize(256, 0u);
+    }
+    else
+    {
+        ModeSlotMap::iterator itr = _modeSlotMap.find(mode);
+        if (itr!=_modeSlotMap.end()) return itr->second;
+    }
+
+    unsigned int slot = static_cast<unsigned int>(_modeSlots.size());
+    ModeMap::value_type& entry = *(_modeMap.insert(ModeMap::value_type(mode, ModeStack())).first);
+    _modeSlots.push_back(&entry);
+    _dirtyModeSlots.resize(slot+1);
+    if (entry.second.changed) _dirtyModeSlots.set(slot);
+
+    if (paged) _modeSlotTables[page][mode&0xff] = slot+1;
+    else _modeSlotMap[mode] = slot;
+
+    return slot;
+}
+
+unsigned int State::createAttributeSlot(StateAttribute::Type type, unsigned int member)
+{
+    // members are normally small indices so are looked up via a table per type, the odd large member is kept in a map.
+    bool tabled = member<256;
+    if (tabled)
+    {
+        if (static_cast<unsigned int>(type)>=_attributeSlotTables.size()) _attributeSlotTables.resize(type+1);
+        SlotTable& table = _attributeSlotTables[type];
+        if (member>=table.size()) table.resize(member+1, 0u);
+    }
+    else
+    {
+        AttributeSlotMap::iterator itr = _attributeSlotMap.find(StateAttribute::TypeMemberPair(type,member));
+        if (itr!=_attributeSlotMap.end()) return itr->second;
+    }
+
+    unsigned int slot = static_cast<unsigned int>(_attributeSlots.size());
+    AttributeMap::value_type& entry = *(_attributeMap.insert(AttributeMap::value_type(StateAttribute::TypeMemberPair(type,member), AttributeStack())).first);
+    _attributeSlots.push_back(&entry);
+    _dirtyAttributeSlots.resize(slot+1);
+    if (entry.second.changed) _dirtyAttributeSlots.set(slot);
+
+    if (tabled) _attributeSlotTables[type][member] = slot+1;
+    else _attributeSlotMap[StateAttribute::TypeMemberPair(type,member)] = slot;
+
+    return slot;
+}
+
+unsigned int State::createUniformSlot(const std::string& name, unsigned int nameID)
+{
+    // uniforms that haven't had their name set don't have a name id assigned yet.
+    if (nameID==UINT_MAX) nameID = Uniform::getNameID(name);
+
+    if (nameID>=_uniformSlotTable.size()) _uniformSlotTable.resize(nameID+1, 0u);
+    if (_uniformSlotTable[nameID]!=0) return _uniformSlotTable[nameID]-1;
+
+    unsigned int slot = static_cast<unsigned int>(_uniformSlots.size());
+    UniformMap::value_type& entry = *(_uniformMap.insert(UniformMap::value_type(name, UniformStack())).first);
+    _uniformSlots.push_back(&entry);
+    _appliedUniformSlots.resize(slot+1);
+
+    _uniformSlotTable[nameID] = slot+1;
+
+    return slot;
+}
+
+void State::dirtyAllStateSlots()
+{
+    if (!_useFlatStateStacks) return;
+
+    for(ModeMap::iterator mitr=_modeMap.begin();
+        mitr!=_modeMap.end();
+        ++mitr)
+    {
+        unsigned int slot = getOrCreateModeSlot(mitr->first);
+        if (mitr->second.changed) _dirtyModeSlots.set(slot);
+    }
+
+    for(AttributeMap::iterator aitr=_attributeMap.begin();
+        aitr!=_attributeMap.end();
+        ++aitr)
+    {
+        unsigned int slot = getOrCreateAttributeSlot(aitr->first.first, aitr->first.second);
+        if (aitr->second.changed) _dirtyAttributeSlots.set(slot);
+    }
+
+    for(UniformMap::iterator uitr=_uniformMap.begin();
+        uitr!=_uniformMap.end();
+        ++uitr)
+    {
+        createUniformSlot(uitr->first, Uniform::getNameID(uitr->first));
+    }
+}
+
+void State::rebuildStateSlots()
+{
+    _modeSlots.clear();
+    _modeSlotTables.clear();
+    _modeSlotMap.clear();
+    _attributeSlots.clear();
+    _attributeSlotTables.clear();
+    _attributeSlotMap.clear();
+    _uniformSlots.clear();
+    _uniformSlotTable.clear();
+    _dirtyModeSlots.words.clear();
+    _dirtyAttributeSlots.words.clear();
+    _appliedUniformSlots.words.clear();
+
+    dirtyAllStateSlots();
 }
 
 
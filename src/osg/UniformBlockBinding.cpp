@@ -0,0 +1,381 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+#include <osg/UniformBlockBinding>
+#include <osg/GLExtensions>
+#include <osg/Program>
+#include <osg/State>
+#include <osg/Notify>
+
+#include <OpenThreads/ScopedLock>
+
+#include <sstream>
+#include <string.h>
+
+using namespace osg;
+
+namespace
+{
+
+struct Std140Type
+{
+    Std140Type(): name(0), columns(0), rows(0), componentSize(0) {}
+    Std140Type(const char* n, unsigned int c, unsigned int r, unsigned int cs): name(n), columns(c), rows(r), componentSize(cs) {}
+
+    const char*     name;
+    unsigned int    columns;
+    unsigned int    rows;
+    unsigned int    componentSize;
+};
+
+Std140Type getStd140Type(Uniform::Type type)
+{
+    switch(type)
+    {
+        case(Uniform::FLOAT):               return Std140Type("float", 1, 1, 4);
+        case(Uniform::FLOAT_VEC2):          return Std140Type("vec2", 1, 2, 4);
+        case(Uniform::FLOAT_VEC3):          return Std140Type("vec3", 1, 3, 4);
+        case(Uniform::FLOAT_VEC4):          return Std140Type("vec4", 1, 4, 4);
+        case(Uniform::INT):                 return Std140Type("int", 1, 1, 4);
+        case(Uniform::INT_VEC2):            return Std140Type("ivec2", 1, 2, 4);
+        case(Uniform::INT_VEC3):            return Std140Type("ivec3", 1, 3, 4);
+        case(Uniform::INT_VEC4):            return Std140Type("ivec4", 1, 4, 4);
+        case(Uniform::UNSIGNED_INT):        return Std140Type("uint", 1, 1, 4);
+        case(Uniform::UNSIGNED_INT_VEC2):   return Std140Type("uvec2", 1, 2, 4);
+        case(Uniform::UNSIGNED_INT_VEC3):   return Std140Type("uvec3", 1, 3, 4);
+        case(Uniform::UNSIGNED_INT_VEC4):   return Std140Type("uvec4", 1, 4, 4);
+        case(Uniform::BOOL):                return Std140Type("bool", 1, 1, 4);
+        case(Uniform::BOOL_VEC2):           return Std140Type("bvec2", 1, 2, 4);
+        case(Uniform::BOOL_VEC3):           return Std140Type("bvec3", 1, 3, 4);
+        case(Uniform::BOOL_VEC4):           return Std140Type("bvec4", 1, 4, 4);
+        case(Uniform::FLOAT_MAT2):          return Std140Type("mat2", 2, 2, 4);
+        case(Uniform::FLOAT_MAT3):          return Std140Type("mat3", 3, 3, 4);
+        case(Uniform::FLOAT_MAT4):          return Std140Type("mat4", 4, 4, 4);
+        case(Uniform::FLOAT_MAT2x3):        return Std140Type("mat2x3", 2, 3, 4);
+        case(Uniform::FLOAT_MAT2x4):        return Std140Type("mat2x4", 2, 4, 4);
+        case(Uniform::FLOAT_MAT3x2):        return Std140Type("mat3x2", 3, 2, 4);
+        case(Uniform::FLOAT_MAT3x4):        return Std140Type("mat3x4", 3, 4, 4);
+        case(Uniform::FLOAT_MAT4x2):        return Std140Type("mat4x2", 4, 2, 4);
+        case(Uniform::FLOAT_MAT4x3):        return Std140Type("mat4x3", 4, 3, 4);
+        case(Uniform::DOUBLE):              return Std140Type("double", 1, 1, 8);
+        case(Uniform::DOUBLE_VEC2):         return Std140Type("dvec2", 1, 2, 8);
+        case(Uniform::DOUBLE_VEC3):         return Std140Type("dvec3", 1, 3, 8);
+        case(Uniform::DOUBLE_VEC4):         return Std140Type("dvec4", 1, 4, 8);
+        case(Uniform::DOUBLE_MAT2):         return Std140Type("dmat2", 2, 2, 8);
+        case(Uniform::DOUBLE_MAT3):         return Std140Type("dmat3", 3, 3, 8);
+        case(Uniform::DOUBLE_MAT4):         return Std140Type("dmat4", 4, 4, 8);
+        default:                            return Std140Type();
+    }
+}
+
+inline unsigned int roundUp(unsigned int value, unsigned int alignment)
+{
+    return ((value+alignment-1)/alignment)*alignment;
+}
+
+}
+
+UniformBlockBinding::UniformBlockBinding():
+    _blockSize(0),
+    _revision(1)
+{
+}
+
+UniformBlockBinding::UniformBlockBinding(const std::string& blockName, GLuint index):
+    UniformBufferBinding(index),
+    _blockName(blockName),
+    _blockSize(0),
+    _revision(1)
+{
+}
+
+UniformBlockBinding::UniformBlockBinding(const UniformBlockBinding& rhs, const CopyOp& copyop):
+    UniformBufferBinding(rhs, copyop),
+    _blockName(rhs._blockName),
+    _blockSize(0),
+    _revision(1)
+{
+    // the buffer data isn't shared with rhs, so it is recreated by updateLayout().
+    _bufferData = 0;
+
+    for(Entries::const_iterator itr = rhs._entries.begin();
+        itr != rhs._entries.end();
+        ++itr)
+    {
+        Entry entry;
+        entry.uniform = copyop(itr->uniform.get());
+        _entries.push_back(entry);
+    }
+
+    updateLayout();
+}
+
+UniformBlockBinding::~UniformBlockBinding()
+{
+}
+
+bool UniformBlockBinding::isSupported(const Uniform* uniform)
+{
+    return uniform && uniform->getNumElements()>0 && getStd140Type(uniform->getType()).name!=0;
+}
+
+bool UniformBlockBinding::addUniform(Uniform* uniform)
+{
+    if (!isSupported(uniform))
+    {
+        OSG_NOTICE<<"Warning: UniformBlockBinding::addUniform() type of uniform "<<(uniform ? uniform->getName() : std::string())<<" not supported in a std140 uniform block."<<std::endl;
+        return false;
+    }
+
+    Entry entry;
+    entry.uniform = uniform;
+    _entries.push_back(entry);
+
+    updateLayout();
+    return true;
+}
+
+void UniformBlockBinding::removeUniform(Uniform* uniform)
+{
+    for(Entries::iterator itr = _entries.begin();
+        itr != _entries.end();
+        ++itr)
+    {
+        if (itr->uniform==uniform)
+        {
+            _entries.erase(itr);
+            updateLayout();
+            return;
+        }
+    }
+}
+
+void UniformBlockBinding::updateLayout()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    unsigned int offset = 0;
+    for(Entries::iterator itr = _entries.begin();
+        itr != _entries.end();
+        ++itr)
+    {
+        Entry& entry = *itr;
+        Std140Type type = getStd140Type(entry.uniform->getType());
+
+        // a vec3 is aligned as a vec4, matrices as arrays of column vectors and arrays on vec4 boundaries.
+        unsigned int vectorAlignment = type.componentSize * (type.rows==3 ? 4 : type.rows);
+        bool isArray = entry.uniform->getNumElements()>1;
+        bool isMatrix = type.columns>1;
+
+        unsigned int alignment = vectorAlignment;
+        if (isArray || isMatrix) alignment = roundUp(alignment, 16);
+
+        entry.columnStride = isMatrix ? roundUp(vectorAlignment, 16) : 0;
+
+        unsigned int elementSize = isMatrix ? type.columns*entry.columnStride : type.componentSize*type.rows;
+        entry.arrayStride = isArray ? roundUp(elementSize, 16) : elementSize;
+
+        offset = roundUp(offset, alignment);
+        entry.numElements = entry.uniform->getNumElements();
+        entry.offset = offset;
+        entry.size = isArray ? entry.arrayStride*entry.uniform->getNumElements() : elementSize;
+        entry.modifiedCount = 0xffffffff;
+
+        offset += entry.size;
+    }
+
+    _blockSize = roundUp(offset, 16);
+
+    if (!_data) _data = new UByteArray;
+    _data->resize(_blockSize);
+    if (_blockSize>0) memset(&_data->front(), 0, _blockSize);
+    _data->dirty();
+
+    if (_bufferData.get()!=_data.get())
+    {
+        _size = 0;
+        setBufferData(_data.get());
+    }
+    if (!dynamic_cast<UniformBufferObject*>(_data->getBufferObject()))
+    {
+        _data->setBufferObject(new UniformBufferObject);
+    }
+    _data->getBufferObject()->setUsage(GL_DYNAMIC_DRAW_ARB);
+    _size = _blockSize;
+}
+
+void UniformBlockBinding::packUniform(unsigned int i) const
+{
+    const Entry& entry = _entries[i];
+    const Uniform* uniform = entry.uniform.get();
+    Std140Type type = getStd140Type(uniform->getType());
+
+    const unsigned char* source = 0;
+    unsigned int numComponents = 0;
+    switch(Uniform::getInternalArrayType(uniform->getType()))
+    {
+        case(GL_FLOAT): if (uniform->getFloatArray()) { source = reinterpret_cast<const unsigned char*>(uniform->getFloatArray()->getDataPointer()); numComponents = uniform->getFloatArray()->getNumElements(); } break;
+        case(GL_DOUBLE): if (uniform->getDoubleArray()) { source = reinterpret_cast<const unsigned char*>(uniform->getDoubleArray()->getDataPointer()); numComponents = uniform->getDoubleArray()->getNumElements(); } break;
+        case(GL_INT): if (uniform->getIntArray()) { source = reinterpret_cast<const unsigned char*>(uniform->getIntArray()->getDataPointer()); numComponents = uniform->getIntArray()->getNumElements(); } break;
+        case(GL_UNSIGNED_INT): if (uniform->getUIntArray()) { source = reinterpret_cast<const unsigned char*>(uniform->getUIntArray()->getDataPointer()); numComponents = uniform->getUIntArray()->getNumElements(); } break;
+        default: break;
+    }
+    if (!source) return;
+
+    // never write past the elements laid out for the uniform, or read past the end of its data.
+    unsigned int numElements = osg::minimum(entry.numElements, numComponents/(type.rows*type.columns));
+
+    unsigned char* destination = &(_data->front()) + entry.offset;
+    unsigned int columnSize = type.componentSize*type.rows;
+    for(unsigned int element=0; element<numElements; ++element)
+    {
+        unsigned char* elementDestination = destination + element*entry.arrayStride;
+        for(unsigned int column=0; column<type.columns; ++column)
+        {
+            memcpy(elementDestination + column*entry.columnStride, source, columnSize);
+            source += columnSize;
+        }
+    }
+}
+
+bool UniformBlockBinding::packModifiedUniforms() const
+{
+    bool packed = false;
+    for(unsigned int i=0; i<_entries.size(); ++i)
+    {
+        const Entry& entry = _entries[i];
+        if (entry.modifiedCount!=entry.uniform->getModifiedCount())
+        {
+            if (!packed)
+            {
+                ++_revision;
+                packed = true;
+            }
+
+            packUniform(i);
+            entry.modifiedCount = entry.uniform->getModifiedCount();
+            entry.revision = _revision;
+        }
+    }
+    return packed;
+}
+
+std::string UniformBlockBinding::getBlockDeclaration() const
+{
+    std::ostringstream str;
+    str<<"layout(std140) uniform "<<_blockName<<" {";
+    for(Entries::const_iterator itr = _entries.begin();
+        itr != _entries.end();
+        ++itr)
+    {
+        str<<" "<<getStd140Type(itr->uniform->getType()).name<<" "<<itr->uniform->getName();
+        if (itr->uniform->getNumElements()>1) str<<"["<<itr->uniform->getNumElements()<<"]";
+        str<<";";
+    }
+    str<<" };";
+    return str.str();
+}
+
+UniformBlockBinding* UniformBlockBinding::createFromStateSet(StateSet* stateset, const std::string& blockName, GLuint index)
+{
+    if (!stateset) return 0;
+
+    ref_ptr<UniformBlockBinding> binding = new UniformBlockBinding(blockName, index);
+
+    // scalar int uniforms are left in the StateSet as they are commonly used to set sampler texture units.
+    // StateSet::UniformList is sorted by name so the layout is independent of the order the uniforms were added in.
+    std::vector< ref_ptr<Uniform> > packed;
+    const StateSet::UniformList& uniforms = stateset->getUniformList();
+    for(StateSet::UniformList::const_iterator itr = uniforms.begin();
+        itr != uniforms.end();
+        ++itr)
+    {
+        Uniform* uniform = dynamic_cast<Uniform*>(itr->second.first.get());
+        if (!uniform || !isSupported(uniform) ||
+            uniform->getUpdateCallback() || uniform->getEventCallback() ||
+            uniform->getName().compare(0, 4, "osg_")==0 ||
+            (uniform->getType()==Uniform::INT && uniform->getNumElements()==1))
+        {
+            continue;
+        }
+
+        Entry entry;
+        entry.uniform = uniform;
+        binding->_entries.push_back(entry);
+        packed.push_back(uniform);
+    }
+
+    if (packed.empty()) return 0;
+
+    binding->updateLayout();
+
+    for(std::vector< ref_ptr<Uniform> >::iterator itr = packed.begin();
+        itr != packed.end();
+        ++itr)
+    {
+        stateset->removeUniform(itr->get());
+    }
+
+    stateset->setAttribute(binding.get());
+    stateset->setDefine(blockName+"_DECLARATION", binding->getBlockDeclaration());
+
+    Program* program = dynamic_cast<Program*>(stateset->getAttribute(StateAttribute::PROGRAM));
+    if (program) program->addBindUniformBlock(blockName, index);
+
+    return binding.release();
+}
+
+void UniformBlockBinding::apply(State& state) const
+{
+    if (!_bufferData.valid() || _blockSize==0) return;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    packModifiedUniforms();
+
+    GLBufferObject* glObject = _bufferData->getBufferObject()->getOrCreateGLBufferObject(state.getContextID());
+    unsigned int& uploadedRevision = _uploadedRevision[state.getContextID()];
+
+    if (glObject->isDirty())
+    {
+        glObject->compileBuffer();
+        uploadedRevision = _revision;
+    }
+    else if (uploadedRevision!=_revision)
+    {
+        // upload the range spanning the uniforms modified since the last upload to this context.
+        unsigned int begin = _blockSize;
+        unsigned int end = 0;
+        for(Entries::const_iterator itr = _entries.begin();
+            itr != _entries.end();
+            ++itr)
+        {
+            if (itr->revision>uploadedRevision)
+            {
+                begin = osg::minimum(begin, itr->offset);
+                end = osg::maximum(end, itr->offset+itr->size);
+            }
+        }
+
+        if (begin<end)
+        {
+            glObject->bindBuffer();
+            glObject->_extensions->glBufferSubData(glObject->getProfile()._target,
+                glObject->getOffset(_bufferData->getBufferIndex())+begin, end-begin,
+                &(_data->front())+begin);
+        }
+        uploadedRevision = _revision;
+    }
+
+    glObject->_extensions->glBindBufferRange(_target, _index,
+            glObject->getGLObjectID(), glObject->getOffset(_bufferData->getBufferIndex())+_offset, _size-_offset);
+}
@@ -54,6 +54,11 @@ UpdateActionVisitor::UpdateActionVisitor()
     _currentAnimationPriority = 0;
 }
 
+void UpdateActionVisitor::setAnimationEvaluator(AnimationEvaluator* evaluator)
+{
+    _animationEvaluator = evaluator;
+}
+
 
 void UpdateActionVisitor::apply(Timeline& tm)
 {
@@ -142,7 +147,10 @@ void UpdateActionVisitor::apply(ActionAnimation& action)
         apply(static_cast<Action&>(action));
         int pri = static_cast<int>(_currentAnimationPriority);
         _currentAnimationPriority++;
-        action.updateAnimation(frame, -pri);
+        if (_animationEvaluator.valid())
+            _animationEvaluator->addAnimation(action.getAnimation(), frame * 1.0 / action.getFramesPerSecond(), -pri);
+        else
+            action.updateAnimation(frame, -pri);
     }
 }
 
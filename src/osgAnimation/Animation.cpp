@@ -114,7 +114,7 @@ void Animation::setWeight (float weight)
     _weight = weight;
 }
 
-bool Animation::update (double time, int priority)
+bool Animation::computeChannelTime(double time, double& channelTime)
 {
     if (!_duration) // if not initialized then do it
         computeDuration();
@@ -127,10 +127,7 @@ bool Animation::update (double time, int priority)
     case ONCE:
         if (t > _originalDuration)
         {
-            for (ChannelList::const_iterator chan = _channels.begin();
-                     chan != _channels.end(); ++chan)
-                (*chan)->update(_originalDuration, _weight, priority);
-
+            channelTime = _originalDuration;
             return false;
         }
         break;
@@ -158,12 +155,21 @@ bool Animation::update (double time, int priority)
         break;
     }
 
+    channelTime = t;
+    return true;
+}
+
+bool Animation::update (double time, int priority)
+{
+    double t;
+    bool playing = computeChannelTime(time, t);
+
     ChannelList::const_iterator chan;
     for( chan=_channels.begin(); chan!=_channels.end(); ++chan)
     {
         (*chan)->update(t, _weight, priority);
     }
-    return true;
+    return playing;
 }
 
 void Animation::resetTargets()
@@ -0,0 +1,271 @@
+/*  -*-c++-*-
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+ */
+
+#include <osgAnimation/AnimationCompressor>
+#include <osgAnimation/AnimationManagerBase>
+
+#include <float.h>
+#include <utility>
+#include <vector>
+
+using namespace osgAnimation;
+
+namespace
+{
+    float interpolationBlend(float t, float t1, float t2)
+    {
+        return t2 > t1 ? (t - t1) / (t2 - t1) : 0.0f;
+    }
+
+    float distance(const osg::Vec3& v1, const osg::Vec3& v2)
+    {
+        return (v1 - v2).length();
+    }
+
+    float distance(const osg::Quat& q1, const osg::Quat& q2)
+    {
+        double dot = osg::absolute(q1.asVec4() * q2.asVec4());
+        return 2.0 * acos(osg::minimum(dot, 1.0));
+    }
+
+    void interpolate(float blend, const osg::Vec3& v1, const osg::Vec3& v2, osg::Vec3& result)
+    {
+        result = v1*(1-blend) + v2*blend;
+    }
+
+    void interpolate(float blend, const osg::Quat& q1, const osg::Quat& q2, osg::Quat& result)
+    {
+        result.slerp(blend, q1, q2);
+    }
+
+    /** Mark in keep the keyframes needed for interpolating the decoded values of the keyframes kept to reproduce the
+      * original values within tolerance, by recursively keeping the keyframe of largest error, Douglas-Peucker style.*/
+    template <typename T>
+    void reduceKeyframes(const std::vector<float>& times, const std::vector<T>& values, const std::vector<T>& decoded,
+                         float tolerance, std::vector<bool>& keep)
+    {
+        unsigned int size = static_cast<unsigned int>(times.size());
+        keep.assign(size, false);
+        if (size==0) return;
+
+        keep.front() = true;
+        keep.back() = true;
+
+        std::vector< std::pair<unsigned int, unsigned int> > spans;
+        spans.push_back(std::make_pair(0u, size-1));
+        while(!spans.empty())
+        {
+            unsigned int first = spans.back().first;
+            unsigned int last = spans.back().second;
+            spans.pop_back();
+
+            unsigned int worst = first;
+            float worstError = tolerance;
+            for(unsigned int i = first+1; i < last; ++i)
+            {
+                T value;
+                interpolate(interpolationBlend(times[i], times[first], times[last]), decoded[first], decoded[last], value);
+                float error = distance(value, values[i]);
+                if (error > worstError)
+                {
+                    worst = i;
+                    worstError = error;
+                }
+            }
+
+            if (worst!=first)
+            {
+                keep[worst] = true;
+                spans.push_back(std::make_pair(first, worst));
+                spans.push_back(std::make_pair(worst, last));
+            }
+        }
+    }
+}
+
+AnimationCompressor::AnimationCompressor(float translationTolerance, float rotationTolerance):
+    osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+    _translationTolerance(translationTolerance),
+    _rotationTolerance(rotationTolerance)
+{
+    resetStats();
+}
+
+void AnimationCompressor::resetStats()
+{
+    _numChannels = 0;
+    _numKeyframesIn = 0;
+    _numKeyframesOut = 0;
+    _numBytesIn = 0;
+    _numBytesOut = 0;
+}
+
+void AnimationCompressor::apply(osg::Node& node)
+{
+    for(osg::Callback* callback = node.getUpdateCallback(); callback; callback = callback->getNestedCallback())
+    {
+        AnimationManagerBase* manager = dynamic_cast<AnimationManagerBase*>(callback);
+        if (!manager) continue;
+
+        AnimationList& animations = manager->getAnimationList();
+        for(AnimationList::iterator itr = animations.begin(); itr != animations.end(); ++itr)
+        {
+            compress(**itr);
+        }
+    }
+    traverse(node);
+}
+
+unsigned int AnimationCompressor::compress(Animation& animation)
+{
+    unsigned int numCompressed = 0;
+    ChannelList& channels = animation.getChannels();
+    for(ChannelList::iterator itr = channels.begin(); itr != channels.end(); ++itr)
+    {
+        Channel* channel = compress(**itr);
+        if (channel)
+        {
+            *itr = channel;
+            ++numCompressed;
+        }
+    }
+    return numCompressed;
+}
+
+Channel* AnimationCompressor::compress(const Channel& channel)
+{
+    if (const Vec3LinearChannel* vec3Channel = dynamic_cast<const Vec3LinearChannel*>(&channel))
+    {
+        const Vec3KeyframeContainer* keyframes = vec3Channel->getSamplerTyped() ? vec3Channel->getSamplerTyped()->getKeyframeContainerTyped() : 0;
+        if (!keyframes || keyframes->empty()) return 0;
+
+        Vec3QuantizedKeyframeContainer* compressed = compress(*keyframes);
+        if (!compressed) return 0;
+
+        Vec3QuantizedLinearChannel* result = new Vec3QuantizedLinearChannel(new Vec3QuantizedLinearSampler, const_cast<Vec3LinearChannel*>(vec3Channel)->getTargetTyped());
+        result->getSamplerTyped()->setKeyframeContainer(compressed);
+        result->setName(channel.getName());
+        result->setTargetName(channel.getTargetName());
+        return result;
+    }
+
+    if (const QuatSphericalLinearChannel* quatChannel = dynamic_cast<const QuatSphericalLinearChannel*>(&channel))
+    {
+        const QuatKeyframeContainer* keyframes = quatChannel->getSamplerTyped() ? quatChannel->getSamplerTyped()->getKeyframeContainerTyped() : 0;
+        if (!keyframes || keyframes->empty()) return 0;
+
+        QuatQuantizedKeyframeContainer* compressed = compress(*keyframes);
+        if (!compressed) return 0;
+
+        QuatQuantizedSphericalLinearChannel* result = new QuatQuantizedSphericalLinearChannel(new QuatQuantizedSphericalLinearSampler, const_cast<QuatSphericalLinearChannel*>(quatChannel)->getTargetTyped());
+        result->getSamplerTyped()->setKeyframeContainer(compressed);
+        result->setName(channel.getName());
+        result->setTargetName(channel.getTargetName());
+        return result;
+    }
+
+    return 0;
+}
+
+Vec3QuantizedKeyframeContainer* AnimationCompressor::compress(const Vec3KeyframeContainer& keyframes)
+{
+    unsigned int size = keyframes.size();
+
+    osg::Vec3 min(FLT_MAX, FLT_MAX, FLT_MAX);
+    osg::Vec3 max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for(unsigned int i=0; i<size; ++i)
+    {
+        const osg::Vec3& value = keyframes[i].getValue();
+        for(unsigned int j=0; j<3; ++j)
+        {
+            min[j] = osg::minimum(min[j], value[j]);
+            max[j] = osg::maximum(max[j], value[j]);
+        }
+    }
+
+    osg::Vec3 scale, scaleInv;
+    for(unsigned int j=0; j<3; ++j)
+    {
+        float range = max[j] - min[j];
+        scale[j] = range / 65535.0f;
+        scaleInv[j] = range > 0.0f ? 65535.0f / range : 0.0f;
+    }
+
+    // the quantization alone must stay within the tolerance
+    if (scale.length()*0.5f > _translationTolerance) return 0;
+
+    std::vector<float> times(size);
+    std::vector<osg::Vec3> values(size);
+    std::vector<osg::Vec3> decoded(size);
+    std::vector<Vec3Quantized> quantized(size);
+    for(unsigned int i=0; i<size; ++i)
+    {
+        times[i] = static_cast<float>(keyframes[i].getTime());
+        values[i] = keyframes[i].getValue();
+        quantized[i].compress(values[i], min, scaleInv);
+        quantized[i].uncompress(scale, min, decoded[i]);
+    }
+
+    std::vector<bool> keep;
+    reduceKeyframes(times, values, decoded, _translationTolerance, keep);
+
+    Vec3QuantizedKeyframeContainer* result = new Vec3QuantizedKeyframeContainer;
+    result->init(min, scale);
+    for(unsigned int i=0; i<size; ++i)
+    {
+        if (keep[i]) result->push_back(Vec3QuantizedKeyframe(times[i], quantized[i]));
+    }
+
+    ++_numChannels;
+    _numKeyframesIn += size;
+    _numKeyframesOut += result->size();
+    _numBytesIn += size * sizeof(Vec3Keyframe);
+    _numBytesOut += result->size() * sizeof(Vec3QuantizedKeyframe);
+    return result;
+}
+
+QuatQuantizedKeyframeContainer* AnimationCompressor::compress(const QuatKeyframeContainer& keyframes)
+{
+    unsigned int size = keyframes.size();
+
+    // the quantization alone must stay within the tolerance
+    if (QuatQuantized::getMaximumError() > _rotationTolerance) return 0;
+
+    std::vector<float> times(size);
+    std::vector<osg::Quat> values(size);
+    std::vector<osg::Quat> decoded(size);
+    std::vector<QuatQuantized> quantized(size);
+    for(unsigned int i=0; i<size; ++i)
+    {
+        times[i] = static_cast<float>(keyframes[i].getTime());
+        values[i] = keyframes[i].getValue();
+        quantized[i].compress(values[i]);
+        quantized[i].uncompress(decoded[i]);
+    }
+
+    std::vector<bool> keep;
+    reduceKeyframes(times, values, decoded, _rotationTolerance, keep);
+
+    QuatQuantizedKeyframeContainer* result = new QuatQuantizedKeyframeContainer;
+    for(unsigned int i=0; i<size; ++i)
+    {
+        if (keep[i]) result->push_back(QuatQuantizedKeyframe(times[i], quantized[i]));
+    }
+
+    ++_numChannels;
+    _numKeyframesIn += size;
+    _numKeyframesOut += result->size();
+    _numBytesIn += size * sizeof(QuatKeyframe);
+    _numBytesOut += result->size() * sizeof(QuatQuantizedKeyframe);
+    return result;
+}
@@ -0,0 +1,334 @@
+/*  -*-c++-*-
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+ */
+
+#include <osgAnimation/AnimationEvaluator>
+#include <osgAnimation/Channel>
+
+#include <osg/ParallelFor>
+
+#include <OpenThreads/Thread>
+
+#include <algorithm>
+#include <map>
+
+using namespace osgAnimation;
+
+/** The tracks of the channels of one type, sampled into a contiguous array of values.*/
+class AnimationEvaluator::TrackGroup : public osg::Referenced
+{
+public:
+    /// add channel if it is of the group's type, starting its key search from cursor
+    virtual bool addChannel(Channel* channel, unsigned int slot, int cursor) = 0;
+
+    virtual unsigned int getNumTracks() const = 0;
+    virtual Channel* getChannel(unsigned int i) const = 0;
+    virtual int getCursor(unsigned int i) const = 0;
+
+    /// sample the tracks in the range [begin, end), may be called from any thread
+    virtual void sample(unsigned int begin, unsigned int end, const AnimationSlotList& slots) = 0;
+
+    /// update the targets of the tracks in the range [begin, end) with their sampled values
+    virtual void write(unsigned int begin, unsigned int end, const AnimationSlotList& slots) = 0;
+
+    virtual void clear() = 0;
+};
+
+namespace
+{
+    template <class SamplerType>
+    class TemplateTrackGroup : public AnimationEvaluator::TrackGroup
+    {
+    public:
+        typedef TemplateChannel<SamplerType> ChannelType;
+        typedef typename SamplerType::UsingType UsingType;
+
+        struct Track
+        {
+            ChannelType*    channel;
+            unsigned int    slot;
+            int             cursor;
+            UsingType       value;
+        };
+
+        virtual bool addChannel(Channel* channel, unsigned int slot, int cursor)
+        {
+            ChannelType* typed = dynamic_cast<ChannelType*>(channel);
+            if (!typed || !typed->getSamplerTyped() || !typed->getTargetTyped()) return false;
+
+            Track track;
+            track.channel = typed;
+            track.slot = slot;
+            track.cursor = cursor;
+            _tracks.push_back(track);
+            return true;
+        }
+
+        virtual unsigned int getNumTracks() const { return static_cast<unsigned int>(_tracks.size()); }
+        virtual Channel* getChannel(unsigned int i) const { return _tracks[i].channel; }
+        virtual int getCursor(unsigned int i) const { return _tracks[i].cursor; }
+
+        virtual void sample(unsigned int begin, unsigned int end, const AnimationEvaluator::AnimationSlotList& slots)
+        {
+            for(unsigned int i=begin; i<end; ++i)
+            {
+                Track& track = _tracks[i];
+                const AnimationEvaluator::AnimationSlot& slot = slots[track.slot];
+                if (slot.weight < 1e-4) continue;
+
+                track.channel->getSamplerTyped()->getValueAt(slot.time, track.value, track.cursor);
+            }
+        }
+
+        virtual void write(unsigned int begin, unsigned int end, const AnimationEvaluator::AnimationSlotList& slots)
+        {
+            for(unsigned int i=begin; i<end; ++i)
+            {
+                const Track& track = _tracks[i];
+                const AnimationEvaluator::AnimationSlot& slot = slots[track.slot];
+                if (slot.weight < 1e-4) continue;
+
+                track.channel->getTargetTyped()->update(slot.weight, track.value, slot.priority);
+            }
+        }
+
+        virtual void clear() { _tracks.clear(); }
+
+    protected:
+        std::vector<Track> _tracks;
+    };
+
+    /** Channels of types without a TemplateTrackGroup, updated with Channel::update() when the targets are written.*/
+    class FallbackTrackGroup : public AnimationEvaluator::TrackGroup
+    {
+    public:
+        struct Track
+        {
+            Channel*        channel;
+            unsigned int    slot;
+        };
+
+        virtual bool addChannel(Channel* channel, unsigned int slot, int)
+        {
+            Track track;
+            track.channel = channel;
+            track.slot = slot;
+            _tracks.push_back(track);
+            return true;
+        }
+
+        virtual unsigned int getNumTracks() const { return static_cast<unsigned int>(_tracks.size()); }
+        virtual Channel* getChannel(unsigned int i) const { return _tracks[i].channel; }
+        virtual int getCursor(unsigned int) const { return -1; }
+
+        virtual void sample(unsigned int, unsigned int, const AnimationEvaluator::AnimationSlotList&) {}
+
+        virtual void write(unsigned int begin, unsigned int end, const AnimationEvaluator::AnimationSlotList& slots)
+        {
+            for(unsigned int i=begin; i<end; ++i)
+            {
+                const AnimationEvaluator::AnimationSlot& slot = slots[_tracks[i].slot];
+                _tracks[i].channel->update(slot.time, slot.weight, slot.priority);
+            }
+        }
+
+        virtual void clear() { _tracks.clear(); }
+
+    protected:
+        std::vector<Track> _tracks;
+    };
+
+    struct SampleChunks : public osg::ParallelForFunctor
+    {
+        SampleChunks(const AnimationEvaluator::ChunkList& chunks, const AnimationEvaluator::AnimationSlotList& slots):
+            _chunks(chunks),
+            _slots(slots) {}
+
+        virtual void operator () (unsigned int begin, unsigned int end)
+        {
+            for(unsigned int i=begin; i<end; ++i)
+            {
+                const AnimationEvaluator::Chunk& chunk = _chunks[i];
+                chunk.group->sample(chunk.begin, chunk.end, _slots);
+            }
+        }
+
+        const AnimationEvaluator::ChunkList&            _chunks;
+        const AnimationEvaluator::AnimationSlotList&    _slots;
+    };
+}
+
+AnimationEvaluator::AnimationEvaluator(unsigned int numThreads):
+    _numThreads(numThreads>0 ? numThreads : OpenThreads::GetNumberOfProcessors()),
+    _numChannelsPerChunk(256),
+    _dirty(true),
+    _numQueuedChannels(0)
+{
+    _groups.push_back(new TemplateTrackGroup<DoubleStepSampler>);
+    _groups.push_back(new TemplateTrackGroup<FloatStepSampler>);
+    _groups.push_back(new TemplateTrackGroup<Vec2StepSampler>);
+    _groups.push_back(new TemplateTrackGroup<Vec3StepSampler>);
+    _groups.push_back(new TemplateTrackGroup<Vec4StepSampler>);
+    _groups.push_back(new TemplateTrackGroup<QuatStepSampler>);
+
+    _groups.push_back(new TemplateTrackGroup<DoubleLinearSampler>);
+    _groups.push_back(new TemplateTrackGroup<FloatLinearSampler>);
+    _groups.push_back(new TemplateTrackGroup<Vec2LinearSampler>);
+    _groups.push_back(new TemplateTrackGroup<Vec3LinearSampler>);
+    _groups.push_back(new TemplateTrackGroup<Vec4LinearSampler>);
+    _groups.push_back(new TemplateTrackGroup<QuatSphericalLinearSampler>);
+    _groups.push_back(new TemplateTrackGroup<MatrixLinearSampler>);
+
+    _groups.push_back(new TemplateTrackGroup<Vec3QuantizedLinearSampler>);
+    _groups.push_back(new TemplateTrackGroup<QuatQuantizedSphericalLinearSampler>);
+
+    _groups.push_back(new TemplateTrackGroup<FloatCubicBezierSampler>);
+    _groups.push_back(new TemplateTrackGroup<DoubleCubicBezierSampler>);
+    _groups.push_back(new TemplateTrackGroup<Vec2CubicBezierSampler>);
+    _groups.push_back(new TemplateTrackGroup<Vec3CubicBezierSampler>);
+    _groups.push_back(new TemplateTrackGroup<Vec4CubicBezierSampler>);
+
+    // must be last as it accepts any channel
+    _groups.push_back(new FallbackTrackGroup);
+}
+
+AnimationEvaluator::~AnimationEvaluator()
+{
+}
+
+void AnimationEvaluator::setNumThreads(unsigned int numThreads)
+{
+    _numThreads = numThreads>0 ? numThreads : OpenThreads::GetNumberOfProcessors();
+}
+
+void AnimationEvaluator::setNumChannelsPerChunk(unsigned int numChannels)
+{
+    numChannels = std::max(1u, numChannels);
+    if (numChannels==_numChannelsPerChunk) return;
+
+    _numChannelsPerChunk = numChannels;
+    _dirty = true;
+}
+
+bool AnimationEvaluator::addAnimation(Animation* animation, double time, int priority)
+{
+    AnimationSlot slot;
+    bool playing = animation->computeChannelTime(time, slot.time);
+    slot.weight = animation->getWeight();
+    slot.priority = priority;
+
+    _animations.push_back(animation);
+    _slots.push_back(slot);
+
+    // compare the channels with those the tracks were built from, rebuilding if they differ.
+    const ChannelList& channels = animation->getChannels();
+    for(ChannelList::const_iterator itr = channels.begin(); itr != channels.end(); ++itr, ++_numQueuedChannels)
+    {
+        if (_numQueuedChannels>=_channels.size() || _channels[_numQueuedChannels]!=*itr) _dirty = true;
+    }
+
+    return playing;
+}
+
+void AnimationEvaluator::clear()
+{
+    _animations.clear();
+    _slots.clear();
+    _numQueuedChannels = 0;
+}
+
+void AnimationEvaluator::rebuild()
+{
+    // keep the cursors of the channels already evaluated, most will still be valid.
+    std::map<Channel*, int> cursors;
+    for(TrackGroupList::iterator itr = _groups.begin(); itr != _groups.end(); ++itr)
+    {
+        TrackGroup* group = itr->get();
+        for(unsigned int i=0; i<group->getNumTracks(); ++i)
+        {
+            cursors[group->getChannel(i)] = group->getCursor(i);
+        }
+        group->clear();
+    }
+
+    _channels.clear();
+    _writeOrder.clear();
+    for(unsigned int slot=0; slot<_animations.size(); ++slot)
+    {
+        const ChannelList& channels = _animations[slot]->getChannels();
+        for(ChannelList::const_iterator itr = channels.begin(); itr != channels.end(); ++itr)
+        {
+            Channel* channel = itr->get();
+            _channels.push_back(channel);
+
+            std::map<Channel*, int>::const_iterator citr = cursors.find(channel);
+            int cursor = citr!=cursors.end() ? citr->second : -1;
+
+            for(TrackGroupList::iterator gitr = _groups.begin(); gitr != _groups.end(); ++gitr)
+            {
+                TrackGroup* group = gitr->get();
+                if (!group->addChannel(channel, slot, cursor)) continue;
+
+                // the targets are written in the order of the channels, extending the last run where possible.
+                unsigned int index = group->getNumTracks()-1;
+                if (!_writeOrder.empty() && _writeOrder.back().group==group && _writeOrder.back().end==index)
+                {
+                    ++_writeOrder.back().end;
+                }
+                else
+                {
+                    Chunk run = { group, index, index+1 };
+                    _writeOrder.push_back(run);
+                }
+                break;
+            }
+        }
+    }
+
+    // split the sampled groups into chunks, the fallback group is updated as its targets are written.
+    _chunks.clear();
+    for(unsigned int g=0; g+1<_groups.size(); ++g)
+    {
+        TrackGroup* group = _groups[g].get();
+        unsigned int numTracks = group->getNumTracks();
+        for(unsigned int begin=0; begin<numTracks; begin+=_numChannelsPerChunk)
+        {
+            Chunk chunk = { group, begin, std::min(begin+_numChannelsPerChunk, numTracks) };
+            _chunks.push_back(chunk);
+        }
+    }
+
+    _dirty = false;
+}
+
+void AnimationEvaluator::sample()
+{
+    if (_chunks.empty()) return;
+
+    SampleChunks sampleChunks(_chunks, _slots);
+    osg::parallelFor(static_cast<unsigned int>(_chunks.size()), 1, sampleChunks, _numThreads);
+}
+
+void AnimationEvaluator::evaluate()
+{
+    if (_numQueuedChannels!=_channels.size()) _dirty = true;
+    if (_dirty) rebuild();
+
+    sample();
+
+    for(ChunkList::iterator itr = _writeOrder.begin(); itr != _writeOrder.end(); ++itr)
+    {
+        itr->group->write(itr->begin, itr->end, _slots);
+    }
+
+    clear();
+}
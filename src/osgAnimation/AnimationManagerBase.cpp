@@ -14,6 +14,7 @@
 
 #include <osgAnimation/AnimationManagerBase>
 #include <osgAnimation/LinkVisitor>
+#include <osgAnimation/Skeleton>
 #include <algorithm>
 
 using namespace osgAnimation;
@@ -24,6 +25,34 @@ AnimationManagerBase::AnimationManagerBase()
 {
     _needToLink = false;
     _automaticLink = true;
+    _skeletonUpdatePolicyDirty = false;
+}
+
+namespace
+{
+    struct AssignSkeletonUpdatePolicyVisitor : public osg::NodeVisitor
+    {
+        AssignSkeletonUpdatePolicyVisitor(SkeletonUpdatePolicy* policy):
+            osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+            _policy(policy) {}
+
+        void apply(osg::Transform& node)
+        {
+            Skeleton* skeleton = dynamic_cast<Skeleton*>(&node);
+            if (skeleton) skeleton->setUpdatePolicy(_policy);
+            traverse(node);
+        }
+
+        SkeletonUpdatePolicy* _policy;
+    };
+}
+
+void AnimationManagerBase::setSkeletonUpdatePolicy(SkeletonUpdatePolicy* policy)
+{
+    if (_skeletonUpdatePolicy==policy) return;
+
+    _skeletonUpdatePolicy = policy;
+    _skeletonUpdatePolicyDirty = true;
 }
 
 void AnimationManagerBase::clearTargets()
@@ -54,6 +83,13 @@ void AnimationManagerBase::operator()(osg::Node* node, osg::NodeVisitor* nv)
                 update of AnimationManager
             */
             link(node);
+            if (_skeletonUpdatePolicy.valid()) _skeletonUpdatePolicyDirty = true;
+        }
+        if (_skeletonUpdatePolicyDirty)
+        {
+            AssignSkeletonUpdatePolicyVisitor assignPolicy(_skeletonUpdatePolicy.get());
+            node->accept(assignPolicy);
+            _skeletonUpdatePolicyDirty = false;
         }
         const osg::FrameStamp* fs = nv->getFrameStamp();
         update(fs->getSimulationTime());
@@ -77,6 +113,9 @@ AnimationManagerBase::AnimationManagerBase(const AnimationManagerBase& b, const
     }
     _needToLink = true;
     _automaticLink = b._automaticLink;
+    if (b._animationEvaluator.valid()) _animationEvaluator = new AnimationEvaluator(b._animationEvaluator->getNumThreads());
+    _skeletonUpdatePolicy = b._skeletonUpdatePolicy;
+    _skeletonUpdatePolicyDirty = _skeletonUpdatePolicy.valid();
     buildTargetReference();
 }
 
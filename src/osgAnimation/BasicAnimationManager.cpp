@@ -104,7 +104,10 @@ void BasicAnimationManager::update (double time)
         AnimationList& list = iterAnim->second;
         for (unsigned int i = 0; i < list.size(); i++)
         {
-            if (! list[i]->update(time, priority))
+            bool playing = _animationEvaluator.valid() ?
+                _animationEvaluator->addAnimation(list[i].get(), time, priority) :
+                list[i]->update(time, priority);
+            if (!playing)
             {
                 // debug
                 // std::cout << list[i]->getName() << " finished at " << time << std::endl;
@@ -123,6 +126,9 @@ void BasicAnimationManager::update (double time)
             toremove.pop_back();
         }
     }
+
+    if (_animationEvaluator.valid())
+        _animationEvaluator->evaluate();
 }
 
 
@@ -0,0 +1,147 @@
+/*  -*-c++-*-
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+ */
+
+#include <osgAnimation/ParallelSkinningCallback>
+#include <osgAnimation/RigTransformSoftware>
+#include <osg/NodeVisitor>
+#include <osg/ParallelFor>
+
+#include <OpenThreads/Thread>
+
+#include <algorithm>
+
+using namespace osgAnimation;
+
+namespace
+{
+    struct CollectSoftwareRigGeometries : public osg::NodeVisitor
+    {
+        CollectSoftwareRigGeometries(std::vector< osg::ref_ptr<RigGeometry> >& rigGeometries):
+            osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+            _rigGeometries(rigGeometries) {}
+
+        void apply(osg::Geometry& geometry)
+        {
+            RigGeometry* rig = dynamic_cast<RigGeometry*>(&geometry);
+            if (rig && dynamic_cast<RigTransformSoftware*>(rig->getRigTransformImplementation()))
+            {
+                _rigGeometries.push_back(rig);
+            }
+        }
+
+        std::vector< osg::ref_ptr<RigGeometry> >& _rigGeometries;
+    };
+
+    struct SkinRigGeometries : public osg::ParallelForFunctor
+    {
+        SkinRigGeometries(std::vector<RigGeometry*>& rigGeometries):
+            _rigGeometries(rigGeometries) {}
+
+        virtual void operator () (unsigned int begin, unsigned int end)
+        {
+            for(unsigned int i=begin; i<end; ++i)
+            {
+                RigGeometry* rig = _rigGeometries[i];
+                static_cast<RigTransformSoftware*>(rig->getRigTransformImplementation())->skin(*rig);
+            }
+        }
+
+        std::vector<RigGeometry*>& _rigGeometries;
+    };
+}
+
+ParallelSkinningCallback::ParallelSkinningCallback(unsigned int numThreads):
+    _numThreads(numThreads>0 ? numThreads : OpenThreads::GetNumberOfProcessors()),
+    _numSkinned(0),
+    _rigGeometriesDirty(true),
+    _numChildrenRequiringUpdateTraversal(0)
+{
+}
+
+ParallelSkinningCallback::ParallelSkinningCallback(const ParallelSkinningCallback& psc, const osg::CopyOp& copyop):
+    osg::Object(psc, copyop),
+    osg::Callback(psc, copyop),
+    osg::NodeCallback(psc, copyop),
+    _numThreads(psc._numThreads),
+    _numSkinned(0),
+    _rigGeometriesDirty(true),
+    _numChildrenRequiringUpdateTraversal(0)
+{
+}
+
+ParallelSkinningCallback::~ParallelSkinningCallback()
+{
+}
+
+void ParallelSkinningCallback::setNumThreads(unsigned int numThreads)
+{
+    _numThreads = numThreads>0 ? numThreads : OpenThreads::GetNumberOfProcessors();
+}
+
+void ParallelSkinningCallback::operator()(osg::Node* node, osg::NodeVisitor* nv)
+{
+    // find the RigGeometry skinned in software, each just once as they may be reached through more than one path.
+    if (_rigGeometriesDirty || node->getNumChildrenRequiringUpdateTraversal()!=_numChildrenRequiringUpdateTraversal)
+    {
+        _rigGeometries.clear();
+        CollectSoftwareRigGeometries collect(_rigGeometries);
+        node->accept(collect);
+        std::sort(_rigGeometries.begin(), _rigGeometries.end());
+        _rigGeometries.erase(std::unique(_rigGeometries.begin(), _rigGeometries.end()), _rigGeometries.end());
+
+        _rigGeometriesDirty = false;
+        _numChildrenRequiringUpdateTraversal = node->getNumChildrenRequiringUpdateTraversal();
+    }
+
+    typedef std::vector< std::pair<RigGeometry*, RigTransformSoftware*> > DeferredList;
+    DeferredList deferred;
+    deferred.reserve(_rigGeometries.size());
+    for(RigGeometryList::iterator itr = _rigGeometries.begin(); itr != _rigGeometries.end(); ++itr)
+    {
+        // skip any RigGeometry removed from the scene graph, or switched to another implementation, since it was collected.
+        RigTransformSoftware* rts = dynamic_cast<RigTransformSoftware*>((*itr)->getRigTransformImplementation());
+        if (!rts || (*itr)->getNumParents()==0)
+        {
+            _rigGeometriesDirty = true;
+            continue;
+        }
+
+        rts->setDeferSkinning(true);
+        deferred.push_back(std::make_pair(itr->get(), rts));
+    }
+
+    traverse(node, nv);
+
+    std::vector<RigGeometry*> pending;
+    pending.reserve(deferred.size());
+    for(DeferredList::iterator itr = deferred.begin(); itr != deferred.end(); ++itr)
+    {
+        itr->second->setDeferSkinning(false);
+        if (itr->second->getSkinningPending() && itr->first->getRigTransformImplementation()==itr->second) pending.push_back(itr->first);
+    }
+
+    _numSkinned = static_cast<unsigned int>(pending.size());
+    if (pending.empty()) return;
+
+    unsigned int numWorkers = std::min(_numThreads, static_cast<unsigned int>(pending.size()));
+    SkinRigGeometries skinRigGeometries(pending);
+    osg::parallelFor(static_cast<unsigned int>(pending.size()), std::max(1u, static_cast<unsigned int>(pending.size())/(numWorkers*4)), skinRigGeometries, _numThreads);
+
+    // dirty the arrays on the update thread, as arrays of different RigGeometry may share a buffer object.
+    for(std::vector<RigGeometry*>::iterator itr = pending.begin(); itr != pending.end(); ++itr)
+    {
+        RigGeometry* rig = *itr;
+        if (rig->getVertexArray()) rig->getVertexArray()->dirty();
+        if (rig->getNormalArray() && rig->getSourceGeometry()->getNormalArray()) rig->getNormalArray()->dirty();
+    }
+}
@@ -20,10 +20,25 @@
 #include <osgAnimation/RigGeometry>
 
 #include <algorithm>
+#include <functional>
+#include <map>
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=1)
+    #include <xmmintrin.h>
+    #define OSGANIMATION_SKINNING_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define OSGANIMATION_SKINNING_NEON
+#endif
 
 using namespace osgAnimation;
 
-RigTransformSoftware::RigTransformSoftware()
+RigTransformSoftware::RigTransformSoftware():
+    _deferSkinning(false),
+    _skinningPending(false),
+    _maxInfluences(0),
+    _reducedMaxInfluences(0)
 {
     _needInit = true;
 }
@@ -31,7 +46,11 @@ RigTransformSoftware::RigTransformSoftware()
 RigTransformSoftware::RigTransformSoftware(const RigTransformSoftware& rts,const osg::CopyOp& copyop):
     RigTransform(rts, copyop),
     _needInit(rts._needInit),
-    _invalidInfluence(rts._invalidInfluence)
+    _invalidInfluence(rts._invalidInfluence),
+    _deferSkinning(false),
+    _skinningPending(false),
+    _maxInfluences(0),
+    _reducedMaxInfluences(0)
 {
 
 }
@@ -203,11 +222,116 @@ bool RigTransformSoftware::init(RigGeometry&rig)
         itvg->normalize();
     }
 
+    buildSkinningData();
+
     _needInit = false;
 
     return true;
 }
 
+void RigTransformSoftware::buildSkinningData()
+{
+    _bones.clear();
+    _skinningMatrices.clear();
+    _groupBoneOffsets.clear();
+    _groupBones.clear();
+    _groupWeights.clear();
+    _groupVertexOffsets.clear();
+    _groupVertices.clear();
+
+    typedef std::map<const Bone*, unsigned int> BoneIndexMap;
+    BoneIndexMap boneIndices;
+
+    _groupBoneOffsets.reserve(_uniqVertexGroupList.size()+1);
+    _groupVertexOffsets.reserve(_uniqVertexGroupList.size()+1);
+
+    for(VertexGroupList::iterator itvg = _uniqVertexGroupList.begin(); itvg != _uniqVertexGroupList.end(); ++itvg)
+    {
+        _groupBoneOffsets.push_back(static_cast<unsigned int>(_groupBones.size()));
+        _groupVertexOffsets.push_back(static_cast<unsigned int>(_groupVertices.size()));
+
+        BonePtrWeightList& boneWeights = itvg->getBoneWeights();
+        for(BonePtrWeightList::iterator bwit = boneWeights.begin(); bwit != boneWeights.end(); ++bwit)
+        {
+            const Bone* bone = bwit->getBonePtr();
+            BoneIndexMap::iterator bitr = boneIndices.find(bone);
+            if (bitr == boneIndices.end())
+            {
+                bitr = boneIndices.insert(BoneIndexMap::value_type(bone, static_cast<unsigned int>(_bones.size()))).first;
+                _bones.push_back(const_cast<Bone*>(bone));
+            }
+
+            _groupBones.push_back(bitr->second);
+            _groupWeights.push_back(bwit->getWeight());
+        }
+
+        if (boneWeights.empty())
+        {
+            OSG_WARN << "RigTransformSoftware::VertexGroup no bones found, its vertices are left as is" << std::endl;
+        }
+
+        const IndexList& vertices = itvg->getVertices();
+        _groupVertices.insert(_groupVertices.end(), vertices.begin(), vertices.end());
+    }
+
+    _groupBoneOffsets.push_back(static_cast<unsigned int>(_groupBones.size()));
+    _groupVertexOffsets.push_back(static_cast<unsigned int>(_groupVertices.size()));
+
+    _skinningMatrices.resize(_bones.size());
+
+    _reducedMaxInfluences = 0;
+}
+
+void RigTransformSoftware::buildReducedSkinningData(unsigned int maxInfluences)
+{
+    _reducedGroupBoneOffsets.clear();
+    _reducedGroupBones.clear();
+    _reducedGroupWeights.clear();
+    _reducedBones.clear();
+
+    std::vector<bool> boneUsed(_bones.size(), false);
+    std::vector< std::pair<float, unsigned int> > influences;
+
+    unsigned int numGroups = _groupBoneOffsets.empty() ? 0 : static_cast<unsigned int>(_groupBoneOffsets.size()-1);
+    _reducedGroupBoneOffsets.reserve(numGroups+1);
+    for(unsigned int g=0; g<numGroups; ++g)
+    {
+        _reducedGroupBoneOffsets.push_back(static_cast<unsigned int>(_reducedGroupBones.size()));
+
+        influences.clear();
+        for(unsigned int b=_groupBoneOffsets[g]; b<_groupBoneOffsets[g+1]; ++b)
+        {
+            influences.push_back(std::make_pair(_groupWeights[b], _groupBones[b]));
+        }
+
+        // keep the bones of largest weight, renormalizing their weights so the vertices aren't scaled
+        if (influences.size()>maxInfluences)
+        {
+            std::partial_sort(influences.begin(), influences.begin()+maxInfluences, influences.end(), std::greater< std::pair<float, unsigned int> >());
+            influences.resize(maxInfluences);
+        }
+
+        float sum = 0.0f;
+        for(unsigned int i=0; i<influences.size(); ++i) sum += influences[i].first;
+        float scale = sum>1e-4f ? 1.0f/sum : 1.0f;
+
+        for(unsigned int i=0; i<influences.size(); ++i)
+        {
+            _reducedGroupBones.push_back(influences[i].second);
+            _reducedGroupWeights.push_back(influences[i].first*scale);
+            boneUsed[influences[i].second] = true;
+        }
+    }
+    _reducedGroupBoneOffsets.push_back(static_cast<unsigned int>(_reducedGroupBones.size()));
+
+    for(unsigned int i=0; i<boneUsed.size(); ++i)
+    {
+        if (boneUsed[i]) _reducedBones.push_back(i);
+    }
+
+    _reducedMaxInfluences = maxInfluences;
+}
+
 void RigTransformSoftware::VertexGroup::normalize()
 {
     osg::Matrix::value_type sum=0;
@@ -229,38 +353,200 @@ void RigTransformSoftware::VertexGroup::normalize()
     }
 }
 
-void RigTransformSoftware::operator()(RigGeometry& geom)
+bool RigTransformSoftware::computeSkinningMatrices(RigGeometry& geom)
 {
-    if (_needInit && !init(geom)) return;
+    if (_needInit && !init(geom)) return false;
 
     if (!geom.getSourceGeometry())
     {
         OSG_WARN << this << " RigTransformSoftware no source geometry found on RigGeometry" << std::endl;
-        return;
+        return false;
     }
-    
+
+    // the skeleton's update policy may limit the bones influencing each vertex of distant characters
+    _maxInfluences = geom.getSkeleton() ? geom.getSkeleton()->getMaxInfluences() : 0;
+    if (_maxInfluences>0 && _maxInfluences!=_reducedMaxInfluences) buildReducedSkinningData(_maxInfluences);
+
+    const osg::Matrix& transform = geom.getMatrixFromSkeletonToGeometry();
+    const osg::Matrix& invTransform = geom.getInvMatrixFromSkeletonToGeometry();
+
+    // the weighted sum of the bone matrices of a vertex group is linear, so the transforms to and from the skeleton
+    // can be folded into each bone's matrix once rather than into every vertex group's matrix.
+    unsigned int numBones = _maxInfluences>0 ? static_cast<unsigned int>(_reducedBones.size()) : static_cast<unsigned int>(_bones.size());
+    for(unsigned int b=0; b<numBones; ++b)
+    {
+        unsigned int i = _maxInfluences>0 ? _reducedBones[b] : b;
+        SkinningMatrix& sm = _skinningMatrices[i];
+
+        const Bone* bone = _bones[i].get();
+        if (!bone)
+        {
+            // a bone that has been deleted no longer contributes to its vertices
+            memset(sm.rows, 0, sizeof(sm.rows));
+            continue;
+        }
+
+        osg::Matrix matrix = transform * bone->getInvBindMatrixInSkeletonSpace() * bone->getMatrixInSkeletonSpace() * invTransform;
+        for(unsigned int r=0; r<4; ++r)
+        {
+            sm.rows[r][0] = static_cast<float>(matrix(r,0));
+            sm.rows[r][1] = static_cast<float>(matrix(r,1));
+            sm.rows[r][2] = static_cast<float>(matrix(r,2));
+            sm.rows[r][3] = 0.0f;
+        }
+    }
+
+    return true;
+}
+
+namespace
+{
+
+#if defined(OSGANIMATION_SKINNING_SSE)
+
+    typedef __m128 Row;
+
+    inline Row loadRow(const float* ptr) { return _mm_loadu_ps(ptr); }
+    inline Row setRow(float x, float y, float z) { return _mm_set_ps(0.0f, z, y, x); }
+    inline Row zeroRow() { return _mm_setzero_ps(); }
+    inline Row mulRow(const Row& a, float s) { return _mm_mul_ps(a, _mm_set1_ps(s)); }
+    inline Row maddRow(const Row& a, float s, const Row& b) { return _mm_add_ps(b, _mm_mul_ps(a, _mm_set1_ps(s))); }
+    inline void storeRow(const Row& r, osg::Vec3& v)
+    {
+        float result[4];
+        _mm_storeu_ps(result, r);
+        v.set(result[0], result[1], result[2]);
+    }
+
+#elif defined(OSGANIMATION_SKINNING_NEON)
+
+    typedef float32x4_t Row;
+
+    inline Row loadRow(const float* ptr) { return vld1q_f32(ptr); }
+    inline Row setRow(float x, float y, float z) { float v[4] = { x, y, z, 0.0f }; return vld1q_f32(v); }
+    inline Row zeroRow() { return vdupq_n_f32(0.0f); }
+    inline Row mulRow(const Row& a, float s) { return vmulq_n_f32(a, s); }
+    inline Row maddRow(const Row& a, float s, const Row& b) { return vmlaq_n_f32(b, a, s); }
+    inline void storeRow(const Row& r, osg::Vec3& v)
+    {
+        float result[4];
+        vst1q_f32(result, r);
+        v.set(result[0], result[1], result[2]);
+    }
+
+#else
+
+    struct Row { float v[4]; };
+
+    inline Row loadRow(const float* ptr) { Row r; r.v[0]=ptr[0]; r.v[1]=ptr[1]; r.v[2]=ptr[2]; r.v[3]=ptr[3]; return r; }
+    inline Row setRow(float x, float y, float z) { Row r; r.v[0]=x; r.v[1]=y; r.v[2]=z; r.v[3]=0.0f; return r; }
+    inline Row zeroRow() { return setRow(0.0f, 0.0f, 0.0f); }
+    inline Row mulRow(const Row& a, float s) { return setRow(a.v[0]*s, a.v[1]*s, a.v[2]*s); }
+    inline Row maddRow(const Row& a, float s, const Row& b) { return setRow(b.v[0]+a.v[0]*s, b.v[1]+a.v[1]*s, b.v[2]+a.v[2]*s); }
+    inline void storeRow(const Row& r, osg::Vec3& v) { v.set(r.v[0], r.v[1], r.v[2]); }
+
+#endif
+
+    /** Skin the vertices, and optionally normals, of each vertex group by the weighted sum of its bones' matrices,
+      * each matrix being 16 floats, 4 rows of 4, of which the first 3 columns are used.*/
+    void skinVertexGroups(const float* matrices,
+                          unsigned int numGroups,
+                          const unsigned int* boneOffsets, const unsigned int* bones, const float* weights,
+                          const unsigned int* vertexOffsets, const unsigned int* vertices,
+                          const osg::Vec3* positionSrc, osg::Vec3* positionDst,
+                          const osg::Vec3* normalSrc, osg::Vec3* normalDst)
+    {
+        for(unsigned int g=0; g<numGroups; ++g)
+        {
+            Row r0, r1, r2, r3;
+            if (boneOffsets[g]==boneOffsets[g+1])
+            {
+                r0 = setRow(1.0f, 0.0f, 0.0f);
+                r1 = setRow(0.0f, 1.0f, 0.0f);
+                r2 = setRow(0.0f, 0.0f, 1.0f);
+                r3 = zeroRow();
+            }
+            else
+            {
+                r0 = r1 = r2 = r3 = zeroRow();
+                for(unsigned int b=boneOffsets[g]; b<boneOffsets[g+1]; ++b)
+                {
+                    const float* m = matrices + bones[b]*16;
+                    float w = weights[b];
+                    r0 = maddRow(loadRow(m), w, r0);
+                    r1 = maddRow(loadRow(m+4), w, r1);
+                    r2 = maddRow(loadRow(m+8), w, r2);
+                    r3 = maddRow(loadRow(m+12), w, r3);
+                }
+            }
+
+            const unsigned int* vitr = vertices + vertexOffsets[g];
+            const unsigned int* vend = vertices + vertexOffsets[g+1];
+            if (normalSrc)
+            {
+                for(; vitr!=vend; ++vitr)
+                {
+                    const osg::Vec3& p = positionSrc[*vitr];
+                    storeRow(maddRow(r0, p.x(), maddRow(r1, p.y(), maddRow(r2, p.z(), r3))), positionDst[*vitr]);
+
+                    const osg::Vec3& n = normalSrc[*vitr];
+                    storeRow(maddRow(r0, n.x(), maddRow(r1, n.y(), mulRow(r2, n.z()))), normalDst[*vitr]);
+                }
+            }
+            else
+            {
+                for(; vitr!=vend; ++vitr)
+                {
+                    const osg::Vec3& p = positionSrc[*vitr];
+                    storeRow(maddRow(r0, p.x(), maddRow(r1, p.y(), maddRow(r2, p.z(), r3))), positionDst[*vitr]);
+                }
+            }
+        }
+    }
+
+}
+
+void RigTransformSoftware::skin(RigGeometry& geom)
+{
+    _skinningPending = false;
+
+    if (_groupVertexOffsets.empty() || !geom.getSourceGeometry()) return;
+
     osg::Geometry& source = *geom.getSourceGeometry();
     osg::Geometry& destination = geom;
 
-    osg::Vec3Array* positionSrc = static_cast<osg::Vec3Array*>(source.getVertexArray());
-    osg::Vec3Array* positionDst = static_cast<osg::Vec3Array*>(destination.getVertexArray());
+    osg::Vec3Array* positionSrc = dynamic_cast<osg::Vec3Array*>(source.getVertexArray());
+    osg::Vec3Array* positionDst = dynamic_cast<osg::Vec3Array*>(destination.getVertexArray());
     osg::Vec3Array* normalSrc = dynamic_cast<osg::Vec3Array*>(source.getNormalArray());
-    osg::Vec3Array* normalDst = static_cast<osg::Vec3Array*>(destination.getNormalArray());
+    osg::Vec3Array* normalDst = dynamic_cast<osg::Vec3Array*>(destination.getNormalArray());
 
+    if (!positionSrc || !positionDst || positionSrc->empty() || positionDst->size()<positionSrc->size()) return;
+    if (!normalSrc || !normalDst || normalSrc->empty() || normalDst->size()<normalSrc->size()) normalSrc = normalDst = 0;
 
-    compute<osg::Vec3>(geom.getMatrixFromSkeletonToGeometry(),
-                       geom.getInvMatrixFromSkeletonToGeometry(),
-                       &positionSrc->front(),
-                       &positionDst->front());    
-    positionDst->dirty();
+    const std::vector<unsigned int>& boneOffsets = _maxInfluences>0 ? _reducedGroupBoneOffsets : _groupBoneOffsets;
+    const std::vector<unsigned int>& bones = _maxInfluences>0 ? _reducedGroupBones : _groupBones;
+    const std::vector<float>& weights = _maxInfluences>0 ? _reducedGroupWeights : _groupWeights;
 
-    if (normalSrc )
+    skinVertexGroups(_skinningMatrices.empty() ? 0 : &(_skinningMatrices.front().rows[0][0]),
+                     static_cast<unsigned int>(_groupVertexOffsets.size()-1),
+                     &boneOffsets.front(), bones.empty() ? 0 : &bones.front(), weights.empty() ? 0 : &weights.front(),
+                     &_groupVertexOffsets.front(), _groupVertices.empty() ? 0 : &_groupVertices.front(),
+                     &positionSrc->front(), &positionDst->front(),
+                     normalSrc ? &normalSrc->front() : 0, normalDst ? &normalDst->front() : 0);
+}
+
+void RigTransformSoftware::operator()(RigGeometry& geom)
+{
+    if (!computeSkinningMatrices(geom)) return;
+
+    if (_deferSkinning)
     {
-        computeNormal<osg::Vec3>(geom.getMatrixFromSkeletonToGeometry(),
-                                 geom.getInvMatrixFromSkeletonToGeometry(),
-                                 &normalSrc->front(),
-                                 &normalDst->front());
-        normalDst->dirty();
+        _skinningPending = true;
+        return;
     }
 
+    skin(geom);
+
+    if (geom.getVertexArray()) geom.getVertexArray()->dirty();
+    if (geom.getNormalArray() && geom.getSourceGeometry()->getNormalArray()) geom.getNormalArray()->dirty();
 }
@@ -15,12 +15,38 @@
 #include <osgAnimation/Skeleton>
 #include <osgAnimation/Bone>
 #include <osg/Notify>
+#include <osg/CullStack>
 
 using namespace osgAnimation;
 
 Skeleton::Skeleton() {}
 
-Skeleton::Skeleton(const Skeleton& b, const osg::CopyOp& copyop) : osg::MatrixTransform(b,copyop) {}
+Skeleton::Skeleton(const Skeleton& b, const osg::CopyOp& copyop) :
+    osg::MatrixTransform(b,copyop),
+    _updatePolicy(b._updatePolicy)
+{
+}
+
+void Skeleton::traverse(osg::NodeVisitor& nv)
+{
+    if (_updatePolicy.valid() && nv.getVisitorType()==osg::NodeVisitor::CULL_VISITOR && nv.getFrameStamp())
+    {
+        osg::CullStack* cullStack = nv.asCullStack();
+        if (cullStack)
+        {
+            // the skeleton's matrix is already on the cull stack, so size the bound of its children.
+            osg::BoundingSphere bs;
+            for(osg::NodeList::iterator itr = _children.begin(); itr != _children.end(); ++itr)
+            {
+                bs.expandBy((*itr)->getBound());
+            }
+            float screenSize = bs.valid() ? cullStack->clampedPixelSize(bs) : 0.0f;
+            _updatePolicy->recordVisible(*this, nv.getFrameStamp()->getFrameNumber(), screenSize);
+        }
+    }
+
+    osg::MatrixTransform::traverse(nv);
+}
 
 Skeleton::UpdateSkeleton::UpdateSkeleton() : _needValidate(true) {}
 
@@ -90,6 +116,13 @@ void Skeleton::UpdateSkeleton::operator()(osg::Node* node, osg::NodeVisitor* nv)
             }
             _needValidate = false;
         }
+
+        if (skeleton && skeleton->getUpdatePolicy() && nv->getFrameStamp() &&
+            !skeleton->getUpdatePolicy()->update(*skeleton, nv->getFrameStamp()->getFrameNumber()))
+        {
+            // skip the update traversal of the whole subgraph, leaving the bones and rigs below in the pose of the last update
+            return;
+        }
     }
     traverse(node,nv);
 }
@@ -0,0 +1,170 @@
+/*  -*-c++-*-
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+ */
+
+#include <osgAnimation/SkeletonUpdatePolicy>
+#include <osgAnimation/Skeleton>
+
+#include <OpenThreads/ScopedLock>
+
+#include <algorithm>
+#include <float.h>
+
+using namespace osgAnimation;
+
+namespace
+{
+    struct LargerScreenSize
+    {
+        bool operator() (const SkeletonUpdatePolicy::Level& lhs, const SkeletonUpdatePolicy::Level& rhs) const
+        {
+            return lhs.minScreenSize > rhs.minScreenSize;
+        }
+    };
+}
+
+SkeletonUpdatePolicy::SkeletonUpdatePolicy():
+    _culledUpdateInterval(10),
+    _cullRecorded(false),
+    _frameNumber(0),
+    _numUpdated(0),
+    _numSkipped(0),
+    _lastNumUpdated(0),
+    _lastNumSkipped(0)
+{
+}
+
+SkeletonUpdatePolicy::SkeletonUpdatePolicy(const SkeletonUpdatePolicy& sup, const osg::CopyOp& copyop):
+    osg::Object(sup, copyop),
+    _levels(sup._levels),
+    _culledUpdateInterval(sup._culledUpdateInterval),
+    _cullRecorded(false),
+    _frameNumber(0),
+    _numUpdated(0),
+    _numSkipped(0),
+    _lastNumUpdated(0),
+    _lastNumSkipped(0)
+{
+}
+
+void SkeletonUpdatePolicy::addLevel(float minScreenSize, unsigned int updateInterval, unsigned int maxInfluences)
+{
+    _levels.push_back(Level(minScreenSize, updateInterval, maxInfluences));
+    std::stable_sort(_levels.begin(), _levels.end(), LargerScreenSize());
+}
+
+void SkeletonUpdatePolicy::setLevels(const LevelList& levels)
+{
+    _levels = levels;
+    std::stable_sort(_levels.begin(), _levels.end(), LargerScreenSize());
+}
+
+const SkeletonUpdatePolicy::Level* SkeletonUpdatePolicy::getLevel(float screenSize) const
+{
+    for(LevelList::const_iterator itr = _levels.begin(); itr != _levels.end(); ++itr)
+    {
+        if (screenSize >= itr->minScreenSize) return &(*itr);
+    }
+    return 0;
+}
+
+void SkeletonUpdatePolicy::recordVisible(Skeleton& skeleton, unsigned int frameNumber, float screenSize)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    // take the largest size the skeleton is drawn at by the cameras of the frame
+    Skeleton::UpdateState& state = skeleton.getUpdateState();
+    if (!state.visible || state.visibleFrameNumber!=frameNumber)
+    {
+        state.visible = true;
+        state.visibleFrameNumber = frameNumber;
+        state.screenSize = screenSize;
+    }
+    else if (screenSize > state.screenSize)
+    {
+        state.screenSize = screenSize;
+    }
+
+    _cullRecorded = true;
+}
+
+bool SkeletonUpdatePolicy::update(Skeleton& skeleton, unsigned int frameNumber)
+{
+    if (frameNumber!=_frameNumber)
+    {
+        _lastNumUpdated = _numUpdated;
+        _lastNumSkipped = _numSkipped;
+        _numUpdated = 0;
+        _numSkipped = 0;
+        _frameNumber = frameNumber;
+    }
+
+    Skeleton::UpdateState& state = skeleton.getUpdateState();
+    if (state.updated && state.updateFrameNumber==frameNumber) return true;
+
+    bool culled;
+    float screenSize;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+        // a skeleton not culled in yet is first updated as if culled in at full size by the cull traversal of the
+        // previous frame, so that one off screen from the start is throttled as culled once the next cull traversal
+        // has passed it by.
+        if (!state.visible)
+        {
+            state.visible = true;
+            state.visibleFrameNumber = frameNumber-1;
+            state.screenSize = FLT_MAX;
+        }
+
+        // the cull traversal of the previous frame decides, once any skeleton sharing the policy has been culled in.
+        culled = _cullRecorded && state.visibleFrameNumber+1 < frameNumber;
+        screenSize = state.screenSize;
+    }
+
+    unsigned int updateInterval = 1;
+    unsigned int maxInfluences = state.maxInfluences;
+    if (culled)
+    {
+        updateInterval = _culledUpdateInterval;
+    }
+    else
+    {
+        const Level* level = getLevel(screenSize);
+        updateInterval = level ? level->updateInterval : 1;
+        maxInfluences = level ? level->maxInfluences : 0;
+    }
+
+    bool needsUpdate = !state.updated ||
+                       frameNumber < state.updateFrameNumber ||
+                       (updateInterval>0 && frameNumber-state.updateFrameNumber >= updateInterval);
+
+    if (!needsUpdate)
+    {
+        ++_numSkipped;
+        return false;
+    }
+
+    state.updated = true;
+    state.updateFrameNumber = frameNumber;
+    state.maxInfluences = maxInfluences;
+    ++_numUpdated;
+    return true;
+}
+
+void SkeletonUpdatePolicy::reportStats(osg::Stats* stats, unsigned int frameNumber) const
+{
+    if (!stats) return;
+
+    stats->setAttribute(frameNumber, "Skeletons updated", _lastNumUpdated);
+    stats->setAttribute(frameNumber, "Skeleton updates skipped", _lastNumSkipped);
+}
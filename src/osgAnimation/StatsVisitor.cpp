@@ -33,6 +33,11 @@ StatsActionVisitor::StatsActionVisitor(osg::Stats* stats,unsigned int frame)
 void StatsActionVisitor::apply(Timeline& tm)
 {
     _stats->setAttribute(_frame,"Timeline", tm.getCurrentTime());
+
+    AnimationManagerBase* manager = tm.getAnimationManager();
+    if (manager && manager->getSkeletonUpdatePolicy())
+        manager->getSkeletonUpdatePolicy()->reportStats(_stats.get(), _frame);
+
     tm.traverse(*this);
 }
 
@@ -95,6 +95,7 @@ void Timeline::update(double simulationTime)
 {
     // first time we call update we generate one frame
     UpdateActionVisitor updateTimeline;
+    updateTimeline.setAnimationEvaluator(_animationManager->getAnimationEvaluator());
     if (!_initFirstFrame)
     {
         _lastUpdate = simulationTime;
@@ -104,6 +105,8 @@ void Timeline::update(double simulationTime)
         _animationManager->clearTargets();
         updateTimeline.setFrame(_currentFrame);
         accept(updateTimeline);
+        if (updateTimeline.getAnimationEvaluator())
+            updateTimeline.getAnimationEvaluator()->evaluate();
 
         if (_collectStats)
         {
@@ -131,6 +134,8 @@ void Timeline::update(double simulationTime)
         _animationManager->clearTargets();
         updateTimeline.setFrame(_currentFrame);
         accept(updateTimeline);
+        if (updateTimeline.getAnimationEvaluator())
+            updateTimeline.getAnimationEvaluator()->evaluate();
         if (_collectStats)
         {
             if (!_statsVisitor)
@@ -14,19 +14,53 @@
 
 #include <osg/Notify>
 #include <osg/ImageSequence>
+#include <osg/OperationThread>
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
 #include <osgDB/XmlParser>
 #include <osgDB/FileNameUtils>
 #include <osgDB/ObjectWrapper>
 #include <osgDB/ConvertBase64>
+#include <OpenThreads/Thread>
+#include <stdlib.h>
 
 using namespace osgDB;
 
 static std::string s_lastSchema;
 
+static unsigned int getImageComponentSize( GLenum dataType )
+{
+    switch ( dataType )
+    {
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:
+    case GL_UNSIGNED_SHORT_5_6_5:
+    case GL_UNSIGNED_SHORT_5_6_5_REV:
+    case GL_UNSIGNED_SHORT_4_4_4_4:
+    case GL_UNSIGNED_SHORT_4_4_4_4_REV:
+    case GL_UNSIGNED_SHORT_5_5_5_1:
+    case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+        return 2;
+    case GL_INT:
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:
+    case GL_UNSIGNED_INT_8_8_8_8:
+    case GL_UNSIGNED_INT_8_8_8_8_REV:
+    case GL_UNSIGNED_INT_10_10_10_2:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+        return 4;
+    case GL_DOUBLE:
+        return 8;
+    default:
+        return 1;
+    }
+}
+
 InputStream::InputStream( const osgDB::Options* options )
-    :   _fileVersion(0), _useSchemaData(false), _forceReadingImage(false), _dataDecompress(0)
+    :   _fileVersion(0), _useSchemaData(false), _forceReadingImage(false), _dataDecompress(0),
+        _useObjectBlocks(false), _numObjectBlockThreads(OpenThreads::GetNumberOfProcessors()),
+        _objectBlockSet(0), _objectBlockIndex(0)
 {
     BEGIN_BRACKET.set( "{", +INDENT_VALUE );
     END_BRACKET.set( "}", -INDENT_VALUE );
@@ -37,6 +71,9 @@ InputStream::InputStream( const osgDB::Options* options )
     if ( options->getPluginStringData("ForceReadingImage")=="true" )
         _forceReadingImage = true;
 
+    if ( !options->getPluginStringData("ObjectBlockThreads").empty() )
+        _numObjectBlockThreads = atoi( options->getPluginStringData("ObjectBlockThreads").c_str() );
+
     if ( !options->getPluginStringData("CustomDomains").empty() )
     {
         StringList domains, keyAndValue;
@@ -330,11 +367,7 @@ osg::ref_ptr<osg::Array> InputStream::readArray()
     unsigned int id = 0;
     *this >> PROPERTY("ArrayID") >> id;
 
-    ArrayMap::iterator itr = _arrayMap.find( id );
-    if ( itr!=_arrayMap.end() )
-    {
-        return itr->second.get();
-    }
+    if ( findArray(id, array) ) return array;
 
     DEF_MAPPEE(ArrayType, type);
     *this >> type;
@@ -603,15 +636,10 @@ osg::ref_ptr<osg::PrimitiveSet> InputStream::readPrimitiveSet()
         break;
     case ID_DRAWARRAY_LENGTH:
         {
-            int first = 0, value = 0; unsigned int size = 0;
-            *this >> first >> size >> BEGIN_BRACKET;
+            int first = 0;
+            *this >> first;
             osg::DrawArrayLengths* dl = new osg::DrawArrayLengths( mode.get(), first );
-            for ( unsigned int i=0; i<size; ++i )
-            {
-                *this >> value;
-                dl->push_back( value );
-            }
-            *this >> END_BRACKET;
+            readArrayImplementation( dl, 1, INT_SIZE );
             primitive = dl;
             primitive->setNumInstances( numInstances );
         }
@@ -619,14 +647,7 @@ osg::ref_ptr<osg::PrimitiveSet> InputStream::readPrimitiveSet()
     case ID_DRAWELEMENTS_UBYTE:
         {
             osg::DrawElementsUByte* de = new osg::DrawElementsUByte( mode.get() );
-            unsigned int size = 0; unsigned char value = 0;
-            *this >> size >> BEGIN_BRACKET;
-            for ( unsigned int i=0; i<size; ++i )
-            {
-                *this >> value;
-                de->push_back( value );
-            }
-            *this >> END_BRACKET;
+            readArrayImplementation( de, 1, CHAR_SIZE );
             primitive = de;
             primitive->setNumInstances( numInstances );
         }
@@ -634,14 +655,7 @@ osg::ref_ptr<osg::PrimitiveSet> InputStream::readPrimitiveSet()
     case ID_DRAWELEMENTS_USHORT:
         {
             osg::DrawElementsUShort* de = new osg::DrawElementsUShort( mode.get() );
-            unsigned int size = 0; unsigned short value = 0;
-            *this >> size >> BEGIN_BRACKET;
-            for ( unsigned int i=0; i<size; ++i )
-            {
-                *this >> value;
-                de->push_back( value );
-            }
-            *this >> END_BRACKET;
+            readArrayImplementation( de, 1, SHORT_SIZE );
             primitive = de;
             primitive->setNumInstances( numInstances );
         }
@@ -649,14 +663,7 @@ osg::ref_ptr<osg::PrimitiveSet> InputStream::readPrimitiveSet()
     case ID_DRAWELEMENTS_UINT:
         {
             osg::DrawElementsUInt* de = new osg::DrawElementsUInt( mode.get() );
-            unsigned int size = 0, value = 0;
-            *this >> size >> BEGIN_BRACKET;
-            for ( unsigned int i=0; i<size; ++i )
-            {
-                *this >> value;
-                de->push_back( value );
-            }
-            *this >> END_BRACKET;
+            readArrayImplementation( de, 1, INT_SIZE );
             primitive = de;
             primitive->setNumInstances( numInstances );
         }
@@ -679,10 +686,10 @@ osg::ref_ptr<osg::Image> InputStream::readImage(bool readFromExternal)
     *this >> PROPERTY("UniqueID") >> id;
     if ( getException() ) return NULL;
 
-    IdentifierMap::iterator itr = _identifierMap.find( id );
-    if ( itr!=_identifierMap.end() )
+    osg::ref_ptr<osg::Object> existingImage;
+    if ( findObject(id, existingImage) )
     {
-        return static_cast<osg::Image*>( itr->second.get() );
+        return static_cast<osg::Image*>( existingImage.get() );
     }
 
     std::string name;
@@ -724,6 +731,13 @@ osg::ref_ptr<osg::Image> InputStream::readImage(bool readFromExternal)
                 image->setOrigin( (osg::Image::Origin)origin );
                 image->setImage( s, t, r, internalFormat, pixelFormat, dataType,
                     (unsigned char*)data, osg::Image::USE_NEW_DELETE, packing );
+
+                // the data is written in the writer's byte order, so swap multi-byte components in place
+                if ( _in->getByteSwap() && !image->isCompressed() )
+                {
+                    unsigned int componentSize = getImageComponentSize( dataType );
+                    if ( componentSize>1 ) InputIterator::swapComponents( data, size/componentSize, componentSize );
+                }
             }
 
             // _mipmapData
@@ -891,11 +905,11 @@ osg::ref_ptr<osg::Object> InputStream::readObject( osg::Object* existingObj )
     *this >> BEGIN_BRACKET >> PROPERTY("UniqueID") >> id;
     if ( getException() ) return 0;
 
-    IdentifierMap::iterator itr = _identifierMap.find( id );
-    if ( itr!=_identifierMap.end() )
+    osg::ref_ptr<osg::Object> existingObject;
+    if ( findObject(id, existingObject) )
     {
         advanceToCurrentEndBracket();
-        return itr->second;
+        return existingObject;
     }
 
     osg::ref_ptr<osg::Object> obj = readObjectFields( className, id, existingObj );
@@ -949,6 +963,281 @@ osg::ref_ptr<osg::Object> InputStream::readObjectFields( const std::string& clas
     return obj;
 }
 
+namespace osgDB
+{
+
+/** The blocks of an object list written by OutputStream::writeObjectList(), decoded by InputStreams of their own on a pool
+  * of threads. Each block records the first object ID it defines, so when a block refers to an object defined by an
+  * earlier block it can wait for that block to complete and pick the object up from its identifier map.*/
+class ObjectBlockSet : public osg::Referenced
+{
+public:
+
+    ObjectBlockSet( InputStream& parent, unsigned int numBlocks ) : _parent(parent), _blocks(numBlocks) {}
+
+    struct Block
+    {
+        Block() : firstID(0), firstArrayID(0), completed(new osg::RefBlock) {}
+
+        unsigned int                    firstID;
+        unsigned int                    firstArrayID;
+        std::string                     data;
+        osg::ref_ptr<osg::Object>       object;
+        InputStream::IdentifierMap      identifierMap;
+        InputStream::ArrayMap           arrayMap;
+        std::string                     error;
+        osg::ref_ptr<osg::RefBlock>     completed;
+    };
+
+    Block& getBlock( unsigned int index ) { return _blocks[index]; }
+
+    void readBlock( unsigned int index )
+    {
+        Block& block = _blocks[index];
+        std::istringstream stream( block.data );
+        block.data = std::string();
+
+        InputStream is( 0 );
+        is._options = _parent._options;
+        is._forceReadingImage = _parent._forceReadingImage;
+        is._domainVersionMap = _parent._domainVersionMap;
+        is._fileVersion = _parent._fileVersion;
+        is._dummyReadObject = new osg::DummyObject;
+        is._useObjectBlocks = true;
+        is._objectBlockSet = this;
+        is._objectBlockIndex = index;
+        is._in = _parent._in->cloneForStream( &stream );
+        is._in->setInputStream( &is );
+        is._fields.push_back( "ObjectBlock" );
+
+        block.object = is.readObject();
+        if ( is.getException() )
+        {
+            block.error = is.getException()->getError() + " At " + is.getException()->getField();
+            block.object = 0;
+        }
+        block.identifierMap.swap( is._identifierMap );
+        block.arrayMap.swap( is._arrayMap );
+        block.completed->release();
+    }
+
+    bool findObject( unsigned int index, unsigned int id, osg::ref_ptr<osg::Object>& obj )
+    {
+        // IDs from the block's own first ID on are defined by the block itself.
+        if ( id>=_blocks[index].firstID ) return false;
+
+        InputStream::IdentifierMap::const_iterator itr = _parent._identifierMap.find( id );
+        if ( itr!=_parent._identifierMap.end() )
+        {
+            obj = itr->second;
+            return true;
+        }
+
+        unsigned int owner = index;
+        while ( owner>0 && _blocks[owner].firstID>id ) --owner;
+        if ( _blocks[owner].firstID>id ) return false;
+
+        waitForBlock( owner );
+        itr = _blocks[owner].identifierMap.find( id );
+        if ( itr==_blocks[owner].identifierMap.end() ) return false;
+
+        obj = itr->second;
+        return true;
+    }
+
+    bool findArray( unsigned int index, unsigned int id, osg::ref_ptr<osg::Array>& array )
+    {
+        // arrays are numbered independently of objects, so each block records the first array ID it defines as well.
+        if ( id>=_blocks[index].firstArrayID ) return false;
+
+        InputStream::ArrayMap::const_iterator itr = _parent._arrayMap.find( id );
+        if ( itr!=_parent._arrayMap.end() )
+        {
+            array = itr->second;
+            return true;
+        }
+
+        unsigned int owner = index;
+        while ( owner>0 && _blocks[owner].firstArrayID>id ) --owner;
+        if ( _blocks[owner].firstArrayID>id ) return false;
+
+        waitForBlock( owner );
+        itr = _blocks[owner].arrayMap.find( id );
+        if ( itr==_blocks[owner].arrayMap.end() ) return false;
+
+        array = itr->second;
+        return true;
+    }
+
+    /** Add the objects and arrays of all the blocks to those of the parent, once all the blocks are complete.*/
+    void merge()
+    {
+        for ( std::vector<Block>::iterator itr=_blocks.begin(); itr!=_blocks.end(); ++itr )
+        {
+            _parent._identifierMap.insert( itr->identifierMap.begin(), itr->identifierMap.end() );
+            _parent._arrayMap.insert( itr->arrayMap.begin(), itr->arrayMap.end() );
+        }
+    }
+
+protected:
+
+    virtual ~ObjectBlockSet() {}
+
+    void waitForBlock( unsigned int index )
+    {
+        // blocks are queued in order so the owner has already been picked up by a thread, and can't be waiting on us
+        _blocks[index].completed->block();
+    }
+
+    InputStream&        _parent;
+    std::vector<Block>  _blocks;
+};
+
+class ReadObjectBlockOperation : public osg::Operation
+{
+public:
+
+    ReadObjectBlockOperation( ObjectBlockSet* blockSet, unsigned int index ) :
+        osg::Operation("ReadObjectBlockOperation", false),
+        _blockSet(blockSet),
+        _index(index) {}
+
+    virtual void operator () (osg::Object*) { _blockSet->readBlock(_index); }
+
+protected:
+
+    ObjectBlockSet*     _blockSet;
+    unsigned int        _index;
+};
+
+/** Threads decoding object blocks, started by the first object list read in parallel and reused by the later ones.*/
+class ObjectBlockThreadPool : public osg::Referenced
+{
+public:
+
+    ObjectBlockThreadPool( unsigned int numThreads ) :
+        _operationQueue(new osg::OperationQueue)
+    {
+        for ( unsigned int i=0; i<numThreads; ++i )
+        {
+            _threads.push_back( new osg::OperationThread );
+            _threads.back()->setOperationQueue( _operationQueue.get() );
+            _threads.back()->startThread();
+        }
+    }
+
+    void add( osg::Operation* operation ) { _operationQueue->add( operation ); }
+
+protected:
+
+    virtual ~ObjectBlockThreadPool()
+    {
+        for ( OperationThreads::iterator itr=_threads.begin(); itr!=_threads.end(); ++itr )
+        {
+            (*itr)->cancel();
+        }
+    }
+
+    typedef std::vector< osg::ref_ptr<osg::OperationThread> > OperationThreads;
+
+    osg::ref_ptr<osg::OperationQueue>   _operationQueue;
+    OperationThreads                    _threads;
+};
+
+}
+
+bool InputStream::findObject( unsigned int id, osg::ref_ptr<osg::Object>& obj )
+{
+    IdentifierMap::iterator itr = _identifierMap.find( id );
+    if ( itr!=_identifierMap.end() )
+    {
+        obj = itr->second;
+        return true;
+    }
+
+    return _objectBlockSet && _objectBlockSet->findObject( _objectBlockIndex, id, obj );
+}
+
+bool InputStream::findArray( unsigned int id, osg::ref_ptr<osg::Array>& array )
+{
+    ArrayMap::iterator itr = _arrayMap.find( id );
+    if ( itr!=_arrayMap.end() )
+    {
+        array = itr->second;
+        return true;
+    }
+
+    return _objectBlockSet && _objectBlockSet->findArray( _objectBlockIndex, id, array );
+}
+
+void InputStream::readObjectList( unsigned int numObjects, ObjectList& objects )
+{
+    bool useBlocks = false;
+    if ( _useObjectBlocks ) *this >> useBlocks;
+    if ( getException() ) return;
+
+    // blocks nested within a block are read in place, as are all blocks if they can't be read in parallel
+    osg::ref_ptr<osg::Referenced> clonedIterator;
+    bool readInParallel = useBlocks && !_objectBlockSet && _numObjectBlockThreads>1 && numObjects>1;
+    if ( readInParallel )
+    {
+        clonedIterator = _in->cloneForStream( 0 );
+        readInParallel = clonedIterator.valid();
+    }
+
+    if ( !readInParallel )
+    {
+        for ( unsigned int i=0; i<numObjects; ++i )
+        {
+            if ( _useObjectBlocks && numObjects>1 )
+            {
+                unsigned int firstID = 0, firstArrayID = 0, size = 0;
+                *this >> firstID >> firstArrayID >> size;
+            }
+            objects.push_back( readObject() );
+            if ( getException() ) return;
+        }
+        return;
+    }
+
+    osg::ref_ptr<ObjectBlockSet> blockSet = new ObjectBlockSet( *this, numObjects );
+    for ( unsigned int i=0; i<numObjects; ++i )
+    {
+        ObjectBlockSet::Block& block = blockSet->getBlock(i);
+        unsigned int size = 0;
+        *this >> block.firstID >> block.firstArrayID >> size;
+        if ( getException() ) return;
+
+        block.data.resize( size );
+        if ( size>0 ) readCharArray( &block.data[0], size );
+        checkStream();
+        if ( getException() ) return;
+    }
+
+    if ( !_objectBlockThreadPool ) _objectBlockThreadPool = new ObjectBlockThreadPool( _numObjectBlockThreads );
+    for ( unsigned int i=0; i<numObjects; ++i )
+    {
+        _objectBlockThreadPool->add( new ReadObjectBlockOperation(blockSet.get(), i) );
+    }
+
+    // the blocks look objects and arrays up in our maps, so only add theirs once all of them are complete
+    for ( unsigned int i=0; i<numObjects; ++i )
+    {
+        blockSet->getBlock(i).completed->block();
+    }
+    blockSet->merge();
+
+    std::string error;
+    for ( unsigned int i=0; i<numObjects; ++i )
+    {
+        ObjectBlockSet::Block& block = blockSet->getBlock(i);
+        if ( error.empty() ) error = block.error;
+        objects.push_back( block.object );
+    }
+
+    if ( !error.empty() ) throwException( error );
+}
+
 void InputStream::readSchema( std::istream& fin )
 {
     // Read from external ascii stream
@@ -1034,6 +1323,12 @@ void InputStream::decompress()
     _fields.clear();
 
     std::string compressorName; *this >> compressorName;
+    if ( compressorName=="#ObjectBlocks" )
+    {
+        _useObjectBlocks = true;
+        *this >> compressorName;
+    }
+
     if ( compressorName!="0" )
     {
         std::string data;
@@ -1120,7 +1415,6 @@ void InputStream::readArrayImplementation( T* a, unsigned int numComponentsPerEl
         if ( isBinary() )
         {
             readComponentArray( (char*)&((*a)[0]), size, numComponentsPerElements, componentSizeInBytes );
-            checkStream();
         }
         else
         {
@@ -21,7 +21,8 @@ Options::Options():
     osg::Object(true),
     _objectCacheHint(CACHE_ARCHIVES),
     _precisionHint(FLOAT_PRECISION_ALL),
-    _buildKdTreesHint(NO_PREFERENCE)
+    _buildKdTreesHint(NO_PREFERENCE),
+    _vertexAttributeCompressionHint(VERTEX_ATTRIBUTE_COMPRESSION_NO_PREFERENCE)
 {
 }
 
@@ -30,7 +31,8 @@ Options::Options(const std::string& str):
     _str(str),
     _objectCacheHint(CACHE_ARCHIVES),
     _precisionHint(FLOAT_PRECISION_ALL),
-    _buildKdTreesHint(NO_PREFERENCE)
+    _buildKdTreesHint(NO_PREFERENCE),
+    _vertexAttributeCompressionHint(VERTEX_ATTRIBUTE_COMPRESSION_NO_PREFERENCE)
 {
     parsePluginStringData(str);
 }
@@ -44,6 +46,7 @@ Options::Options(const Options& options,const osg::CopyOp& copyop):
     _objectCache(options._objectCache),
     _precisionHint(options._precisionHint),
     _buildKdTreesHint(options._buildKdTreesHint),
+    _vertexAttributeCompressionHint(options._vertexAttributeCompressionHint),
     _pluginData(options._pluginData),
     _pluginStringData(options._pluginStringData),
     _findFileCallback(options._findFileCallback),
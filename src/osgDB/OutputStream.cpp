@@ -26,7 +26,7 @@
 using namespace osgDB;
 
 OutputStream::OutputStream( const osgDB::Options* options )
-:   _writeImageHint(WRITE_USE_IMAGE_HINT), _useSchemaData(false), _useRobustBinaryFormat(true), _targetFileVersion(OPENSCENEGRAPH_SOVERSION)
+:   _writeImageHint(WRITE_USE_IMAGE_HINT), _useSchemaData(false), _useRobustBinaryFormat(true), _objectBlockThreshold(0), _targetFileVersion(OPENSCENEGRAPH_SOVERSION)
 {
     BEGIN_BRACKET.set( "{", +INDENT_VALUE );
     END_BRACKET.set( "}", -INDENT_VALUE );
@@ -42,6 +42,11 @@ OutputStream::OutputStream( const osgDB::Options* options )
         _schemaName = options->getPluginStringData("SchemaFile");
     if ( !options->getPluginStringData("Compressor").empty() )
         _compressorName = options->getPluginStringData("Compressor");
+    if ( !options->getPluginStringData("ObjectBlocks").empty() )
+    {
+        std::string blockString = options->getPluginStringData("ObjectBlocks");
+        _objectBlockThreshold = (blockString=="true") ? 1048576 : atoi(blockString.c_str());
+    }
     if ( !options->getPluginStringData("WriteImageHint").empty() )
     {
         std::string hintString = options->getPluginStringData("WriteImageHint");
@@ -746,6 +751,61 @@ void OutputStream::writeObjectFields( const osg::Object* obj, const std::string&
     }
 }
 
+void OutputStream::writeObjectList( const ObjectList& objects )
+{
+    if ( !_objectBlockThreshold )
+    {
+        for ( ObjectList::const_iterator itr=objects.begin(); itr!=objects.end(); ++itr )
+            writeObject( *itr );
+        return;
+    }
+
+    if ( objects.size()<2 )
+    {
+        *this << false;
+        if ( !objects.empty() ) writeObject( objects.front() );
+        return;
+    }
+
+    // Write each object in place after the first object and array IDs that it allocates and a placeholder for its size,
+    // which is patched once the object is written. IDs are allocated in order so a reader can tell which block defines
+    // any object or array that another block refers to.
+    std::ostream* stream = _out->getStream();
+    std::streampos flagPos = stream->tellp();
+    *this << false;
+
+    unsigned int totalSize = 0, largestSize = 0;
+    for ( unsigned int i=0; i<objects.size(); ++i )
+    {
+        unsigned int firstID = _objectMap.size()+1, firstArrayID = _arrayMap.size()+1, size = 0;
+        *this << firstID << firstArrayID;
+        std::streampos sizePos = stream->tellp();
+        *this << size;
+        std::streampos beginPos = stream->tellp();
+        writeObject( objects[i] );
+        if ( getException() ) return;
+
+        std::streampos endPos = stream->tellp();
+        size = (unsigned int)(endPos - beginPos);
+        stream->seekp( sizePos );
+        *this << size;
+        stream->seekp( endPos );
+
+        totalSize += size;
+        if ( size>largestSize ) largestSize = size;
+    }
+
+    // only worth decoding in parallel when the other objects have enough work to run alongside the largest one,
+    // otherwise the blocks are read inline so any lists nested within the largest object can be decoded in parallel.
+    if ( (totalSize-largestSize)>=_objectBlockThreshold )
+    {
+        std::streampos endPos = stream->tellp();
+        stream->seekp( flagPos );
+        *this << true;
+        stream->seekp( endPos );
+    }
+}
+
 void OutputStream::start( OutputIterator* outIterator, OutputStream::WriteType type )
 {
     _fields.clear();
@@ -809,6 +869,11 @@ void OutputStream::start( OutputIterator* outIterator, OutputStream::WriteType t
                 useCompressSource = true;
             }
         }
+        // Object blocks were added in SOVERSION 161. The marker is written in place of the compressor name
+        // so that older readers, which don't know how to decode the blocks, fail cleanly on an unknown compressor.
+        if ( _targetFileVersion<161 ) _objectBlockThreshold = 0;
+        if ( _objectBlockThreshold>0 ) *this << std::string("#ObjectBlocks");
+
         if ( !_compressorName.empty() ) *this << _compressorName;
         else *this << std::string("0");  // No compressor
 
@@ -821,6 +886,8 @@ void OutputStream::start( OutputIterator* outIterator, OutputStream::WriteType t
     }
     else
     {
+        _objectBlockThreshold = 0;  // object blocks are only supported by the binary format
+
         std::string typeString("Unknown");
         switch ( type )
         {
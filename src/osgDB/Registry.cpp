@@ -24,6 +24,7 @@
 #include <osg/ApplicationUsage>
 #include <osg/Version>
 #include <osg/Timer>
+#include <osg/DisplaySettings>
 
 #include <osgDB/Registry>
 #include <osgDB/FileUtils>
@@ -32,6 +33,8 @@
 #include <osgDB/fstream>
 #include <osgDB/Archive>
 
+#include <osgUtil/VertexAttributeCompressionVisitor>
+
 #include <algorithm>
 #include <set>
 #include <memory>
@@ -63,6 +66,7 @@ static osg::ApplicationUsageProxy Registry_e1(osg::ApplicationUsage::ENVIRONMENT
 #endif
 
 static osg::ApplicationUsageProxy Registry_e2(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_BUILD_KDTREES on/off","Enable/disable the automatic building of KdTrees for each loaded Geometry.");
+static osg::ApplicationUsageProxy Registry_e3(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_COMPRESS_VERTEX_ATTRIBUTES <attribute>[,attribute]..","Quantize the vertex attributes of each loaded Geometry, any of VERTICES, NORMALS, OCTAHEDRAL_NORMALS, TEXCOORDS, ALL or OFF. ALL only includes TEXCOORDS with vertex attribute aliasing or the shader pipeline.");
 
 
 // from MimeTypes.cpp
@@ -235,6 +239,19 @@ Registry::Registry()
         else _buildKdTreesHint = Options::BUILD_KDTREES;
     }
 
+    _vertexAttributeCompressionHint = Options::NO_VERTEX_ATTRIBUTE_COMPRESSION;
+
+    const char* compression_str = getenv("OSG_COMPRESS_VERTEX_ATTRIBUTES");
+    if (compression_str)
+    {
+        std::string str(compression_str);
+        if (str.find("OCTAHEDRAL_NORMALS")!=std::string::npos) _vertexAttributeCompressionHint |= Options::COMPRESS_NORMALS_OCTAHEDRAL;
+        else if (str.find("NORMALS")!=std::string::npos) _vertexAttributeCompressionHint |= Options::COMPRESS_NORMALS;
+        if (str.find("VERTICES")!=std::string::npos) _vertexAttributeCompressionHint |= Options::COMPRESS_VERTICES;
+        if (str.find("TEXCOORDS")!=std::string::npos) _vertexAttributeCompressionHint |= Options::COMPRESS_TEX_COORDS;
+        if (str.find("ALL")!=std::string::npos) _vertexAttributeCompressionHint |= Options::COMPRESS_ALL;
+    }
+
     const char* ptr=0;
 
     _expiryDelay = 10.0;
@@ -1467,6 +1484,43 @@ ReaderWriter::WriteResult Registry::writeHeightFieldImplementation(const HeightF
 }
 
 
+void Registry::_compressVertexAttributesIfRequired(ReaderWriter::ReadResult& result, const Options* options)
+{
+    Options::VertexAttributeCompressionHint hint = static_cast<Options::VertexAttributeCompressionHint>(_vertexAttributeCompressionHint);
+    if (options)
+    {
+        Options::VertexAttributeCompressionHint optionsHint = static_cast<Options::VertexAttributeCompressionHint>(options->getVertexAttributeCompressionHint());
+        if (optionsHint!=Options::VERTEX_ATTRIBUTE_COMPRESSION_NO_PREFERENCE) hint = optionsHint;
+    }
+
+    if (hint==Options::NO_VERTEX_ATTRIBUTE_COMPRESSION || !result.validNode()) return;
+
+    unsigned int compressionOptions = 0;
+    if (hint & Options::COMPRESS_VERTICES) compressionOptions |= osgUtil::VertexAttributeCompressionVisitor::COMPRESS_VERTICES;
+    if (hint & Options::COMPRESS_NORMALS) compressionOptions |= osgUtil::VertexAttributeCompressionVisitor::COMPRESS_NORMALS;
+    if (hint & Options::COMPRESS_NORMALS_OCTAHEDRAL) compressionOptions |= osgUtil::VertexAttributeCompressionVisitor::COMPRESS_NORMALS | osgUtil::VertexAttributeCompressionVisitor::OCTAHEDRAL_NORMALS;
+    if (hint & Options::COMPRESS_TEX_COORDS) compressionOptions |= osgUtil::VertexAttributeCompressionVisitor::COMPRESS_TEX_COORDS;
+
+    if (hint & Options::COMPRESS_ALL)
+    {
+        compressionOptions |= osgUtil::VertexAttributeCompressionVisitor::COMPRESS_VERTICES | osgUtil::VertexAttributeCompressionVisitor::COMPRESS_NORMALS;
+
+        // normalized texture coordinates are only passed on to shaders via vertex attribute aliasing or the shader pipeline.
+#if defined(OSG_GL_FIXED_FUNCTION_AVAILABLE)
+        bool normalizedTexCoords = osg::DisplaySettings::instance()->getShaderPipeline();
+#else
+        bool normalizedTexCoords = true;
+#endif
+        if (normalizedTexCoords) compressionOptions |= osgUtil::VertexAttributeCompressionVisitor::COMPRESS_TEX_COORDS;
+    }
+
+    // as the loaded node has no parents its own vertices are left as is, so that it's never replaced by the restoring transform.
+    osgUtil::VertexAttributeCompressionVisitor visitor(compressionOptions);
+    result.getNode()->accept(visitor);
+
+    if (osg::isNotifyEnabled(osg::INFO)) visitor.report(osg::notify(osg::INFO));
+}
+
 ReaderWriter::ReadResult Registry::readNodeImplementation(const std::string& fileName,const Options* options)
 {
 #if 0
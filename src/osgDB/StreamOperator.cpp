@@ -26,6 +26,20 @@ void InputIterator::checkStream() const
     }
 }
 
+void InputIterator::swapComponents( char* s, unsigned int numComponents, unsigned int componentSizeInBytes )
+{
+    char* ptr = s;
+    char* end = s + numComponents*componentSizeInBytes;
+    switch(componentSizeInBytes)
+    {
+        case(1): break;
+        case(2): for(; ptr<end; ptr+=2) osg::swapBytes2(ptr); break;
+        case(4): for(; ptr<end; ptr+=4) osg::swapBytes4(ptr); break;
+        case(8): for(; ptr<end; ptr+=8) osg::swapBytes8(ptr); break;
+        default: for(; ptr<end; ptr+=componentSizeInBytes) osg::swapBytes(ptr, componentSizeInBytes); break;
+    }
+}
+
 void InputIterator::readComponentArray( char* s, unsigned int numElements, unsigned int numComponentsPerElements, unsigned int componentSizeInBytes)
 {
     unsigned int size = numElements * numComponentsPerElements * componentSizeInBytes;
@@ -35,15 +49,7 @@ void InputIterator::readComponentArray( char* s, unsigned int numElements, unsig
 
         if (_byteSwap && componentSizeInBytes>1)
         {
-            char* ptr = s;
-            for(unsigned int i=0; i<numElements; ++i)
-            {
-                for(unsigned int j=0; j<numComponentsPerElements; ++j)
-                {
-                    osg::swapBytes( ptr, componentSizeInBytes );
-                    ptr += componentSizeInBytes;
-                }
-            }
+            swapComponents( s, numElements*numComponentsPerElements, componentSizeInBytes );
         }
     }
 }
@@ -2,6 +2,7 @@
 #include <osgParticle/ModularProgram>
 #include <osgParticle/Operator>
 #include <osgParticle/Particle>
+#include <osgParticle/ParticleArrays>
 #include <osg/Notify>
 
 osgParticle::FluidFrictionOperator::FluidFrictionOperator():
@@ -54,3 +55,33 @@ void osgParticle::FluidFrictionOperator::operate(Particle* P, double dt)
 
     P->addVelocity(dv);
 }
+
+void osgParticle::FluidFrictionOperator::operateAll(ParticleArrays& arrays, unsigned int begin, unsigned int end, double dt)
+{
+    // dv is -R*massInv*dt along the normalized relative velocity clamped to its length vm, and R is proportional to vm,
+    // so it is the relative velocity scaled by min(R*massInv*dt/vm, 1), which needs neither a normalization nor a branch.
+    const float coeffA = _coeff_A * dt;
+    const float coeffB = _coeff_B * dt;
+    const float wx = _wind.x();
+    const float wy = _wind.y();
+    const float wz = _wind.z();
+    const float* radius = &arrays.radius.front();
+    const float* massInv = &arrays.massInv.front();
+    float* vx = &arrays.velocityX.front();
+    float* vy = &arrays.velocityY.front();
+    float* vz = &arrays.velocityZ.front();
+
+    const bool overrideRadius = _ovr_rad > 0;
+    for (unsigned int i=begin; i<end; ++i)
+    {
+        float r = overrideRadius ? _ovr_rad : radius[i];
+        float x = vx[i] - wx;
+        float y = vy[i] - wy;
+        float z = vz[i] - wz;
+        float vm = sqrtf(x*x + y*y + z*z);
+        float scale = osg::minimum(r * (coeffA + coeffB * r * vm) * massInv[i], 1.0f);
+        vx[i] -= x * scale;
+        vy[i] -= y * scale;
+        vz[i] -= z * scale;
+    }
+}
@@ -3,13 +3,40 @@
 #include <osgParticle/ParticleSystem>
 #include <osgParticle/Particle>
 
+#include <osg/ParallelFor>
+
+#include <algorithm>
+
+namespace
+{
+    class OperateAll : public osg::ParallelForFunctor
+    {
+    public:
+        OperateAll(osgParticle::Operator* op, osgParticle::ParticleArrays& arrays, double dt):
+            _op(op),
+            _arrays(arrays),
+            _dt(dt) {}
+
+        virtual void operator () (unsigned int begin, unsigned int end) { _op->operateAll(_arrays, begin, end, _dt); }
+
+    protected:
+        osgParticle::Operator*          _op;
+        osgParticle::ParticleArrays&    _arrays;
+        double                          _dt;
+    };
+}
+
 osgParticle::ModularProgram::ModularProgram()
-: Program()
+: Program(),
+  _numThreads(1),
+  _numParticlesPerChunk(16384)
 {
 }
 
 osgParticle::ModularProgram::ModularProgram(const ModularProgram& copy, const osg::CopyOp& copyop)
-: Program(copy, copyop)
+: Program(copy, copyop),
+  _numThreads(copy._numThreads),
+  _numParticlesPerChunk(copy._numParticlesPerChunk)
 {
     Operator_vector::const_iterator ci;
     for (ci=copy._operators.begin(); ci!=copy._operators.end(); ++ci) {
@@ -17,6 +44,16 @@ osgParticle::ModularProgram::ModularProgram(const ModularProgram& copy, const os
     }
 }
 
+void osgParticle::ModularProgram::setNumThreads(unsigned int numThreads)
+{
+    _numThreads = numThreads;
+}
+
+void osgParticle::ModularProgram::setNumParticlesPerChunk(unsigned int numParticles)
+{
+    _numParticlesPerChunk = std::max(1u, numParticles);
+}
+
 void osgParticle::ModularProgram::execute(double dt)
 {
     Operator_vector::iterator ci;
@@ -25,7 +62,18 @@ void osgParticle::ModularProgram::execute(double dt)
     ParticleSystem* ps = getParticleSystem();
     for (ci=_operators.begin(); ci!=ci_end; ++ci) {
         (*ci)->beginOperate(this);
-        (*ci)->operateParticles(ps, dt);
+        if (ps->getUseParticleArrays() && (*ci)->supportsOperateAll())
+        {
+            if ((*ci)->isEnabled())
+            {
+                OperateAll operateAll(ci->get(), ps->getParticleArrays(), dt);
+                osg::parallelFor(ps->getParticleArrays().size(), _numParticlesPerChunk, operateAll, _numThreads);
+            }
+        }
+        else
+        {
+            (*ci)->operateParticles(ps, dt);
+        }
         (*ci)->endOperate();
     }
 }
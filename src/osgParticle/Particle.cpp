@@ -51,10 +51,132 @@ osgParticle::Particle::Particle()
     _t_coord(0.0f),
     _previousParticle(INVALID_INDEX),
     _nextParticle(INVALID_INDEX),
-    _depth(0.0)
+    _depth(0.0),
+    _arrays(0),
+    _arrayIndex(0)
 {
 }
 
+osgParticle::Particle::Particle(const Particle& copy)
+:   _shape(copy._shape),
+    _sr(copy._sr),
+    _ar(copy._ar),
+    _cr(copy._cr),
+    _si(copy._si),
+    _ai(copy._ai),
+    _ci(copy._ci),
+    _mustdie(copy._mustdie),
+    _lifeTime(copy._lifeTime),
+    _radius(copy.getRadius()),
+    _mass(copy._mass),
+    _massinv(copy.getMassInv()),
+    _prev_pos(copy._prev_pos),
+    _position(copy.getPosition()),
+    _velocity(copy.getVelocity()),
+    _prev_angle(copy._prev_angle),
+    _angle(copy._angle),
+    _angul_arvel(copy._angul_arvel),
+    _t0(copy.getAge()),
+    _alive(copy._alive),
+    _current_size(copy._current_size),
+    _current_alpha(copy._current_alpha),
+    _base_prop(copy._base_prop),
+    _current_color(copy._current_color),
+    _s_tile(copy._s_tile),
+    _t_tile(copy._t_tile),
+    _start_tile(copy._start_tile),
+    _end_tile(copy._end_tile),
+    _cur_tile(copy._cur_tile),
+    _s_coord(copy._s_coord),
+    _t_coord(copy._t_coord),
+    _previousParticle(copy._previousParticle),
+    _nextParticle(copy._nextParticle),
+    _depth(copy._depth),
+    _arrays(0),
+    _arrayIndex(0)
+{
+}
+
+osgParticle::Particle& osgParticle::Particle::operator = (const Particle& rhs)
+{
+    if (&rhs==this) return *this;
+
+    _shape = rhs._shape;
+    _sr = rhs._sr;
+    _ar = rhs._ar;
+    _cr = rhs._cr;
+    _si = rhs._si;
+    _ai = rhs._ai;
+    _ci = rhs._ci;
+    _mustdie = rhs._mustdie;
+    _lifeTime = rhs._lifeTime;
+    _mass = rhs._mass;
+    _prev_pos = rhs._prev_pos;
+    _prev_angle = rhs._prev_angle;
+    _angle = rhs._angle;
+    _angul_arvel = rhs._angul_arvel;
+    _alive = rhs._alive;
+    _current_size = rhs._current_size;
+    _current_alpha = rhs._current_alpha;
+    _base_prop = rhs._base_prop;
+    _current_color = rhs._current_color;
+    _s_tile = rhs._s_tile;
+    _t_tile = rhs._t_tile;
+    _start_tile = rhs._start_tile;
+    _end_tile = rhs._end_tile;
+    _cur_tile = rhs._cur_tile;
+    _s_coord = rhs._s_coord;
+    _t_coord = rhs._t_coord;
+    _previousParticle = rhs._previousParticle;
+    _nextParticle = rhs._nextParticle;
+    _depth = rhs._depth;
+
+    setPosition(rhs.getPosition());
+    setVelocity(rhs.getVelocity());
+    setRadius(rhs.getRadius());
+    if (_arrays)
+    {
+        _arrays->age[_arrayIndex] = rhs.getAge();
+        _arrays->massInv[_arrayIndex] = rhs.getMassInv();
+    }
+    else
+    {
+        _t0 = rhs.getAge();
+        _massinv = rhs.getMassInv();
+    }
+
+    return *this;
+}
+
+void osgParticle::Particle::setParticleArrays(ParticleArrays* arrays, unsigned int index)
+{
+    osg::Vec3 position = getPosition();
+    osg::Vec3 velocity = getVelocity();
+    double age = getAge();
+    float radius = getRadius();
+    float massInv = getMassInv();
+
+    _arrays = arrays;
+    _arrayIndex = index;
+
+    if (_arrays)
+    {
+        _arrays->setPosition(_arrayIndex, position);
+        _arrays->setVelocity(_arrayIndex, velocity);
+        _arrays->age[_arrayIndex] = age;
+        _arrays->radius[_arrayIndex] = radius;
+        _arrays->massInv[_arrayIndex] = massInv;
+    }
+    else
+    {
+        _position = position;
+        _velocity = velocity;
+        _t0 = age;
+        _radius = radius;
+        _massinv = massInv;
+    }
+}
+
 bool osgParticle::Particle::update(double dt, bool onlyTimeStamp)
 {
     // this method should return false when the particle dies;
@@ -65,13 +187,16 @@ bool osgParticle::Particle::update(double dt, bool onlyTimeStamp)
     }
 
     double x = 0;
+    double t0 = getAge();
 
     // if we don't live forever, compute our normalized age.
     if (_lifeTime > 0) {
-        x = _t0 / _lifeTime;
+        x = t0 / _lifeTime;
     }
 
-    _t0 += dt;
+    // the particle system ages and moves the particles in particle arrays all at once.
+    t0 += dt;
+    if (!_arrays) _t0 = t0;
 
     // if our age is over the lifetime limit, then die and return.
     if (x > 1) {
@@ -81,7 +206,7 @@ bool osgParticle::Particle::update(double dt, bool onlyTimeStamp)
 
     // compute the current values for size, alpha and color.
     if (_lifeTime <= 0) {
-       if (dt == _t0) {
+       if (dt == t0) {
           _current_size = _sr.get_random();
           _current_alpha = _ar.get_random();
           _current_color = _cr.get_random();
@@ -93,8 +218,8 @@ bool osgParticle::Particle::update(double dt, bool onlyTimeStamp)
     }
 
     // update position
-    _prev_pos = _position;
-    _position += _velocity * dt;
+    _prev_pos = getPosition();
+    if (!_arrays) _position += _velocity * dt;
 
     // return now if we indicate that only time stamp should be updated
     // the shader will handle remain properties in this case
@@ -20,6 +20,7 @@ using namespace osgParticle;
 ParticleEffect::ParticleEffect(const ParticleEffect& copy, const osg::CopyOp& copyop):
     osg::Group(copy,copyop),
     _automaticSetup(copy._automaticSetup),
+    _particleSystemUpdater(copy._particleSystemUpdater),
     _useLocalParticleSystem(copy._useLocalParticleSystem),
     _textureFileName(copy._textureFileName),
     _defaultParticleTemplate(copy._defaultParticleTemplate),
@@ -32,6 +33,24 @@ ParticleEffect::ParticleEffect(const ParticleEffect& copy, const osg::CopyOp& co
 {
 }
 
+ParticleEffect::~ParticleEffect()
+{
+    osg::ref_ptr<ParticleSystemUpdater> psu;
+    if (_particleSystemUpdater.lock(psu) && _particleSystem.valid()) psu->removeParticleSystem(_particleSystem.get());
+}
+
+void ParticleEffect::setParticleSystemUpdater(ParticleSystemUpdater* psu)
+{
+    if (_particleSystemUpdater==psu) return;
+
+    osg::ref_ptr<ParticleSystemUpdater> previous;
+    if (_particleSystemUpdater.lock(previous) && _particleSystem.valid()) previous->removeParticleSystem(_particleSystem.get());
+
+    _particleSystemUpdater = psu;
+
+    if (_automaticSetup) buildEffect();
+}
+
 void ParticleEffect::setUseLocalParticleSystem(bool local)
 {
     if (_useLocalParticleSystem==local) return;
@@ -122,6 +141,9 @@ void ParticleEffect::setParticleSystem(ParticleSystem* ps)
 {
     if (_particleSystem==ps) return;
 
+    osg::ref_ptr<ParticleSystemUpdater> psu;
+    if (_particleSystemUpdater.lock(psu) && _particleSystem.valid()) psu->removeParticleSystem(_particleSystem.get());
+
     _particleSystem = ps;
 
     if (_automaticSetup) buildEffect();
@@ -157,10 +179,18 @@ void ParticleEffect::buildEffect()
     // add the program to update the particles
     addChild(program.get());
 
-    // add the particle system updater.
-    osg::ref_ptr<osgParticle::ParticleSystemUpdater> psu = new osgParticle::ParticleSystemUpdater;
-    psu->addParticleSystem(particleSystem.get());
-    addChild(psu.get());
+    // add the particle system updater, unless the particle system is updated by a shared one.
+    osg::ref_ptr<osgParticle::ParticleSystemUpdater> psu;
+    if (_particleSystemUpdater.lock(psu))
+    {
+        if (!psu->containsParticleSystem(particleSystem.get())) psu->addParticleSystem(particleSystem.get());
+    }
+    else
+    {
+        psu = new osgParticle::ParticleSystemUpdater;
+        psu->addParticleSystem(particleSystem.get());
+        addChild(psu.get());
+    }
 
     if (_useLocalParticleSystem)
     {
@@ -27,7 +27,8 @@ osgParticle::ParticleProcessor::ParticleProcessor()
     _startTime(0.0),
     _currentTime(0.0),
     _resetTime(0.0),
-    _frameNumber(0)
+    _frameNumber(0),
+    _deferredDt(0.0)
 {
     setCullingActive(false);
 }
@@ -48,7 +49,8 @@ osgParticle::ParticleProcessor::ParticleProcessor(const ParticleProcessor& copy,
     _startTime(copy._startTime),
     _currentTime(copy._currentTime),
     _resetTime(copy._resetTime),
-    _frameNumber(copy._frameNumber)
+    _frameNumber(copy._frameNumber),
+    _deferredDt(0.0)
 {
 }
 
@@ -112,8 +114,22 @@ void osgParticle::ParticleProcessor::traverse(osg::NodeVisitor& nv)
                             _need_wtl_matrix = true;
                             _current_nodevisitor = &nv;
 
-                            // do some process (unimplemented in this base class)
-                            process( t - _t0 );
+                            if (_ps->getDeferProcessing())
+                            {
+                                // the node path is only valid during the traversal, so compute the matrices now
+                                // and leave the processing to the ParticleSystemUpdater.
+                                getLocalToWorldMatrix();
+                                getWorldToLocalMatrix();
+                                _current_nodevisitor = 0;
+
+                                _deferredDt = t - _t0;
+                                _ps->getDeferredProcessors().push_back(this);
+                            }
+                            else
+                            {
+                                // do some process (unimplemented in this base class)
+                                process( t - _t0 );
+                            }
                         } else {
                             //The values of _previous_wtl_matrix and _previous_ltw_matrix will be invalid
                             //since processing was skipped for this frame
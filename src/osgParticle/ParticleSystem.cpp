@@ -1,4 +1,5 @@
 #include <osgParticle/ParticleSystem>
+#include <osgParticle/ParticleProcessor>
 
 #include <vector>
 
@@ -40,6 +41,7 @@ osgParticle::ParticleSystem::ParticleSystem()
     _useVertexArray(false),
     _useShaders(false),
     _dirty_uniforms(false),
+    _useInstancing(false),
     _doublepass(false),
     _frozen(false),
     _bmin(0, 0, 0),
@@ -55,7 +57,9 @@ osgParticle::ParticleSystem::ParticleSystem()
     _detail(1),
     _sortMode(NO_SORT),
     _visibilityDistance(-1.0),
-    _estimatedMaxNumOfParticles(0)
+    _estimatedMaxNumOfParticles(0),
+    _useParticleArrays(false),
+    _deferProcessing(false)
 {
     // we don't support display lists because particle systems
     // are dynamic, and they always changes between frames
@@ -72,6 +76,7 @@ osgParticle::ParticleSystem::ParticleSystem(const ParticleSystem& copy, const os
     _useVertexArray(copy._useVertexArray),
     _useShaders(copy._useShaders),
     _dirty_uniforms(copy._dirty_uniforms),
+    _useInstancing(copy._useInstancing),
     _doublepass(copy._doublepass),
     _frozen(copy._frozen),
     _bmin(copy._bmin),
@@ -87,7 +92,9 @@ osgParticle::ParticleSystem::ParticleSystem(const ParticleSystem& copy, const os
     _detail(copy._detail),
     _sortMode(copy._sortMode),
     _visibilityDistance(copy._visibilityDistance),
-    _estimatedMaxNumOfParticles(0)
+    _estimatedMaxNumOfParticles(0),
+    _useParticleArrays(copy._useParticleArrays),
+    _deferProcessing(false)
 {
 }
 
@@ -98,23 +105,25 @@ osgParticle::ParticleSystem::~ParticleSystem()
 
 osgParticle::Particle* osgParticle::ParticleSystem::createParticle(const osgParticle::Particle* ptemplate)
 {
+    Particle* P = 0;
+
     // is there any dead particle?
     if (!_deadparts.empty())
     {
 
         // retrieve a pointer to the last dead particle
-        Particle* P = _deadparts.top();
+        P = _deadparts.top();
 
         // create a new (alive) particle in the same place
         *P = ptemplate? *ptemplate: _def_ptemp;
 
         // remove the pointer from the death stack
         _deadparts.pop();
-        return P;
 
     }
     else
     {
+        const Particle* front = _particles.empty() ? 0 : &_particles.front();
 
         if (_particles.size()==_particles.capacity())
         {
@@ -126,8 +135,41 @@ osgParticle::Particle* osgParticle::ParticleSystem::createParticle(const osgPart
 
         // add a new particle to the vector
         _particles.push_back(ptemplate? *ptemplate: _def_ptemp);
-        return &_particles.back();
+        P = &_particles.back();
+
+        if (_useParticleArrays)
+        {
+            // the particles copied to a larger vector hold their values themselves until moved back into the arrays
+            unsigned int index = static_cast<unsigned int>(_particles.size()-1);
+            _particleArrays.resize(index+1);
+            if (&_particles.front()!=front)
+            {
+                for(unsigned int i=0; i<index; ++i)
+                {
+                    _particles[i].setParticleArrays(&_particleArrays, i);
+                }
+            }
+            P->setParticleArrays(&_particleArrays, index);
+        }
+    }
+
+    return P;
+}
+
+void osgParticle::ParticleSystem::setUseParticleArrays(bool v)
+{
+    if (v==_useParticleArrays) return;
+
+    _useParticleArrays = v;
+
+    if (v) _particleArrays.resize(_particles.size());
+
+    for(unsigned int i=0; i<_particles.size(); ++i)
+    {
+        _particles[i].setParticleArrays(v ? &_particleArrays : 0, i);
     }
+
+    if (!v) _particleArrays.clear();
 }
 
 void osgParticle::ParticleSystem::update(double dt, osg::NodeVisitor& nv)
@@ -152,25 +194,72 @@ void osgParticle::ParticleSystem::update(double dt, osg::NodeVisitor& nv)
         }
     }
 
-    for(unsigned int i=0; i<_particles.size(); ++i)
+    if (_useParticleArrays)
     {
-        Particle& particle = _particles[i];
-        if (particle.isAlive())
+        // the particles are moved and aged in the arrays afterwards, the bounds take in where they are moved to.
+        const float fdt = static_cast<float>(dt);
+        ParticleArrays& arrays = _particleArrays;
+        for(unsigned int i=0; i<_particles.size(); ++i)
         {
-            if (particle.update(dt, _useShaders))
+            Particle& particle = _particles[i];
+            if (particle.isAlive())
             {
-                update_bounds(particle.getPosition(), particle.getCurrentSize());
+                if (particle.update(dt, _useShaders))
+                {
+                    update_bounds(arrays.getPosition(i) + arrays.getVelocity(i)*fdt, particle.getCurrentSize());
+                }
+                else
+                {
+                    reuseParticle(i);
+                }
             }
-            else
+        }
+
+        // the dead particles are moved too so that the loop has no branches, they are reset when reused.
+        unsigned int numParticles = arrays.size();
+        if (numParticles>0)
+        {
+            float* px = &arrays.positionX.front();
+            float* py = &arrays.positionY.front();
+            float* pz = &arrays.positionZ.front();
+            const float* vx = &arrays.velocityX.front();
+            const float* vy = &arrays.velocityY.front();
+            const float* vz = &arrays.velocityZ.front();
+            float* age = &arrays.age.front();
+            for(unsigned int i=0; i<numParticles; ++i)
             {
-                reuseParticle(i);
+                px[i] += vx[i]*fdt;
+                py[i] += vy[i]*fdt;
+                pz[i] += vz[i]*fdt;
+                age[i] += fdt;
+            }
+        }
+    }
+    else
+    {
+        for(unsigned int i=0; i<_particles.size(); ++i)
+        {
+            Particle& particle = _particles[i];
+            if (particle.isAlive())
+            {
+                if (particle.update(dt, _useShaders))
+                {
+                    update_bounds(particle.getPosition(), particle.getCurrentSize());
+                }
+                else
+                {
+                    reuseParticle(i);
+                }
             }
         }
     }
 
     if (_sortMode != NO_SORT)
     {
-        // sort particles
+        // sort the indices of the alive particles on 32 bit keys of their depth rather than the particles themselves,
+        // which leaves the particles, the death stack and the particle arrays where they are.
+        _sortedParticles.clear();
+
         osgUtil::CullVisitor* cv = nv.asCullVisitor();
         if (cv)
         {
@@ -181,26 +270,24 @@ void osgParticle::ParticleSystem::update(double dt, osg::NodeVisitor& nv)
             {
                 Particle& particle = _particles[i];
                 if (particle.isAlive())
-                    particle.setDepth(distance(particle.getPosition(), modelview) * scale);
+                {
+                    double depth = distance(particle.getPosition(), modelview) * scale;
+                    particle.setDepth(depth);
+                    _sortedParticles.push_back(osgUtil::RadixSortItem<unsigned int>(osgUtil::floatToRadixKey(static_cast<float>(depth)), i));
+                }
                 else
+                {
                     particle.setDepth(deadDistance);
+                }
             }
-            std::sort<Particle_vector::iterator>(_particles.begin(), _particles.end());
 
-            // Repopulate the death stack as it will have been invalidated by the sort.
-            unsigned int numDead = _deadparts.size();
-            if (numDead>0)
+            osgUtil::radixSort(_sortedParticles, _sortScratch, 32);
+        }
+        else
+        {
+            for (unsigned int i=0; i<_particles.size(); ++i)
             {
-                 // clear the death stack
-                _deadparts = Death_stack();
-
-                // copy the tail of the _particles vector as this will contain all the dead Particle thanks to the depth sort against DBL_MAX
-                Particle* first_dead_ptr  = &_particles[_particles.size()-numDead];
-                Particle* last_dead_ptr  = &_particles[_particles.size()-1];
-                for(Particle* dead_ptr  = first_dead_ptr; dead_ptr<=last_dead_ptr; ++dead_ptr)
-                {
-                    _deadparts.push(dead_ptr);
-                }
+                if (_particles[i].isAlive()) _sortedParticles.push_back(osgUtil::RadixSortItem<unsigned int>(0, i));
             }
         }
     }
@@ -230,6 +317,98 @@ void osgParticle::ParticleSystem::drawImplementation(osg::RenderInfo& renderInfo
 
     ArrayData& ad = _bufferedArrayData[state.getContextID()];
 
+    if (_useInstancing)
+    {
+        const osg::GLExtensions* extensions = state.get<osg::GLExtensions>();
+        const osg::Program::PerContextProgram* pcp = state.getLastAppliedProgramObject();
+        if (!extensions->glDrawArraysInstanced || !extensions->glVertexAttribDivisor || !pcp)
+        {
+            OSG_NOTICE<<"Warning: ParticleSystem::drawImplementation(..) instanced drawing requires instanced arrays and a Program."<<std::endl;
+            return;
+        }
+
+        if (!ad.corners.valid())
+        {
+            ad.initInstanced();
+        }
+
+        unsigned int numInstances = fillInstanceArrays(*ad.instancePositionSizes, *ad.instanceColors, *ad.instanceAngles);
+        if (numInstances==0) return;
+
+        ad.dirty();
+
+        // the billboard axes in local coordinates, as the other paths compute them for each particle.
+        osg::Vec3 xAxis = _align_X_axis;
+        osg::Vec3 yAxis = _align_Y_axis;
+        if (_alignment==BILLBOARD)
+        {
+            xAxis = osg::Matrix::transform3x3(modelview,_align_X_axis);
+            yAxis = osg::Matrix::transform3x3(modelview,_align_Y_axis);
+
+            float lengthX2 = xAxis.length2();
+            float lengthY2 = yAxis.length2();
+            if (_particleScaleReferenceFrame==LOCAL_COORDINATES)
+            {
+                xAxis /= sqrtf(lengthX2);
+                yAxis /= sqrtf(lengthY2);
+            }
+            else
+            {
+                xAxis /= lengthX2;
+                yAxis /= lengthY2;
+            }
+        }
+
+        GLint xAxisLocation = pcp->getUniformLocation(osg::Uniform::getNameID("osg_ParticleXAxis"));
+        GLint yAxisLocation = pcp->getUniformLocation(osg::Uniform::getNameID("osg_ParticleYAxis"));
+        if (xAxisLocation>=0) extensions->glUniform3f(xAxisLocation, xAxis.x(), xAxis.y(), xAxis.z());
+        if (yAxisLocation>=0) extensions->glUniform3f(yAxisLocation, yAxis.x(), yAxis.y(), yAxis.z());
+
+        osg::VertexArrayState* vas = state.getCurrentVertexArrayState();
+        vas->lazyDisablingOfVertexAttributes();
+        vas->setVertexArray(state, ad.corners.get());
+        vas->setVertexAttribArray(state, 6, ad.instancePositionSizes.get());
+        vas->setVertexAttribArray(state, 7, ad.instanceColors.get());
+        vas->setVertexAttribArray(state, 1, ad.instanceAngles.get());
+        vas->applyDisablingOfVertexAttributes(state);
+
+        extensions->glVertexAttribDivisor(6, 1);
+        extensions->glVertexAttribDivisor(7, 1);
+        extensions->glVertexAttribDivisor(1, 1);
+
+#if !defined(OSG_GLES1_AVAILABLE) && !defined(OSG_GLES2_AVAILABLE) && !defined(OSG_GLES3_AVAILABLE) && !defined(OSG_GL3_AVAILABLE)
+        glPushAttrib(GL_DEPTH_BUFFER_BIT);
+#endif
+
+        glDepthMask(GL_FALSE);
+
+        extensions->glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, numInstances);
+
+#if !defined(OSG_GLES1_AVAILABLE) && !defined(OSG_GLES2_AVAILABLE) && !defined(OSG_GLES3_AVAILABLE) && !defined(OSG_GL3_AVAILABLE)
+        glPopAttrib();
+#endif
+
+        if (_doublepass)
+        {
+#if !defined(OSG_GLES1_AVAILABLE) && !defined(OSG_GLES2_AVAILABLE) && !defined(OSG_GLES3_AVAILABLE) && !defined(OSG_GL3_AVAILABLE)
+            glPushAttrib(GL_COLOR_BUFFER_BIT);
+#endif
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+            extensions->glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, numInstances);
+
+#if !defined(OSG_GLES1_AVAILABLE) && !defined(OSG_GLES2_AVAILABLE) && !defined(OSG_GLES3_AVAILABLE) && !defined(OSG_GL3_AVAILABLE)
+            glPopAttrib();
+#endif
+        }
+
+        // the divisors are vertex array state other drawables don't expect
+        extensions->glVertexAttribDivisor(6, 0);
+        extensions->glVertexAttribDivisor(7, 0);
+        extensions->glVertexAttribDivisor(1, 0);
+        return;
+    }
+
     if (_useVertexArray)
     {
         // note from Robert Osfield, September 2016, this block implemented for backwards compatibility but is pretty way vertex array/shaders were hacked into osgParticle
@@ -250,9 +429,10 @@ void osgParticle::ParticleSystem::drawImplementation(osg::RenderInfo& renderInfo
         osg::Vec3Array& texcoords = *ad.texcoords3;
         ArrayData::Primitives& primitives = ad.primitives;
 
-        for(unsigned int i=0; i<_particles.size(); i+=_detail)
+        unsigned int numParticles = numParticlesToDraw();
+        for(unsigned int i=0; i<numParticles; i+=_detail)
         {
-            const Particle* particle = &_particles[i];
+            const Particle* particle = &getParticleToDraw(i);
             const osg::Vec4& color = particle->getCurrentColor();
             const osg::Vec3& pos = particle->getPosition();
             const osg::Vec3& vel = particle->getVelocity();
@@ -319,9 +499,10 @@ void osgParticle::ParticleSystem::drawImplementation(osg::RenderInfo& renderInfo
             yAxis *= yScale;
         }
 
-        for(unsigned int i=0; i<_particles.size(); i+=_detail)
+        unsigned int numParticles = numParticlesToDraw();
+        for(unsigned int i=0; i<numParticles; i+=_detail)
         {
-            const Particle* currentParticle = &_particles[i];
+            const Particle* currentParticle = &getParticleToDraw(i);
 
             bool insideDistance = true;
             if (_sortMode != NO_SORT && _visibilityDistance>0.0)
@@ -504,6 +685,43 @@ void osgParticle::ParticleSystem::drawImplementation(osg::RenderInfo& renderInfo
     }
 }
 
+unsigned int osgParticle::ParticleSystem::fillInstanceArrays(osg::Vec4Array& positionSizes, osg::Vec4ubArray& colors, osg::FloatArray& angles) const
+{
+    unsigned int numParticles = numParticlesToDraw();
+    unsigned int maxNumInstances = (numParticles + _detail - 1) / _detail;
+    if (positionSizes.size()<maxNumInstances || colors.size()<maxNumInstances || angles.size()<maxNumInstances)
+    {
+        // grow geometrically so that the layout of the buffer holding the arrays rarely changes
+        unsigned int capacity = osg::maximum(maxNumInstances, static_cast<unsigned int>(positionSizes.size())*2);
+        positionSizes.resize(capacity);
+        colors.resize(capacity);
+        angles.resize(capacity);
+    }
+
+    float scale = sqrtf(static_cast<float>(_detail));
+    bool checkDistance = _sortMode != NO_SORT && _visibilityDistance>0.0;
+
+    unsigned int numInstances = 0;
+    for(unsigned int i=0; i<numParticles; i+=_detail)
+    {
+        const Particle& particle = getParticleToDraw(i);
+        if (!particle.isAlive()) continue;
+        if (checkDistance && (particle.getDepth()<0.0 || particle.getDepth()>_visibilityDistance)) continue;
+
+        const osg::Vec3& position = particle.getPosition();
+        const osg::Vec4& color = particle.getCurrentColor();
+        positionSizes[numInstances].set(position.x(), position.y(), position.z(), particle.getCurrentSize() * scale);
+        colors[numInstances].set(static_cast<unsigned char>(osg::clampBetween(color.r(), 0.0f, 1.0f) * 255.0f + 0.5f),
+                                 static_cast<unsigned char>(osg::clampBetween(color.g(), 0.0f, 1.0f) * 255.0f + 0.5f),
+                                 static_cast<unsigned char>(osg::clampBetween(color.b(), 0.0f, 1.0f) * 255.0f + 0.5f),
+                                 static_cast<unsigned char>(osg::clampBetween(color.a() * particle.getCurrentAlpha(), 0.0f, 1.0f) * 255.0f + 0.5f));
+        angles[numInstances] = particle.getAngle().z();
+        ++numInstances;
+    }
+
+    return numInstances;
+}
+
 void osgParticle::ParticleSystem::setDefaultAttributes(const std::string& texturefile, bool emissive_particles, bool lighting, int texture_unit)
 {
     osg::StateSet *stateset = new osg::StateSet;
@@ -633,6 +851,87 @@ void osgParticle::ParticleSystem::setDefaultAttributesUsingShaders(const std::st
     setUseShaders(true);
 }
 
+void osgParticle::ParticleSystem::setDefaultAttributesUsingInstancing(const std::string& texturefile, bool emissive_particles, int texture_unit)
+{
+    osg::StateSet *stateset = new osg::StateSet;
+    stateset->setRenderingHint(osg::StateSet::TRANSPARENT_BIN);
+    stateset->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+
+    bool textured = !texturefile.empty();
+    if (textured)
+    {
+        osg::Texture2D *texture = new osg::Texture2D;
+        texture->setImage(osgDB::readRefImageFile(texturefile));
+        texture->setFilter(osg::Texture2D::MIN_FILTER, osg::Texture2D::LINEAR);
+        texture->setFilter(osg::Texture2D::MAG_FILTER, osg::Texture2D::LINEAR);
+        texture->setWrap(osg::Texture2D::WRAP_S, osg::Texture2D::MIRROR);
+        texture->setWrap(osg::Texture2D::WRAP_T, osg::Texture2D::MIRROR);
+        stateset->setTextureAttributeAndModes(texture_unit, texture, osg::StateAttribute::ON);
+    }
+
+    osg::BlendFunc *blend = new osg::BlendFunc;
+    if (emissive_particles)
+    {
+        blend->setFunction(osg::BlendFunc::SRC_ALPHA, osg::BlendFunc::ONE);
+    }
+    else
+    {
+        blend->setFunction(osg::BlendFunc::SRC_ALPHA, osg::BlendFunc::ONE_MINUS_SRC_ALPHA);
+    }
+    stateset->setAttributeAndModes(blend, osg::StateAttribute::ON);
+
+    char vertexShaderSource[] =
+        "uniform vec3 osg_ParticleXAxis;\n"
+        "uniform vec3 osg_ParticleYAxis;\n"
+        "attribute vec4 osg_ParticlePositionSize;\n"
+        "attribute vec4 osg_ParticleColor;\n"
+        "attribute float osg_ParticleAngle;\n"
+        "varying vec2 texCoord;\n"
+        "\n"
+        "void main(void)\n"
+        "{\n"
+        "    vec2 corner = gl_Vertex.xy;\n"
+        "    float c = cos(osg_ParticleAngle);\n"
+        "    float s = sin(osg_ParticleAngle);\n"
+        "    vec3 xAxis = osg_ParticleXAxis*c + osg_ParticleYAxis*s;\n"
+        "    vec3 yAxis = osg_ParticleYAxis*c - osg_ParticleXAxis*s;\n"
+        "    vec3 position = osg_ParticlePositionSize.xyz + (xAxis*corner.x + yAxis*corner.y)*osg_ParticlePositionSize.w;\n"
+        "    gl_Position = gl_ModelViewProjectionMatrix * vec4(position, 1.0);\n"
+        "    texCoord = corner*0.5 + 0.5;\n"
+        "    gl_FrontColor = osg_ParticleColor;\n"
+        "}\n";
+    char texturedFragmentShaderSource[] =
+        "uniform sampler2D baseTexture;\n"
+        "varying vec2 texCoord;\n"
+        "\n"
+        "void main(void)\n"
+        "{\n"
+        "    gl_FragColor = gl_Color * texture2D(baseTexture, texCoord);\n"
+        "}\n";
+    char fragmentShaderSource[] =
+        "varying vec2 texCoord;\n"
+        "\n"
+        "void main(void)\n"
+        "{\n"
+        "    gl_FragColor = gl_Color;\n"
+        "}\n";
+
+    osg::Program *program = new osg::Program;
+    program->addShader(new osg::Shader(osg::Shader::VERTEX, vertexShaderSource));
+    program->addShader(new osg::Shader(osg::Shader::FRAGMENT, textured ? texturedFragmentShaderSource : fragmentShaderSource));
+    program->addBindAttribLocation("osg_ParticlePositionSize", 6);
+    program->addBindAttribLocation("osg_ParticleColor", 7);
+    program->addBindAttribLocation("osg_ParticleAngle", 1);
+    stateset->setAttributeAndModes(program, osg::StateAttribute::ON);
+
+    if (textured) stateset->addUniform(new osg::IntUniform("baseTexture", texture_unit));
+    setStateSet(stateset);
+
+    setUseVertexArray(false);
+    setUseShaders(false);
+    setUseInstancing(true);
+}
+
 osg::BoundingBox osgParticle::ParticleSystem::computeBoundingBox() const
 {
     if (!_bounds_computed)
@@ -684,6 +983,9 @@ osg::VertexArrayState* osgParticle::ParticleSystem::createVertexArrayStateImplem
     vas->assignColorArrayDispatcher();
     vas->assignTexCoordArrayDispatcher(1);
 
+    // instance data, see fillInstanceArrays()
+    vas->assignVertexAttribArrayDispatcher(8);
+
     if (state.useVertexArrayObject(_useVertexArrayObject))
     {
         vas->generateVertexArrayObject();
@@ -719,6 +1021,34 @@ void osgParticle::ParticleSystem::ArrayData::init()
     texcoords2->setDataVariance(osg::Object::DYNAMIC);
 }
 
+void osgParticle::ParticleSystem::ArrayData::initInstanced()
+{
+    // a single buffer, rewritten every frame, holds the corners of the quad followed by the instance arrays.
+    vertexBufferObject = new osg::VertexBufferObject;
+    vertexBufferObject->setUsage(GL_DYNAMIC_DRAW);
+    vertexBufferObject->setStreaming(true);
+
+    corners = new osg::Vec2Array(osg::Array::BIND_PER_VERTEX);
+    corners->push_back(osg::Vec2(-1.0f, -1.0f));
+    corners->push_back(osg::Vec2(1.0f, -1.0f));
+    corners->push_back(osg::Vec2(-1.0f, 1.0f));
+    corners->push_back(osg::Vec2(1.0f, 1.0f));
+    corners->setBufferObject(vertexBufferObject.get());
+
+    instancePositionSizes = new osg::Vec4Array(osg::Array::BIND_PER_VERTEX);
+    instancePositionSizes->setBufferObject(vertexBufferObject.get());
+    instancePositionSizes->setDataVariance(osg::Object::DYNAMIC);
+
+    instanceColors = new osg::Vec4ubArray(osg::Array::BIND_PER_VERTEX);
+    instanceColors->setNormalize(true);
+    instanceColors->setBufferObject(vertexBufferObject.get());
+    instanceColors->setDataVariance(osg::Object::DYNAMIC);
+
+    instanceAngles = new osg::FloatArray(osg::Array::BIND_PER_VERTEX);
+    instanceAngles->setBufferObject(vertexBufferObject.get());
+    instanceAngles->setDataVariance(osg::Object::DYNAMIC);
+}
+
 void osgParticle::ParticleSystem::ArrayData::init3()
 {
     vertexBufferObject = new osg::VertexBufferObject;
@@ -774,6 +1104,10 @@ void osgParticle::ParticleSystem::ArrayData::resizeGLObjectBuffers(unsigned int
     if (colors.valid()) colors->resizeGLObjectBuffers(maxSize);
     if (texcoords2.valid()) texcoords2->resizeGLObjectBuffers(maxSize);
     if (texcoords3.valid()) texcoords3->resizeGLObjectBuffers(maxSize);
+    if (corners.valid()) corners->resizeGLObjectBuffers(maxSize);
+    if (instancePositionSizes.valid()) instancePositionSizes->resizeGLObjectBuffers(maxSize);
+    if (instanceColors.valid()) instanceColors->resizeGLObjectBuffers(maxSize);
+    if (instanceAngles.valid()) instanceAngles->resizeGLObjectBuffers(maxSize);
 }
 
 void osgParticle::ParticleSystem::ArrayData::releaseGLObjects(osg::State* state)
@@ -787,6 +1121,10 @@ void osgParticle::ParticleSystem::ArrayData::releaseGLObjects(osg::State* state)
     if (colors.valid()) colors->releaseGLObjects(state);
     if (texcoords2.valid()) texcoords2->releaseGLObjects(state);
     if (texcoords3.valid()) texcoords3->releaseGLObjects(state);
+    if (corners.valid()) corners->releaseGLObjects(state);
+    if (instancePositionSizes.valid()) instancePositionSizes->releaseGLObjects(state);
+    if (instanceColors.valid()) instanceColors->releaseGLObjects(state);
+    if (instanceAngles.valid()) instanceAngles->releaseGLObjects(state);
 }
 
 void osgParticle::ParticleSystem::ArrayData::clear()
@@ -806,6 +1144,10 @@ void osgParticle::ParticleSystem::ArrayData::dirty()
     if (colors.valid()) colors->dirty();
     if (texcoords2.valid()) texcoords2->dirty();
     if (texcoords3.valid()) texcoords3->dirty();
+    if (corners.valid()) corners->dirty();
+    if (instancePositionSizes.valid()) instancePositionSizes->dirty();
+    if (instanceColors.valid()) instanceColors->dirty();
+    if (instanceAngles.valid()) instanceAngles->dirty();
 }
 
 void osgParticle::ParticleSystem::ArrayData::dispatchArrays(osg::State& state)
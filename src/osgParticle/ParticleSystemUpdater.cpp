@@ -1,18 +1,51 @@
 #include <osgParticle/ParticleSystemUpdater>
+#include <osgParticle/ParticleProcessor>
 
 #include <osg/CopyOp>
 #include <osg/Geode>
+#include <osg/ParallelFor>
+
+#include <OpenThreads/Thread>
 
 using namespace osg;
 
+/** The particle systems to process and update this frame, shared out between threads by osg::parallelFor().*/
+struct osgParticle::ParticleSystemUpdater::UpdateParticleSystems : public osg::ParallelForFunctor
+{
+    struct Entry
+    {
+        ParticleSystem* ps;
+        bool update;
+    };
+    typedef std::vector<Entry> EntryList;
+
+    UpdateParticleSystems(ParticleSystemUpdater* updater, double dt, osg::NodeVisitor& nv):
+        _updater(updater),
+        _dt(dt),
+        _nv(nv) {}
+
+    virtual void operator () (unsigned int begin, unsigned int end)
+    {
+        for(unsigned int i=begin; i<end; ++i)
+        {
+            _updater->updateParticleSystem(_entries[i].ps, _dt, _entries[i].update, _nv);
+        }
+    }
+
+    ParticleSystemUpdater*  _updater;
+    double                  _dt;
+    osg::NodeVisitor&       _nv;
+    EntryList               _entries;
+};
+
 osgParticle::ParticleSystemUpdater::ParticleSystemUpdater()
-: osg::Node(), _t0(-1), _frameNumber(0)
+: osg::Node(), _t0(-1), _frameNumber(0), _numThreads(1)
 {
     setCullingActive(false);
 }
 
 osgParticle::ParticleSystemUpdater::ParticleSystemUpdater(const ParticleSystemUpdater& copy, const osg::CopyOp& copyop)
-: osg::Node(copy, copyop), _t0(copy._t0), _frameNumber(0)
+: osg::Node(copy, copyop), _t0(copy._t0), _frameNumber(0), _numThreads(copy._numThreads)
 {
     ParticleSystem_Vector::const_iterator i;
     for (i=copy._psv.begin(); i!=copy._psv.end(); ++i) {
@@ -20,6 +53,45 @@ osgParticle::ParticleSystemUpdater::ParticleSystemUpdater(const ParticleSystemUp
     }
 }
 
+osgParticle::ParticleSystemUpdater::~ParticleSystemUpdater()
+{
+    for (ParticleSystem_Vector::iterator i=_psv.begin(); i!=_psv.end(); ++i)
+    {
+        releaseParticleSystem(i->get());
+    }
+}
+
+void osgParticle::ParticleSystemUpdater::setNumThreads(unsigned int numThreads)
+{
+    _numThreads = numThreads==0 ? OpenThreads::GetNumberOfProcessors() : numThreads;
+}
+
+void osgParticle::ParticleSystemUpdater::releaseParticleSystem(ParticleSystem* ps)
+{
+    if (!ps) return;
+
+    ParticleSystem::ScopedWriteLock lock(*(ps->getReadWriteMutex()));
+    ps->setDeferProcessing(false);
+    ps->getDeferredProcessors().clear();
+}
+
+void osgParticle::ParticleSystemUpdater::updateParticleSystem(ParticleSystem* ps, double dt, bool update, osg::NodeVisitor& nv)
+{
+    ParticleSystem::ScopedWriteLock lock(*(ps->getReadWriteMutex()));
+
+    // the emitters and programs queued in traversal order, so particles are emitted and animated as they
+    // would have been had they processed the particle system themselves.
+    ParticleSystem::ParticleProcessorList& processors = ps->getDeferredProcessors();
+    for (ParticleSystem::ParticleProcessorList::iterator itr = processors.begin(); itr != processors.end(); ++itr)
+    {
+        osg::ref_ptr<ParticleProcessor> processor;
+        if (itr->lock(processor)) processor->process(processor->_deferredDt);
+    }
+    processors.clear();
+
+    if (update) ps->update(dt, nv);
+}
+
 void osgParticle::ParticleSystemUpdater::traverse(osg::NodeVisitor& nv)
 {
     if (nv.getVisitorType() == osg::NodeVisitor::CULL_VISITOR)
@@ -31,24 +103,55 @@ void osgParticle::ParticleSystemUpdater::traverse(osg::NodeVisitor& nv)
                 _frameNumber = nv.getFrameStamp()->getFrameNumber();
 
                 double t = nv.getFrameStamp()->getSimulationTime();
-                if (_t0 != -1.0)
+                double dt = t - _t0;
+                bool parallel = _numThreads>1 && _psv.size()>1;
+
+                UpdateParticleSystems updateParticleSystems(this, dt, nv);
+
+                ParticleSystem_Vector::iterator i;
+                for (i=_psv.begin(); i!=_psv.end(); ++i)
                 {
-                    ParticleSystem_Vector::iterator i;
-                    for (i=_psv.begin(); i!=_psv.end(); ++i)
-                    {
-                        ParticleSystem* ps = i->get();
+                    ParticleSystem* ps = i->get();
 
-                        ParticleSystem::ScopedWriteLock lock(*(ps->getReadWriteMutex()));
+                    // We need to allow at least 2 frames difference, because the particle system's lastFrameNumber
+                    // is updated in the draw thread which may not have completed yet.
+                    UpdateParticleSystems::Entry entry;
+                    entry.ps = ps;
+                    entry.update = _t0 != -1.0 &&
+                                   !ps->isFrozen() &&
+                                   (!ps->getFreezeOnCull() || ((nv.getFrameStamp()->getFrameNumber()-ps->getLastFrameNumber()) <= 2));
 
-                        // We need to allow at least 2 frames difference, because the particle system's lastFrameNumber
-                        // is updated in the draw thread which may not have completed yet.
-                        if (!ps->isFrozen() &&
-                            (!ps->getFreezeOnCull() || ((nv.getFrameStamp()->getFrameNumber()-ps->getLastFrameNumber()) <= 2)) )
+                    if (parallel)
+                    {
+                        if (!ps->getDeferProcessing())
                         {
-                            ps->update(t - _t0, nv);
+                            ParticleSystem::ScopedWriteLock lock(*(ps->getReadWriteMutex()));
+                            ps->setDeferProcessing(true);
                         }
+
+                        // dirty the bounds of the particle systems here so that the dirtyBound() calls of their updates
+                        // stop at the particle systems rather than dirty parents they may share from several threads.
+                        if (entry.update) ps->dirtyBound();
+                        updateParticleSystems._entries.push_back(entry);
+                    }
+                    else
+                    {
+                        if (ps->getDeferProcessing())
+                        {
+                            ParticleSystem::ScopedWriteLock lock(*(ps->getReadWriteMutex()));
+                            ps->setDeferProcessing(false);
+                        }
+
+                        // also runs any processing queued while the particle systems were updated in parallel
+                        updateParticleSystem(ps, dt, entry.update, nv);
                     }
                 }
+
+                if (parallel)
+                {
+                    osg::parallelFor(static_cast<unsigned int>(updateParticleSystems._entries.size()), 1, updateParticleSystems, _numThreads);
+                }
+
                 _t0 = t;
             }
 
@@ -93,6 +196,10 @@ bool osgParticle::ParticleSystemUpdater::removeParticleSystem(unsigned int pos,
          OSG_DEBUG<<"         of ParticleSystems to remove, trimming just to end of ParticleSystem list."<<std::endl;
          endOfRemoveRange = _psv.size();
       }
+      for (unsigned int i=pos; i<endOfRemoveRange; ++i)
+      {
+         releaseParticleSystem(_psv[i].get());
+      }
       _psv.erase(_psv.begin()+pos, _psv.begin()+endOfRemoveRange);
       return true;
    }
@@ -115,6 +222,7 @@ bool osgParticle::ParticleSystemUpdater::setParticleSystem( unsigned int i, Part
 {
    if( (i < _psv.size()) && ps )
    {
+      if (_psv[i]!=ps) releaseParticleSystem(_psv[i].get());
       _psv[i] = ps;
       return true;
    }
@@ -26,6 +26,7 @@
 #include <osgDB/ReadFile>
 #include <osgDB/FileUtils>
 #include "Registry.h"
+#include "ReadCache.h"
 #include "Document.h"
 #include "AttrData.h"
 #include "RecordInputStream.h"
@@ -494,8 +495,11 @@ protected:
             return;
         }
 
-        // Is texture in local cache?
-        osg::ref_ptr<osg::StateSet> stateset = flt::Registry::instance()->getTextureFromLocalCache(pathname);
+        // Is texture in the cache shared with externals being read in parallel, or in local cache?
+        ReadCache* readCache = ReadCache::get(document.getOptions());
+        osg::ref_ptr<osg::StateSet> stateset = readCache ? readCache->getTexture(pathname) : 0;
+        if (!stateset.valid())
+            stateset = flt::Registry::instance()->getTextureFromLocalCache(pathname);
 
         // Read file if not in cache.
         if (!stateset.valid())
@@ -506,6 +510,10 @@ protected:
             flt::Registry::instance()->addTextureToLocalCache(pathname,stateset.get());
         }
 
+        // Another thread may have read the same texture in the meantime, if so share its StateSet.
+        if (readCache)
+            stateset = readCache->addTexture(pathname,stateset.get());
+
         // Add to texture pool.
         TexturePool* tp = document.getOrCreateTexturePool();
         (*tp)[index] = stateset;
@@ -0,0 +1,88 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#ifndef FLT_READCACHE_H
+#define FLT_READCACHE_H 1
+
+#include <map>
+#include <string>
+#include <osg/Node>
+#include <osg/StateSet>
+#include <osgDB/Options>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+
+namespace flt {
+
+/** Cache of externals and texture palette entries shared by all the Documents read while loading the
+  * external references of a master file in parallel. When two threads read the same file the first
+  * one to finish wins and the other adopts its result, so the resulting scene graph shares objects in
+  * the same way as the serial load does through flt::Registry's local cache.*/
+class ReadCache : public osg::Referenced
+{
+    public:
+
+        ReadCache() {}
+
+        /** Name the cache is passed under as osgDB::Options plugin data.*/
+        static const char* pluginDataName() { return "flt::ReadCache"; }
+
+        static ReadCache* get(const osgDB::Options* options)
+        {
+            return options ? const_cast<ReadCache*>(static_cast<const ReadCache*>(options->getPluginData(pluginDataName()))) : 0;
+        }
+
+        osg::Node* getExternal(const std::string& filename) { return find(_externals, filename); }
+
+        /** Add an external to the cache, returning the entry already cached under filename if there is one.*/
+        osg::Node* addExternal(const std::string& filename, osg::Node* node) { return insert(_externals, filename, node); }
+
+        osg::StateSet* getTexture(const std::string& filename) { return find(_textures, filename); }
+
+        /** Add a texture StateSet to the cache, returning the entry already cached under filename if there is one.*/
+        osg::StateSet* addTexture(const std::string& filename, osg::StateSet* stateset) { return insert(_textures, filename, stateset); }
+
+        /** Mutex held while attaching externals to their ProxyNodes, as a cached external may be attached
+          * to several parents from different threads.*/
+        OpenThreads::Mutex& getAttachMutex() { return _attachMutex; }
+
+    protected:
+
+        virtual ~ReadCache() {}
+
+        template<class T>
+        T* find(std::map< std::string, osg::ref_ptr<T> >& cache, const std::string& filename)
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            typename std::map< std::string, osg::ref_ptr<T> >::iterator itr = cache.find(filename);
+            return itr!=cache.end() ? itr->second.get() : 0;
+        }
+
+        template<class T>
+        T* insert(std::map< std::string, osg::ref_ptr<T> >& cache, const std::string& filename, T* object)
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            osg::ref_ptr<T>& entry = cache[filename];
+            if (!entry) entry = object;
+            return entry.get();
+        }
+
+        OpenThreads::Mutex                                      _mutex;
+        OpenThreads::Mutex                                      _attachMutex;
+        std::map< std::string, osg::ref_ptr<osg::Node> >        _externals;
+        std::map< std::string, osg::ref_ptr<osg::StateSet> >    _textures;
+};
+
+} // end namespace
+
+#endif
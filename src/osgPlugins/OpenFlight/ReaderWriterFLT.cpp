@@ -18,8 +18,11 @@
 //
 
 #include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
 #include <osg/Notify>
 #include <osg/ProxyNode>
+#include <osg/OperationThread>
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
 #include <osgDB/Registry>
@@ -28,6 +31,7 @@
 #include <osgUtil/Optimizer>
 
 #include "Registry.h"
+#include "ReadCache.h"
 #include "Document.h"
 #include "RecordInputStream.h"
 #include "DataOutputStream.h"
@@ -145,26 +149,88 @@ USE_FLTRECORD(NormalVertex, OLD_NORMAL_VERTEX_OP)
 
 
 
+/** Reads the file of an external reference on one of the threads of ReadExternalsVisitor's pool. The
+  * block is released once the read completes so the result can be attached to its ProxyNode in order.*/
+class ReadExternalOperation : public osg::Operation
+{
+public:
+
+    ReadExternalOperation(const std::string& filename, ReaderWriter::Options* options) :
+        osg::Operation("ReadExternalOperation", false),
+        _filename(filename),
+        _options(options),
+        _block(new osg::RefBlock) {}
+
+    virtual void operator () (osg::Object*)
+    {
+        _external = osgDB::readRefNodeFile(_filename,_options.get());
+        _block->release();
+    }
+
+    osg::Node* waitForExternal()
+    {
+        _block->block();
+        return _external.get();
+    }
+
+protected:
+
+    std::string                         _filename;
+    osg::ref_ptr<ReaderWriter::Options> _options;
+    osg::ref_ptr<osg::RefBlock>         _block;
+    osg::ref_ptr<osg::Node>             _external;
+};
+
+
+
 class ReadExternalsVisitor : public osg::NodeVisitor
 {
     osg::ref_ptr<ReaderWriter::Options> _options;
     bool _cloneExternalReferences;
+    unsigned int _numThreads;
+    osg::ref_ptr<ReadCache> _readCache;
+
+    typedef std::vector< osg::ref_ptr<ProxyNode> > ProxyNodeList;
+    ProxyNodeList _proxyNodes;
 
 public:
 
     ReadExternalsVisitor(ReaderWriter::Options* options) :
         osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
         _options(options),
-        _cloneExternalReferences(false)
+        _cloneExternalReferences(false),
+        _numThreads(0),
+        _readCache(ReadCache::get(options))
     {
         if (options)
+        {
             _cloneExternalReferences = (options->getOptionString().find("cloneExternalReferences")!=std::string::npos);
+
+            // Externals of externals are read serially on the thread reading their parent, only the
+            // master file dispatches its externals to a thread pool.
+            std::string::size_type pos = options->getOptionString().find("parallelExternals");
+            if (pos!=std::string::npos && !_readCache)
+            {
+                pos += strlen("parallelExternals");
+                if (pos<options->getOptionString().size() && options->getOptionString()[pos]=='=')
+                    _numThreads = atoi(options->getOptionString().c_str()+pos+1);
+                else
+                    _numThreads = OpenThreads::GetNumberOfProcessors();
+            }
+        }
     }
 
     virtual ~ReadExternalsVisitor() {}
 
     virtual void apply(ProxyNode& node)
     {
+        if (_numThreads>0)
+        {
+            // collect the externals to read them all in parallel in readExternals().
+            _proxyNodes.push_back(&node);
+            return;
+        }
+
         // Transfer ownership of pools.
         _options->setUserData( node.getUserData() );
         node.setUserData(NULL);
@@ -175,14 +241,82 @@ public:
 
             // read external
             osg::ref_ptr<osg::Node> external = osgDB::readRefNodeFile(filename,_options.get());
-            if (external.valid())
+            addExternal(node, external.get());
+        }
+    }
+
+    /** Read the externals collected by apply(ProxyNode&) on a pool of threads, attaching them to
+      * their ProxyNodes in traversal order so that the result matches the serial load.*/
+    void readExternals()
+    {
+        if (_proxyNodes.empty()) return;
+
+        _readCache = new ReadCache;
+        osg::ref_ptr<osg::OperationQueue> operationQueue = new osg::OperationQueue;
+
+        typedef std::vector< osg::ref_ptr<ReadExternalOperation> > Operations;
+        Operations operations;
+
+        for (ProxyNodeList::iterator itr = _proxyNodes.begin(); itr != _proxyNodes.end(); ++itr)
+        {
+            ProxyNode& node = *(*itr);
+
+            // each external gets its own options so it can own the parent pools.
+            osg::ref_ptr<osg::Referenced> parentPools = node.getUserData();
+            node.setUserData(NULL);
+
+            for (unsigned int pos=0; pos<node.getNumFileNames(); pos++)
             {
-                if (_cloneExternalReferences)
-                    external = dynamic_cast<osg::Node*>(external->clone(osg::CopyOp(osg::CopyOp::DEEP_COPY_NODES)));
+                osg::ref_ptr<ReaderWriter::Options> options = static_cast<ReaderWriter::Options*>(_options->clone(osg::CopyOp::SHALLOW_COPY));
+                options->setUserData(parentPools.get());
+                options->setPluginData(ReadCache::pluginDataName(), _readCache.get());
 
-                node.addChild(external.get());
+                operations.push_back(new ReadExternalOperation(node.getFileName(pos), options.get()));
+                operationQueue->add(operations.back().get());
+            }
+        }
+
+        typedef std::vector< osg::ref_ptr<osg::OperationThread> > OperationThreads;
+        OperationThreads threads;
+        for (unsigned int i=0; i<_numThreads && i<operations.size(); ++i)
+        {
+            threads.push_back(new osg::OperationThread);
+            threads.back()->setOperationQueue(operationQueue.get());
+            threads.back()->startThread();
+        }
+
+        Operations::iterator oitr = operations.begin();
+        for (ProxyNodeList::iterator itr = _proxyNodes.begin(); itr != _proxyNodes.end(); ++itr)
+        {
+            for (unsigned int pos=0; pos<(*itr)->getNumFileNames(); pos++, ++oitr)
+            {
+                addExternal(*(*itr), (*oitr)->waitForExternal());
             }
         }
+
+        for (OperationThreads::iterator titr = threads.begin(); titr != threads.end(); ++titr)
+        {
+            (*titr)->cancel();
+        }
+
+        _proxyNodes.clear();
+        _readCache = 0;
+    }
+
+protected:
+
+    void addExternal(ProxyNode& node, osg::Node* node_external)
+    {
+        osg::ref_ptr<osg::Node> external = node_external;
+        if (external.valid())
+        {
+            if (_cloneExternalReferences)
+                external = dynamic_cast<osg::Node*>(external->clone(osg::CopyOp(osg::CopyOp::DEEP_COPY_NODES)));
+
+            // externals are shared between the threads reading in parallel, so serialize changes to their parent lists.
+            OpenThreads::ScopedPointerLock<OpenThreads::Mutex> lock(_readCache.valid() ? &_readCache->getAttachMutex() : 0);
+            node.addChild(external.get());
+        }
     }
 };
 
@@ -229,6 +363,7 @@ class FLTReaderWriter : public ReaderWriter
 
             supportsOption("clampToEdge","Import option");
             supportsOption("keepExternalReferences","Import option");
+            supportsOption("parallelExternals[=<num threads>]","Import option: Read external references on a pool of threads, defaults to one thread per processor");
             supportsOption("preserveFace","Import option");
             supportsOption("preserveObject","Import option");
             supportsOption("replaceDoubleSidedPolys","Import option");
@@ -266,7 +401,10 @@ class FLTReaderWriter : public ReaderWriter
 
         virtual ReadResult readNode(const std::string& file, const Options* options) const
         {
-            SERIALIZER();
+            // Externals being read in parallel are handed out by a master file read that already holds
+            // the serializer, and share the ReadCache rather than relying on the serializer.
+            ReadCache* readCache = ReadCache::get(options);
+            OpenThreads::ScopedPointerLock<OpenThreads::ReentrantMutex> lock(readCache ? 0 : &_serializerMutex);
 
             std::string ext = osgDB::getLowerCaseFileExtension(file);
             if (!acceptsExtension(ext)) return ReadResult::FILE_NOT_HANDLED;
@@ -276,7 +414,9 @@ class FLTReaderWriter : public ReaderWriter
 
             // in local cache?
             {
-                osg::ref_ptr<osg::Node> node = flt::Registry::instance()->getExternalFromLocalCache(fileName);
+                osg::ref_ptr<osg::Node> node = readCache ? readCache->getExternal(fileName) : 0;
+                if (!node.valid())
+                    node = flt::Registry::instance()->getExternalFromLocalCache(fileName);
                 if (node.valid())
                     return ReadResult(node, ReaderWriter::ReadResult::FILE_LOADED_FROM_CACHE);
             }
@@ -301,6 +441,15 @@ class FLTReaderWriter : public ReaderWriter
 
             if (rr.success())
             {
+                // share the result with any other thread that has read the same external in the meantime,
+                // only the node that won the race is resolved and goes into the local cache.
+                if (readCache)
+                {
+                    osg::Node* cachedNode = readCache->addExternal(fileName,rr.getNode());
+                    if (cachedNode!=rr.getNode())
+                        return ReadResult(cachedNode, ReaderWriter::ReadResult::FILE_LOADED_FROM_CACHE);
+                }
+
                 // add to local cache.
                 flt::Registry::instance()->addExternalToLocalCache(fileName,rr.getNode());
 
@@ -317,6 +466,7 @@ class FLTReaderWriter : public ReaderWriter
                     {
                         ReadExternalsVisitor visitor(local_opt.get());
                         rr.getNode()->accept(visitor);
+                        visitor.readExternals();
                     }
                 }
                 else
@@ -325,7 +475,9 @@ class FLTReaderWriter : public ReaderWriter
                 }
             }
 
-            if (rr.getNode())
+            // externals read in parallel may be shared between threads while still being loaded, so leave
+            // configuring their buffer objects to the master file once everything is attached.
+            if (rr.getNode() && !readCache)
             {
                 osg::ConfigureBufferObjectsVisitor cbov;
                 rr.getNode()->accept(cbov);
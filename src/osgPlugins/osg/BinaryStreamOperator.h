@@ -154,6 +154,13 @@ public:
 
     virtual bool isBinary() const { return true; }
 
+    virtual osgDB::InputIterator* cloneForStream( std::istream* istream ) const
+    {
+        BinaryInputIterator* ii = new BinaryInputIterator(istream, _byteSwap);
+        ii->setSupportBinaryBrackets(_supportBinaryBrackets);
+        return ii;
+    }
+
     virtual void readBool( bool& b )
     {
         char c = 0;
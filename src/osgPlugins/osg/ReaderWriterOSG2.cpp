@@ -131,6 +131,10 @@ public:
         supportsOption( "SchemaData", "Export option: Record inbuilt schema data into a binary file" );
         supportsOption( "SchemaFile=<file>", "Import/Export option: Use/Record an ascii schema file" );
         supportsOption( "Compressor=<name>", "Export option: Use an inbuilt or user-defined compressor" );
+        supportsOption( "ObjectBlocks[=<bytes>]", "Export option: Write the children of Groups and Geodes holding more than the given "
+                        "number of bytes (default 1MB) outside of their largest child as blocks that can be read in parallel. "
+                        "Binary files only, not readable by earlier versions" );
+        supportsOption( "ObjectBlockThreads=<num threads>", "Import option: Number of threads used to read object blocks, default is the number of processors" );
         supportsOption( "WriteImageHint=<hint>", "Export option: Hint of writing image to stream: "
                         "<IncludeData> writes Image::data() directly; "
                         "<IncludeFile> writes the image file itself to stream; "
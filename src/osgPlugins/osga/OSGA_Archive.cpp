@@ -271,6 +271,8 @@ void OSGA_Archive::IndexBlock::write(std::ostream& out)
     if( _filePosition < currentPos ) // move file ptr to the end of file
         out.seekp( STREAM_POS( currentPos ) );
 
+    _requiresWrite = false;
+
     OSG_INFO<<"OSGA_Archive::IndexBlock::write() end"<<std::endl;
 }
 
@@ -546,6 +548,18 @@ void OSGA_Archive::writeIndexBlocks()
     }
 }
 
+bool OSGA_Archive::flush()
+{
+    SERIALIZER();
+
+    if (_status!=WRITE || !_output) return false;
+
+    writeIndexBlocks();
+    _output.flush();
+
+    return !_output.fail();
+}
+
 bool OSGA_Archive::fileExists(const std::string& filename) const
 {
     return (_indexMap.count(filename)!=0);
@@ -789,6 +803,26 @@ ReaderWriter::ReadResult OSGA_Archive::readShader(const std::string& fileName,co
     return const_cast<OSGA_Archive*>(this)->read(ReadShaderFunctor(fileName, options));
 }
 
+bool OSGA_Archive::readFileData(const std::string& fileName, std::string& data) const
+{
+    SERIALIZER();
+
+    if (_status!=READ) return false;
+
+    FileNamePositionMap::const_iterator itr = _indexMap.find(fileName);
+    if (itr==_indexMap.end()) return false;
+
+    osgDB::ifstream& input = const_cast<OSGA_Archive*>(this)->_input;
+    input.seekg( STREAM_POS( itr->second.first ) );
+
+    data.resize(static_cast<std::string::size_type>(itr->second.second));
+    if (!data.empty()) input.read(&data[0], data.size());
+
+    bool success = !input.fail();
+    input.clear();
+    return success;
+}
+
 
 struct OSGA_Archive::WriteObjectFunctor : public OSGA_Archive::WriteFunctor
 {
@@ -910,3 +944,24 @@ ReaderWriter::WriteResult OSGA_Archive::writeShader(const osg::Shader& shader,co
     return const_cast<OSGA_Archive*>(this)->write(WriteShaderFunctor(shader, fileName, options));
 }
 
+ReaderWriter::WriteResult OSGA_Archive::writeFileData(const std::string& data, const std::string& fileName) const
+{
+    SERIALIZER();
+
+    OSGA_Archive* archive = const_cast<OSGA_Archive*>(this);
+    if (_status!=WRITE)
+    {
+        OSG_INFO<<"OSGA_Archive::writeFileData("<<fileName<<") failed, archive opened as read only."<<std::endl;
+        return WriteResult(WriteResult::FILE_NOT_HANDLED);
+    }
+
+    pos_type position = ARCHIVE_POS( archive->_output.tellp() );
+
+    archive->_output.write(data.data(), data.size());
+    if (archive->_output.fail()) return WriteResult(WriteResult::ERROR_IN_WRITING_FILE);
+
+    if (!archive->addFileReference(position, size_type(data.size()), fileName)) return WriteResult(WriteResult::ERROR_IN_WRITING_FILE);
+
+    return WriteResult(WriteResult::FILE_SAVED);
+}
+
@@ -90,6 +90,15 @@ class OSGA_Archive : public osgDB::Archive
         /** Write an osg::Shader with specified file name to the Archive.*/
         virtual WriteResult writeShader(const osg::Shader& shader,const std::string& fileName,const Options* options=NULL) const;
 
+        /** Read the bytes stored for a file in the Archive.*/
+        virtual bool readFileData(const std::string& fileName, std::string& data) const;
+
+        /** Write a file already serialized by the plugin for its extension to the Archive.*/
+        virtual WriteResult writeFileData(const std::string& data, const std::string& fileName) const;
+
+        /** Write out the index blocks modified since the last flush or open.*/
+        virtual bool flush();
+
         #if defined(_MSC_VER)
         typedef __int64 pos_type;
         typedef __int64 size_type;
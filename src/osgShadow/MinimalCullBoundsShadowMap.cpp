@@ -121,7 +121,7 @@ void MinimalCullBoundsShadowMap::ViewData::GetRenderLeaves
         for( osgUtil::StateGraph::LeafList::const_iterator dw_itr =
             (*oitr)->_leaves.begin(); dw_itr != (*oitr)->_leaves.end(); ++dw_itr)
         {
-            rll.push_back( dw_itr->get() );
+            rll.push_back( *dw_itr );
         }
     }
 
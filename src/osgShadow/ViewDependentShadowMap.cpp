@@ -91,7 +91,7 @@ public:
             itr != rbl.end();
             ++itr)
         {
-            traverse(itr->second.get());
+            traverse(itr->second);
         }
 
         const osgUtil::RenderBin::RenderLeafList& rll = renderBin->getRenderLeafList();
@@ -119,7 +119,7 @@ public:
             itr != cl.end();
             ++itr)
         {
-            traverse(itr->second.get());
+            traverse(itr->second);
         }
 
         const osgUtil::StateGraph::LeafList& ll = stateGraph->_leaves;
@@ -127,7 +127,7 @@ public:
             itr != ll.end();
             ++itr)
         {
-            handle(itr->get());
+            handle(*itr);
         }
     }
 
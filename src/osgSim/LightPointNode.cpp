@@ -216,7 +216,7 @@ void LightPointNode::traverse(osg::NodeVisitor& nv)
             // and update its time signatures.
 
             drawable->reset();
-            rg->addLeaf(new osgUtil::RenderLeaf(drawable,&projection,NULL,FLT_MAX));
+            rg->addArenaLeaf(cv->createOrReuseRenderLeaf(drawable,&projection,NULL,FLT_MAX));
 
             // need to update the drawable's frame count.
             if (cv->getFrameStamp())
@@ -21,11 +21,16 @@
 #include <osgDB/ReadFile>
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
+#include <osgDB/fstream>
 #include <osg/GLU>
+#include <osg/ParallelFor>
 
 #include <string.h>
+#include <sstream>
+#include <iomanip>
 
 #include <OpenThreads/ReentrantMutex>
+#include <OpenThreads/Thread>
 
 #include "DefaultFont.h"
 
@@ -224,6 +229,7 @@ osg::ref_ptr<Font> osgText::readRefFontStream(std::istream& stream, const osgDB:
 
 Font::Font(FontImplementation* implementation):
     osg::Object(true),
+    _numGlyphThreads(0),
     _textureWidthHint(1024),
     _textureHeightHint(1024),
     _minFilterHint(osg::Texture::LINEAR_MIPMAP_LINEAR),
@@ -246,7 +252,23 @@ Font::Font(FontImplementation* implementation):
 
 Font::~Font()
 {
+    if (_preloadThread.valid()) _preloadThread->cancel();
+
     if (_implementation.valid()) _implementation->_facade = 0;
+
+    for(std::vector<GlyphCacheTable*>::iterator itr = _glyphCacheTables.begin();
+        itr != _glyphCacheTables.end();
+        ++itr)
+    {
+        delete *itr;
+    }
+
+    for(std::vector<GlyphCacheEntry*>::iterator itr = _glyphCacheEntries.begin();
+        itr != _glyphCacheEntries.end();
+        ++itr)
+    {
+        delete *itr;
+    }
 }
 
 void Font::setImplementation(FontImplementation* implementation)
@@ -328,6 +350,9 @@ Glyph* Font::getGlyph(const FontResolution& fontRes, unsigned int charcode)
     FontResolution fontResUsed(0,0);
     if (_implementation->supportsMultipleFontResolutions()) fontResUsed = fontRes;
 
+    Glyph* glyph = findCachedGlyph(fontResUsed, charcode);
+    if (glyph) return glyph;
+
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_glyphMapMutex);
     FontSizeGlyphMap::iterator itr = _sizeGlyphMap.find(fontResUsed);
     if (itr!=_sizeGlyphMap.end())
@@ -337,15 +362,206 @@ Glyph* Font::getGlyph(const FontResolution& fontRes, unsigned int charcode)
         if (gitr!=glyphmap.end()) return gitr->second.get();
     }
 
-    Glyph* glyph = _implementation->getGlyph(fontResUsed, charcode);
+    glyph = _implementation->getGlyph(fontResUsed, charcode);
     if (glyph)
     {
         _sizeGlyphMap[fontResUsed][charcode] = glyph;
+        addCachedGlyph(fontResUsed, charcode, glyph);
         return glyph;
     }
     else return 0;
 }
 
+unsigned int Font::glyphCacheHash(const FontResolution& fontRes, unsigned int charcode)
+{
+    unsigned int hash = charcode * 2654435761u;
+    hash ^= (fontRes.first * 40503u + fontRes.second) * 2246822519u;
+    return hash ^ (hash >> 15);
+}
+
+Glyph* Font::findCachedGlyph(const FontResolution& fontRes, unsigned int charcode) const
+{
+    const GlyphCacheTable* table = static_cast<const GlyphCacheTable*>(_glyphCache.get());
+    if (!table) return 0;
+
+    // the table is never more than half full so the probing always ends on an empty slot
+    unsigned int mask = table->_size-1;
+    for(unsigned int i = glyphCacheHash(fontRes, charcode) & mask; ; i = (i+1) & mask)
+    {
+        const GlyphCacheEntry* entry = static_cast<const GlyphCacheEntry*>(table->_slots[i].get());
+        if (!entry) return 0;
+        if (entry->_charcode==charcode && entry->_fontRes==fontRes) return entry->_glyph.get();
+    }
+}
+
+void Font::addCachedGlyph(const FontResolution& fontRes, unsigned int charcode, Glyph* glyph)
+{
+    GlyphCacheTable* table = static_cast<GlyphCacheTable*>(_glyphCache.get());
+    if (!table || (table->_numEntries+1)*2 > table->_size)
+    {
+        // readers may still be probing the old table so it's kept, along with its entries, which are shared by the new table
+        GlyphCacheTable* newTable = new GlyphCacheTable(table ? table->_size*2 : 256);
+        if (table)
+        {
+            unsigned int mask = newTable->_size-1;
+            for(unsigned int j=0; j<table->_size; ++j)
+            {
+                GlyphCacheEntry* entry = static_cast<GlyphCacheEntry*>(table->_slots[j].get());
+                if (!entry) continue;
+
+                unsigned int i = glyphCacheHash(entry->_fontRes, entry->_charcode) & mask;
+                while(newTable->_slots[i].get()) i = (i+1) & mask;
+                newTable->_slots[i].assign(entry, 0);
+            }
+            newTable->_numEntries = table->_numEntries;
+        }
+
+        _glyphCacheTables.push_back(newTable);
+        _glyphCache.assign(newTable, table);
+        table = newTable;
+    }
+
+    GlyphCacheEntry* newEntry = new GlyphCacheEntry(fontRes, charcode, glyph);
+    _glyphCacheEntries.push_back(newEntry);
+
+    unsigned int mask = table->_size-1;
+    for(unsigned int i = glyphCacheHash(fontRes, charcode) & mask; ; i = (i+1) & mask)
+    {
+        GlyphCacheEntry* entry = static_cast<GlyphCacheEntry*>(table->_slots[i].get());
+        if (!entry)
+        {
+            table->_slots[i].assign(newEntry, 0);
+            ++(table->_numEntries);
+            return;
+        }
+        if (entry->_charcode==charcode && entry->_fontRes==fontRes)
+        {
+            table->_slots[i].assign(newEntry, entry);
+            return;
+        }
+    }
+}
+
+namespace
+{
+    class GenerateGlyphImages : public osg::ParallelForFunctor
+    {
+    public:
+        GenerateGlyphImages(const std::vector<Glyph*>& glyphs, ShaderTechnique shaderTechnique):
+            _glyphs(glyphs),
+            _shaderTechnique(shaderTechnique) {}
+
+        virtual void operator () (unsigned int begin, unsigned int end)
+        {
+            for(unsigned int i=begin; i<end; ++i)
+            {
+                const Glyph::TextureInfo* info = _glyphs[i]->getTextureInfo(_shaderTechnique);
+                if (info && info->texture) info->texture->generateGlyphImage(_glyphs[i]);
+            }
+        }
+
+    protected:
+        const std::vector<Glyph*>&  _glyphs;
+        ShaderTechnique             _shaderTechnique;
+    };
+}
+
+void Font::setNumGlyphThreads(unsigned int numThreads)
+{
+    _numGlyphThreads = numThreads;
+}
+
+void Font::generateGlyphImages(const std::vector<Glyph*>& glyphs, ShaderTechnique shaderTechnique)
+{
+    GenerateGlyphImages generateGlyphImages(glyphs, shaderTechnique);
+    osg::parallelFor(static_cast<unsigned int>(glyphs.size()), 1, generateGlyphImages, _numGlyphThreads);
+}
+
+unsigned int Font::preloadGlyphs(const FontResolution& fontRes, const String& characters, ShaderTechnique shaderTechnique)
+{
+    // glyphs are laid out in the GlyphTextures first, then their distance fields, which take most of the time, are generated in parallel
+    bool deferImages = shaderTechnique>GREYSCALE;
+    std::vector<Glyph*> glyphsToGenerate;
+
+    unsigned int numGlyphs = 0;
+    for(String::const_iterator itr = characters.begin();
+        itr != characters.end();
+        ++itr)
+    {
+        Glyph* glyph = getGlyph(fontRes, *itr);
+        if (!glyph) continue;
+
+        if (deferImages)
+        {
+            if (glyph->assignTextureInfo(shaderTechnique, false)) glyphsToGenerate.push_back(glyph);
+        }
+        else if (shaderTechnique!=NO_TEXT_SHADER)
+        {
+            glyph->getOrCreateTextureInfo(shaderTechnique);
+        }
+        ++numGlyphs;
+    }
+
+    if (!glyphsToGenerate.empty()) generateGlyphImages(glyphsToGenerate, shaderTechnique);
+
+    return numGlyphs;
+}
+
+namespace
+{
+    class PreloadGlyphsOperation : public osg::Operation
+    {
+    public:
+        PreloadGlyphsOperation(Font* font, const FontResolution& fontRes, const String& characters, ShaderTechnique shaderTechnique):
+            osg::Operation("PreloadGlyphs", false),
+            _font(font),
+            _fontRes(fontRes),
+            _characters(characters),
+            _shaderTechnique(shaderTechnique) {}
+
+        virtual void operator () (osg::Object*)
+        {
+            unsigned int numGlyphs = _font->preloadGlyphs(_fontRes, _characters, _shaderTechnique);
+            OSG_INFO<<"Font "<<_font->getFileName()<<" preloaded "<<numGlyphs<<" glyphs"<<std::endl;
+        }
+
+    protected:
+        osg::ref_ptr<Font>  _font;
+        FontResolution      _fontRes;
+        String              _characters;
+        ShaderTechnique     _shaderTechnique;
+    };
+
+    struct ReleaseBlockOperation : public osg::Operation, public osg::RefBlock
+    {
+        ReleaseBlockOperation():
+            osg::Operation("ReleaseBlock", false) {}
+
+        virtual void operator () (osg::Object*) { OpenThreads::Block::release(); }
+    };
+}
+
+void Font::preloadGlyphsInBackground(const FontResolution& fontRes, const String& characters, ShaderTechnique shaderTechnique)
+{
+    if (!_preloadThread)
+    {
+        _preloadThread = new osg::OperationThread;
+        _preloadThread->startThread();
+    }
+
+    _preloadThread->add(new PreloadGlyphsOperation(this, fontRes, characters, shaderTechnique));
+}
+
+void Font::waitForPreloadedGlyphs()
+{
+    if (!_preloadThread) return;
+
+    // the block is released once the preload thread reaches it, after the preload operations queued before it
+    osg::ref_ptr<ReleaseBlockOperation> block = new ReleaseBlockOperation;
+    _preloadThread->add(block.get());
+    block->block();
+}
+
 Glyph3D* Font::getGlyph3D(const FontResolution &fontRes, unsigned int charcode)
 {
     if (!_implementation) return 0;
@@ -375,6 +591,8 @@ void Font::setThreadSafeRefUnref(bool threadSafe)
 {
    osg::Object::setThreadSafeRefUnref(threadSafe);
 
+    // the preloading of glyphs may add GlyphTextures from another thread
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_glyphTextureListMutex);
     for(GlyphTextureList::const_iterator itr=_glyphTextureList.begin();
         itr!=_glyphTextureList.end();
         ++itr)
@@ -392,6 +610,7 @@ void Font::resizeGLObjectBuffers(unsigned int maxSize)
         (*itr)->resizeGLObjectBuffers(maxSize);
     }
 
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_glyphTextureListMutex);
     for(GlyphTextureList::const_iterator itr=_glyphTextureList.begin();
         itr!=_glyphTextureList.end();
         ++itr)
@@ -409,6 +628,7 @@ void Font::releaseGLObjects(osg::State* state) const
         (*itr)->releaseGLObjects(state);
     }
 
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_glyphTextureListMutex);
     for(GlyphTextureList::const_iterator itr=_glyphTextureList.begin();
         itr!=_glyphTextureList.end();
         ++itr)
@@ -439,13 +659,35 @@ void Font::addGlyph(const FontResolution& fontRes, unsigned int charcode, Glyph*
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_glyphMapMutex);
 
     _sizeGlyphMap[fontRes][charcode]=glyph;
+    addCachedGlyph(fontRes, charcode, glyph);
+}
+
+GlyphTexture* Font::createGlyphTexture(ShaderTechnique shaderTechnique)
+{
+    GlyphTexture* glyphTexture = new GlyphTexture;
+
+    static int numberOfTexturesAllocated = 0;
+    ++numberOfTexturesAllocated;
+
+    OSG_INFO<< "   Font " << this<< ", numberOfTexturesAllocated "<<numberOfTexturesAllocated<<std::endl;
 
+    // reserve enough space for the glyphs.
+    glyphTexture->setShaderTechnique(shaderTechnique);
+    glyphTexture->setTextureSize(_textureWidthHint,_textureHeightHint);
+    glyphTexture->setFilter(osg::Texture::MIN_FILTER,_minFilterHint);
+    glyphTexture->setFilter(osg::Texture::MAG_FILTER,_magFilterHint);
+    glyphTexture->setMaxAnisotropy(_maxAnisotropy);
+
+    return glyphTexture;
 }
 
-void Font::assignGlyphToGlyphTexture(Glyph* glyph, ShaderTechnique shaderTechnique)
+void Font::assignGlyphToGlyphTexture(Glyph* glyph, ShaderTechnique shaderTechnique, bool generateImage)
 {
     int posX=0,posY=0;
 
+    // glyphs may be assigned by the layout of Text in several threads and by the preloading of glyphs
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_glyphTextureListMutex);
+
     GlyphTexture* glyphTexture = 0;
     for(GlyphTextureList::iterator itr=_glyphTextureList.begin();
         itr!=_glyphTextureList.end() && !glyphTexture;
@@ -461,20 +703,7 @@ void Font::assignGlyphToGlyphTexture(Glyph* glyph, ShaderTechnique shaderTechniq
 
     if (!glyphTexture)
     {
-
-        glyphTexture = new GlyphTexture;
-
-        static int numberOfTexturesAllocated = 0;
-        ++numberOfTexturesAllocated;
-
-        OSG_INFO<< "   Font " << this<< ", numberOfTexturesAllocated "<<numberOfTexturesAllocated<<std::endl;
-
-        // reserve enough space for the glyphs.
-        glyphTexture->setShaderTechnique(shaderTechnique);
-        glyphTexture->setTextureSize(_textureWidthHint,_textureHeightHint);
-        glyphTexture->setFilter(osg::Texture::MIN_FILTER,_minFilterHint);
-        glyphTexture->setFilter(osg::Texture::MAG_FILTER,_magFilterHint);
-        glyphTexture->setMaxAnisotropy(_maxAnisotropy);
+        glyphTexture = createGlyphTexture(shaderTechnique);
 
         _glyphTextureList.push_back(glyphTexture);
 
@@ -487,5 +716,330 @@ void Font::assignGlyphToGlyphTexture(Glyph* glyph, ShaderTechnique shaderTechniq
     }
 
     // add the glyph into the texture.
-    glyphTexture->addGlyph(glyph,posX,posY);
+    glyphTexture->addGlyph(glyph,posX,posY,generateImage);
+}
+
+namespace
+{
+    const char s_glyphAtlasMagic[8] = { 'O', 'S', 'G', 'A', 'T', 'L', 'A', 'S' };
+    const unsigned int s_glyphAtlasVersion = 1;
+    const unsigned int s_glyphAtlasByteOrder = 0x01020304;
+
+    template<typename T>
+    void writeValue(std::ostream& fout, const T& value)
+    {
+        fout.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    bool readValue(std::istream& fin, T& value)
+    {
+        fin.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return !fin.fail();
+    }
+
+    void writeImage(std::ostream& fout, const osg::Image* image)
+    {
+        writeValue(fout, image->s());
+        writeValue(fout, image->t());
+        writeValue(fout, static_cast<unsigned int>(image->getPixelFormat()));
+        writeValue(fout, image->getInternalTextureFormat());
+        writeValue(fout, static_cast<unsigned int>(image->getDataType()));
+        writeValue(fout, image->getPacking());
+
+        unsigned int size = image->data() ? image->getTotalSizeInBytes() : 0;
+        writeValue(fout, size);
+        if (size>0) fout.write(reinterpret_cast<const char*>(image->data()), size);
+    }
+
+    bool readImage(std::istream& fin, osg::Image* image)
+    {
+        int s, t, internalFormat;
+        unsigned int pixelFormat, dataType, packing, size;
+        if (!readValue(fin, s) || !readValue(fin, t) || !readValue(fin, pixelFormat) || !readValue(fin, internalFormat) ||
+            !readValue(fin, dataType) || !readValue(fin, packing) || !readValue(fin, size)) return false;
+
+        if (size>0)
+        {
+            image->allocateImage(s, t, 1, pixelFormat, dataType, packing);
+            if (image->getTotalSizeInBytes()!=size) return false;
+
+            fin.read(reinterpret_cast<char*>(image->data()), size);
+        }
+        image->setInternalTextureFormat(internalFormat);
+
+        return !fin.fail();
+    }
+}
+
+uint64_t Font::getFontFileHash() const
+{
+    std::string filename = getFileName();
+    if (filename.empty()) return 0;
+
+    osgDB::ifstream fin(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!fin) return 0;
+
+    // 64 bit FNV-1a
+    const uint64_t prime = (static_cast<uint64_t>(0x100)<<32) | 0x1b3;
+    uint64_t hash = (static_cast<uint64_t>(0xcbf29ce4)<<32) | 0x84222325;
+
+    char buffer[4096];
+    while(fin.read(buffer, sizeof(buffer)) || fin.gcount()>0)
+    {
+        for(std::streamsize i=0; i<fin.gcount(); ++i)
+        {
+            hash ^= static_cast<unsigned char>(buffer[i]);
+            hash *= prime;
+        }
+    }
+    return hash;
+}
+
+std::string Font::getGlyphAtlasFileName(const std::string& directory) const
+{
+    std::ostringstream str;
+    str<<osgDB::getStrippedName(getFileName())<<"_"<<std::hex<<std::setw(16)<<std::setfill('0')<<getFontFileHash()<<".osgtextatlas";
+    return osgDB::concatPaths(directory, str.str());
+}
+
+bool Font::writeGlyphAtlas(const std::string& filename) const
+{
+    uint64_t fontFileHash = getFontFileHash();
+    if (fontFileHash==0)
+    {
+        OSG_NOTICE<<"Warning: Font::writeGlyphAtlas("<<filename<<") unable to read font file \""<<getFileName()<<"\""<<std::endl;
+        return false;
+    }
+
+    osgDB::ofstream fout(filename.c_str(), std::ios::out | std::ios::binary);
+    if (!fout)
+    {
+        OSG_NOTICE<<"Warning: Font::writeGlyphAtlas("<<filename<<") unable to open file for writing."<<std::endl;
+        return false;
+    }
+
+    fout.write(s_glyphAtlasMagic, sizeof(s_glyphAtlasMagic));
+    writeValue(fout, s_glyphAtlasVersion);
+    writeValue(fout, s_glyphAtlasByteOrder);
+    writeValue(fout, fontFileHash);
+
+    // the glyphs are numbered in the order written for the GlyphTextures to refer to them
+    std::map<const Glyph*, unsigned int> glyphIndices;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_glyphMapMutex);
+
+        unsigned int numGlyphs = 0;
+        for(FontSizeGlyphMap::const_iterator sitr = _sizeGlyphMap.begin();
+            sitr != _sizeGlyphMap.end();
+            ++sitr)
+        {
+            numGlyphs += static_cast<unsigned int>(sitr->second.size());
+        }
+        writeValue(fout, numGlyphs);
+
+        unsigned int index = 0;
+        for(FontSizeGlyphMap::const_iterator sitr = _sizeGlyphMap.begin();
+            sitr != _sizeGlyphMap.end();
+            ++sitr)
+        {
+            for(GlyphMap::const_iterator gitr = sitr->second.begin();
+                gitr != sitr->second.end();
+                ++gitr)
+            {
+                const Glyph* glyph = gitr->second.get();
+                glyphIndices[glyph] = index++;
+
+                writeValue(fout, sitr->first.first);
+                writeValue(fout, sitr->first.second);
+                writeValue(fout, gitr->first);
+                writeValue(fout, glyph->getFontResolution().first);
+                writeValue(fout, glyph->getFontResolution().second);
+                writeValue(fout, glyph->getWidth());
+                writeValue(fout, glyph->getHeight());
+                writeValue(fout, glyph->getHorizontalBearing());
+                writeValue(fout, glyph->getHorizontalAdvance());
+                writeValue(fout, glyph->getVerticalBearing());
+                writeValue(fout, glyph->getVerticalAdvance());
+                writeImage(fout, glyph);
+            }
+        }
+    }
+
+    // copy the list of GlyphTextures rather than holding its mutex while the glyphs are locked for their TextureInfo
+    GlyphTextureList glyphTextures;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_glyphTextureListMutex);
+
+        for(GlyphTextureList::const_iterator itr = _glyphTextureList.begin();
+            itr != _glyphTextureList.end();
+            ++itr)
+        {
+            if ((*itr)->getImage()) glyphTextures.push_back(*itr);
+        }
+    }
+
+    writeValue(fout, static_cast<unsigned int>(glyphTextures.size()));
+
+    for(GlyphTextureList::const_iterator itr = glyphTextures.begin();
+        itr != glyphTextures.end();
+        ++itr)
+    {
+        const GlyphTexture* glyphTexture = itr->get();
+
+        int usedY, partUsedX, partUsedY;
+        glyphTexture->getUsedSpace(usedY, partUsedX, partUsedY);
+
+        writeValue(fout, static_cast<unsigned int>(glyphTexture->getShaderTechnique()));
+        writeValue(fout, glyphTexture->getTextureWidth());
+        writeValue(fout, glyphTexture->getTextureHeight());
+        writeValue(fout, usedY);
+        writeValue(fout, partUsedX);
+        writeValue(fout, partUsedY);
+        writeImage(fout, glyphTexture->getImage());
+
+        const GlyphTexture::GlyphRefList& glyphs = glyphTexture->getGlyphs();
+        writeValue(fout, static_cast<unsigned int>(glyphs.size()));
+        for(GlyphTexture::GlyphRefList::const_iterator gitr = glyphs.begin();
+            gitr != glyphs.end();
+            ++gitr)
+        {
+            std::map<const Glyph*, unsigned int>::const_iterator iitr = glyphIndices.find(gitr->get());
+            const Glyph::TextureInfo* info = (*gitr)->getTextureInfo(glyphTexture->getShaderTechnique());
+
+            writeValue(fout, iitr!=glyphIndices.end() ? iitr->second : ~0u);
+            writeValue(fout, info ? info->texturePositionX : 0);
+            writeValue(fout, info ? info->texturePositionY : 0);
+        }
+    }
+
+    return !fout.fail();
+}
+
+bool Font::readGlyphAtlas(const std::string& filename)
+{
+    osgDB::ifstream fin(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!fin) return false;
+
+    char magic[sizeof(s_glyphAtlasMagic)];
+    unsigned int version, byteOrder;
+    uint64_t fontFileHash;
+    fin.read(magic, sizeof(magic));
+    if (fin.fail() || memcmp(magic, s_glyphAtlasMagic, sizeof(magic))!=0 ||
+        !readValue(fin, version) || version!=s_glyphAtlasVersion ||
+        !readValue(fin, byteOrder) || byteOrder!=s_glyphAtlasByteOrder ||
+        !readValue(fin, fontFileHash))
+    {
+        OSG_NOTICE<<"Warning: Font::readGlyphAtlas("<<filename<<") file isn't a glyph atlas of a supported version."<<std::endl;
+        return false;
+    }
+
+    if (fontFileHash!=getFontFileHash())
+    {
+        OSG_INFO<<"Font::readGlyphAtlas("<<filename<<") glyph atlas written for another font file than \""<<getFileName()<<"\""<<std::endl;
+        return false;
+    }
+
+    typedef std::vector< osg::ref_ptr<Glyph> > GlyphList;
+    GlyphList glyphs;
+    std::vector<FontResolution> glyphMapResolutions;
+
+    unsigned int numGlyphs = 0;
+    bool ok = readValue(fin, numGlyphs);
+    for(unsigned int i=0; i<numGlyphs && ok; ++i)
+    {
+        FontResolution glyphMapResolution, fontRes;
+        unsigned int charcode;
+        float width, height, horizontalAdvance, verticalAdvance;
+        osg::Vec2 horizontalBearing, verticalBearing;
+
+        ok = readValue(fin, glyphMapResolution.first) && readValue(fin, glyphMapResolution.second) && readValue(fin, charcode) &&
+             readValue(fin, fontRes.first) && readValue(fin, fontRes.second) &&
+             readValue(fin, width) && readValue(fin, height) &&
+             readValue(fin, horizontalBearing) && readValue(fin, horizontalAdvance) &&
+             readValue(fin, verticalBearing) && readValue(fin, verticalAdvance);
+        if (!ok) break;
+
+        osg::ref_ptr<Glyph> glyph = new Glyph(this, charcode);
+        glyph->setFontResolution(fontRes);
+        glyph->setWidth(width);
+        glyph->setHeight(height);
+        glyph->setHorizontalBearing(horizontalBearing);
+        glyph->setHorizontalAdvance(horizontalAdvance);
+        glyph->setVerticalBearing(verticalBearing);
+        glyph->setVerticalAdvance(verticalAdvance);
+        ok = readImage(fin, glyph.get());
+
+        glyphs.push_back(glyph);
+        glyphMapResolutions.push_back(glyphMapResolution);
+    }
+
+    GlyphTextureList glyphTextures;
+
+    unsigned int numGlyphTextures = 0;
+    ok = ok && readValue(fin, numGlyphTextures);
+    for(unsigned int i=0; i<numGlyphTextures && ok; ++i)
+    {
+        unsigned int shaderTechnique;
+        int width, height, usedY, partUsedX, partUsedY;
+        ok = readValue(fin, shaderTechnique) && readValue(fin, width) && readValue(fin, height) &&
+             readValue(fin, usedY) && readValue(fin, partUsedX) && readValue(fin, partUsedY);
+        if (!ok) break;
+
+        osg::ref_ptr<GlyphTexture> glyphTexture = createGlyphTexture(static_cast<ShaderTechnique>(shaderTechnique));
+        glyphTexture->setTextureSize(width, height);
+        glyphTexture->setUsedSpace(usedY, partUsedX, partUsedY);
+
+        osg::ref_ptr<osg::Image> image = new osg::Image;
+        ok = readImage(fin, image.get()) && image->s()==width && image->t()==height;
+        if (!ok) break;
+
+        glyphTexture->setImage(image.get());
+
+        unsigned int numTextureGlyphs = 0;
+        ok = readValue(fin, numTextureGlyphs);
+        for(unsigned int j=0; j<numTextureGlyphs && ok; ++j)
+        {
+            unsigned int index;
+            int posX, posY;
+            ok = readValue(fin, index) && readValue(fin, posX) && readValue(fin, posY);
+
+            // the image of the glyph is already in the texture image
+            if (ok && index<glyphs.size()) glyphTexture->addGlyph(glyphs[index].get(), posX, posY, false);
+        }
+
+        glyphTextures.push_back(glyphTexture);
+    }
+
+    if (!ok)
+    {
+        OSG_NOTICE<<"Warning: Font::readGlyphAtlas("<<filename<<") unable to read glyph atlas."<<std::endl;
+        return false;
+    }
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_glyphMapMutex);
+
+        for(unsigned int i=0; i<glyphs.size(); ++i)
+        {
+            const FontResolution& fontRes = glyphMapResolutions[i];
+            unsigned int charcode = glyphs[i]->getGlyphCode();
+
+            GlyphMap& glyphMap = _sizeGlyphMap[fontRes];
+            if (glyphMap.count(charcode)!=0) continue;
+
+            glyphMap[charcode] = glyphs[i];
+            addCachedGlyph(fontRes, charcode, glyphs[i].get());
+        }
+    }
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_glyphTextureListMutex);
+
+        _glyphTextureList.insert(_glyphTextureList.end(), glyphTextures.begin(), glyphTextures.end());
+    }
+
+    OSG_INFO<<"Font::readGlyphAtlas("<<filename<<") restored "<<glyphs.size()<<" glyphs in "<<glyphTextures.size()<<" textures."<<std::endl;
+
+    return true;
 }
@@ -24,6 +24,7 @@
 #include <stdlib.h>
 
 #include "GlyphGeometry.h"
+#include "GlyphDistanceField.h"
 
 using namespace osgText;
 using namespace std;
@@ -34,11 +35,15 @@ using namespace std;
 #define OSGTEXT_GLYPH_ALPHA_INTERNALFORMAT GL_R8
 #define OSGTEXT_GLYPH_SDF_FORMAT GL_RG
 #define OSGTEXT_GLYPH_SDF_INTERNALFORMAT GL_RG8
+#define OSGTEXT_GLYPH_MSDF_FORMAT GL_RGBA
+#define OSGTEXT_GLYPH_MSDF_INTERNALFORMAT GL_RGBA8
 #else
 #define OSGTEXT_GLYPH_ALPHA_FORMAT GL_ALPHA
 #define OSGTEXT_GLYPH_ALPHA_INTERNALFORMAT GL_ALPHA
 #define OSGTEXT_GLYPH_SDF_FORMAT GL_LUMINANCE_ALPHA
 #define OSGTEXT_GLYPH_SDF_INTERNALFORMAT GL_LUMINANCE_ALPHA
+#define OSGTEXT_GLYPH_MSDF_FORMAT GL_RGBA
+#define OSGTEXT_GLYPH_MSDF_INTERNALFORMAT GL_RGBA
 #endif
 
 
@@ -150,7 +155,7 @@ bool GlyphTexture::getSpaceForGlyph(Glyph* glyph, int& posX, int& posY)
     return false;
 }
 
-void GlyphTexture::addGlyph(Glyph* glyph, int posX, int posY)
+void GlyphTexture::addGlyph(Glyph* glyph, int posX, int posY, bool generateImage)
 {
 
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
@@ -168,13 +173,27 @@ void GlyphTexture::addGlyph(Glyph* glyph, int posX, int posY)
 
     glyph->setTextureInfo(_shaderTechnique, info.get());
 
-    copyGlyphImage(glyph, info.get());
+    if (generateImage)
+    {
+        copyGlyphImage(glyph, info.get());
+        _image->dirty();
+    }
 }
 
-void GlyphTexture::copyGlyphImage(Glyph* glyph, Glyph::TextureInfo* info)
+void GlyphTexture::generateGlyphImage(Glyph* glyph)
 {
+    const Glyph::TextureInfo* info = glyph->getTextureInfo(_shaderTechnique);
+    if (!info || info->texture!=this || !_image) return;
+
+    // glyphs don't overlap in the image so only dirtying it needs the lock
+    copyGlyphImage(glyph, info);
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
     _image->dirty();
+}
 
+void GlyphTexture::copyGlyphImage(Glyph* glyph, const Glyph::TextureInfo* info)
+{
     if (_shaderTechnique<=GREYSCALE)
     {
         // OSG_NOTICE<<"GlyphTexture::copyGlyphImage() greyscale copying. glyphTexture="<<this<<", glyph="<<glyph->getGlyphCode()<<std::endl;
@@ -212,6 +231,13 @@ void GlyphTexture::copyGlyphImage(Glyph* glyph, Glyph::TextureInfo* info)
     if ((lower+info->texturePositionY)<0) lower = -info->texturePositionY;
     if ((upper+info->texturePositionY)>=dest_rows) upper = dest_rows-info->texturePositionY-1;
 
+    if (_shaderTechnique==MULTI_CHANNEL_SIGNED_DISTANCE_FIELD)
+    {
+        // fonts without outlines fall back to the distance field of the glyph image below
+        Glyph3D* outline = glyph->getFont() ? glyph->getFont()->getGlyph3D(glyph->getFontResolution(), glyph->getGlyphCode()) : 0;
+        if (outline && computeMultiChannelDistanceField(glyph, outline, left, right, lower, upper, max_distance, dest_data, dest_columns)) return;
+    }
+
 
     int num_components = osg::Image::computeNumComponents(_image->getPixelFormat());
     int bytes_per_pixel = osg::Image::computePixelSizeInBits(_image->getPixelFormat(),_image->getDataType())/8;
@@ -377,6 +403,11 @@ void GlyphTexture::copyGlyphImage(Glyph* glyph, Glyph::TextureInfo* info)
                 // original alpha value from glyph image
                 *(dest_ptr+alpha_offset) = center_value;
             }
+            else if (num_components==4)
+            {
+                // same distance in all the channels of a multi-channel distance field
+                *(dest_ptr) = *(dest_ptr+1) = *(dest_ptr+2) = *(dest_ptr+3) = value;
+            }
             else
             {
                 *(dest_ptr) = value;
@@ -418,6 +449,11 @@ osg::Image* GlyphTexture::createImage()
 
         GLenum imageFormat = (_shaderTechnique<=GREYSCALE) ? OSGTEXT_GLYPH_ALPHA_FORMAT : OSGTEXT_GLYPH_SDF_FORMAT;
         GLenum internalFormat = (_shaderTechnique<=GREYSCALE) ? OSGTEXT_GLYPH_ALPHA_INTERNALFORMAT : OSGTEXT_GLYPH_SDF_INTERNALFORMAT;
+        if (_shaderTechnique==MULTI_CHANNEL_SIGNED_DISTANCE_FIELD)
+        {
+            imageFormat = OSGTEXT_GLYPH_MSDF_FORMAT;
+            internalFormat = OSGTEXT_GLYPH_MSDF_INTERNALFORMAT;
+        }
 
         _image->allocateImage(getTextureWidth(), getTextureHeight(), 1, imageFormat, GL_UNSIGNED_BYTE);
         _image->setInternalTextureFormat(internalFormat);
@@ -484,15 +520,24 @@ Glyph::TextureInfo* Glyph::getOrCreateTextureInfo(ShaderTechnique technique)
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_textureInfoListMutex);
 
+    assignTextureInfo(technique, true);
+
+    return  _textureInfoList[technique].get();
+}
+
+bool Glyph::assignTextureInfo(ShaderTechnique technique, bool generateImage)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_textureInfoListMutex);
+
     if (technique>=_textureInfoList.size())
     {
         _textureInfoList.resize(technique+1);
     }
-    if (!_textureInfoList[technique])
-    {
-        _font->assignGlyphToGlyphTexture(this, technique);
-    }
-    return  _textureInfoList[technique].get();
+    if (_textureInfoList[technique].valid()) return false;
+
+    _font->assignGlyphToGlyphTexture(this, technique, generateImage);
+
+    return _textureInfoList[technique].valid();
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,335 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include "GlyphDistanceField.h"
+
+#include <float.h>
+#include <math.h>
+#include <vector>
+
+using namespace osgText;
+
+namespace
+{
+    enum EdgeColor
+    {
+        BLACK = 0,
+        RED = 1,
+        GREEN = 2,
+        YELLOW = RED | GREEN,
+        BLUE = 4,
+        MAGENTA = RED | BLUE,
+        CYAN = GREEN | BLUE,
+        WHITE = RED | GREEN | BLUE
+    };
+
+    // the cosine of the smallest angle between two segments of an outline considered a corner, the curves of the outline are
+    // approximated by segments turning by less than that.
+    const float s_cornerCosine = 0.75f;
+
+    inline float cross(const osg::Vec2& a, const osg::Vec2& b) { return a.x()*b.y() - a.y()*b.x(); }
+
+    /** Move on to the next color of the edges of a contour, avoiding sharing two channels with the banned color.*/
+    void switchColor(int& color, int banned)
+    {
+        int combined = color & banned;
+        if (combined==RED || combined==GREEN || combined==BLUE)
+        {
+            color = combined ^ WHITE;
+            return;
+        }
+        if (color==BLACK || color==WHITE)
+        {
+            color = CYAN;
+            return;
+        }
+        int shifted = color<<1;
+        color = (shifted | (shifted>>3)) & WHITE;
+    }
+
+    struct SignedDistance
+    {
+        SignedDistance(): distance(-FLT_MAX), dot(1.0f) {}
+        SignedDistance(float d, float o): distance(d), dot(o) {}
+
+        // the nearest segment to a point, with the segment most orthogonal to it chosen when the point is nearest to their shared end
+        bool operator < (const SignedDistance& rhs) const
+        {
+            float d = fabsf(distance), rd = fabsf(rhs.distance);
+            return d<rd || (d==rd && dot<rhs.dot);
+        }
+
+        float distance;
+        float dot;
+    };
+
+    struct Segment
+    {
+        osg::Vec2   a;
+        osg::Vec2   b;
+        osg::Vec2   direction;
+        int         color;
+
+        // whether the segment begins or ends an edge of the outline at a corner
+        bool        startsEdge;
+        bool        endsEdge;
+
+        /** Signed distance of the point to the segment, positive on its right, returning in param the position of the nearest
+          * point of the line along the segment.*/
+        SignedDistance signedDistance(const osg::Vec2& p, float& param) const
+        {
+            osg::Vec2 ab = b-a;
+            osg::Vec2 aq = p-a;
+            param = (aq*ab)/ab.length2();
+
+            osg::Vec2 eq = (param>0.5f ? b : a) - p;
+            float endpointDistance = eq.length();
+            if (param>0.0f && param<1.0f)
+            {
+                float orthoDistance = cross(aq, direction);
+                if (fabsf(orthoDistance)<endpointDistance) return SignedDistance(orthoDistance, 0.0f);
+            }
+
+            float side = cross(aq, ab)>0.0f ? 1.0f : -1.0f;
+            float dot = endpointDistance>0.0f ? fabsf(direction*eq)/endpointDistance : 0.0f;
+            return SignedDistance(side*endpointDistance, dot);
+        }
+
+        /** Extend the distance beyond the corners ending the edge of the segment to the distance to the line of the segment,
+          * which is what keeps the corners sharp where the channels of the edges meeting there differ.*/
+        float pseudoDistance(const osg::Vec2& p, const SignedDistance& distance, float param) const
+        {
+            if (param<0.0f && startsEdge)
+            {
+                osg::Vec2 aq = p-a;
+                if (aq*direction<0.0f)
+                {
+                    float pseudo = cross(aq, direction);
+                    if (fabsf(pseudo)<=fabsf(distance.distance)) return pseudo;
+                }
+            }
+            else if (param>1.0f && endsEdge)
+            {
+                osg::Vec2 bq = p-b;
+                if (bq*direction>0.0f)
+                {
+                    float pseudo = cross(bq, direction);
+                    if (fabsf(pseudo)<=fabsf(distance.distance)) return pseudo;
+                }
+            }
+            return distance.distance;
+        }
+    };
+
+    typedef std::vector<osg::Vec2> Contour;
+    typedef std::vector<Segment> Segments;
+
+    /** Add the segments of a closed contour, colored so that the edges meeting at each corner share a single channel.*/
+    void addContour(const Contour& contour, Segments& segments)
+    {
+        unsigned int size = static_cast<unsigned int>(contour.size());
+        unsigned int first = static_cast<unsigned int>(segments.size());
+
+        std::vector<unsigned int> corners;
+        for(unsigned int i=0; i<size; ++i)
+        {
+            Segment segment;
+            segment.a = contour[i];
+            segment.b = contour[(i+1)%size];
+            segment.direction = segment.b-segment.a;
+            segment.direction.normalize();
+            segment.color = WHITE;
+            segment.startsEdge = false;
+            segment.endsEdge = false;
+            segments.push_back(segment);
+
+            osg::Vec2 incoming = contour[i]-contour[(i+size-1)%size];
+            incoming.normalize();
+            if (incoming*segment.direction<s_cornerCosine) corners.push_back(i);
+        }
+
+        // smooth contours are left white, the distance in all the channels is then the true distance
+        if (corners.empty()) return;
+
+        for(std::vector<unsigned int>::iterator itr = corners.begin();
+            itr != corners.end();
+            ++itr)
+        {
+            segments[first+*itr].startsEdge = true;
+            segments[first+(*itr+size-1)%size].endsEdge = true;
+        }
+
+        if (corners.size()==1)
+        {
+            // a single corner is kept sharp by splitting the contour into three edges of different colors
+            int colors[3] = { WHITE, WHITE, WHITE };
+            switchColor(colors[0], BLACK);
+            colors[2] = colors[0];
+            switchColor(colors[2], BLACK);
+
+            for(unsigned int k=0; k<size; ++k)
+            {
+                segments[first+(corners[0]+k)%size].color = colors[(3*k)/size];
+            }
+            return;
+        }
+
+        int color = WHITE;
+        switchColor(color, BLACK);
+        int initialColor = color;
+
+        unsigned int numCorners = static_cast<unsigned int>(corners.size());
+        unsigned int spline = 0;
+        for(unsigned int k=0; k<size; ++k)
+        {
+            unsigned int index = (corners[0]+k)%size;
+            if (spline+1<numCorners && corners[spline+1]==index)
+            {
+                ++spline;
+                // the last edge also differs from the first one it meets
+                switchColor(color, spline==numCorners-1 ? initialColor : BLACK);
+            }
+            segments[first+index].color = color;
+        }
+    }
+
+    inline unsigned char encodeDistance(float distance, float max_distance)
+    {
+        float value = 128.0f + (distance/max_distance)*127.0f;
+        if (value<0.0f) return 0;
+        if (value>255.0f) return 255;
+        return static_cast<unsigned char>(value);
+    }
+
+    inline float median(float a, float b, float c)
+    {
+        return osg::maximum(osg::minimum(a, b), osg::minimum(osg::maximum(a, b), c));
+    }
+}
+
+bool osgText::computeMultiChannelDistanceField(const Glyph* glyph, const Glyph3D* outline,
+                                               int left, int right, int lower, int upper, float max_distance,
+                                               unsigned char* dest_data, int dest_columns)
+{
+    const osg::Vec3Array* vertices = outline->getRawVertexArray();
+    if (!vertices || vertices->empty()) return false;
+
+    // map the outline onto the glyph image as Text maps the glyph width and height onto it
+    float scaleX = glyph->getWidth()>0.0f ? float(glyph->s())/glyph->getWidth() : float(glyph->getFontResolution().second);
+    float scaleY = glyph->getHeight()>0.0f ? float(glyph->t())/glyph->getHeight() : float(glyph->getFontResolution().second);
+    const osg::Vec2& origin = glyph->getHorizontalBearing();
+
+    Segments segments;
+    float area = 0.0f;
+
+    const osg::Geometry::PrimitiveSetList& contours = outline->getRawFacePrimitiveSetList();
+    for(osg::Geometry::PrimitiveSetList::const_iterator itr = contours.begin();
+        itr != contours.end();
+        ++itr)
+    {
+        const osg::PrimitiveSet* primitives = itr->get();
+
+        Contour contour;
+        for(unsigned int i=0; i<primitives->getNumIndices(); ++i)
+        {
+            const osg::Vec3& v = (*vertices)[primitives->index(i)];
+            osg::Vec2 p((v.x()-origin.x())*scaleX, (v.y()-origin.y())*scaleY);
+            if (contour.empty() || contour.back()!=p) contour.push_back(p);
+        }
+        while(contour.size()>1 && contour.back()==contour.front()) contour.pop_back();
+        if (contour.size()<3) continue;
+
+        for(unsigned int i=0; i<contour.size(); ++i)
+        {
+            area += cross(contour[i], contour[(i+1)%contour.size()]);
+        }
+
+        addContour(contour, segments);
+    }
+
+    if (segments.empty()) return false;
+
+    // the inside of the glyph is on the right of the outer contours when they wind clockwise
+    float orientation = area>0.0f ? -1.0f : 1.0f;
+
+    for(int dr=lower; dr<=upper; ++dr)
+    {
+        for(int dc=left; dc<=right; ++dc)
+        {
+            osg::Vec2 p(float(dc)+0.5f, float(dr)+0.5f);
+
+            SignedDistance nearest[3];
+            const Segment* nearestSegment[3] = { 0, 0, 0 };
+            float nearestParam[3] = { 0.0f, 0.0f, 0.0f };
+            float minDistance = FLT_MAX;
+            int winding = 0;
+
+            for(Segments::const_iterator itr = segments.begin();
+                itr != segments.end();
+                ++itr)
+            {
+                const Segment& segment = *itr;
+
+                // non zero winding rule for the sign of the true distance
+                float side = cross(segment.b-segment.a, p-segment.a);
+                if (segment.a.y()<=p.y())
+                {
+                    if (segment.b.y()>p.y() && side>0.0f) ++winding;
+                }
+                else
+                {
+                    if (segment.b.y()<=p.y() && side<0.0f) --winding;
+                }
+
+                float param;
+                SignedDistance distance = segment.signedDistance(p, param);
+                minDistance = osg::minimum(minDistance, fabsf(distance.distance));
+
+                for(unsigned int channel=0; channel<3; ++channel)
+                {
+                    if ((segment.color & (1<<channel))!=0 && (!nearestSegment[channel] || distance<nearest[channel]))
+                    {
+                        nearest[channel] = distance;
+                        nearestSegment[channel] = &segment;
+                        nearestParam[channel] = param;
+                    }
+                }
+            }
+
+            bool inside = winding!=0;
+            float trueDistance = inside ? minDistance : -minDistance;
+
+            float distances[3];
+            for(unsigned int channel=0; channel<3; ++channel)
+            {
+                distances[channel] = nearestSegment[channel] ?
+                    nearestSegment[channel]->pseudoDistance(p, nearest[channel], nearestParam[channel])*orientation :
+                    trueDistance;
+            }
+
+            // where the channels disagree with the true inside, such as where contours overlap, fall back to the true distance
+            if ((median(distances[0], distances[1], distances[2])>0.0f)!=inside)
+            {
+                distances[0] = distances[1] = distances[2] = trueDistance;
+            }
+
+            unsigned char* dest_ptr = dest_data + (dr*dest_columns + dc)*4;
+            dest_ptr[0] = encodeDistance(distances[0], max_distance);
+            dest_ptr[1] = encodeDistance(distances[1], max_distance);
+            dest_ptr[2] = encodeDistance(distances[2], max_distance);
+            dest_ptr[3] = encodeDistance(trueDistance, max_distance);
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,34 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#ifndef OSGTEXT_GLYPHDISTANCEFIELD
+#define OSGTEXT_GLYPHDISTANCEFIELD 1
+
+#include <osgText/Glyph>
+
+namespace osgText
+{
+
+/** Compute the multi-channel signed distance field of the outline of a glyph into the RGBA texels of dest_data, a texture image
+  * dest_columns wide positioned at the bottom left corner of the glyph image, for the texels from left to right and lower to upper
+  * inclusive relative to it. The edges of the outline are split at its corners and colored so that the median of the red, green
+  * and blue distances keeps the corners sharp, the alpha channel holds the true signed distance. Distances are positive inside the
+  * glyph, in texels, and mapped from -max_distance..max_distance to 0..255.
+  * Returns false, leaving the texels untouched, if the outline has no contour.*/
+extern bool computeMultiChannelDistanceField(const Glyph* glyph, const Glyph3D* outline,
+                                             int left, int right, int lower, int upper, float max_distance,
+                                             unsigned char* dest_data, int dest_columns);
+
+}
+
+#endif
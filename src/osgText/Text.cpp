@@ -45,7 +45,10 @@ Text::Text():
     _colorGradientTopLeft(1.0f, 0.0f, 0.0f, 1.0f),
     _colorGradientBottomLeft(0.0f, 1.0f, 0.0f, 1.0f),
     _colorGradientBottomRight(0.0f, 0.0f, 1.0f, 1.0f),
-    _colorGradientTopRight(1.0f, 1.0f, 1.0f, 1.0f)
+    _colorGradientTopRight(1.0f, 1.0f, 1.0f, 1.0f),
+    _numGlyphCoords(0),
+    _glyphCoordsModified(false),
+    _glyphTexCoordsModified(false)
 {
     _supportsVertexBufferObjects = true;
 
@@ -55,6 +58,7 @@ Text::Text():
         if (str=="ALL_FEATURES" || str=="ALL") _shaderTechnique = ALL_FEATURES;
         else if (str=="GREYSCALE") _shaderTechnique = GREYSCALE;
         else if (str=="SIGNED_DISTANCE_FIELD" || str=="SDF") _shaderTechnique = SIGNED_DISTANCE_FIELD;
+        else if (str=="MULTI_CHANNEL_SIGNED_DISTANCE_FIELD" || str=="MSDF") _shaderTechnique = MULTI_CHANNEL_SIGNED_DISTANCE_FIELD;
         else if (str=="NO_TEXT_SHADER" || str=="NONE") _shaderTechnique = NO_TEXT_SHADER;
     }
 
@@ -73,7 +77,10 @@ Text::Text(const Text& text,const osg::CopyOp& copyop):
     _colorGradientTopLeft(text._colorGradientTopLeft),
     _colorGradientBottomLeft(text._colorGradientBottomLeft),
     _colorGradientBottomRight(text._colorGradientBottomRight),
-    _colorGradientTopRight(text._colorGradientTopRight)
+    _colorGradientTopRight(text._colorGradientTopRight),
+    _numGlyphCoords(0),
+    _glyphCoordsModified(false),
+    _glyphTexCoordsModified(false)
 {
     computeGlyphRepresentation();
 }
@@ -160,6 +167,11 @@ osg::StateSet* Text::createStateSet()
         defineList["SIGNED_DISTANCE_FIELD"] = osg::StateSet::DefinePair("1", osg::StateAttribute::ON);
     }
 
+    if (_shaderTechnique==MULTI_CHANNEL_SIGNED_DISTANCE_FIELD)
+    {
+        defineList["MULTI_CHANNEL_SIGNED_DISTANCE_FIELD"] = osg::StateSet::DefinePair("1", osg::StateAttribute::ON);
+    }
+
 #if 0
     OSG_NOTICE<<"Text::createStateSet() defines:"<<defineList.size()<<std::endl;
     for(osg::StateSet::DefineList::iterator itr = defineList.begin();
@@ -197,6 +209,7 @@ osg::StateSet* Text::createStateSet()
             case(GREYSCALE) : DEBUG_MESSAGE<<"GREYSCALE"<<std::endl; break;
             case(SIGNED_DISTANCE_FIELD) : DEBUG_MESSAGE<<"SIGNED_DISTANCE_FIELD"<<std::endl; break;
             case(ALL_FEATURES) : DEBUG_MESSAGE<<"ALL_FEATURES"<<std::endl; break;
+            case(MULTI_CHANNEL_SIGNED_DISTANCE_FIELD) : DEBUG_MESSAGE<<"MULTI_CHANNEL_SIGNED_DISTANCE_FIELD"<<std::endl; break;
         }
     }
 
@@ -388,6 +401,64 @@ String::iterator Text::computeLastCharacterOnLine(osg::Vec2& cursor, String::ite
     return lastChar;
 }
 
+namespace
+{
+    void setNextElement(Text::GlyphQuads& glyphquad, unsigned int index)
+    {
+        osg::DrawElements* primitives = glyphquad._primitives.get();
+        if (glyphquad._numIndices<primitives->getNumIndices())
+        {
+            if (primitives->index(glyphquad._numIndices)!=index)
+            {
+                primitives->setElement(glyphquad._numIndices, index);
+                glyphquad._primitivesModified = true;
+            }
+        }
+        else
+        {
+            primitives->addElement(index);
+            glyphquad._primitivesModified = true;
+        }
+        ++glyphquad._numIndices;
+    }
+}
+
+unsigned int Text::setGlyphVertex(const osg::Vec2& coord, const osg::Vec2& texcoord)
+{
+    unsigned int i = _numGlyphCoords++;
+
+    osg::Vec3 c(coord.x(), coord.y(), 0.0f);
+    if (i<_coords->size())
+    {
+        if ((*_coords)[i]!=c)
+        {
+            (*_coords)[i] = c;
+            _glyphCoordsModified = true;
+        }
+    }
+    else
+    {
+        _coords->push_back(c);
+        _glyphCoordsModified = true;
+    }
+
+    if (i<_texcoords->size())
+    {
+        if ((*_texcoords)[i]!=texcoord)
+        {
+            (*_texcoords)[i] = texcoord;
+            _glyphTexCoordsModified = true;
+        }
+    }
+    else
+    {
+        _texcoords->push_back(texcoord);
+        _glyphTexCoordsModified = true;
+    }
+
+    return i;
+}
+
 void Text::addGlyphQuad(Glyph* glyph, const osg::Vec2& minc, const osg::Vec2& maxc, const osg::Vec2& mintc, const osg::Vec2& maxtc)
 {
     // set up the coords of the quad
@@ -407,27 +478,19 @@ void Text::addGlyphQuad(Glyph* glyph, const osg::Vec2& minc, const osg::Vec2& ma
         glyphquad._primitives = primitives;
     }
 
+    // set up the coords and tex coords of the quad
+    unsigned int lt = setGlyphVertex(osg::Vec2(minc.x(), maxc.y()), osg::Vec2(mintc.x(), maxtc.y()));
+    unsigned int lb = setGlyphVertex(osg::Vec2(minc.x(), minc.y()), osg::Vec2(mintc.x(), mintc.y()));
+    unsigned int rb = setGlyphVertex(osg::Vec2(maxc.x(), minc.y()), osg::Vec2(maxtc.x(), mintc.y()));
+    unsigned int rt = setGlyphVertex(osg::Vec2(maxc.x(), maxc.y()), osg::Vec2(maxtc.x(), maxtc.y()));
 
-    unsigned int lt = addCoord(osg::Vec2(minc.x(), maxc.y()));
-    unsigned int lb = addCoord(osg::Vec2(minc.x(), minc.y()));
-    unsigned int rb = addCoord(osg::Vec2(maxc.x(), minc.y()));
-    unsigned int rt = addCoord(osg::Vec2(maxc.x(), maxc.y()));
-
-    // set up the tex coords of the quad
-    addTexCoord(osg::Vec2(mintc.x(), maxtc.y()));
-    addTexCoord(osg::Vec2(mintc.x(), mintc.y()));
-    addTexCoord(osg::Vec2(maxtc.x(), mintc.y()));
-    addTexCoord(osg::Vec2(maxtc.x(), maxtc.y()));
-
-    primitives->addElement(lt);
-    primitives->addElement(lb);
-    primitives->addElement(rb);
+    setNextElement(glyphquad, lt);
+    setNextElement(glyphquad, lb);
+    setNextElement(glyphquad, rb);
 
-    primitives->addElement(lt);
-    primitives->addElement(rb);
-    primitives->addElement(rt);
-
-    primitives->dirty();
+    setNextElement(glyphquad, lt);
+    setNextElement(glyphquad, rb);
+    setNextElement(glyphquad, rt);
 }
 
 void Text::computeGlyphRepresentation()
@@ -436,13 +499,18 @@ void Text::computeGlyphRepresentation()
     if (!activefont) return;
 
     if (!_coords) { _coords = new osg::Vec3Array(osg::Array::BIND_PER_VERTEX); _coords->setBufferObject(_vbo.get()); }
-    else _coords->clear();
 
     if (!_colorCoords) { _colorCoords = new osg::Vec4Array(osg::Array::BIND_PER_VERTEX); _colorCoords->setBufferObject(_vbo.get()); }
     else _colorCoords->clear();
 
     if (!_texcoords) { _texcoords = new osg::Vec2Array(osg::Array::BIND_PER_VERTEX); _texcoords->setBufferObject(_vbo.get()); }
-    else _texcoords->clear();
+
+    // the glyph quads are rewritten in place, the decorations following them are set up again afterwards.
+    _glyphCoordsModified = _coords->size()>_numGlyphCoords;
+    _glyphTexCoordsModified = _texcoords->size()>_numGlyphCoords;
+    if (_glyphCoordsModified) _coords->resize(_numGlyphCoords);
+    if (_glyphTexCoordsModified) _texcoords->resize(_numGlyphCoords);
+    _numGlyphCoords = 0;
 
     for(TextureGlyphQuadMap::iterator itr = _textureGlyphQuadMap.begin();
         itr != _textureGlyphQuadMap.end();
@@ -450,11 +518,8 @@ void Text::computeGlyphRepresentation()
     {
         GlyphQuads& glyphquads = itr->second;
         glyphquads._glyphs.clear();
-        if (glyphquads._primitives.valid())
-        {
-            glyphquads._primitives->resizeElements(0);
-            glyphquads._primitives->dirty();
-        }
+        glyphquads._numIndices = 0;
+        glyphquads._primitivesModified = false;
     }
 
 
@@ -462,6 +527,8 @@ void Text::computeGlyphRepresentation()
 
     if (_text.empty())
     {
+        finishGlyphRepresentation();
+
         _textBB.set(0,0,0,0,0,0);//no size text
         computePositions(); //to reset the origin
         return;
@@ -740,6 +807,8 @@ void Text::computeGlyphRepresentation()
         }
     }
 
+    finishGlyphRepresentation();
+
     computePositions();
     computeColorGradients();
 
@@ -747,6 +816,41 @@ void Text::computeGlyphRepresentation()
     setupDecoration();
 }
 
+void Text::finishGlyphRepresentation()
+{
+    // drop what is left of the previous layout and dirty only the arrays that have changed.
+    if (_coords->size()>_numGlyphCoords)
+    {
+        _coords->resize(_numGlyphCoords);
+        _glyphCoordsModified = true;
+    }
+
+    if (_texcoords->size()>_numGlyphCoords)
+    {
+        _texcoords->resize(_numGlyphCoords);
+        _glyphTexCoordsModified = true;
+    }
+
+    if (_glyphCoordsModified) _coords->dirty();
+    if (_glyphTexCoordsModified) _texcoords->dirty();
+
+    for(TextureGlyphQuadMap::iterator itr = _textureGlyphQuadMap.begin();
+        itr != _textureGlyphQuadMap.end();
+        ++itr)
+    {
+        GlyphQuads& glyphquads = itr->second;
+        if (!glyphquads._primitives) continue;
+
+        if (glyphquads._numIndices<glyphquads._primitives->getNumIndices())
+        {
+            glyphquads._primitives->resizeElements(glyphquads._numIndices);
+            glyphquads._primitivesModified = true;
+        }
+
+        if (glyphquads._primitivesModified) glyphquads._primitives->dirty();
+    }
+}
+
 // Returns false if there are no glyphs and the width/height values are invalid.
 // Also sets avg_width and avg_height to 0.0f if the value is invalid.
 // This method is used several times in a loop for the same object which will produce the same values.
@@ -946,6 +1050,8 @@ void Text::computeColorGradients()
         default:
             break;
     }
+
+    _colorCoords->dirty();
 }
 
 void Text::computeColorGradientsOverall()
@@ -1188,6 +1294,8 @@ void Text::drawImplementation(osg::State& state, const osg::Vec4& colorMultiplie
     bool usingVertexArrayObjects = usingVertexBufferObjects && state.useVertexArrayObject(_useVertexArrayObject);
     bool requiresSetArrays = !usingVertexBufferObjects || !usingVertexArrayObjects || vas->getRequiresSetArrays();
 
+    if (usingVertexBufferObjects) markVertexBufferObjectDynamic();
+
     if (requiresSetArrays)
     {
         vas->lazyDisablingOfVertexAttributes();
@@ -1395,11 +1503,15 @@ float Text::bilinearInterpolate(float x1, float x2, float y1, float y2, float x,
     );
 }
 
-Text::GlyphQuads::GlyphQuads()
+Text::GlyphQuads::GlyphQuads():
+    _numIndices(0),
+    _primitivesModified(false)
 {
 }
 
-Text::GlyphQuads::GlyphQuads(const GlyphQuads&)
+Text::GlyphQuads::GlyphQuads(const GlyphQuads&):
+    _numIndices(0),
+    _primitivesModified(false)
 {
 }
 
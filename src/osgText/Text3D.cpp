@@ -510,6 +510,8 @@ void Text3D::drawImplementation(osg::RenderInfo& renderInfo) const
     bool usingVertexArrayObjects = usingVertexBufferObjects && state.useVertexArrayObject(_useVertexArrayObject);
     bool requiresSetArrays = !usingVertexBufferObjects || !usingVertexArrayObjects || vas->getRequiresSetArrays();
 
+    if (usingVertexBufferObjects) markVertexBufferObjectDynamic();
+
     if (requiresSetArrays)
     {
         vas->lazyDisablingOfVertexAttributes();
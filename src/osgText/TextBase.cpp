@@ -137,8 +137,18 @@ osg::VertexArrayState* TextBase::createVertexArrayStateImplementation(osg::Rende
     return vas;
 }
 
+void TextBase::markVertexBufferObjectDynamic() const
+{
+    if (getDataVariance()==DYNAMIC && _vbo.valid() && _vbo->getDataVariance()!=DYNAMIC && osg::BufferObject::getStreamDynamicData())
+    {
+        _vbo->setDataVariance(DYNAMIC);
+    }
+}
+
 void TextBase::compileGLObjects(osg::RenderInfo& renderInfo) const
 {
+    markVertexBufferObjectDynamic();
+
     Drawable::compileGLObjects(renderInfo);
 }
 
@@ -0,0 +1,413 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgText/TextBatch>
+
+#include <osg/GL>
+#include <osg/Notify>
+
+using namespace osgText;
+
+struct TextBatch::TextBatchUpdateCallback : public osg::DrawableUpdateCallback
+{
+    virtual void update(osg::NodeVisitor*, osg::Drawable* drawable)
+    {
+        TextBatch* textBatch = dynamic_cast<TextBatch*>(drawable);
+        if (textBatch) textBatch->update();
+    }
+};
+
+TextBatch::TextBatch():
+    _labelsModified(false),
+    _enableDepthWrites(true)
+{
+    init();
+}
+
+TextBatch::TextBatch(const TextBatch& textBatch,const osg::CopyOp& copyop):
+    osg::Drawable(textBatch,copyop),
+    _labels(textBatch._labels),
+    _labelsModified(true),
+    _enableDepthWrites(textBatch._enableDepthWrites)
+{
+    init();
+}
+
+TextBatch::~TextBatch()
+{
+}
+
+void TextBatch::init()
+{
+    setDataVariance(osg::Object::DYNAMIC);
+    setUseDisplayList(false);
+    setSupportsDisplayList(false);
+    _supportsVertexBufferObjects = true;
+
+    _vbo = new osg::VertexBufferObject;
+    _ebo = new osg::ElementBufferObject;
+
+    _coords = new osg::Vec3Array(osg::Array::BIND_PER_VERTEX);
+    _texcoords = new osg::Vec2Array(osg::Array::BIND_PER_VERTEX);
+    _colors = new osg::Vec4Array(osg::Array::BIND_PER_VERTEX);
+
+    _coords->setBufferObject(_vbo.get());
+    _texcoords->setBufferObject(_vbo.get());
+    _colors->setBufferObject(_vbo.get());
+
+    _texturePrimitivesMap.clear();
+
+    setUpdateCallback(new TextBatchUpdateCallback());
+}
+
+unsigned int TextBatch::addText(Text* text)
+{
+    if (!getStateSet() && text->getStateSet()) setStateSet(text->getStateSet());
+
+    Label label;
+    label._text = text;
+    _labels.push_back(label);
+    _labelsModified = true;
+
+    dirtyBound();
+
+    return static_cast<unsigned int>(_labels.size()-1);
+}
+
+bool TextBatch::removeText(Text* text)
+{
+    for(Labels::iterator itr = _labels.begin();
+        itr != _labels.end();
+        ++itr)
+    {
+        if (itr->_text==text)
+        {
+            _labels.erase(itr);
+            _labelsModified = true;
+            dirtyBound();
+            return true;
+        }
+    }
+    return false;
+}
+
+void TextBatch::removeAllText()
+{
+    _labels.clear();
+    _labelsModified = true;
+    dirtyBound();
+}
+
+namespace
+{
+    unsigned int primitivesModifiedCount(const Text& text)
+    {
+        // changes whenever the indices of a GlyphTexture or the GlyphTextures used change
+        const Text::TextureGlyphQuadMap& textureGlyphQuadMap = text.getTextureGlyphQuadMap();
+        unsigned int modifiedCount = static_cast<unsigned int>(textureGlyphQuadMap.size());
+        for(Text::TextureGlyphQuadMap::const_iterator itr = textureGlyphQuadMap.begin();
+            itr != textureGlyphQuadMap.end();
+            ++itr)
+        {
+            if (itr->second._primitives.valid()) modifiedCount += itr->second._primitives->getModifiedCount();
+        }
+        return modifiedCount;
+    }
+}
+
+void TextBatch::update()
+{
+    // lay the labels out again in the pool when their number of vertices changes.
+    bool resized = _labelsModified;
+    for(Labels::iterator itr = _labels.begin();
+        itr != _labels.end() && !resized;
+        ++itr)
+    {
+        if (itr->_count!=itr->_text->getNumGlyphCoords()) resized = true;
+    }
+
+    if (resized)
+    {
+        unsigned int numVertices = 0;
+        for(Labels::iterator itr = _labels.begin();
+            itr != _labels.end();
+            ++itr)
+        {
+            itr->_first = numVertices;
+            itr->_count = itr->_text->getNumGlyphCoords();
+            numVertices += itr->_count;
+        }
+
+        _coords->resize(numVertices);
+        _texcoords->resize(numVertices);
+        _colors->resize(numVertices);
+        _labelsModified = false;
+    }
+
+    bool coordsModified = resized;
+    bool texcoordsModified = resized;
+    bool colorsModified = resized;
+    bool primitivesModified = resized;
+
+    for(Labels::iterator itr = _labels.begin();
+        itr != _labels.end();
+        ++itr)
+    {
+        Label& label = *itr;
+        const Text& text = *label._text;
+        if (label._count==0) continue;
+
+        const osg::Vec3Array* coords = text.getCoords().get();
+        if (resized || label._coordsModifiedCount!=coords->getModifiedCount() || label._matrix!=text.getMatrix())
+        {
+            const osg::Matrix& matrix = text.getMatrix();
+            for(unsigned int i=0; i<label._count; ++i)
+            {
+                (*_coords)[label._first+i] = (*coords)[i] * matrix;
+            }
+            label._coordsModifiedCount = coords->getModifiedCount();
+            label._matrix = matrix;
+            coordsModified = true;
+        }
+
+        const osg::Vec2Array* texcoords = text.getTexCoords();
+        if (resized || label._texcoordsModifiedCount!=texcoords->getModifiedCount())
+        {
+            std::copy(texcoords->begin(), texcoords->begin()+label._count, _texcoords->begin()+label._first);
+            label._texcoordsModifiedCount = texcoords->getModifiedCount();
+            texcoordsModified = true;
+        }
+
+        const osg::Vec4Array* colorCoords = text.getColorCoords();
+        bool gradient = colorCoords && colorCoords->size()>=label._count;
+        if (resized || label._color!=text.getColor() || (gradient && label._colorCoordsModifiedCount!=colorCoords->getModifiedCount()))
+        {
+            if (gradient) std::copy(colorCoords->begin(), colorCoords->begin()+label._count, _colors->begin()+label._first);
+            else std::fill(_colors->begin()+label._first, _colors->begin()+label._first+label._count, text.getColor());
+
+            label._colorCoordsModifiedCount = colorCoords ? colorCoords->getModifiedCount() : 0;
+            label._color = text.getColor();
+            colorsModified = true;
+        }
+
+        unsigned int modifiedCount = primitivesModifiedCount(text);
+        if (label._primitivesModifiedCount!=modifiedCount)
+        {
+            label._primitivesModifiedCount = modifiedCount;
+            primitivesModified = true;
+        }
+    }
+
+    if (primitivesModified)
+    {
+        for(TexturePrimitivesMap::iterator itr = _texturePrimitivesMap.begin();
+            itr != _texturePrimitivesMap.end();
+            ++itr)
+        {
+            itr->second->clear();
+        }
+
+        for(Labels::iterator itr = _labels.begin();
+            itr != _labels.end();
+            ++itr)
+        {
+            const Text::TextureGlyphQuadMap& textureGlyphQuadMap = itr->_text->getTextureGlyphQuadMap();
+            for(Text::TextureGlyphQuadMap::const_iterator titr = textureGlyphQuadMap.begin();
+                titr != textureGlyphQuadMap.end();
+                ++titr)
+            {
+                const osg::DrawElements* elements = titr->second._primitives.get();
+                if (!elements || elements->getNumIndices()==0) continue;
+
+                osg::ref_ptr<osg::DrawElementsUInt>& primitives = _texturePrimitivesMap[titr->first];
+                if (!primitives)
+                {
+                    primitives = new osg::DrawElementsUInt(GL_TRIANGLES);
+                    primitives->setBufferObject(_ebo.get());
+                }
+
+                for(unsigned int i=0; i<elements->getNumIndices(); ++i)
+                {
+                    primitives->push_back(itr->_first + elements->index(i));
+                }
+            }
+        }
+
+        for(TexturePrimitivesMap::iterator itr = _texturePrimitivesMap.begin();
+            itr != _texturePrimitivesMap.end();
+            )
+        {
+            if (itr->second->empty())
+            {
+                _texturePrimitivesMap.erase(itr++);
+            }
+            else
+            {
+                itr->second->dirty();
+                ++itr;
+            }
+        }
+    }
+
+    if (coordsModified)
+    {
+        _coords->dirty();
+        dirtyBound();
+    }
+    if (texcoordsModified) _texcoords->dirty();
+    if (colorsModified) _colors->dirty();
+}
+
+osg::BoundingBox TextBatch::computeBoundingBox() const
+{
+    osg::BoundingBox bbox;
+    for(Labels::const_iterator itr = _labels.begin();
+        itr != _labels.end();
+        ++itr)
+    {
+        bbox.expandBy(itr->_text->getBoundingBox());
+    }
+    return bbox;
+}
+
+osg::VertexArrayState* TextBatch::createVertexArrayStateImplementation(osg::RenderInfo& renderInfo) const
+{
+    osg::State& state = *renderInfo.getState();
+
+    osg::VertexArrayState* vas = new osg::VertexArrayState(&state);
+
+    vas->assignVertexArrayDispatcher();
+    vas->assignColorArrayDispatcher();
+    vas->assignNormalArrayDispatcher();
+    vas->assignTexCoordArrayDispatcher(1);
+
+    if (state.useVertexArrayObject(_useVertexArrayObject))
+    {
+        vas->generateVertexArrayObject();
+    }
+
+    return vas;
+}
+
+void TextBatch::drawPrimitives(osg::State& state, bool usingVertexBufferObjects) const
+{
+    for(TexturePrimitivesMap::const_iterator itr = _texturePrimitivesMap.begin();
+        itr != _texturePrimitivesMap.end();
+        ++itr)
+    {
+        state.applyTextureAttribute(0, itr->first.get());
+        itr->second->draw(state, usingVertexBufferObjects);
+    }
+}
+
+void TextBatch::drawImplementation(osg::RenderInfo& renderInfo) const
+{
+    if (_texturePrimitivesMap.empty()) return;
+
+    osg::State& state = *renderInfo.getState();
+
+    osg::VertexArrayState* vas = state.getCurrentVertexArrayState();
+    bool usingVertexBufferObjects = state.useVertexBufferObject(_supportsVertexBufferObjects && _useVertexBufferObjects);
+    bool usingVertexArrayObjects = usingVertexBufferObjects && state.useVertexArrayObject(_useVertexArrayObject);
+    bool requiresSetArrays = !usingVertexBufferObjects || !usingVertexArrayObjects || vas->getRequiresSetArrays();
+
+    state.Normal(0.0f, 0.0f, 1.0f);
+
+    // as Text, a DYNAMIC batch has its vertex buffer object streamed when osg::BufferObject::getStreamDynamicData() is set.
+    if (usingVertexBufferObjects && getDataVariance()==DYNAMIC && _vbo->getDataVariance()!=DYNAMIC && osg::BufferObject::getStreamDynamicData())
+    {
+        _vbo->setDataVariance(DYNAMIC);
+    }
+
+    if (requiresSetArrays)
+    {
+        vas->lazyDisablingOfVertexAttributes();
+        vas->setVertexArray(state, _coords.get());
+        vas->setColorArray(state, _colors.get());
+        vas->setTexCoordArray(state, 0, _texcoords.get());
+        vas->applyDisablingOfVertexAttributes(state);
+    }
+
+    // as Text, draw without writing depth then write the depth only
+    glDepthMask(GL_FALSE);
+
+    drawPrimitives(state, usingVertexBufferObjects);
+
+    if (_enableDepthWrites)
+    {
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_TRUE);
+
+        drawPrimitives(state, usingVertexBufferObjects);
+
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        state.haveAppliedAttribute(osg::StateAttribute::COLORMASK);
+    }
+
+    state.haveAppliedAttribute(osg::StateAttribute::DEPTH);
+
+    if (usingVertexBufferObjects && !usingVertexArrayObjects)
+    {
+        // unbind the VBO's if any are used.
+        vas->unbindVertexBufferObject();
+        vas->unbindElementBufferObject();
+    }
+}
+
+void TextBatch::accept(osg::Drawable::ConstAttributeFunctor& af) const
+{
+    if (_coords.valid() && !_coords->empty())
+    {
+        af.apply(osg::Drawable::VERTICES, _coords->size(), &(_coords->front()));
+    }
+
+    if (_texcoords.valid() && !_texcoords->empty())
+    {
+        af.apply(osg::Drawable::TEXTURE_COORDS_0, _texcoords->size(), &(_texcoords->front()));
+    }
+
+    if (_colors.valid() && !_colors->empty())
+    {
+        af.apply(osg::Drawable::COLORS, _colors->size(), &(_colors->front()));
+    }
+}
+
+void TextBatch::accept(osg::PrimitiveFunctor& pf) const
+{
+    if (!_coords || _coords->empty()) return;
+
+    pf.setVertexArray(_coords->size(), &(_coords->front()));
+
+    for(TexturePrimitivesMap::const_iterator itr = _texturePrimitivesMap.begin();
+        itr != _texturePrimitivesMap.end();
+        ++itr)
+    {
+        pf.drawElements(GL_TRIANGLES, itr->second->size(), &(itr->second->front()));
+    }
+}
+
+void TextBatch::resizeGLObjectBuffers(unsigned int maxSize)
+{
+    osg::Drawable::resizeGLObjectBuffers(maxSize);
+
+    if (_vbo.valid()) _vbo->resizeGLObjectBuffers(maxSize);
+    if (_ebo.valid()) _ebo->resizeGLObjectBuffers(maxSize);
+}
+
+void TextBatch::releaseGLObjects(osg::State* state) const
+{
+    osg::Drawable::releaseGLObjects(state);
+
+    if (_vbo.valid()) _vbo->releaseGLObjects(state);
+    if (_ebo.valid()) _ebo->releaseGLObjects(state);
+}
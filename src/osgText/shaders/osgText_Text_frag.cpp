@@ -1,7 +1,7 @@
 char osgText_Text_frag[] = "$OSG_GLSL_VERSION\n"
                            "\n"
                            "#pragma import_defines( BACKDROP_COLOR, SHADOW, OUTLINE)\n"
-                           "#pragma import_defines( SIGNED_DISTANCE_FIELD, TEXTURE_DIMENSION, GLYPH_DIMENSION)\n"
+                           "#pragma import_defines( SIGNED_DISTANCE_FIELD, MULTI_CHANNEL_SIGNED_DISTANCE_FIELD, TEXTURE_DIMENSION, GLYPH_DIMENSION)\n"
                            "\n"
                            "#ifdef GL_ES\n"
                            "    #extension GL_OES_standard_derivatives : enable\n"
@@ -60,7 +60,12 @@ char osgText_Text_frag[] = "$OSG_GLSL_VERSION\n"
                            "\n"
                            "float distanceFromEdge(vec2 tc)\n"
                            "{\n"
+                           "#ifdef MULTI_CHANNEL_SIGNED_DISTANCE_FIELD\n"
+                           "    vec3 msdf = TEXTURELOD(glyphTexture, tc, 0.0).rgb;\n"
+                           "    float center_alpha = max(min(msdf.r, msdf.g), min(max(msdf.r, msdf.g), msdf.b));\n"
+                           "#else\n"
                            "    float center_alpha = TEXTURELOD(glyphTexture, tc, 0.0).SDF;\n"
+                           "#endif\n"
                            "    if (center_alpha==0.0) return -1.0;\n"
                            "\n"
                            "    //float distance_scale = (1.0/4.0)*1.41;\n"
@@ -51,7 +51,7 @@ CullVisitor::CullVisitor():
     _computed_znear(FLT_MAX),
     _computed_zfar(-FLT_MAX),
     _traversalOrderNumber(0),
-    _currentReuseRenderLeafIndex(0),
+    _stateGraphArena(new StateGraphArena),
     _numberOfEncloseOverrideRenderBinDetails(0)
 {
     _identifier = new Identifier;
@@ -66,7 +66,7 @@ CullVisitor::CullVisitor(const CullVisitor& rhs):
     _computed_znear(FLT_MAX),
     _computed_zfar(-FLT_MAX),
     _traversalOrderNumber(0),
-    _currentReuseRenderLeafIndex(0),
+    _stateGraphArena(new StateGraphArena),
     _numberOfEncloseOverrideRenderBinDetails(0),
     _identifier(rhs._identifier)
 {
@@ -119,17 +119,8 @@ void CullVisitor::reset()
 
     _bbCornerNear = (~_bbCornerFar)&7;
 
-    // Only reset the RenderLeaf objects used last frame.
-    for(RenderLeafList::iterator itr=_reuseRenderLeafList.begin(),
-        iter_end=_reuseRenderLeafList.begin()+_currentReuseRenderLeafIndex;
-        itr!=iter_end;
-        ++itr)
-    {
-        (*itr)->reset();
-    }
-
-    // reset the resuse lists.
-    _currentReuseRenderLeafIndex = 0;
+    // recycle all the StateGraphs and RenderLeaves used last frame.
+    _stateGraphArena->reset();
 
     _nearPlaneCandidateMap.clear();
     _farPlaneCandidateMap.clear();
@@ -1558,11 +1549,13 @@ void CullVisitor::apply(osg::Camera& camera)
             _rootStateGraph = rtts->getStateGraph();
             if (_rootStateGraph)
             {
+                _rootStateGraph->setArena(_stateGraphArena.get());
                 _rootStateGraph->clean();
             }
             else
             {
                 _rootStateGraph = new StateGraph;
+                _rootStateGraph->setArena(_stateGraphArena.get());
 
                 // assign the state graph to the RenderStage to ensure it remains in memory for the draw traversal.
                 rtts->setStateGraph(_rootStateGraph.get());
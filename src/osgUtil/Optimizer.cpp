@@ -16,6 +16,7 @@
 #include <osgUtil/Optimizer>
 
 #include <osg/ApplicationUsage>
+#include <osg/CullStack>
 #include <osg/Transform>
 #include <osg/MatrixTransform>
 #include <osg/PositionAttitudeTransform>
@@ -40,7 +41,10 @@
 #include <osgUtil/Statistics>
 #include <osgUtil/MeshOptimizers>
 
+#include <OpenThreads/ScopedLock>
+
 #include <typeinfo>
+#include <climits>
 #include <algorithm>
 #include <numeric>
 #include <sstream>
@@ -53,7 +57,7 @@ void Optimizer::reset()
 {
 }
 
-static osg::ApplicationUsageProxy Optimizer_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OPTIMIZER \"<type> [<type>]\"","OFF | DEFAULT | FLATTEN_STATIC_TRANSFORMS | FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS | REMOVE_REDUNDANT_NODES | COMBINE_ADJACENT_LODS | SHARE_DUPLICATE_STATE | MERGE_GEOMETRY | MERGE_GEODES | SPATIALIZE_GROUPS  | COPY_SHARED_NODES | OPTIMIZE_TEXTURE_SETTINGS | REMOVE_LOADED_PROXY_NODES | TESSELLATE_GEOMETRY | CHECK_GEOMETRY |  FLATTEN_BILLBOARDS | TEXTURE_ATLAS_BUILDER | STATIC_OBJECT_DETECTION | INDEX_MESH | VERTEX_POSTTRANSFORM | VERTEX_PRETRANSFORM | BUFFER_OBJECT_SETTINGS");
+static osg::ApplicationUsageProxy Optimizer_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OPTIMIZER \"<type> [<type>]\"","OFF | DEFAULT | FLATTEN_STATIC_TRANSFORMS | FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS | REMOVE_REDUNDANT_NODES | COMBINE_ADJACENT_LODS | SHARE_DUPLICATE_STATE | MERGE_GEOMETRY | MERGE_GEODES | SPATIALIZE_GROUPS  | COPY_SHARED_NODES | OPTIMIZE_TEXTURE_SETTINGS | REMOVE_LOADED_PROXY_NODES | TESSELLATE_GEOMETRY | CHECK_GEOMETRY |  FLATTEN_BILLBOARDS | TEXTURE_ATLAS_BUILDER | STATIC_OBJECT_DETECTION | INDEX_MESH | VERTEX_POSTTRANSFORM | VERTEX_PRETRANSFORM | BUFFER_OBJECT_SETTINGS | MULTI_DRAW_INDIRECT");
 
 void Optimizer::optimize(osg::Node* node)
 {
@@ -132,6 +136,9 @@ void Optimizer::optimize(osg::Node* node)
 
         if(str.find("~BUFFER_OBJECT_SETTINGS")!=std::string::npos) options ^= BUFFER_OBJECT_SETTINGS;
         else if(str.find("BUFFER_OBJECT_SETTINGS")!=std::string::npos) options |= BUFFER_OBJECT_SETTINGS;
+
+        if(str.find("~MULTI_DRAW_INDIRECT")!=std::string::npos) options ^= MULTI_DRAW_INDIRECT;
+        else if(str.find("MULTI_DRAW_INDIRECT")!=std::string::npos) options |= MULTI_DRAW_INDIRECT;
     }
     else
     {
@@ -362,6 +369,13 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
         vaov.optimizeOrder();
     }
 
+    if (options & MULTI_DRAW_INDIRECT)
+    {
+        OSG_INFO<<"Optimizer::optimize() doing MULTI_DRAW_INDIRECT"<<std::endl;
+        MultiDrawIndirectVisitor mdiv(this);
+        node->accept(mdiv);
+    }
+
     if (options & BUFFER_OBJECT_SETTINGS)
     {
         OSG_INFO<<"Optimizer::optimize() doing BUFFER_OBJECT_SETTINGS"<<std::endl;
@@ -4546,3 +4560,357 @@ void Optimizer::BufferObjectVisitor::apply(osg::Geometry& geometry)
         geometry.setUseDisplayList(_valueDisplayList);
     }
 }
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Batch static geometries into shared arrays drawn with glMultiDrawElementsIndirect.
+//
+
+namespace
+{
+
+typedef std::vector<int> ArrayLayout;
+
+// record the type of each of the arrays of a geometry, returning false if any of them aren't bound per vertex.
+bool getArrayLayout(const osg::Geometry& geometry, ArrayLayout& layout)
+{
+    const osg::Array* vertices = geometry.getVertexArray();
+    if (!vertices || vertices->getNumElements()==0) return false;
+
+    osg::Geometry::ArrayList arrays;
+    arrays.push_back(const_cast<osg::Array*>(vertices));
+    arrays.push_back(const_cast<osg::Array*>(geometry.getNormalArray()));
+    arrays.push_back(const_cast<osg::Array*>(geometry.getColorArray()));
+    arrays.push_back(const_cast<osg::Array*>(geometry.getSecondaryColorArray()));
+    arrays.push_back(const_cast<osg::Array*>(geometry.getFogCoordArray()));
+    for(unsigned int i=0; i<geometry.getNumTexCoordArrays(); ++i) arrays.push_back(const_cast<osg::Array*>(geometry.getTexCoordArray(i)));
+    arrays.push_back(0);
+    for(unsigned int i=0; i<geometry.getNumVertexAttribArrays(); ++i) arrays.push_back(const_cast<osg::Array*>(geometry.getVertexAttribArray(i)));
+
+    layout.clear();
+    for(osg::Geometry::ArrayList::iterator itr = arrays.begin();
+        itr != arrays.end();
+        ++itr)
+    {
+        const osg::Array* array = itr->get();
+        if (!array)
+        {
+            layout.push_back(-1);
+            continue;
+        }
+
+        if (array->getBinding()!=osg::Array::BIND_PER_VERTEX ||
+            array->getNumElements()!=vertices->getNumElements())
+        {
+            return false;
+        }
+
+        layout.push_back(array->getType()*2 + (array->getNormalize() ? 1 : 0));
+    }
+
+    return true;
+}
+
+struct BatchKey
+{
+    BatchKey(const osg::StateSet* ss, osg::Node::NodeMask nm, GLenum m, const ArrayLayout& al): stateset(ss), nodeMask(nm), mode(m), layout(al) {}
+
+    bool operator < (const BatchKey& rhs) const
+    {
+        if (stateset<rhs.stateset) return true;
+        if (rhs.stateset<stateset) return false;
+        if (nodeMask<rhs.nodeMask) return true;
+        if (rhs.nodeMask<nodeMask) return false;
+        if (mode<rhs.mode) return true;
+        if (rhs.mode<mode) return false;
+        return layout<rhs.layout;
+    }
+
+    const osg::StateSet*    stateset;
+    osg::Node::NodeMask     nodeMask;
+    GLenum                  mode;
+    ArrayLayout             layout;
+};
+
+// append the contents of rhs to lhs, creating lhs as a copy of rhs if it doesn't exist yet.
+void appendArray(osg::ref_ptr<osg::Array>& lhs, const osg::Array* rhs)
+{
+    if (!rhs) return;
+
+    if (!lhs)
+    {
+        lhs = static_cast<osg::Array*>(rhs->clone(osg::CopyOp::DEEP_COPY_ALL));
+        lhs->setBufferObject(0);
+        lhs->setUserDataContainer(0);
+        return;
+    }
+
+    MergeArrayVisitor merger;
+    merger.merge(lhs.get(), const_cast<osg::Array*>(rhs));
+}
+
+template<class DrawElementsType>
+void appendIndices(osg::MultiDrawElementsIndirectUInt& indices, const osg::PrimitiveSet& primitiveSet)
+{
+    const DrawElementsType& de = static_cast<const DrawElementsType&>(primitiveSet);
+    indices.insert(indices.end(), de.begin(), de.end());
+}
+
+}
+
+bool Optimizer::MultiDrawIndirectVisitor::isBatchable(const osg::Geometry& geometry) const
+{
+    if (geometry.getDataVariance()==osg::Object::DYNAMIC ||
+        geometry.getUpdateCallback() || geometry.getEventCallback() || geometry.getCullCallback() ||
+        geometry.getDrawCallback() || geometry.getComputeBoundingBoxCallback() ||
+        geometry.getUserDataContainer() ||
+        geometry.getNumPrimitiveSets()==0 ||
+        !isOperationPermissibleForObject(&geometry))
+    {
+        return false;
+    }
+
+    ArrayLayout layout;
+    if (!getArrayLayout(geometry, layout)) return false;
+
+    GLenum mode = geometry.getPrimitiveSet(0)->getMode();
+    for(unsigned int i=0; i<geometry.getNumPrimitiveSets(); ++i)
+    {
+        const osg::PrimitiveSet* primitiveSet = geometry.getPrimitiveSet(i);
+        if (primitiveSet->getMode()!=mode || primitiveSet->getNumInstances()!=0) return false;
+
+        switch(primitiveSet->getType())
+        {
+            case(osg::PrimitiveSet::DrawArraysPrimitiveType):
+            case(osg::PrimitiveSet::DrawElementsUBytePrimitiveType):
+            case(osg::PrimitiveSet::DrawElementsUShortPrimitiveType):
+            case(osg::PrimitiveSet::DrawElementsUIntPrimitiveType):
+                break;
+            default:
+                return false;
+        }
+    }
+
+    return true;
+}
+
+bool Optimizer::MultiDrawIndirectVisitor::batchGroup(osg::Group& group)
+{
+    if (!isOperationPermissibleForObject(&group)) return false;
+
+    if (group.getNumChildren()<_minimumNumberOfGeometries) return false;
+
+    typedef std::vector<osg::Geometry*> GeometryList;
+    typedef std::map<BatchKey, GeometryList> BatchMap;
+
+    BatchMap batchMap;
+    for(unsigned int i=0; i<group.getNumChildren(); ++i)
+    {
+        osg::Geometry* geometry = group.getChild(i)->asGeometry();
+        if (!geometry || geometry->getNumParents()!=1 || !isBatchable(*geometry)) continue;
+
+        ArrayLayout layout;
+        getArrayLayout(*geometry, layout);
+
+        batchMap[BatchKey(geometry->getStateSet(), geometry->getNodeMask(), geometry->getPrimitiveSet(0)->getMode(), layout)].push_back(geometry);
+    }
+
+    bool batched = false;
+    for(BatchMap::iterator itr = batchMap.begin();
+        itr != batchMap.end();
+        ++itr)
+    {
+        GeometryList& geometries = itr->second;
+
+        // split into batches of the target size.
+        GeometryList::iterator start = geometries.begin();
+        while(start!=geometries.end())
+        {
+            unsigned int numVertices = 0;
+            GeometryList::iterator end = start;
+            while(end!=geometries.end() && (end==start || numVertices+(*end)->getVertexArray()->getNumElements()<=_targetMaximumNumberOfVertices))
+            {
+                numVertices += (*end)->getVertexArray()->getNumElements();
+                ++end;
+            }
+
+            if (static_cast<unsigned int>(end-start)>=_minimumNumberOfGeometries)
+            {
+                GeometryList batch(start, end);
+                osg::ref_ptr<osg::Geometry> geometry = createBatch(batch);
+
+                for(GeometryList::iterator gitr = batch.begin();
+                    gitr != batch.end();
+                    ++gitr)
+                {
+                    group.removeChild(*gitr);
+                }
+                group.addChild(geometry.get());
+
+                batched = true;
+            }
+
+            start = end;
+        }
+    }
+
+    return batched;
+}
+
+osg::Geometry* Optimizer::MultiDrawIndirectVisitor::createBatch(const std::vector<osg::Geometry*>& geometries)
+{
+    const osg::Geometry* first = geometries.front();
+
+    osg::ref_ptr<osg::Array> vertices, normals, colors, secondaryColors, fogCoords;
+    std::vector< osg::ref_ptr<osg::Array> > texCoords(first->getNumTexCoordArrays());
+    std::vector< osg::ref_ptr<osg::Array> > vertexAttribs(first->getNumVertexAttribArrays());
+
+    osg::ref_ptr<osg::MultiDrawElementsIndirectUInt> indices = new osg::MultiDrawElementsIndirectUInt(first->getPrimitiveSet(0)->getMode());
+    osg::ref_ptr<osg::DefaultIndirectCommandDrawElements> commands = new osg::DefaultIndirectCommandDrawElements;
+    indices->setIndirectCommandArray(commands.get());
+
+    MultiDrawIndirectCullCallback::BoundingBoxList boundingBoxes;
+
+    std::string name;
+    unsigned int baseVertex = 0;
+    for(std::vector<osg::Geometry*>::const_iterator itr = geometries.begin();
+        itr != geometries.end();
+        ++itr)
+    {
+        const osg::Geometry* geometry = *itr;
+
+        appendArray(vertices, geometry->getVertexArray());
+        appendArray(normals, geometry->getNormalArray());
+        appendArray(colors, geometry->getColorArray());
+        appendArray(secondaryColors, geometry->getSecondaryColorArray());
+        appendArray(fogCoords, geometry->getFogCoordArray());
+        for(unsigned int i=0; i<texCoords.size(); ++i) appendArray(texCoords[i], geometry->getTexCoordArray(i));
+        for(unsigned int i=0; i<vertexAttribs.size(); ++i) appendArray(vertexAttribs[i], geometry->getVertexAttribArray(i));
+
+        const osg::BoundingBox& bb = geometry->getBoundingBox();
+        for(unsigned int i=0; i<geometry->getNumPrimitiveSets(); ++i)
+        {
+            const osg::PrimitiveSet* primitiveSet = geometry->getPrimitiveSet(i);
+            unsigned int firstIndex = indices->size();
+
+            switch(primitiveSet->getType())
+            {
+                case(osg::PrimitiveSet::DrawArraysPrimitiveType):
+                {
+                    const osg::DrawArrays* drawArrays = static_cast<const osg::DrawArrays*>(primitiveSet);
+                    for(GLsizei j=0; j<drawArrays->getCount(); ++j) indices->push_back(drawArrays->getFirst()+j);
+                    break;
+                }
+                case(osg::PrimitiveSet::DrawElementsUBytePrimitiveType): appendIndices<osg::DrawElementsUByte>(*indices, *primitiveSet); break;
+                case(osg::PrimitiveSet::DrawElementsUShortPrimitiveType): appendIndices<osg::DrawElementsUShort>(*indices, *primitiveSet); break;
+                case(osg::PrimitiveSet::DrawElementsUIntPrimitiveType): appendIndices<osg::DrawElementsUInt>(*indices, *primitiveSet); break;
+                default: break;
+            }
+
+            unsigned int count = indices->size()-firstIndex;
+            if (count==0) continue;
+
+            commands->push_back(osg::DrawElementsIndirectCommand(count, 1, firstIndex, baseVertex, 0));
+            boundingBoxes.push_back(bb);
+        }
+
+        baseVertex += geometry->getVertexArray()->getNumElements();
+
+        if (!geometry->getName().empty())
+        {
+            if (!name.empty()) name += ",";
+            name += geometry->getName();
+        }
+    }
+
+    osg::Geometry* batch = new osg::Geometry;
+    batch->setName(name);
+    batch->setStateSet(const_cast<osg::StateSet*>(first->getStateSet()));
+    batch->setNodeMask(first->getNodeMask());
+
+    // the cull callback rewrites the instance counts of the commands every frame.
+    batch->setDataVariance(osg::Object::DYNAMIC);
+    commands->setDataVariance(osg::Object::DYNAMIC);
+
+    batch->setVertexArray(vertices.get());
+    batch->setNormalArray(normals.get());
+    batch->setColorArray(colors.get());
+    batch->setSecondaryColorArray(secondaryColors.get());
+    batch->setFogCoordArray(fogCoords.get());
+    for(unsigned int i=0; i<texCoords.size(); ++i) batch->setTexCoordArray(i, texCoords[i].get());
+    for(unsigned int i=0; i<vertexAttribs.size(); ++i) batch->setVertexAttribArray(i, vertexAttribs[i].get());
+
+    batch->addPrimitiveSet(indices.get());
+
+    batch->setUseDisplayList(false);
+    batch->setUseVertexBufferObjects(true);
+
+    osg::ref_ptr<MultiDrawIndirectCullCallback> cullCallback = new MultiDrawIndirectCullCallback;
+    cullCallback->setIndirectCommandArray(commands.get());
+    cullCallback->setBoundingBoxList(boundingBoxes);
+    batch->setCullCallback(cullCallback.get());
+
+    return batch;
+}
+
+Optimizer::MultiDrawIndirectCullCallback::MultiDrawIndirectCullCallback():
+    _frameNumber(UINT_MAX)
+{
+}
+
+Optimizer::MultiDrawIndirectCullCallback::MultiDrawIndirectCullCallback(const MultiDrawIndirectCullCallback& rhs, const osg::CopyOp& copyop):
+    osg::Object(rhs, copyop),
+    osg::Callback(rhs, copyop),
+    osg::DrawableCullCallback(rhs, copyop),
+    _commands(rhs._commands),
+    _boundingBoxList(rhs._boundingBoxList),
+    _frameNumber(UINT_MAX)
+{
+}
+
+bool Optimizer::MultiDrawIndirectCullCallback::cull(osg::NodeVisitor* nv, osg::Drawable*, osg::RenderInfo*) const
+{
+    osg::CullStack* cullStack = nv ? nv->asCullStack() : 0;
+    if (!cullStack || !_commands.valid()) return false;
+
+    osg::CullingSet& cullingSet = cullStack->getCurrentCullingSet();
+    unsigned int frameNumber = nv->getFrameStamp() ? nv->getFrameStamp()->getFrameNumber() : 0;
+
+    unsigned int numCommands = osg::minimum(_commands->getNumElements(), static_cast<unsigned int>(_boundingBoxList.size()));
+
+    // cull features smaller than the small feature culling pixel size, as the cull traversal would the original Geometries' nodes.
+    bool smallFeatureCulling = (cullingSet.getCullingMask() & osg::CullingSet::SMALL_FEATURE_CULLING)!=0;
+    const osg::Vec4& pixelSizeVector = cullingSet.getPixelSizeVector();
+    float smallFeatureCullingPixelSize = cullingSet.getSmallFeatureCullingPixelSize();
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    // the first cull traversal of a frame starts with all the commands hidden, later ones add the commands they see.
+    bool firstCullOfFrame = (frameNumber!=_frameNumber);
+    _frameNumber = frameNumber;
+
+    bool modified = false;
+    unsigned int numVisible = 0;
+    for(unsigned int i=0; i<numCommands; ++i)
+    {
+        unsigned int& instanceCount = _commands->instanceCount(i);
+        const osg::BoundingBox& bb = _boundingBoxList[i];
+        bool culled = cullingSet.isCulled(bb);
+        if (!culled && smallFeatureCulling) culled = ((bb.center()*pixelSizeVector)*smallFeatureCullingPixelSize)>bb.radius();
+
+        unsigned int visible = culled ? 0 : 1;
+        if (!firstCullOfFrame && instanceCount!=0) visible = 1;
+
+        if (instanceCount!=visible)
+        {
+            instanceCount = visible;
+            modified = true;
+        }
+        numVisible += visible;
+    }
+
+    if (modified) _commands->dirty();
+
+    // nothing to draw if none of the commands are visible.
+    return numVisible==0;
+}
@@ -15,13 +15,17 @@
 
 #include <osgUtil/RenderBin>
 #include <osgUtil/RenderStage>
+#include <osgUtil/RenderLeafInstancer>
 #include <osgUtil/Statistics>
 
+#include <osg/ContextData>
 #include <osg/Notify>
 #include <osg/ApplicationUsage>
 #include <osg/AlphaFunc>
+#include <osg/Profiler>
 
 #include <algorithm>
+#include <sstream>
 
 using namespace osg;
 using namespace osgUtil;
@@ -142,6 +146,64 @@ RenderBin::SortMode RenderBin::getDefaultRenderBinSortMode()
     return s_defaultBinSortMode;
 }
 
+// The defaults below are read from the environment by function scope statics, first used when the RenderBin
+// prototypes are constructed during static initialization, so that several cull threads never initialize them at once.
+static osg::ApplicationUsageProxy RenderBin_e1(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_RADIX_SORT <mode>","ON | OFF - use a radix sort rather than std::sort to sort RenderBin leaves");
+
+static bool& defaultUseRadixSort()
+{
+    struct EnvVar
+    {
+        static bool read()
+        {
+            const char* str = getenv("OSG_RADIX_SORT");
+            return str && (strcmp(str,"ON")==0 || strcmp(str,"on")==0);
+        }
+    };
+
+    static bool s_defaultUseRadixSort = EnvVar::read();
+    return s_defaultUseRadixSort;
+}
+
+void RenderBin::setDefaultUseRadixSort(bool flag)
+{
+    defaultUseRadixSort() = flag;
+}
+
+bool RenderBin::getDefaultUseRadixSort()
+{
+    return defaultUseRadixSort();
+}
+
+static osg::ApplicationUsageProxy RenderBin_e2(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_AUTO_INSTANCING <num>","Minimum number of leaves sharing the same Geometry and state to draw with a single instanced draw call, 0 to disable");
+
+static unsigned int& defaultInstancingThreshold()
+{
+    struct EnvVar
+    {
+        static unsigned int read()
+        {
+            const char* str = getenv("OSG_AUTO_INSTANCING");
+            if (!str || strcmp(str,"OFF")==0 || strcmp(str,"off")==0) return 0;
+            if (strcmp(str,"ON")==0 || strcmp(str,"on")==0) return 2;
+            return atoi(str);
+        }
+    };
+
+    static unsigned int s_defaultInstancingThreshold = EnvVar::read();
+    return s_defaultInstancingThreshold;
+}
+
+void RenderBin::setDefaultInstancingThreshold(unsigned int threshold)
+{
+    defaultInstancingThreshold() = threshold;
+}
+
+unsigned int RenderBin::getDefaultInstancingThreshold()
+{
+    return defaultInstancingThreshold();
+}
+
 RenderBin::RenderBin()
 {
     _binNum = 0;
@@ -149,6 +211,9 @@ RenderBin::RenderBin()
     _stage = NULL;
     _sorted = false;
     _sortMode = getDefaultRenderBinSortMode();
+    _useRadixSort = getDefaultUseRadixSort();
+    _sortFrontToBackWithinStateGraphs = false;
+    _instancingThreshold = getDefaultInstancingThreshold();
 }
 
 RenderBin::RenderBin(SortMode mode)
@@ -158,6 +223,9 @@ RenderBin::RenderBin(SortMode mode)
     _stage = NULL;
     _sorted = false;
     _sortMode = mode;
+    _useRadixSort = getDefaultUseRadixSort();
+    _sortFrontToBackWithinStateGraphs = false;
+    _instancingThreshold = getDefaultInstancingThreshold();
 
 #if 1
     if (_sortMode==SORT_BACK_TO_FRONT)
@@ -187,6 +255,9 @@ RenderBin::RenderBin(const RenderBin& rhs,const CopyOp& copyop):
         _renderLeafList(rhs._renderLeafList),
         _sorted(rhs._sorted),
         _sortMode(rhs._sortMode),
+        _useRadixSort(rhs._useRadixSort),
+        _sortFrontToBackWithinStateGraphs(rhs._sortFrontToBackWithinStateGraphs),
+        _instancingThreshold(rhs._instancingThreshold),
         _sortCallback(rhs._sortCallback),
         _drawCallback(rhs._drawCallback),
         _stateset(rhs._stateset)
@@ -269,6 +340,51 @@ void RenderBin::sortByState()
     // the StateGraph leaves is already coarse grained sorted, this
     // sorting is as a function of the cull traversal.
     // cout << "doing sortByState "<<this<<endl;
+
+    // the leaves within each StateGraph share the same state so can be
+    // drawn front to back to reduce overdraw without adding state changes.
+    if (_sortFrontToBackWithinStateGraphs)
+    {
+        if (_useRadixSort)
+        {
+            radixSortLeavesWithinStateGraphs();
+        }
+        else
+        {
+            for(StateGraphList::iterator itr=_stateGraphList.begin();
+                itr!=_stateGraphList.end();
+                ++itr)
+            {
+                (*itr)->sortFrontToBack();
+            }
+        }
+    }
+    else if (_instancingThreshold>0)
+    {
+        groupLeavesWithinStateGraphsByDrawable();
+    }
+}
+
+struct DrawableSortFunctor
+{
+    bool operator() (const RenderLeaf* lhs,const RenderLeaf* rhs) const
+    {
+        return (lhs->_drawable<rhs->_drawable);
+    }
+};
+
+void RenderBin::groupLeavesWithinStateGraphsByDrawable()
+{
+    for(StateGraphList::iterator itr=_stateGraphList.begin();
+        itr!=_stateGraphList.end();
+        ++itr)
+    {
+        StateGraph::LeafList& leaves = (*itr)->_leaves;
+        if (leaves.size()>=_instancingThreshold)
+        {
+            std::stable_sort(leaves.begin(), leaves.end(), DrawableSortFunctor());
+        }
+    }
 }
 
 
@@ -282,11 +398,13 @@ struct StateGraphFrontToBackSortFunctor
 
 void RenderBin::sortByStateThenFrontToBack()
 {
+    if (_useRadixSort) radixSortLeavesWithinStateGraphs();
+
     for(StateGraphList::iterator itr=_stateGraphList.begin();
         itr!=_stateGraphList.end();
         ++itr)
     {
-        (*itr)->sortFrontToBack();
+        if (!_useRadixSort) (*itr)->sortFrontToBack();
         (*itr)->getMinimumDistance();
     }
     std::sort(_stateGraphList.begin(),_stateGraphList.end(),StateGraphFrontToBackSortFunctor());
@@ -303,6 +421,12 @@ struct FrontToBackSortFunctor
 
 void RenderBin::sortFrontToBack()
 {
+    if (_useRadixSort)
+    {
+        radixSortLeavesIntoRenderLeafList(FRONT_TO_BACK_KEY);
+        return;
+    }
+
     copyLeavesFromStateGraphListToRenderLeafList();
 
     // now sort the list into acending depth order.
@@ -321,6 +445,12 @@ struct BackToFrontSortFunctor
 
 void RenderBin::sortBackToFront()
 {
+    if (_useRadixSort)
+    {
+        radixSortLeavesIntoRenderLeafList(BACK_TO_FRONT_KEY);
+        return;
+    }
+
     copyLeavesFromStateGraphListToRenderLeafList();
 
     // now sort the list into acending depth order.
@@ -340,6 +470,12 @@ struct TraversalOrderFunctor
 
 void RenderBin::sortTraversalOrder()
 {
+    if (_useRadixSort)
+    {
+        radixSortLeavesIntoRenderLeafList(TRAVERSAL_ORDER_KEY);
+        return;
+    }
+
     copyLeavesFromStateGraphListToRenderLeafList();
 
     // now sort the list into acending depth order.
@@ -374,7 +510,7 @@ void RenderBin::copyLeavesFromStateGraphListToRenderLeafList()
         {
             if (!osg::isNaN((*dw_itr)->_depth))
             {
-                _renderLeafList.push_back(dw_itr->get());
+                _renderLeafList.push_back(*dw_itr);
             }
             else
             {
@@ -389,6 +525,114 @@ void RenderBin::copyLeavesFromStateGraphListToRenderLeafList()
     _stateGraphList.clear();
 }
 
+RenderBin::RadixSortItems& RenderBin::getRadixSortBuffers(RadixSortItems*& scratch)
+{
+    // RenderBins are recreated every frame, so share the buffers of their RenderStage which persists between frames.
+    RenderBin* owner = _stage ? static_cast<RenderBin*>(_stage) : this;
+    scratch = &(owner->_radixSortScratch);
+    owner->_radixSortItems.clear();
+    return owner->_radixSortItems;
+}
+
+void RenderBin::radixSortLeavesIntoRenderLeafList(LeafSortKey sortKey)
+{
+    _renderLeafList.clear();
+
+    RadixSortItems* scratch = 0;
+    RadixSortItems& items = getRadixSortBuffers(scratch);
+
+    bool detectedNaN = false;
+
+    // compute the keys, placing the depth above the rank of the StateGraph so that
+    // leaves at the same depth are kept together by state.
+    uint64_t stateGraphRank = 0;
+    for(StateGraphList::iterator itr=_stateGraphList.begin();
+        itr!=_stateGraphList.end();
+        ++itr, ++stateGraphRank)
+    {
+        for(StateGraph::LeafList::iterator dw_itr = (*itr)->_leaves.begin();
+            dw_itr != (*itr)->_leaves.end();
+            ++dw_itr)
+        {
+            RenderLeaf* rl = *dw_itr;
+            if (osg::isNaN(rl->_depth))
+            {
+                detectedNaN = true;
+                continue;
+            }
+
+            uint64_t key;
+            switch(sortKey)
+            {
+                case(FRONT_TO_BACK_KEY): key = (uint64_t(floatToRadixKey(rl->_depth))<<32) | stateGraphRank; break;
+                case(BACK_TO_FRONT_KEY): key = (uint64_t(~floatToRadixKey(rl->_depth))<<32) | stateGraphRank; break;
+                default: key = rl->_traversalOrderNumber; break;
+            }
+
+            items.push_back(RadixSortItem<RenderLeaf*>(key, rl));
+        }
+    }
+
+    radixSort(items, *scratch, sortKey==TRAVERSAL_ORDER_KEY ? 32 : 64);
+
+    _renderLeafList.reserve(items.size());
+    for(RadixSortItems::iterator itr=items.begin();
+        itr!=items.end();
+        ++itr)
+    {
+        _renderLeafList.push_back(itr->value);
+    }
+
+    if (detectedNaN) OSG_NOTICE<<"Warning: RenderBin::radixSortLeavesIntoRenderLeafList() detected NaN depth values, database may be corrupted."<<std::endl;
+
+    // empty the render graph list to prevent it being drawn along side the render leaf list (see drawImplementation.)
+    _stateGraphList.clear();
+}
+
+void RenderBin::radixSortLeavesWithinStateGraphs()
+{
+    RadixSortItems* scratch = 0;
+    RadixSortItems& items = getRadixSortBuffers(scratch);
+
+    // key on the rank of the StateGraph then the depth, so that one sort orders the leaves of all the StateGraphs.
+    uint64_t stateGraphRank = 0;
+    for(StateGraphList::iterator itr=_stateGraphList.begin();
+        itr!=_stateGraphList.end();
+        ++itr, ++stateGraphRank)
+    {
+        StateGraph::LeafList& leaves = (*itr)->_leaves;
+        if (leaves.size()<2) continue;
+
+        for(StateGraph::LeafList::iterator dw_itr = leaves.begin();
+            dw_itr != leaves.end();
+            ++dw_itr)
+        {
+            items.push_back(RadixSortItem<RenderLeaf*>((stateGraphRank<<32) | floatToRadixKey((*dw_itr)->_depth), *dw_itr));
+        }
+    }
+
+    if (items.empty()) return;
+
+    radixSort(items, *scratch);
+
+    // copy the sorted leaves back, the StateGraphs appear in the sorted items in the same order as in the StateGraphList.
+    RadixSortItems::iterator sitr = items.begin();
+    for(StateGraphList::iterator itr=_stateGraphList.begin();
+        itr!=_stateGraphList.end();
+        ++itr)
+    {
+        StateGraph::LeafList& leaves = (*itr)->_leaves;
+        if (leaves.size()<2) continue;
+
+        for(StateGraph::LeafList::iterator dw_itr = leaves.begin();
+            dw_itr != leaves.end();
+            ++dw_itr, ++sitr)
+        {
+            *dw_itr = sitr->value;
+        }
+    }
+}
+
 RenderBin* RenderBin::find_or_insert(int binNum,const std::string& binName)
 {
     // search for appropriate bin.
@@ -423,12 +667,26 @@ void RenderBin::draw(osg::RenderInfo& renderInfo,RenderLeaf*& previous)
 {
     renderInfo.pushRenderBin(this);
 
+    // record the time taken to draw the bin when profiling, the RenderBin of the RenderStage itself is covered by its Camera scope.
+    osg::State& state = *renderInfo.getState();
+    osg::Profiler* profiler = state.getProfiler();
+    bool profile = profiler && profiler->getEnabled() && _stage!=this;
+    unsigned int profileScope = 0;
+    if (profile)
+    {
+        std::ostringstream name;
+        name<<"RenderBin "<<_binNum;
+        profileScope = profiler->beginScope(state, name.str());
+    }
+
     if (_drawCallback.valid())
     {
         _drawCallback->drawImplementation(this,renderInfo,previous);
     }
     else drawImplementation(renderInfo,previous);
 
+    if (profile) profiler->endScope(state, profileScope);
+
     renderInfo.popRenderBin();
 }
 
@@ -459,13 +717,9 @@ void RenderBin::drawImplementation(osg::RenderInfo& renderInfo,RenderLeaf*& prev
     }
 
     // draw fine grained ordering.
-    for(RenderLeafList::iterator rlitr= _renderLeafList.begin();
-        rlitr!= _renderLeafList.end();
-        ++rlitr)
+    if (!_renderLeafList.empty())
     {
-        RenderLeaf* rl = *rlitr;
-        rl->render(renderInfo,previous);
-        previous = rl;
+        drawLeaves(renderInfo, &_renderLeafList.front(), _renderLeafList.size(), previous);
     }
 
 
@@ -478,15 +732,10 @@ void RenderBin::drawImplementation(osg::RenderInfo& renderInfo,RenderLeaf*& prev
             oitr!=_stateGraphList.end();
             ++oitr)
         {
-
-            for(StateGraph::LeafList::iterator dw_itr = (*oitr)->_leaves.begin();
-                dw_itr != (*oitr)->_leaves.end();
-                ++dw_itr)
+            StateGraph::LeafList& leaves = (*oitr)->_leaves;
+            if (!leaves.empty())
             {
-                RenderLeaf* rl = dw_itr->get();
-                rl->render(renderInfo,previous);
-                previous = rl;
-
+                drawLeaves(renderInfo, &leaves.front(), leaves.size(), previous);
             }
         }
     }
@@ -501,7 +750,7 @@ void RenderBin::drawImplementation(osg::RenderInfo& renderInfo,RenderLeaf*& prev
                 dw_itr != (*oitr)->_leaves.end();
                 ++dw_itr)
             {
-                RenderLeaf* rl = dw_itr->get();
+                RenderLeaf* rl = *dw_itr;
                 rl->render(renderInfo,previous);
                 previous = rl;
 
@@ -527,6 +776,59 @@ void RenderBin::drawImplementation(osg::RenderInfo& renderInfo,RenderLeaf*& prev
     // OSG_NOTICE<<"end RenderBin::drawImplementation "<<className()<<std::endl;
 }
 
+void RenderBin::drawLeaves(osg::RenderInfo& renderInfo, RenderLeaf** leaves, unsigned int numLeaves, RenderLeaf*& previous)
+{
+    if (_instancingThreshold<2 || numLeaves<_instancingThreshold)
+    {
+        for(unsigned int i=0; i<numLeaves; ++i)
+        {
+            RenderLeaf* rl = leaves[i];
+            rl->render(renderInfo,previous);
+            previous = rl;
+        }
+        return;
+    }
+
+    unsigned int i=0;
+    while(i<numLeaves)
+    {
+        RenderLeaf* rl = leaves[i];
+
+        // find the run of leaves that can be drawn with a single instanced draw call.
+        unsigned int end = i+1;
+        if (rl->_modelview.valid())
+        {
+            while(end<numLeaves &&
+                  leaves[end]->_drawable==rl->_drawable &&
+                  leaves[end]->_parent==rl->_parent &&
+                  leaves[end]->_projection==rl->_projection &&
+                  leaves[end]->_modelview.valid())
+            {
+                ++end;
+            }
+        }
+
+        if (end-i>=_instancingThreshold && RenderLeafInstancer::isInstanceable(rl->_drawable))
+        {
+            if (osg::get<RenderLeafInstancer>(renderInfo.getContextID())->draw(renderInfo, previous, leaves+i, end-i))
+            {
+                previous = leaves[end-1];
+                i = end;
+                continue;
+            }
+
+            // the state of the first leaf has already been applied.
+            previous = rl;
+        }
+
+        for(; i<end; ++i)
+        {
+            leaves[i]->render(renderInfo,previous);
+            previous = leaves[i];
+        }
+    }
+}
+
 // stats
 bool RenderBin::getStats(Statistics& stats) const
 {
@@ -570,7 +872,7 @@ bool RenderBin::getStats(Statistics& stats) const
             dw_itr != (*oitr)->_leaves.end();
             ++dw_itr)
         {
-            const RenderLeaf* rl = dw_itr->get();
+            const RenderLeaf* rl = *dw_itr;
             const Drawable* dw = rl->getDrawable();
             stats.addDrawable(); // number of geosets
 
@@ -635,7 +937,7 @@ unsigned int RenderBin::computeNumberOfDynamicRenderLeaves() const
             dw_itr != (*oitr)->_leaves.end();
             ++dw_itr)
         {
-            RenderLeaf* rl = dw_itr->get();
+            RenderLeaf* rl = *dw_itr;
             if (rl->_dynamic) ++count;
         }
     }
@@ -28,13 +28,29 @@ void RenderLeaf::render(osg::RenderInfo& renderInfo,RenderLeaf* previous)
         return;
     }
 
-    if (previous)
+    applyState(renderInfo, previous);
+
+    // draw the drawable
+    _drawable->draw(renderInfo);
+
+    if (_dynamic)
     {
+        state.decrementDynamicObjectCount();
+    }
 
-        // apply matrices if required.
-        state.applyProjectionMatrix(_projection.get());
-        state.applyModelViewMatrix(_modelview.get());
+    // OSG_NOTICE<<"RenderLeaf "<<_drawable->getName()<<" "<<_depth<<std::endl;
+}
+
+void RenderLeaf::applyState(osg::RenderInfo& renderInfo,RenderLeaf* previous)
+{
+    osg::State& state = *renderInfo.getState();
+
+    // apply matrices if required.
+    state.applyProjectionMatrix(_projection.get());
+    state.applyModelViewMatrix(_modelview.get());
 
+    if (previous)
+    {
         // apply state if required.
         StateGraph* prev_rg = previous->_parent;
         StateGraph* prev_rg_parent = prev_rg->_parent;
@@ -54,38 +70,16 @@ void RenderLeaf::render(osg::RenderInfo& renderInfo,RenderLeaf* previous)
             state.apply(rg->getStateSet());
 
         }
-
-        // if we are using osg::Program which requires OSG's generated uniforms to track
-        // modelview and projection matrices then apply them now.
-        if (state.getUseModelViewAndProjectionUniforms()) state.applyModelViewAndProjectionUniformsIfRequired();
-
-
-        // draw the drawable
-        _drawable->draw(renderInfo);
     }
     else
     {
-        // apply matrices if required.
-        state.applyProjectionMatrix(_projection.get());
-        state.applyModelViewMatrix(_modelview.get());
-
         // apply state if required.
         StateGraph::moveStateGraph(state,NULL,_parent->_parent);
 
         state.apply(_parent->getStateSet());
-
-        // if we are using osg::Program which requires OSG's generated uniforms to track
-        // modelview and projection matrices then apply them now.
-        if (state.getUseModelViewAndProjectionUniforms()) state.applyModelViewAndProjectionUniformsIfRequired();
-
-        // draw the drawable
-        _drawable->draw(renderInfo);
     }
 
-    if (_dynamic)
-    {
-        state.decrementDynamicObjectCount();
-    }
-
-    // OSG_NOTICE<<"RenderLeaf "<<_drawable->getName()<<" "<<_depth<<std::endl;
+    // if we are using osg::Program which requires OSG's generated uniforms to track
+    // modelview and projection matrices then apply them now.
+    if (state.getUseModelViewAndProjectionUniforms()) state.applyModelViewAndProjectionUniformsIfRequired();
 }
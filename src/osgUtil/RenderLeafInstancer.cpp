@@ -0,0 +1,325 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+#include <osgUtil/RenderLeafInstancer>
+#include <osgUtil/StateGraph>
+
+#include <osg/GLExtensions>
+#include <osg/Notify>
+#include <osg/Texture>
+
+using namespace osg;
+using namespace osgUtil;
+
+static unsigned int s_instanceTextureUnit = 15;
+
+static const char* s_fixedFunctionInstancingVertexShader =
+    "#version 140\n"
+    "#extension GL_ARB_compatibility : enable\n"
+    "uniform samplerBuffer osg_InstanceModelViewMatrices;\n"
+    "void main(void)\n"
+    "{\n"
+    "    int i = gl_InstanceID*4;\n"
+    "    mat4 modelView = mat4(texelFetch(osg_InstanceModelViewMatrices, i),\n"
+    "                          texelFetch(osg_InstanceModelViewMatrices, i+1),\n"
+    "                          texelFetch(osg_InstanceModelViewMatrices, i+2),\n"
+    "                          texelFetch(osg_InstanceModelViewMatrices, i+3));\n"
+    "    vec4 eyeVertex = modelView * gl_Vertex;\n"
+    "    gl_Position = gl_ProjectionMatrix * eyeVertex;\n"
+    "    gl_ClipVertex = eyeVertex;\n"
+    "    gl_FrontColor = gl_Color;\n"
+    "    gl_BackColor = gl_Color;\n"
+    "    gl_FrontSecondaryColor = gl_SecondaryColor;\n"
+    "    gl_BackSecondaryColor = gl_SecondaryColor;\n"
+    "    gl_TexCoord[0] = gl_TextureMatrix[0] * gl_MultiTexCoord0;\n"
+    "    gl_TexCoord[1] = gl_TextureMatrix[1] * gl_MultiTexCoord1;\n"
+    "    gl_TexCoord[2] = gl_TextureMatrix[2] * gl_MultiTexCoord2;\n"
+    "    gl_TexCoord[3] = gl_TextureMatrix[3] * gl_MultiTexCoord3;\n"
+    "    gl_FogFragCoord = abs(eyeVertex.z);\n"
+    "}\n";
+
+void RenderLeafInstancer::setTextureUnit(unsigned int unit)
+{
+    s_instanceTextureUnit = unit;
+}
+
+unsigned int RenderLeafInstancer::getTextureUnit()
+{
+    return s_instanceTextureUnit;
+}
+
+RenderLeafInstancer::RenderLeafInstancer(unsigned int contextID):
+    _contextID(contextID),
+    _numInstancedDraws(0),
+    _numInstances(0)
+{
+    _matrices = new osg::FloatArray;
+    _matrices->setDataVariance(osg::Object::DYNAMIC);
+
+    _textureBuffer = new osg::TextureBuffer(_matrices.get());
+    _textureBuffer->setInternalFormat(GL_RGBA32F_ARB);
+
+    osg::ref_ptr<osg::Uniform> sampler = new osg::Uniform(osg::Uniform::SAMPLER_BUFFER, "osg_InstanceModelViewMatrices");
+    sampler->set(static_cast<int>(s_instanceTextureUnit));
+
+    _programStateSet = new osg::StateSet;
+    _programStateSet->setDefine("OSG_INSTANCING");
+    _programStateSet->setTextureAttribute(s_instanceTextureUnit, _textureBuffer.get());
+    _programStateSet->addUniform(sampler.get());
+
+    osg::ref_ptr<osg::Program> program = new osg::Program;
+    program->setName("RenderLeafInstancer");
+    program->addShader(new osg::Shader(osg::Shader::VERTEX, s_fixedFunctionInstancingVertexShader));
+
+    _fixedFunctionStateSet = new osg::StateSet;
+    _fixedFunctionStateSet->setAttribute(program.get());
+    _fixedFunctionStateSet->setTextureAttribute(s_instanceTextureUnit, _textureBuffer.get());
+    _fixedFunctionStateSet->addUniform(sampler.get());
+}
+
+RenderLeafInstancer::~RenderLeafInstancer()
+{
+}
+
+bool RenderLeafInstancer::isInstanceable(const osg::Drawable* drawable)
+{
+    const osg::Geometry* geometry = drawable ? drawable->asGeometry() : 0;
+    if (!geometry || geometry->getDrawCallback() || !geometry->getUseVertexBufferObjects()) return false;
+
+    const osg::Geometry::PrimitiveSetList& primitives = geometry->getPrimitiveSetList();
+    if (primitives.empty()) return false;
+
+    for(osg::Geometry::PrimitiveSetList::const_iterator itr = primitives.begin();
+        itr != primitives.end();
+        ++itr)
+    {
+        const osg::PrimitiveSet* primitiveSet = itr->get();
+        if (primitiveSet->getNumInstances()!=0) return false;
+
+        switch(primitiveSet->getType())
+        {
+            case(osg::PrimitiveSet::DrawArraysPrimitiveType):
+            case(osg::PrimitiveSet::DrawElementsUBytePrimitiveType):
+            case(osg::PrimitiveSet::DrawElementsUShortPrimitiveType):
+            case(osg::PrimitiveSet::DrawElementsUIntPrimitiveType):
+                break;
+            default:
+                return false;
+        }
+
+#if defined(OSG_GLES1_AVAILABLE) || defined(OSG_GLES2_AVAILABLE) || defined(OSG_GLES3_AVAILABLE)
+        GLenum mode = primitiveSet->getMode();
+        if (mode==GL_QUADS || mode==GL_QUAD_STRIP || mode==GL_POLYGON) return false;
+#endif
+    }
+
+    return true;
+}
+
+bool RenderLeafInstancer::supportsInstancing(const osg::Program* program) const
+{
+    for(unsigned int i=0; i<program->getNumShaders(); ++i)
+    {
+        const osg::Shader* shader = program->getShader(i);
+        if (shader->getType()==osg::Shader::VERTEX &&
+            shader->getShaderDefines().count("OSG_INSTANCING")!=0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RenderLeafInstancer::supportsFixedFunctionInstancing(osg::State& state) const
+{
+    // the built in vertex shader doesn't do lighting or texture coordinate generation.
+    if (state.getLastAppliedMode(GL_LIGHTING)) return false;
+
+#if defined(OSG_GL_FIXED_FUNCTION_AVAILABLE)
+    for(unsigned int unit=0; unit<4; ++unit)
+    {
+        if (state.getLastAppliedTextureMode(unit, GL_TEXTURE_GEN_S) ||
+            state.getLastAppliedTextureMode(unit, GL_TEXTURE_GEN_T) ||
+            state.getLastAppliedTextureMode(unit, GL_TEXTURE_GEN_R) ||
+            state.getLastAppliedTextureMode(unit, GL_TEXTURE_GEN_Q))
+        {
+            return false;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool RenderLeafInstancer::draw(osg::RenderInfo& renderInfo, RenderLeaf* previous, RenderLeaf** leaves, unsigned int numLeaves)
+{
+    osg::State& state = *renderInfo.getState();
+    RenderLeaf* first = leaves[0];
+
+    first->applyState(renderInfo, previous);
+
+    const osg::GLExtensions* extensions = state.get<osg::GLExtensions>();
+    if (!extensions->isGlslSupported || extensions->glslLanguageVersion<1.4f || !extensions->isTBOSupported ||
+        !extensions->glDrawArraysInstanced || !extensions->glDrawElementsInstanced)
+    {
+        return false;
+    }
+
+    // select the state that passes the instance matrices on to the vertex shader.
+    const osg::Program* program = dynamic_cast<const osg::Program*>(state.getLastAppliedAttribute(osg::StateAttribute::PROGRAM));
+    osg::StateSet* instancingStateSet = 0;
+    if (!program || program->getNumShaders()==0)
+    {
+        if (supportsFixedFunctionInstancing(state)) instancingStateSet = _fixedFunctionStateSet.get();
+    }
+    else if (supportsInstancing(program))
+    {
+        instancingStateSet = _programStateSet.get();
+    }
+
+    if (!instancingStateSet) return false;
+
+    // copy the modelview matrices into the texture buffer.
+    _matrices->resize(numLeaves*16);
+    float* matrixPtr = &(_matrices->front());
+    for(unsigned int i=0; i<numLeaves; ++i, matrixPtr+=16)
+    {
+        const osg::Matrix& modelview = *(leaves[i]->_modelview);
+        for(unsigned int j=0; j<16; ++j) matrixPtr[j] = static_cast<float>(modelview.ptr()[j]);
+    }
+    _matrices->dirty();
+    _textureBuffer->setTextureWidth(numLeaves*4);
+
+    const osg::StateSet* stateset = first->_parent->getStateSet();
+    if (stateset) state.pushStateSet(stateset);
+    state.pushStateSet(instancingStateSet);
+    state.apply();
+
+    // the texture buffer is already current if used earlier in the frame, so apply it directly to upload the matrices.
+    state.setActiveTextureUnit(s_instanceTextureUnit);
+    _textureBuffer->apply(state);
+
+    if (state.getUseModelViewAndProjectionUniforms()) state.applyModelViewAndProjectionUniformsIfRequired();
+
+    drawInstanced(renderInfo, first->_drawable->asGeometry(), numLeaves);
+
+    // restore the state of the leaves' StateGraph for the leaves that follow.
+    state.popStateSet();
+    if (stateset) state.popStateSet();
+    state.apply(stateset);
+
+    for(unsigned int i=0; i<numLeaves; ++i)
+    {
+        if (leaves[i]->_dynamic) state.decrementDynamicObjectCount();
+    }
+
+    ++_numInstancedDraws;
+    _numInstances += numLeaves;
+
+    return true;
+}
+
+void RenderLeafInstancer::drawInstanced(osg::RenderInfo& renderInfo, const osg::Geometry* geometry, unsigned int numInstances)
+{
+    osg::State& state = *renderInfo.getState();
+
+    // set up the vertex array state as osg::Drawable::draw() does.
+    bool usingVertexBufferObjects = state.useVertexBufferObject(geometry->getUseVertexBufferObjects());
+    if (usingVertexBufferObjects && state.useVertexArrayObject(geometry->getUseVertexArrayObject()))
+    {
+        osg::VertexArrayStateList& vasList = const_cast<osg::Geometry*>(geometry)->getVertexArrayStateList();
+        osg::VertexArrayState* vas = vasList[_contextID].get();
+        if (!vas)
+        {
+            vasList[_contextID] = vas = geometry->createVertexArrayState(renderInfo);
+        }
+
+        osg::State::SetCurrentVertexArrayStateProxy setVASProxy(state, vas);
+
+        state.bindVertexArrayObject(vas);
+
+        drawInstancedImplementation(renderInfo, geometry, numInstances);
+
+        vas->setRequiresSetArrays(geometry->getDataVariance()==osg::Object::DYNAMIC);
+        return;
+    }
+
+    if (state.getCurrentVertexArrayState())
+    {
+        state.bindVertexArrayObject(state.getCurrentVertexArrayState());
+    }
+
+    drawInstancedImplementation(renderInfo, geometry, numInstances);
+}
+
+void RenderLeafInstancer::drawInstancedImplementation(osg::RenderInfo& renderInfo, const osg::Geometry* geometry, unsigned int numInstances)
+{
+    // mirrors osg::Geometry::drawImplementation(), drawing each PrimitiveSet instanced.
+    osg::State& state = *renderInfo.getState();
+
+    bool usingVertexBufferObjects = state.useVertexBufferObject(geometry->getUseVertexBufferObjects());
+    bool usingVertexArrayObjects = usingVertexBufferObjects && state.useVertexArrayObject(geometry->getUseVertexArrayObject());
+
+    osg::VertexArrayState* vas = state.getCurrentVertexArrayState();
+    vas->setVertexBufferObjectSupported(usingVertexBufferObjects);
+
+    geometry->drawVertexArraysImplementation(renderInfo);
+
+    osg::AttributeDispatchers& attributeDispatchers = state.getAttributeDispatchers();
+    bool bindPerPrimitiveSetActive = attributeDispatchers.active();
+
+    const osg::Geometry::PrimitiveSetList& primitives = geometry->getPrimitiveSetList();
+    for(unsigned int primitiveSetNum=0; primitiveSetNum<primitives.size(); ++primitiveSetNum)
+    {
+        if (bindPerPrimitiveSetActive) attributeDispatchers.dispatch(primitiveSetNum);
+
+        const osg::PrimitiveSet* primitiveSet = primitives[primitiveSetNum].get();
+        GLenum mode = primitiveSet->getMode();
+
+        GLenum indexType = 0;
+        switch(primitiveSet->getType())
+        {
+            case(osg::PrimitiveSet::DrawArraysPrimitiveType):
+            {
+                const osg::DrawArrays* drawArrays = static_cast<const osg::DrawArrays*>(primitiveSet);
+                state.glDrawArraysInstanced(mode, drawArrays->getFirst(), drawArrays->getCount(), numInstances);
+                continue;
+            }
+            case(osg::PrimitiveSet::DrawElementsUBytePrimitiveType): indexType = GL_UNSIGNED_BYTE; break;
+            case(osg::PrimitiveSet::DrawElementsUShortPrimitiveType): indexType = GL_UNSIGNED_SHORT; break;
+            case(osg::PrimitiveSet::DrawElementsUIntPrimitiveType): indexType = GL_UNSIGNED_INT; break;
+            default: continue;
+        }
+
+        if (primitiveSet->getNumIndices()==0) continue;
+
+        osg::GLBufferObject* ebo = usingVertexBufferObjects ? primitiveSet->getOrCreateGLBufferObject(_contextID) : 0;
+        if (ebo)
+        {
+            vas->bindElementBufferObject(ebo);
+            state.glDrawElementsInstanced(mode, primitiveSet->getNumIndices(), indexType, (const GLvoid *)(ebo->getOffset(primitiveSet->getBufferIndex())), numInstances);
+        }
+        else
+        {
+            vas->unbindElementBufferObject();
+            state.glDrawElementsInstanced(mode, primitiveSet->getNumIndices(), indexType, primitiveSet->getDataPointer(), numInstances);
+        }
+    }
+
+    if (usingVertexBufferObjects && !usingVertexArrayObjects)
+    {
+        // unbind the VBO's if any are used.
+        vas->unbindVertexBufferObject();
+        vas->unbindElementBufferObject();
+    }
+}
@@ -22,6 +22,7 @@
 #include <osg/ContextData>
 #include <osg/GLExtensions>
 #include <osg/GLU>
+#include <osg/Profiler>
 
 #include <osgUtil/Statistics>
 
@@ -904,6 +905,17 @@ void RenderStage::drawInner(osg::RenderInfo& renderInfo,RenderLeaf*& previous, b
 
     osg::State& state = *renderInfo.getState();
 
+    // record the time taken to draw the Camera when profiling, the name is only built when needed.
+    osg::Profiler* profiler = state.getProfiler();
+    bool profile = profiler && profiler->getEnabled();
+    unsigned int profileScope = 0;
+    if (profile)
+    {
+        std::string name("Camera");
+        if (_camera.valid() && !_camera->getName().empty()) name += " " + _camera->getName();
+        profileScope = profiler->beginScope(state, name);
+    }
+
     osg::GLExtensions* ext = _fbo.valid() ? state.get<osg::GLExtensions>() : 0;
     bool fbo_supported = ext && ext->isFrameBufferObjectSupported;
 
@@ -1110,6 +1122,8 @@ void RenderStage::drawInner(osg::RenderInfo& renderInfo,RenderLeaf*& previous, b
             }
         }
     }
+
+    if (profile) profiler->endScope(state, profileScope);
 }
 
 struct DrawInnerOperation : public osg::Operation
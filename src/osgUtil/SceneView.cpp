@@ -906,12 +906,14 @@ bool SceneView::cullStage(const osg::Matrixd& projection,const osg::Matrixd& mod
     renderStage->sort();
 
     // prune out any empty StateGraph children.
-    // note, this would be not required if the rendergraph had been
-    // reset at the start of each frame (see top of this method) but
-    // a clean has been used instead to try to minimize the amount of
-    // allocation and deleting of the StateGraph nodes.
+    // note, when the StateGraph children are allocated from the CullVisitor's
+    // StateGraphArena they are all recycled by the reset at the start of the
+    // next frame, so prune() has nothing to do.
     rendergraph->prune();
 
+    // release whatever the StateGraphs and RenderLeaves left unused this frame still reference.
+    cullVisitor->getStateGraphArena()->releaseUnused();
+
     // set the number of dynamic objects in the scene.
     _dynamicObjectCount += renderStage->computeNumberOfDynamicRenderLeaves();
 
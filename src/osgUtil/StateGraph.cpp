@@ -17,15 +17,48 @@
 using namespace osg;
 using namespace osgUtil;
 
+StateGraph::~StateGraph()
+{
+    releaseChildren();
+}
+
+void StateGraph::releaseChildren()
+{
+    // children allocated on the heap are owned by their parent, while arena children are owned by the arena.
+    if (!_arena)
+    {
+        for(ChildList::iterator itr=_children.begin();
+            itr!=_children.end();
+            ++itr)
+        {
+            itr->second->unref();
+        }
+    }
+
+    _children.clear();
+}
+
+void StateGraph::setArena(StateGraphArena* arena)
+{
+    if (_arena==arena) return;
+
+    releaseChildren();
+
+    _arena = arena;
+    _arenaGeneration = arena ? arena->getGeneration() : 0;
+}
+
 void StateGraph::reset()
 {
+    releaseChildren();
+
     _parent = NULL;
     _stateset = NULL;
 
     _depth = 0;
 
-    _children.clear();
     _leaves.clear();
+    _ownedLeaves.clear();
 }
 
 /** recursively clean the StateGraph of all its drawables, lights and depths.
@@ -35,6 +68,15 @@ void StateGraph::clean()
 
     // clean local drawables etc.
     _leaves.clear();
+    if (!_ownedLeaves.empty()) _ownedLeaves.clear();
+
+    // children from an arena that has been reset since they were allocated have already been recycled.
+    if (_arena && _arenaGeneration!=_arena->getGeneration())
+    {
+        _children.clear();
+        _arenaGeneration = _arena->getGeneration();
+        return;
+    }
 
     // call clean on all children.
     for(ChildList::iterator itr=_children.begin();
@@ -49,6 +91,9 @@ void StateGraph::clean()
 /** recursively prune the StateGraph of empty children.*/
 void StateGraph::prune()
 {
+    // arena children are recycled wholesale when the arena is reset.
+    if (_arena) return;
+
     // call prune on all children.
     ChildList::iterator citr=_children.begin();
     while(citr!=_children.end())
@@ -58,8 +103,83 @@ void StateGraph::prune()
         if (citr->second->empty())
         {
             ChildList::iterator ditr= citr++;
+            ditr->second->unref();
             _children.erase(ditr);
         }
         else ++citr;
     }
 }
+
+void StateGraph::ChildList::rehash()
+{
+    std::vector<value_type> entries;
+    std::vector<unsigned char> slots;
+    entries.swap(_entries);
+    slots.swap(_slots);
+
+    // grow when more than a quarter full of live entries, otherwise just clear out the tombstones.
+    size_t capacity = entries.empty() ? 8 : entries.size();
+    if ((_size+1)*4 > capacity) capacity *= 2;
+
+    _entries.resize(capacity);
+    _slots.resize(capacity, static_cast<unsigned char>(EMPTY));
+    _size = 0;
+    _numTombstones = 0;
+
+    for(size_t i=0; i<entries.size(); ++i)
+    {
+        if (slots[i]==OCCUPIED) insert(entries[i].first, entries[i].second);
+    }
+}
+
+StateGraphArena::StateGraphArena():
+    osg::Referenced(false),
+    _numStateGraphsUsed(0),
+    _numRenderLeavesUsed(0),
+    _numStateGraphsHeld(0),
+    _numRenderLeavesHeld(0),
+    _generation(0)
+{
+}
+
+StateGraphArena::~StateGraphArena()
+{
+}
+
+void StateGraphArena::reset()
+{
+    // the objects are reinitialized by set() when handed out again, so there is nothing to walk here,
+    // just note how many of them may still hold references for releaseUnused().
+    _numStateGraphsHeld = osg::maximum(_numStateGraphsHeld, _numStateGraphsUsed);
+    _numRenderLeavesHeld = osg::maximum(_numRenderLeavesHeld, _numRenderLeavesUsed);
+    _numStateGraphsUsed = 0;
+    _numRenderLeavesUsed = 0;
+    ++_generation;
+}
+
+void StateGraphArena::releaseUnused()
+{
+    for(unsigned int i=_numStateGraphsUsed; i<_numStateGraphsHeld; ++i)
+    {
+        StateGraph* sg = _stateGraphs[i].get();
+        sg->reset();
+        sg->setUserData(NULL);
+    }
+
+    for(unsigned int i=_numRenderLeavesUsed; i<_numRenderLeavesHeld; ++i)
+    {
+        // leaves still referenced from outside the arena are left to their owner.
+        if (_renderLeaves[i]->referenceCount()==1) _renderLeaves[i]->reset();
+    }
+
+    _numStateGraphsHeld = _numStateGraphsUsed;
+    _numRenderLeavesHeld = _numRenderLeavesUsed;
+}
+
+void StateGraphArena::trim()
+{
+    _stateGraphs.resize(_numStateGraphsUsed);
+    _renderLeaves.resize(_numRenderLeavesUsed);
+    _numStateGraphsHeld = _numStateGraphsUsed;
+    _numRenderLeavesHeld = _numRenderLeavesUsed;
+}
@@ -0,0 +1,820 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgUtil/TileBuilder>
+#include <osgUtil/Simplifier>
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/LOD>
+#include <osg/PagedLOD>
+#include <osg/Transform>
+#include <osg/TriangleIndexFunctor>
+#include <osg/OperationThread>
+#include <osg/Notify>
+
+#include <osg/Timer>
+
+#include <OpenThreads/ScopedLock>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+
+namespace osgUtil
+{
+
+namespace
+{
+    // number of triangles read or written to the temporary files at a time
+    const unsigned int s_chunkSize = 4096;
+
+    bool appendTriangles(const std::string& fileName, const TileBuilder::Triangles& triangles)
+    {
+        if (triangles.empty()) return true;
+
+        std::ofstream fout(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::app);
+        fout.write(reinterpret_cast<const char*>(&triangles.front()), triangles.size()*sizeof(TileBuilder::Triangle));
+        return !fout.fail();
+    }
+
+    /** Read up to maxNumTriangles, returning false once the end of the file is reached.*/
+    bool readTriangles(std::istream& fin, TileBuilder::Triangles& triangles, unsigned int maxNumTriangles)
+    {
+        triangles.resize(maxNumTriangles);
+        fin.read(reinterpret_cast<char*>(&triangles.front()), maxNumTriangles*sizeof(TileBuilder::Triangle));
+        triangles.resize(static_cast<unsigned int>(fin.gcount())/sizeof(TileBuilder::Triangle));
+        return !triangles.empty();
+    }
+
+    bool readTriangleFile(const std::string& fileName, TileBuilder::Triangles& triangles, unsigned int numTriangles)
+    {
+        std::ifstream fin(fileName.c_str(), std::ios::in | std::ios::binary);
+        if (!fin) return false;
+
+        triangles.clear();
+        if (numTriangles==0) return true;
+
+        return readTriangles(fin, triangles, numTriangles) && triangles.size()==numTriangles;
+    }
+
+    struct CollectTriangleIndices
+    {
+        std::vector<unsigned int>* _indices;
+
+        void operator() (unsigned int p1, unsigned int p2, unsigned int p3)
+        {
+            if (p1==p2 || p2==p3 || p1==p3) return;
+            _indices->push_back(p1);
+            _indices->push_back(p2);
+            _indices->push_back(p3);
+        }
+    };
+
+    void expandBy(osg::BoundingBox& bb, const TileBuilder::Triangle& triangle)
+    {
+        for(unsigned int v=0; v<3; ++v) bb.expandBy(triangle.vertices[v].position);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  TileCollectVisitor flattens the transforms and state of a model into the TileBuilder's batches
+//
+class TileCollectVisitor : public osg::NodeVisitor
+{
+public:
+
+    TileCollectVisitor(TileBuilder& builder):
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
+        _builder(builder)
+    {
+        _matrixStack.push_back(osg::Matrix::identity());
+    }
+
+    virtual void apply(osg::Node& node)
+    {
+        pushStateSet(node.getStateSet());
+        traverse(node);
+        popStateSet(node.getStateSet());
+    }
+
+    virtual void apply(osg::Transform& transform)
+    {
+        osg::Matrix matrix = _matrixStack.back();
+        transform.computeLocalToWorldMatrix(matrix, this);
+
+        pushStateSet(transform.getStateSet());
+        _matrixStack.push_back(matrix);
+        traverse(transform);
+        _matrixStack.pop_back();
+        popStateSet(transform.getStateSet());
+    }
+
+    virtual void apply(osg::LOD& lod)
+    {
+        // only the most detailed child of an LOD contributes to the tiles.
+        unsigned int mostDetailed = lod.getNumChildren();
+        for(unsigned int i=0; i<lod.getNumChildren() && i<lod.getNumRanges(); ++i)
+        {
+            if (mostDetailed==lod.getNumChildren() || lod.getMinRange(i)<lod.getMinRange(mostDetailed)) mostDetailed = i;
+        }
+
+        pushStateSet(lod.getStateSet());
+        if (mostDetailed<lod.getNumChildren()) lod.getChild(mostDetailed)->accept(*this);
+        popStateSet(lod.getStateSet());
+    }
+
+    virtual void apply(osg::Geometry& geometry)
+    {
+        pushStateSet(geometry.getStateSet());
+        addGeometry(geometry);
+        popStateSet(geometry.getStateSet());
+    }
+
+protected:
+
+    void pushStateSet(osg::StateSet* stateset)
+    {
+        if (stateset) _stateSetPath.push_back(stateset);
+    }
+
+    void popStateSet(osg::StateSet* stateset)
+    {
+        if (stateset) _stateSetPath.pop_back();
+    }
+
+    osg::StateSet* getMergedStateSet()
+    {
+        if (_stateSetPath.empty()) return 0;
+        if (_stateSetPath.size()==1) return _stateSetPath.front();
+
+        osg::ref_ptr<osg::StateSet>& merged = _mergedStateSets[_stateSetPath];
+        if (!merged)
+        {
+            merged = new osg::StateSet(*_stateSetPath.front(), osg::CopyOp::SHALLOW_COPY);
+            for(StateSetPath::iterator itr = _stateSetPath.begin()+1; itr != _stateSetPath.end(); ++itr)
+            {
+                merged->merge(**itr);
+            }
+        }
+        return merged.get();
+    }
+
+    void addGeometry(osg::Geometry& geometry)
+    {
+        osg::ref_ptr<osg::Vec3Array> vertices = dynamic_cast<osg::Vec3Array*>(geometry.getVertexArray());
+        if (!vertices)
+        {
+            osg::Vec3dArray* vertices_d = dynamic_cast<osg::Vec3dArray*>(geometry.getVertexArray());
+            if (!vertices_d) return;
+            vertices = new osg::Vec3Array(vertices_d->begin(), vertices_d->end());
+        }
+
+        osg::Vec3Array* normals = dynamic_cast<osg::Vec3Array*>(geometry.getNormalArray());
+        if (normals && (normals->getBinding()!=osg::Array::BIND_PER_VERTEX || normals->size()!=vertices->size())) normals = 0;
+
+        osg::Vec2Array* texcoords = dynamic_cast<osg::Vec2Array*>(geometry.getTexCoordArray(0));
+        if (texcoords && texcoords->size()!=vertices->size()) texcoords = 0;
+
+        osg::Vec4Array* colors = dynamic_cast<osg::Vec4Array*>(geometry.getColorArray());
+        bool overallColor = colors && colors->getBinding()==osg::Array::BIND_OVERALL && !colors->empty();
+        if (colors && !overallColor && (colors->getBinding()!=osg::Array::BIND_PER_VERTEX || colors->size()!=vertices->size())) colors = 0;
+
+        std::vector<unsigned int> indices;
+        osg::TriangleIndexFunctor<CollectTriangleIndices> collectTriangles;
+        collectTriangles._indices = &indices;
+        geometry.accept(collectTriangles);
+
+        if (indices.empty()) return;
+
+        const osg::Matrix& matrix = _matrixStack.back();
+        osg::Matrix normalMatrix = osg::Matrix::inverse(matrix);
+
+        unsigned int batchIndex = _builder.getBatch(getMergedStateSet(), normals!=0, texcoords!=0, colors!=0);
+
+        for(std::vector<unsigned int>::iterator itr = indices.begin(); itr != indices.end(); )
+        {
+            TileBuilder::Triangle triangle;
+            triangle.batch = batchIndex;
+
+            for(unsigned int i=0; i<3; ++i, ++itr)
+            {
+                unsigned int index = *itr;
+                if (index>=vertices->size()) return;
+
+                TileBuilder::Vertex& vertex = triangle.vertices[i];
+                vertex.position = (*vertices)[index] * matrix;
+                if (normals)
+                {
+                    // transform normals by the inverse transpose.
+                    vertex.normal = osg::Matrix::transform3x3(normalMatrix, (*normals)[index]);
+                    vertex.normal.normalize();
+                }
+                else vertex.normal.set(0.0f, 0.0f, 0.0f);
+                vertex.texcoord = texcoords ? (*texcoords)[index] : osg::Vec2(0.0f, 0.0f);
+                vertex.color = colors ? (overallColor ? colors->front() : (*colors)[index]) : osg::Vec4(1.0f, 1.0f, 1.0f, 1.0f);
+            }
+
+            _triangles.push_back(triangle);
+            if (_triangles.size()>=s_chunkSize) flush();
+        }
+    }
+
+public:
+
+    /** Pass the triangles collected so far on to the TileBuilder's temporary file.*/
+    void flush()
+    {
+        if (_triangles.empty()) return;
+        _builder.addTriangles(_triangles);
+        _triangles.clear();
+    }
+
+protected:
+
+    typedef std::vector<osg::StateSet*> StateSetPath;
+    typedef std::map< StateSetPath, osg::ref_ptr<osg::StateSet> > MergedStateSets;
+
+    TileBuilder&                _builder;
+    std::vector<osg::Matrix>    _matrixStack;
+    StateSetPath                _stateSetPath;
+    MergedStateSets             _mergedStateSets;
+    TileBuilder::Triangles      _triangles;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  TileOperation partitions a cell top down into its children, or builds it once its children have been built
+//
+class TileOperation : public osg::Operation
+{
+public:
+
+    /** Counts the operations still to be run, releasing the block once all are done.*/
+    class Tracker : public osg::Referenced
+    {
+    public:
+        Tracker(osg::OperationQueue* queue):
+            _queue(queue),
+            _numPending(0),
+            _block(new osg::RefBlock) {}
+
+        void add(TileOperation* operation)
+        {
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+                ++_numPending;
+            }
+            _queue->add(operation);
+        }
+
+        void completed()
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            if (--_numPending==0) _block->release();
+        }
+
+        void waitForCompletion() { _block->block(); }
+
+    protected:
+
+        osg::ref_ptr<osg::OperationQueue>   _queue;
+        OpenThreads::Mutex                  _mutex;
+        unsigned int                        _numPending;
+        osg::ref_ptr<osg::RefBlock>         _block;
+    };
+
+    enum Type
+    {
+        PARTITION,
+        BUILD
+    };
+
+    TileOperation(TileBuilder& builder, TileBuilder::Cell* cell, Type type, Tracker* tracker):
+        osg::Operation("TileOperation", false),
+        _builder(builder),
+        _cell(cell),
+        _type(type),
+        _tracker(tracker) {}
+
+    virtual void operator () (osg::Object*)
+    {
+        if (_type==PARTITION)
+        {
+            bool result = _builder.partitionCell(*_cell);
+
+            // queue the children before completing, so the tracker doesn't run out of operations in between
+            for(std::vector<TileBuilder::Cell*>::iterator itr = _cell->children.begin(); itr != _cell->children.end(); ++itr)
+            {
+                _tracker->add(new TileOperation(_builder, *itr, PARTITION, _tracker.get()));
+            }
+
+            if (!result)
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_builder._mutex);
+                _builder._failed = true;
+            }
+
+            if (_cell->children.empty()) built();
+        }
+        else
+        {
+            if (!_builder.buildCell(*_cell))
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_builder._mutex);
+                _builder._failed = true;
+            }
+            built();
+        }
+
+        _tracker->completed();
+    }
+
+protected:
+
+    /** Build the parent of the cell once all its children are built.*/
+    void built()
+    {
+        TileBuilder::Cell* parent = _cell->parent;
+        if (!parent) return;
+
+        bool parentReady = false;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_builder._mutex);
+            parentReady = (--parent->numPendingChildren==0);
+        }
+
+        if (parentReady) _tracker->add(new TileOperation(_builder, parent, BUILD, _tracker.get()));
+    }
+
+    TileBuilder&            _builder;
+    TileBuilder::Cell*      _cell;
+    Type                    _type;
+    osg::ref_ptr<Tracker>   _tracker;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  TileBuilder
+//
+TileBuilder::TileBuilder():
+    _subdivision(QUADTREE),
+    _maximumNumTrianglesPerTile(20000),
+    _maximumLevel(16),
+    _rangeMultiplier(4.0f),
+    _numThreads(1),
+    _tileExtension(".osgb"),
+    _numTriangles(0),
+    _numTemporaryFiles(0),
+    _numTilesWritten(0),
+    _numTrianglesDropped(0),
+    _failed(false)
+{
+}
+
+TileBuilder::~TileBuilder()
+{
+    reset();
+}
+
+void TileBuilder::addModel(osg::Node& model)
+{
+    TileCollectVisitor tcv(*this);
+    model.accept(tcv);
+    tcv.flush();
+}
+
+void TileBuilder::reset()
+{
+    if (!_inputFileName.empty()) remove(_inputFileName.c_str());
+    _inputFileName.clear();
+    _numTriangles = 0;
+    _bb.init();
+
+    Batches().swap(_batches);
+    _batchMap.clear();
+}
+
+unsigned int TileBuilder::getBatch(osg::StateSet* stateset, bool normals, bool texcoords, bool colors)
+{
+    BatchKey key(stateset, (normals ? 1 : 0) | (texcoords ? 2 : 0) | (colors ? 4 : 0));
+    BatchMap::iterator itr = _batchMap.find(key);
+    if (itr!=_batchMap.end()) return itr->second;
+
+    Batch batch;
+    batch.stateset = stateset;
+    batch.normals = normals;
+    batch.texcoords = texcoords;
+    batch.colors = colors;
+
+    unsigned int index = static_cast<unsigned int>(_batches.size());
+    _batches.push_back(batch);
+    _batchMap[key] = index;
+    return index;
+}
+
+std::string TileBuilder::createTemporaryFileName()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    if (_temporaryFilePrefix.empty())
+    {
+        // distinguish the files of builders sharing the directory
+        std::ostringstream str;
+        str<<"tilebuilder_"<<std::hex<<osg::Timer::instance()->tick()<<"_"<<this<<std::dec;
+        _temporaryFilePrefix = str.str();
+    }
+
+    std::ostringstream str;
+    if (!_temporaryDirectory.empty()) str<<_temporaryDirectory<<"/";
+    str<<_temporaryFilePrefix<<"_"<<(_numTemporaryFiles++)<<".tmp";
+    return str.str();
+}
+
+void TileBuilder::addTriangles(const Triangles& triangles)
+{
+    if (_inputFileName.empty()) _inputFileName = createTemporaryFileName();
+
+    if (!appendTriangles(_inputFileName, triangles))
+    {
+        OSG_WARN<<"TileBuilder::addModel() unable to write triangles to "<<_inputFileName<<std::endl;
+        _failed = true;
+        return;
+    }
+
+    for(Triangles::const_iterator itr = triangles.begin(); itr != triangles.end(); ++itr)
+    {
+        expandBy(_bb, *itr);
+    }
+    _numTriangles += static_cast<unsigned int>(triangles.size());
+}
+
+bool TileBuilder::partitionCell(Cell& cell)
+{
+    if (cell.numTriangles<=_maximumNumTrianglesPerTile || cell.level>=_maximumLevel) return true;
+
+    unsigned int numZ = (_subdivision==OCTREE) ? 2 : 1;
+    osg::Vec3 centre = cell.bb.center();
+
+    std::vector<Cell*> children(4*numZ, static_cast<Cell*>(0));
+    std::vector<Triangles> buffers(children.size());
+    bool result = true;
+
+    // stream the triangles of the cell into the files of its children, only a chunk of each is held in memory at a time
+    {
+        std::ifstream fin(cell.fileName.c_str(), std::ios::in | std::ios::binary);
+        if (!fin) return false;
+
+        Triangles triangles;
+        while(result && readTriangles(fin, triangles, s_chunkSize))
+        {
+            for(Triangles::const_iterator itr = triangles.begin(); itr != triangles.end(); ++itr)
+            {
+                osg::Vec3 triangleCentre = itr->centre();
+                unsigned int i = (triangleCentre.x()>=centre.x() ? 1 : 0) |
+                                 (triangleCentre.y()>=centre.y() ? 2 : 0) |
+                                 ((numZ==2 && triangleCentre.z()>=centre.z()) ? 4 : 0);
+
+                Cell*& child = children[i];
+                if (!child)
+                {
+                    unsigned int dx = i&1, dy = (i>>1)&1, dz = (i>>2)&1;
+                    child = new Cell;
+                    child->parent = &cell;
+                    child->level = cell.level+1;
+                    child->x = cell.x*2+dx;
+                    child->y = cell.y*2+dy;
+                    child->z = cell.z*numZ+dz;
+                    child->fileName = createTemporaryFileName();
+                }
+
+                // the cell bounds cover the whole of their triangles, not just their centres.
+                expandBy(child->bb, *itr);
+                ++(child->numTriangles);
+
+                Triangles& buffer = buffers[i];
+                buffer.push_back(*itr);
+                if (buffer.size()>=s_chunkSize)
+                {
+                    result = appendTriangles(child->fileName, buffer) && result;
+                    buffer.clear();
+                }
+            }
+        }
+    }
+
+    for(unsigned int i=0; i<children.size(); ++i)
+    {
+        if (!children[i]) continue;
+
+        result = appendTriangles(children[i]->fileName, buffers[i]) && result;
+        cell.children.push_back(children[i]);
+    }
+
+    // the triangles now live in the children's files
+    remove(cell.fileName.c_str());
+    cell.fileName.clear();
+    cell.numTriangles = 0;
+    cell.numPendingChildren = static_cast<unsigned int>(cell.children.size());
+
+    return result;
+}
+
+bool TileBuilder::buildCell(Cell& cell)
+{
+    osg::ref_ptr<osg::Group> group = new osg::Group;
+    Triangles combined;
+    bool result = true;
+
+    for(std::vector<Cell*>::iterator itr = cell.children.begin(); itr != cell.children.end(); ++itr)
+    {
+        Cell& child = **itr;
+
+        Triangles triangles;
+        if (!readTriangleFile(child.fileName, triangles, child.numTriangles))
+        {
+            OSG_WARN<<"TileBuilder::build() unable to read the triangles of tile "<<getChildrenFileName(child)<<std::endl;
+            result = false;
+        }
+        remove(child.fileName.c_str());
+
+        group->addChild(createCellNode(child, triangles).get());
+        combined.insert(combined.end(), triangles.begin(), triangles.end());
+    }
+
+    result = result && _writeTileCallback.valid() && _writeTileCallback->writeTile(*group, getChildrenFileName(cell));
+    group = 0;
+
+    // the coarse version of the cell is simplified from the coarse versions of its children, so each level only has
+    // a bounded number of triangles to simplify per cell.
+    unsigned int numTrianglesDropped = 0;
+    if (combined.size()>_maximumNumTrianglesPerTile)
+    {
+        osg::ref_ptr<osg::Geode> geode = createTileGeometry(combined, _maximumNumTrianglesPerTile);
+        combined.clear();
+        numTrianglesDropped = collectTriangles(*geode, combined);
+    }
+
+    cell.fileName = createTemporaryFileName();
+    cell.numTriangles = static_cast<unsigned int>(combined.size());
+    result = appendTriangles(cell.fileName, combined) && result;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    if (result) ++_numTilesWritten;
+    _numTrianglesDropped += numTrianglesDropped;
+    return result;
+}
+
+std::string TileBuilder::getChildrenFileName(const Cell& cell) const
+{
+    std::ostringstream str;
+    str<<_baseName<<"_L"<<cell.level<<"_X"<<cell.x<<"_Y"<<cell.y;
+    if (_subdivision==OCTREE) str<<"_Z"<<cell.z;
+    str<<_tileExtension;
+    return str.str();
+}
+
+osg::ref_ptr<osg::Geode> TileBuilder::createTileGeometry(const Triangles& triangles, unsigned int targetNumTriangles) const
+{
+    typedef std::map<unsigned int, std::vector<const Triangle*> > BatchTriangles;
+    BatchTriangles batchTriangles;
+    for(Triangles::const_iterator itr = triangles.begin(); itr != triangles.end(); ++itr)
+    {
+        batchTriangles[itr->batch].push_back(&(*itr));
+    }
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    for(BatchTriangles::iterator bitr = batchTriangles.begin(); bitr != batchTriangles.end(); ++bitr)
+    {
+        const Batch& batch = _batches[bitr->first];
+
+        osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+        osg::ref_ptr<osg::Vec3Array> normals = batch.normals ? new osg::Vec3Array(osg::Array::BIND_PER_VERTEX) : 0;
+        osg::ref_ptr<osg::Vec2Array> texcoords = batch.texcoords ? new osg::Vec2Array(osg::Array::BIND_PER_VERTEX) : 0;
+        osg::ref_ptr<osg::Vec4Array> colors = batch.colors ? new osg::Vec4Array(osg::Array::BIND_PER_VERTEX) : 0;
+        osg::ref_ptr<osg::DrawElementsUInt> elements = new osg::DrawElementsUInt(GL_TRIANGLES);
+        elements->reserve(bitr->second.size()*3);
+
+        // share the vertices of adjoining triangles, the Simplifier collapses edges between shared vertices only
+        typedef std::map<osg::Vec3, unsigned int> VertexMap;
+        VertexMap vertexMap;
+        for(std::vector<const Triangle*>::iterator itr = bitr->second.begin(); itr != bitr->second.end(); ++itr)
+        {
+            const Triangle& triangle = **itr;
+            for(unsigned int i=0; i<3; ++i)
+            {
+                const Vertex& vertex = triangle.vertices[i];
+                unsigned int index = static_cast<unsigned int>(vertices->size());
+
+                std::pair<VertexMap::iterator, bool> inserted = vertexMap.insert(VertexMap::value_type(vertex.position, index));
+                bool shared = !inserted.second;
+                if (shared)
+                {
+                    // only share vertices whose attributes match too
+                    unsigned int existing = inserted.first->second;
+                    shared = (!normals || (*normals)[existing]==vertex.normal) &&
+                             (!texcoords || (*texcoords)[existing]==vertex.texcoord) &&
+                             (!colors || (*colors)[existing]==vertex.color);
+                    if (shared) index = existing;
+                }
+
+                if (!shared)
+                {
+                    vertices->push_back(vertex.position);
+                    if (normals.valid()) normals->push_back(vertex.normal);
+                    if (texcoords.valid()) texcoords->push_back(vertex.texcoord);
+                    if (colors.valid()) colors->push_back(vertex.color);
+                }
+                elements->push_back(index);
+            }
+        }
+
+        osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+        geometry->setStateSet(batch.stateset.get());
+        geometry->setVertexArray(vertices.get());
+        if (normals.valid()) geometry->setNormalArray(normals.get());
+        if (texcoords.valid()) geometry->setTexCoordArray(0, texcoords.get());
+        if (colors.valid()) geometry->setColorArray(colors.get());
+        geometry->addPrimitiveSet(elements.get());
+        geode->addDrawable(geometry.get());
+    }
+
+    if (targetNumTriangles>0 && triangles.size()>targetNumTriangles)
+    {
+        osgUtil::Simplifier simplifier(static_cast<double>(targetNumTriangles)/static_cast<double>(triangles.size()));
+        geode->accept(simplifier);
+    }
+
+    return geode;
+}
+
+unsigned int TileBuilder::collectTriangles(const osg::Geode& geode, Triangles& triangles) const
+{
+    unsigned int numTrianglesDropped = 0;
+    for(unsigned int i=0; i<geode.getNumDrawables(); ++i)
+    {
+        const osg::Geometry* geometry = geode.getDrawable(i)->asGeometry();
+        const osg::Vec3Array* vertices = geometry ? dynamic_cast<const osg::Vec3Array*>(geometry->getVertexArray()) : 0;
+        if (!vertices) continue;
+
+        const osg::Vec3Array* normals = dynamic_cast<const osg::Vec3Array*>(geometry->getNormalArray());
+        const osg::Vec2Array* texcoords = dynamic_cast<const osg::Vec2Array*>(geometry->getTexCoordArray(0));
+        const osg::Vec4Array* colors = dynamic_cast<const osg::Vec4Array*>(geometry->getColorArray());
+
+        // the geometry was created by createTileGeometry() for the batch matching its StateSet and vertex attributes
+        BatchKey key(const_cast<osg::StateSet*>(geometry->getStateSet()), (normals ? 1 : 0) | (texcoords ? 2 : 0) | (colors ? 4 : 0));
+        BatchMap::const_iterator bitr = _batchMap.find(key);
+
+        std::vector<unsigned int> indices;
+        osg::TriangleIndexFunctor<CollectTriangleIndices> collect;
+        collect._indices = &indices;
+        const_cast<osg::Geometry*>(geometry)->accept(collect);
+
+        if (bitr==_batchMap.end())
+        {
+            // batches can't be added here as other threads read them, the geometry's vertex attributes must have been changed.
+            OSG_WARN<<"Warning: TileBuilder::collectTriangles() no batch matches the vertex attributes of a geometry, "<<indices.size()/3<<" triangles dropped."<<std::endl;
+            numTrianglesDropped += static_cast<unsigned int>(indices.size()/3);
+            continue;
+        }
+
+        for(std::vector<unsigned int>::iterator itr = indices.begin(); itr+2 < indices.end(); itr += 3)
+        {
+            Triangle triangle;
+            triangle.batch = bitr->second;
+            for(unsigned int v=0; v<3; ++v)
+            {
+                unsigned int index = *(itr+v);
+                Vertex& vertex = triangle.vertices[v];
+                vertex.position = (*vertices)[index];
+                vertex.normal = (normals && index<normals->size()) ? (*normals)[index] : osg::Vec3(0.0f, 0.0f, 0.0f);
+                vertex.texcoord = (texcoords && index<texcoords->size()) ? (*texcoords)[index] : osg::Vec2(0.0f, 0.0f);
+                vertex.color = (colors && index<colors->size()) ? (*colors)[index] : osg::Vec4(1.0f, 1.0f, 1.0f, 1.0f);
+            }
+            triangles.push_back(triangle);
+        }
+    }
+
+    return numTrianglesDropped;
+}
+
+osg::ref_ptr<osg::Node> TileBuilder::createCellNode(const Cell& cell, const Triangles& triangles) const
+{
+    // a leaf's triangles are all of its triangles, otherwise they are the coarse version of the cell
+    osg::ref_ptr<osg::Geode> geode = createTileGeometry(triangles, 0);
+    if (cell.children.empty()) return geode;
+
+    float radius = cell.bb.radius();
+    float cutOffDistance = radius*_rangeMultiplier;
+
+    // the coarse version of the cell is shown from a distance, its children are paged in from their own file when close to.
+    std::string childrenFileName = getChildrenFileName(cell);
+
+    osg::ref_ptr<osg::PagedLOD> plod = new osg::PagedLOD;
+    plod->setCenterMode(osg::LOD::USER_DEFINED_CENTER);
+    plod->setCenter(cell.bb.center());
+    plod->setRadius(radius);
+    plod->addChild(geode.get(), cutOffDistance, FLT_MAX);
+    plod->setFileName(1, childrenFileName.substr(_directory.size()));
+    plod->setRange(1, 0.0f, cutOffDistance);
+    return plod;
+}
+
+osg::ref_ptr<osg::Node> TileBuilder::build(const std::string& rootFileName)
+{
+    if (!_writeTileCallback)
+    {
+        OSG_NOTICE<<"TileBuilder::build("<<rootFileName<<") failed, no WriteTileCallback assigned."<<std::endl;
+        return 0;
+    }
+
+    if (_numTriangles==0)
+    {
+        OSG_NOTICE<<"TileBuilder::build("<<rootFileName<<") failed, no triangles to tile."<<std::endl;
+        return 0;
+    }
+
+    if (_failed)
+    {
+        OSG_NOTICE<<"TileBuilder::build("<<rootFileName<<") failed, unable to store the triangles to tile."<<std::endl;
+        reset();
+        _failed = false;
+        return 0;
+    }
+
+    std::string::size_type slash = rootFileName.find_last_of("/\\");
+    std::string::size_type dot = rootFileName.find_last_of('.');
+    _directory = (slash==std::string::npos) ? std::string() : rootFileName.substr(0, slash+1);
+    _baseName = (dot==std::string::npos || (slash!=std::string::npos && dot<slash)) ? rootFileName : rootFileName.substr(0, dot);
+    _numTilesWritten = 0;
+    _numTrianglesDropped = 0;
+
+    // the root cell takes over the file of the triangles added
+    Cell* root = new Cell;
+    root->fileName = _inputFileName;
+    root->numTriangles = _numTriangles;
+    root->bb = _bb;
+    _inputFileName.clear();
+
+    osg::ref_ptr<osg::OperationQueue> operationQueue = new osg::OperationQueue;
+    osg::ref_ptr<TileOperation::Tracker> tracker = new TileOperation::Tracker(operationQueue.get());
+    tracker->add(new TileOperation(*this, root, TileOperation::PARTITION, tracker.get()));
+
+    typedef std::vector< osg::ref_ptr<osg::OperationThread> > OperationThreads;
+    OperationThreads threads;
+    for(unsigned int i=0; i<std::max(_numThreads, 1u); ++i)
+    {
+        threads.push_back(new osg::OperationThread);
+        threads.back()->setOperationQueue(operationQueue.get());
+        threads.back()->startThread();
+    }
+
+    tracker->waitForCompletion();
+
+    for(OperationThreads::iterator itr = threads.begin(); itr != threads.end(); ++itr)
+    {
+        (*itr)->cancel();
+    }
+
+    osg::ref_ptr<osg::Node> rootNode;
+    if (!_failed)
+    {
+        Triangles triangles;
+        if (readTriangleFile(root->fileName, triangles, root->numTriangles)) rootNode = createCellNode(*root, triangles);
+    }
+
+    // remove the cells along with any temporary file left behind by a failure
+    std::vector<Cell*> cells(1, root);
+    while(!cells.empty())
+    {
+        Cell* cell = cells.back();
+        cells.pop_back();
+        cells.insert(cells.end(), cell->children.begin(), cell->children.end());
+
+        if (!cell->fileName.empty()) remove(cell->fileName.c_str());
+        delete cell;
+    }
+
+    OSG_INFO<<"TileBuilder::build("<<rootFileName<<") wrote "<<_numTilesWritten<<" tiles."<<std::endl;
+    if (_numTrianglesDropped>0) OSG_WARN<<"Warning: TileBuilder::build("<<rootFileName<<") dropped "<<_numTrianglesDropped<<" triangles from coarse tiles."<<std::endl;
+
+    bool failed = _failed;
+    reset();
+    _failed = false;
+
+    return failed ? 0 : rootNode;
+}
+
+}
@@ -0,0 +1,401 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgUtil/VertexAttributeCompressionVisitor>
+
+#include <osg/KdTree>
+#include <osg/Notify>
+#include <osg/io_utils>
+
+using namespace osgUtil;
+
+namespace
+{
+    inline short quantizeSNorm16(float v)
+    {
+        return static_cast<short>(floorf(osg::clampBetween(v, -1.0f, 1.0f)*32767.0f + 0.5f));
+    }
+
+    inline float dequantizeSNorm16(short v)
+    {
+        return osg::maximum(static_cast<float>(v)/32767.0f, -1.0f);
+    }
+
+    inline unsigned short quantizeUNorm16(float v)
+    {
+        return static_cast<unsigned short>(floorf(osg::clampBetween(v, 0.0f, 1.0f)*65535.0f + 0.5f));
+    }
+
+    inline float dequantizeUNorm16(unsigned short v)
+    {
+        return static_cast<float>(v)/65535.0f;
+    }
+
+    inline double angleInDegrees(const osg::Vec3& lhs, const osg::Vec3& rhs)
+    {
+        // atan2 rather than acos so that small angles are resolved accurately.
+        osg::Vec3d a(lhs), b(rhs);
+        return osg::RadiansToDegrees(atan2((a^b).length(), a*b));
+    }
+
+    inline osg::Vec3 normalized(const osg::Vec3& v)
+    {
+        osg::Vec3 n(v);
+        n.normalize();
+        return n;
+    }
+}
+
+VertexAttributeCompressionVisitor::VertexAttributeCompressionVisitor(unsigned int options):
+    osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+    _options(options),
+    _vertexTolerance(1e-4),
+    _normalTolerance(0.1),
+    _texCoordTolerance(1e-4)
+{
+}
+
+void VertexAttributeCompressionVisitor::reset()
+{
+    _quantizedVertices.clear();
+    _quantizedNormals.clear();
+    _quantizedTexCoords.clear();
+    _processed.clear();
+
+    _vertexStats = AttributeStats();
+    _normalStats = AttributeStats();
+    _texCoordStats = AttributeStats();
+}
+
+void VertexAttributeCompressionVisitor::report(std::ostream& out) const
+{
+    struct Line
+    {
+        static void write(std::ostream& out, const char* name, const AttributeStats& stats)
+        {
+            out<<"    "<<name<<": "<<stats.numArraysCompressed<<" arrays compressed, "<<stats.numArraysRejected<<" rejected, "
+               <<stats.originalSize<<" -> "<<stats.compressedSize<<" bytes, max error "<<stats.maxError<<std::endl;
+        }
+    };
+
+    out<<"VertexAttributeCompressionVisitor"<<std::endl;
+    Line::write(out, "vertices", _vertexStats);
+    Line::write(out, "normals (degrees)", _normalStats);
+    Line::write(out, "texcoords", _texCoordStats);
+}
+
+osg::Vec2 VertexAttributeCompressionVisitor::encodeOctahedral(const osg::Vec3& normal)
+{
+    float l1 = fabsf(normal.x()) + fabsf(normal.y()) + fabsf(normal.z());
+    if (l1==0.0f) return osg::Vec2(0.0f, 0.0f);
+
+    osg::Vec2 e(normal.x()/l1, normal.y()/l1);
+    if (normal.z()<0.0f)
+    {
+        e.set((1.0f - fabsf(e.y())) * (e.x()>=0.0f ? 1.0f : -1.0f),
+              (1.0f - fabsf(e.x())) * (e.y()>=0.0f ? 1.0f : -1.0f));
+    }
+    return e;
+}
+
+osg::Vec3 VertexAttributeCompressionVisitor::decodeOctahedral(const osg::Vec2& e)
+{
+    osg::Vec3 n(e.x(), e.y(), 1.0f - fabsf(e.x()) - fabsf(e.y()));
+    if (n.z()<0.0f)
+    {
+        n.set((1.0f - fabsf(e.y())) * (e.x()>=0.0f ? 1.0f : -1.0f),
+              (1.0f - fabsf(e.x())) * (e.y()>=0.0f ? 1.0f : -1.0f),
+              n.z());
+    }
+    n.normalize();
+    return n;
+}
+
+void VertexAttributeCompressionVisitor::apply(osg::Geode& geode)
+{
+    if (!_processed.insert(&geode).second) return;
+
+    traverse(geode);
+
+    if ((_options & COMPRESS_VERTICES)==0) return;
+
+    // Geode can only have Drawable children, so the vertices of all its Geometry are quantized together.
+    GeometryList geometries;
+    for(unsigned int i=0; i<geode.getNumDrawables(); ++i)
+    {
+        osg::Geometry* geometry = geode.getDrawable(i)->asGeometry();
+        if (!geometry || geometry->getDataVariance()==osg::Object::DYNAMIC || geometry->getNumParents()!=1) return;
+        geometries.push_back(geometry);
+    }
+
+    compressVertices(geode, geometries);
+}
+
+void VertexAttributeCompressionVisitor::apply(osg::Geometry& geometry)
+{
+    if (geometry.getDataVariance()==osg::Object::DYNAMIC) return;
+
+    if (!_processed.insert(&geometry).second) return;
+
+    if (_options & COMPRESS_NORMALS) compressNormals(geometry);
+    if (_options & COMPRESS_TEX_COORDS) compressTexCoords(geometry);
+
+    if (_options & COMPRESS_VERTICES)
+    {
+        for(unsigned int i=0; i<geometry.getNumParents(); ++i)
+        {
+            if (geometry.getParent(i)->asGeode()) return;
+        }
+
+        compressVertices(geometry, GeometryList(1, &geometry));
+    }
+}
+
+void VertexAttributeCompressionVisitor::compressVertices(osg::Node& node, const GeometryList& geometries)
+{
+    // the restoring transform is inserted between the node and its parents.
+    if (geometries.empty() || node.getNumParents()==0) return;
+
+    osg::BoundingBox bb;
+    for(GeometryList::const_iterator gitr = geometries.begin(); gitr != geometries.end(); ++gitr)
+    {
+        const osg::Vec3Array* vertices = dynamic_cast<const osg::Vec3Array*>((*gitr)->getVertexArray());
+        if (!vertices || vertices->empty()) return;
+
+        for(osg::Vec3Array::const_iterator vitr = vertices->begin(); vitr != vertices->end(); ++vitr)
+        {
+            bb.expandBy(*vitr);
+        }
+    }
+
+    // a uniform scale keeps the normals' directions, so that GL_RESCALE_NORMAL is sufficient to restore them.
+    osg::Vec3 center = bb.center();
+    float extent = osg::maximum(bb.xMax()-bb.xMin(), osg::maximum(bb.yMax()-bb.yMin(), bb.zMax()-bb.zMin()));
+    float scale = extent>0.0f ? extent/65534.0f : 1.0f;
+    osg::Matrix matrix = osg::Matrix::scale(scale, scale, scale) * osg::Matrix::translate(center);
+
+    // arrays shared with Geometry already quantized in a different frame can't be used.
+    for(GeometryList::const_iterator gitr = geometries.begin(); gitr != geometries.end(); ++gitr)
+    {
+        QuantizedArrayMap::iterator itr = _quantizedVertices.find((*gitr)->getVertexArray());
+        if (itr!=_quantizedVertices.end() && (!itr->second.array || itr->second.matrix!=matrix)) return;
+    }
+
+    double maxError = 0.0;
+    unsigned int originalSize = 0;
+    unsigned int compressedSize = 0;
+    std::vector< osg::ref_ptr<osg::Vec3sArray> > quantizedArrays;
+    std::set<const osg::Array*> arraysToQuantize;
+    for(GeometryList::const_iterator gitr = geometries.begin(); gitr != geometries.end(); ++gitr)
+    {
+        const osg::Vec3Array* vertices = static_cast<const osg::Vec3Array*>((*gitr)->getVertexArray());
+        if (_quantizedVertices.count(vertices)!=0 || !arraysToQuantize.insert(vertices).second)
+        {
+            quantizedArrays.push_back(0);
+            continue;
+        }
+
+        osg::ref_ptr<osg::Vec3sArray> quantized = new osg::Vec3sArray(vertices->size());
+        quantized->setBinding(vertices->getBinding());
+        quantized->setName(vertices->getName());
+
+        for(unsigned int i=0; i<vertices->size(); ++i)
+        {
+            const osg::Vec3& v = (*vertices)[i];
+            osg::Vec3s& q = (*quantized)[i];
+            for(unsigned int c=0; c<3; ++c)
+            {
+                float value = floorf((v[c]-center[c])/scale + 0.5f);
+                q[c] = static_cast<short>(osg::clampBetween(value, -32767.0f, 32767.0f));
+            }
+
+            osg::Vec3 decoded = center + osg::Vec3(q.x(), q.y(), q.z())*scale;
+            maxError = osg::maximum(maxError, static_cast<double>((decoded-v).length()));
+        }
+
+        originalSize += vertices->getTotalDataSize();
+        compressedSize += quantized->getTotalDataSize();
+        quantizedArrays.push_back(quantized);
+    }
+
+    if (maxError > _vertexTolerance*bb.radius())
+    {
+        OSG_INFO<<"VertexAttributeCompressionVisitor: vertex error "<<maxError<<" exceeds tolerance, leaving vertices of "<<node.getName()<<" as floats."<<std::endl;
+        _vertexStats.numArraysRejected += geometries.size();
+        return;
+    }
+
+    for(unsigned int i=0; i<geometries.size(); ++i)
+    {
+        osg::Geometry* geometry = geometries[i];
+        const osg::Array* vertices = geometry->getVertexArray();
+        if (quantizedArrays[i].valid())
+        {
+            QuantizedArray& qa = _quantizedVertices[vertices];
+            qa.source = vertices;
+            qa.array = quantizedArrays[i].get();
+            qa.matrix = matrix;
+            ++_vertexStats.numArraysCompressed;
+        }
+
+        geometry->setVertexArray(_quantizedVertices[vertices].array.get());
+
+        // a KdTree would hold the floating point vertices, which are no longer in the Geometry's coordinate frame.
+        if (dynamic_cast<osg::KdTree*>(geometry->getShape())) geometry->setShape(0);
+
+        geometry->dirtyBound();
+    }
+
+    _vertexStats.originalSize += originalSize;
+    _vertexStats.compressedSize += compressedSize;
+    _vertexStats.maxError = osg::maximum(_vertexStats.maxError, maxError);
+
+    osg::ref_ptr<osg::Node> node_ref = &node;
+
+    osg::ref_ptr<osg::MatrixTransform> transform = new osg::MatrixTransform(matrix);
+    transform->setName(node.getName());
+    transform->getOrCreateStateSet()->setMode(GL_RESCALE_NORMAL, osg::StateAttribute::ON);
+
+    osg::Node::ParentList parents = node.getParents();
+    for(osg::Node::ParentList::iterator pitr = parents.begin(); pitr != parents.end(); ++pitr)
+    {
+        (*pitr)->replaceChild(&node, transform.get());
+    }
+    transform->addChild(&node);
+}
+
+void VertexAttributeCompressionVisitor::compressNormals(osg::Geometry& geometry)
+{
+    osg::Vec3Array* normals = dynamic_cast<osg::Vec3Array*>(geometry.getNormalArray());
+    if (!normals || normals->empty()) return;
+
+    bool octahedral = (_options & OCTAHEDRAL_NORMALS)!=0;
+
+    QuantizedArrayMap::iterator itr = _quantizedNormals.find(normals);
+    if (itr==_quantizedNormals.end())
+    {
+        osg::ref_ptr<osg::Array> quantized;
+        double maxError = 0.0;
+
+        if (octahedral)
+        {
+            osg::ref_ptr<osg::Vec2sArray> encoded = new osg::Vec2sArray(normals->size());
+            for(unsigned int i=0; i<normals->size(); ++i)
+            {
+                osg::Vec3 n = normalized((*normals)[i]);
+                osg::Vec2 e = encodeOctahedral(n);
+                osg::Vec2s& q = (*encoded)[i];
+                q.set(quantizeSNorm16(e.x()), quantizeSNorm16(e.y()));
+
+                osg::Vec3 decoded = decodeOctahedral(osg::Vec2(dequantizeSNorm16(q.x()), dequantizeSNorm16(q.y())));
+                maxError = osg::maximum(maxError, angleInDegrees(n, decoded));
+            }
+            quantized = encoded.get();
+        }
+        else
+        {
+            osg::ref_ptr<osg::Vec3sArray> encoded = new osg::Vec3sArray(normals->size());
+            for(unsigned int i=0; i<normals->size(); ++i)
+            {
+                osg::Vec3 n = normalized((*normals)[i]);
+                osg::Vec3s& q = (*encoded)[i];
+                q.set(quantizeSNorm16(n.x()), quantizeSNorm16(n.y()), quantizeSNorm16(n.z()));
+
+                osg::Vec3 decoded = normalized(osg::Vec3(dequantizeSNorm16(q.x()), dequantizeSNorm16(q.y()), dequantizeSNorm16(q.z())));
+                maxError = osg::maximum(maxError, angleInDegrees(n, decoded));
+            }
+            quantized = encoded.get();
+        }
+
+        if (maxError > _normalTolerance)
+        {
+            OSG_INFO<<"VertexAttributeCompressionVisitor: normal error "<<maxError<<" degrees exceeds tolerance, leaving normals as floats."<<std::endl;
+            ++_normalStats.numArraysRejected;
+            quantized = 0;
+        }
+        else
+        {
+            quantized->setBinding(normals->getBinding());
+            quantized->setNormalize(true);
+            quantized->setName(normals->getName());
+
+            ++_normalStats.numArraysCompressed;
+            _normalStats.originalSize += normals->getTotalDataSize();
+            _normalStats.compressedSize += quantized->getTotalDataSize();
+            _normalStats.maxError = osg::maximum(_normalStats.maxError, maxError);
+        }
+
+        QuantizedArray& qa = _quantizedNormals[normals];
+        qa.source = normals;
+        qa.array = quantized;
+        itr = _quantizedNormals.find(normals);
+    }
+
+    if (!itr->second.array) return;
+
+    geometry.setNormalArray(itr->second.array.get());
+
+    if (octahedral) geometry.getOrCreateStateSet()->setDefine("OSG_OCTAHEDRAL_NORMALS");
+}
+
+void VertexAttributeCompressionVisitor::compressTexCoords(osg::Geometry& geometry)
+{
+    for(unsigned int unit=0; unit<geometry.getNumTexCoordArrays(); ++unit)
+    {
+        osg::Vec2Array* texcoords = dynamic_cast<osg::Vec2Array*>(geometry.getTexCoordArray(unit));
+        if (!texcoords || texcoords->empty()) continue;
+
+        QuantizedArrayMap::iterator itr = _quantizedTexCoords.find(texcoords);
+        if (itr==_quantizedTexCoords.end())
+        {
+            osg::ref_ptr<osg::Vec2usArray> quantized = new osg::Vec2usArray(texcoords->size());
+
+            // coordinates outside of [0,1] are clamped, so their error is included in the maximum error.
+            double maxError = 0.0;
+            for(unsigned int i=0; i<texcoords->size(); ++i)
+            {
+                const osg::Vec2& tc = (*texcoords)[i];
+                osg::Vec2us& q = (*quantized)[i];
+                q.set(quantizeUNorm16(tc.x()), quantizeUNorm16(tc.y()));
+
+                maxError = osg::maximum(maxError, static_cast<double>(fabsf(dequantizeUNorm16(q.x())-tc.x())));
+                maxError = osg::maximum(maxError, static_cast<double>(fabsf(dequantizeUNorm16(q.y())-tc.y())));
+            }
+
+            if (maxError > _texCoordTolerance)
+            {
+                OSG_INFO<<"VertexAttributeCompressionVisitor: texcoord error "<<maxError<<" exceeds tolerance, leaving texcoords as floats."<<std::endl;
+                ++_texCoordStats.numArraysRejected;
+                quantized = 0;
+            }
+            else
+            {
+                quantized->setBinding(texcoords->getBinding());
+                quantized->setNormalize(true);
+                quantized->setName(texcoords->getName());
+
+                ++_texCoordStats.numArraysCompressed;
+                _texCoordStats.originalSize += texcoords->getTotalDataSize();
+                _texCoordStats.compressedSize += quantized->getTotalDataSize();
+                _texCoordStats.maxError = osg::maximum(_texCoordStats.maxError, maxError);
+            }
+
+            QuantizedArray& qa = _quantizedTexCoords[texcoords];
+            qa.source = texcoords;
+            qa.array = quantized.get();
+            itr = _quantizedTexCoords.find(texcoords);
+        }
+
+        if (itr->second.array.valid()) geometry.setTexCoordArray(unit, itr->second.array.get());
+    }
+}
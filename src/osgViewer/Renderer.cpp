@@ -13,11 +13,14 @@
 
 #include <stdio.h>
 
+#include <osg/ContextData>
 #include <osg/GLExtensions>
+#include <osg/Profiler>
 #include <OpenThreads/ReentrantMutex>
 
 #include <osgUtil/Optimizer>
 #include <osgUtil/GLObjectsVisitor>
+#include <osgUtil/RenderLeafInstancer>
 #include <osgUtil/Statistics>
 
 #include <osgViewer/Renderer>
@@ -781,6 +784,11 @@ void Renderer::draw()
             _querySupport->beginQuery(frameNumber, state);
         }
 
+        state->resetStateAttributeCounts();
+
+        osgUtil::RenderLeafInstancer* instancer = osg::get<osgUtil::RenderLeafInstancer>(state->getContextID());
+        instancer->resetStats();
+
         osg::Timer_t beforeDrawTick;
 
 
@@ -816,6 +824,18 @@ void Renderer::draw()
             stats->setAttribute(frameNumber, "Draw traversal begin time", osg::Timer::instance()->delta_s(_startTick, beforeDrawTick));
             stats->setAttribute(frameNumber, "Draw traversal end time", osg::Timer::instance()->delta_s(_startTick, afterDrawTick));
             stats->setAttribute(frameNumber, "Draw traversal time taken", osg::Timer::instance()->delta_s(beforeDrawTick, afterDrawTick));
+            stats->setAttribute(frameNumber, "State attributes applied", static_cast<double>(state->getNumStateAttributesApplied()));
+            stats->setAttribute(frameNumber, "State attributes skipped", static_cast<double>(state->getNumStateAttributesSkipped()));
+            stats->setAttribute(frameNumber, "Instanced draws", static_cast<double>(instancer->getNumInstancedDraws()));
+            stats->setAttribute(frameNumber, "Instances drawn", static_cast<double>(instancer->getNumInstances()));
+        }
+
+        // read back the profiled frames whose GPU timer queries have completed.
+        osg::Profiler* profiler = state->getProfiler();
+        if (profiler && profiler->getEnabled())
+        {
+            profiler->collectFrames(*state);
+            if (stats && stats->collectStats("rendering")) profiler->reportStats(stats);
         }
 
         sceneView->clearReferencesToDependentCameras();
@@ -891,6 +911,11 @@ void Renderer::cull_draw()
         _querySupport->beginQuery(frameNumber, state);
     }
 
+    state->resetStateAttributeCounts();
+
+    osgUtil::RenderLeafInstancer* instancer = osg::get<osgUtil::RenderLeafInstancer>(state->getContextID());
+    instancer->resetStats();
+
     osg::Timer_t beforeDrawTick;
 
     if (_serializeDraw)
@@ -925,6 +950,18 @@ void Renderer::cull_draw()
         stats->setAttribute(frameNumber, "Draw traversal begin time", osg::Timer::instance()->delta_s(_startTick, beforeDrawTick));
         stats->setAttribute(frameNumber, "Draw traversal end time", osg::Timer::instance()->delta_s(_startTick, afterDrawTick));
         stats->setAttribute(frameNumber, "Draw traversal time taken", osg::Timer::instance()->delta_s(beforeDrawTick, afterDrawTick));
+        stats->setAttribute(frameNumber, "State attributes applied", static_cast<double>(state->getNumStateAttributesApplied()));
+        stats->setAttribute(frameNumber, "State attributes skipped", static_cast<double>(state->getNumStateAttributesSkipped()));
+        stats->setAttribute(frameNumber, "Instanced draws", static_cast<double>(instancer->getNumInstancedDraws()));
+        stats->setAttribute(frameNumber, "Instances drawn", static_cast<double>(instancer->getNumInstances()));
+    }
+
+    // read back the profiled frames whose GPU timer queries have completed.
+    osg::Profiler* profiler = state->getProfiler();
+    if (profiler && profiler->getEnabled())
+    {
+        profiler->collectFrames(*state);
+        if (stats && stats->collectStats("rendering")) profiler->reportStats(stats);
     }
 
     DEBUG_MESSAGE<<"end cull_draw() "<<this<<std::endl;
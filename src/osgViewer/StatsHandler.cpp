@@ -24,6 +24,10 @@
 
 #include <osg/PolygonMode>
 #include <osg/Geometry>
+#include <osg/Profiler>
+#include <osg/os_utils>
+
+#include <osgDB/fstream>
 
 namespace osgViewer
 {
@@ -100,6 +104,7 @@ StatsHandler::StatsHandler():
     _viewerChildNum(0),
     _cameraSceneChildNum(0),
     _viewerSceneChildNum(0),
+    _profilerChildNum(0),
     _numBlocks(8),
     _blockMultiplier(10000.0),
     _statsWidth(1280.0f),
@@ -112,6 +117,8 @@ StatsHandler::StatsHandler():
 {
     OSG_INFO<<"StatsHandler::StatsHandler()"<<std::endl;
 
+    osg::getEnvVar("OSG_PROFILER_TRACE_FILE", _profilerTraceFileName);
+
     _camera = new osg::Camera;
     _camera->getOrCreateStateSet()->setGlobalDefaults();
     _camera->setRenderer(new Renderer(_camera.get()));
@@ -209,6 +216,8 @@ bool StatsHandler::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdap
 
                             viewer->getViewerStats()->collectStats("scene",false);
 
+                            if (!osg::Profiler::getDefaultEnabled()) setProfilersEnabled(viewer, false);
+
                             _camera->setNodeMask(0x0);
                             _switch->setAllChildrenOff();
                             break;
@@ -279,6 +288,15 @@ bool StatsHandler::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdap
 
                             break;
                         }
+                        case(PROFILER_STATS):
+                        {
+                            _camera->setNodeMask(0xffffffff);
+                            _switch->setValue(_profilerChildNum, true);
+
+                            setProfilersEnabled(viewer, true);
+
+                            break;
+                        }
                         default:
                             break;
                     }
@@ -326,6 +344,7 @@ bool StatsHandler::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdap
                         OSG_NOTICE<<std::endl;
                     }
 
+                    writeProfilerTrace(viewer);
                 }
                 return true;
             }
@@ -355,6 +374,47 @@ void StatsHandler::updateThreadingModelText()
     }
 }
 
+void StatsHandler::setProfilersEnabled(osgViewer::ViewerBase* viewer, bool enabled)
+{
+    osgViewer::ViewerBase::Contexts contexts;
+    viewer->getContexts(contexts);
+    for(osgViewer::ViewerBase::Contexts::iterator gcitr = contexts.begin();
+        gcitr != contexts.end();
+        ++gcitr)
+    {
+        osg::State* state = (*gcitr)->getState();
+        if (state && state->getProfiler()) state->getProfiler()->setEnabled(enabled);
+    }
+}
+
+void StatsHandler::writeProfilerTrace(osgViewer::ViewerBase* viewer)
+{
+    if (_profilerTraceFileName.empty()) return;
+
+    osgDB::ofstream fout(_profilerTraceFileName.c_str());
+    if (!fout)
+    {
+        OSG_NOTICE<<"Could not open profiler trace file "<<_profilerTraceFileName<<std::endl;
+        return;
+    }
+
+    // write the frames of each graphics context as a separate process.
+    fout<<"{\"traceEvents\":[\n";
+
+    bool first = true;
+    osgViewer::ViewerBase::Contexts contexts;
+    viewer->getContexts(contexts);
+    for(unsigned int i=0; i<contexts.size(); ++i)
+    {
+        osg::State* state = contexts[i]->getState();
+        if (state && state->getProfiler()) state->getProfiler()->writeChromeTraceEvents(fout, i, first);
+    }
+
+    fout<<"\n],\"displayTimeUnit\":\"ms\"}"<<std::endl;
+
+    OSG_NOTICE<<"Written profiler trace to "<<_profilerTraceFileName<<std::endl;
+}
+
 void StatsHandler::reset()
 {
     _initialized = false;
@@ -630,6 +690,65 @@ struct CameraSceneStatsTextDrawCallback : public virtual osg::Drawable::DrawCall
     int                             _cameraNumber;
 };
 
+struct ProfilerTextDrawCallback : public virtual osg::Drawable::DrawCallback
+{
+    ProfilerTextDrawCallback(osg::Camera* camera, int cameraNumber):
+        _camera(camera),
+        _tickLastUpdated(0),
+        _cameraNumber(cameraNumber)
+    {
+    }
+
+    /** do customized draw code.*/
+    virtual void drawImplementation(osg::RenderInfo& renderInfo,const osg::Drawable* drawable) const
+    {
+        if (!_camera) return;
+
+        osgText::Text* text = (osgText::Text*)drawable;
+
+        osg::Timer_t tick = osg::Timer::instance()->tick();
+        double delta = osg::Timer::instance()->delta_m(_tickLastUpdated, tick);
+
+        if (delta > 100) // update every 100ms
+        {
+            _tickLastUpdated = tick;
+
+            osg::GraphicsContext* gc = _camera->getGraphicsContext();
+            osg::Profiler* profiler = (gc && gc->getState()) ? gc->getState()->getProfiler() : 0;
+
+            osg::Profiler::Frame frame;
+            if (profiler && profiler->getLatestCompletedFrame(frame))
+            {
+                std::ostringstream viewStr;
+                viewStr.setf(std::ios::fixed);
+                viewStr.precision(2);
+
+                viewStr << "#" << _cameraNumber << " frame " << frame.frameNumber << std::endl;
+                viewStr << "           CPU ms   GPU ms" << std::endl;
+
+                for(osg::Profiler::Scopes::const_iterator itr = frame.scopes.begin(); itr != frame.scopes.end(); ++itr)
+                {
+                    viewStr << std::setw(8) << itr->cpuDuration()*1000.0 << " ";
+                    if (itr->gpuValid) viewStr << std::setw(8) << itr->gpuDuration()*1000.0;
+                    else viewStr << std::setw(8) << ".";
+                    viewStr << "  " << std::string(itr->depth*2, ' ') << itr->name << std::endl;
+                }
+
+                text->setText(viewStr.str());
+            }
+            else
+            {
+                text->setText("No profiled frames");
+            }
+        }
+        text->drawImplementation(renderInfo);
+    }
+
+    osg::observer_ptr<osg::Camera>  _camera;
+    mutable osg::Timer_t            _tickLastUpdated;
+    int                             _cameraNumber;
+};
+
 
 struct ViewSceneStatsTextDrawCallback : public virtual osg::Drawable::DrawCallback
 {
@@ -1586,8 +1705,10 @@ void StatsHandler::setUpScene(osgViewer::ViewerBase* viewer)
     }
 
     // Camera scene stats
+    osg::Vec3 profilerPos;
     {
         pos.y() -= (_characterSize + backgroundSpacing + 2 * backgroundMargin);
+        profilerPos = pos;
 
         osg::Group* group = new osg::Group;
         _cameraSceneChildNum = _switch->getNumChildren();
@@ -1740,6 +1861,42 @@ void StatsHandler::setUpScene(osgViewer::ViewerBase* viewer)
             viewCounter++;
         }
     }
+
+    // Profiler stats, the scopes of the latest profiled frame of each camera's graphics context
+    {
+        pos = profilerPos;
+
+        osg::Group* group = new osg::Group;
+        _profilerChildNum = _switch->getNumChildren();
+        _switch->addChild(group, false);
+
+        osg::Geode* geode = new osg::Geode();
+        geode->setCullingActive(false);
+        group->addChild(geode);
+
+        int cameraCounter = 0;
+        for(ViewerBase::Cameras::iterator citr = cameras.begin(); citr != cameras.end(); ++citr)
+        {
+            geode->addDrawable(createBackgroundRectangle(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0),
+                                                            20 * _characterSize + 2 * backgroundMargin,
+                                                            24 * _characterSize + 2 * backgroundMargin,
+                                                            backgroundColor));
+
+            osg::ref_ptr<osgText::Text> profilerText = new osgText::Text;
+            geode->addDrawable( profilerText.get() );
+
+            profilerText->setColor(dynamicTextColor);
+            profilerText->setFont(_font);
+            profilerText->setCharacterSize(_characterSize);
+            profilerText->setPosition(pos);
+            profilerText->setText("");
+            profilerText->setDataVariance(osg::Object::DYNAMIC);
+            profilerText->setDrawCallback(new ProfilerTextDrawCallback(*citr, cameraCounter));
+
+            pos.x() += 20 * _characterSize + 2 * backgroundMargin + backgroundSpacing;
+            cameraCounter++;
+        }
+    }
 }
 
 void StatsHandler::createTimeStatsLine(const std::string& lineLabel,
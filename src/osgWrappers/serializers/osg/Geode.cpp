@@ -13,9 +13,11 @@ static bool checkDrawables( const osg::Geode& node )
 static bool readDrawables( osgDB::InputStream& is, osg::Geode& node )
 {
     unsigned int size = 0; is >> size >> is.BEGIN_BRACKET;
-    for ( unsigned int i=0; i<size; ++i )
+    osgDB::InputStream::ObjectList drawables;
+    is.readObjectList( size, drawables );
+    for ( osgDB::InputStream::ObjectList::iterator itr=drawables.begin(); itr!=drawables.end(); ++itr )
     {
-        osg::ref_ptr<osg::Drawable> drawable = is.readObjectOfType<osg::Drawable>();
+        osg::Drawable* drawable = dynamic_cast<osg::Drawable*>( itr->get() );
         if ( drawable )
         {
             node.addDrawable( drawable );
@@ -29,10 +31,12 @@ static bool writeDrawables( osgDB::OutputStream& os, const osg::Geode& node )
 {
     unsigned int size = node.getNumDrawables();
     os << size << os.BEGIN_BRACKET << std::endl;
+    osgDB::OutputStream::ObjectList drawables;
     for ( unsigned int i=0; i<size; ++i )
     {
-        os << node.getDrawable(i);
+        drawables.push_back( node.getDrawable(i) );
     }
+    os.writeObjectList( drawables );
     os << os.END_BRACKET << std::endl;
     return true;
 }
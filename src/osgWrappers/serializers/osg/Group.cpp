@@ -12,10 +12,11 @@ static bool checkChildren( const osg::Group& node )
 static bool readChildren( osgDB::InputStream& is, osg::Group& node )
 {
     unsigned int size = 0; is >> size >> is.BEGIN_BRACKET;
-    for ( unsigned int i=0; i<size; ++i )
+    osgDB::InputStream::ObjectList children;
+    is.readObjectList( size, children );
+    for ( osgDB::InputStream::ObjectList::iterator itr=children.begin(); itr!=children.end(); ++itr )
     {
-        osg::ref_ptr<osg::Object> obj = is.readObject();
-        osg::Node* child = dynamic_cast<osg::Node*>( obj.get() );
+        osg::Node* child = dynamic_cast<osg::Node*>( itr->get() );
         if ( child ) node.addChild( child );
     }
     is >> is.END_BRACKET;
@@ -26,10 +27,12 @@ static bool writeChildren( osgDB::OutputStream& os, const osg::Group& node )
 {
     unsigned int size = node.getNumChildren();
     os << size << os.BEGIN_BRACKET << std::endl;
+    osgDB::OutputStream::ObjectList children;
     for ( unsigned int i=0; i<size; ++i )
     {
-        os << node.getChild(i);
+        children.push_back( node.getChild(i) );
     }
+    os.writeObjectList( children );
     os << os.END_BRACKET << std::endl;
     return true;
 }
@@ -56,6 +56,49 @@ static void readContainer2( osgDB::InputStream& is, ContainerType* container )
     }
 }
 
+static void readQuantizedContainer( osgDB::InputStream& is, osgAnimation::Vec3QuantizedKeyframeContainer* container )
+{
+    bool hasContainer = false;
+    is >> is.PROPERTY("KeyFrameContainer") >> hasContainer;
+    if ( hasContainer )
+    {
+        osg::Vec3f min, scale;
+        is >> is.PROPERTY("Min") >> min;
+        is >> is.PROPERTY("Scale") >> scale;
+        container->init( min, scale );
+
+        unsigned int size = 0;
+        size = is.readSize(); is >> is.BEGIN_BRACKET;
+        for ( unsigned int i=0; i<size; ++i )
+        {
+            float time = 0.0f;
+            unsigned short x = 0, y = 0, z = 0;
+            is >> time >> x >> y >> z;
+            container->push_back( osgAnimation::Vec3QuantizedKeyframe(time, osgAnimation::Vec3Quantized(x, y, z)) );
+        }
+        is >> is.END_BRACKET;
+    }
+}
+
+static void readQuantizedContainer( osgDB::InputStream& is, osgAnimation::QuatQuantizedKeyframeContainer* container )
+{
+    bool hasContainer = false;
+    is >> is.PROPERTY("KeyFrameContainer") >> hasContainer;
+    if ( hasContainer )
+    {
+        unsigned int size = 0;
+        size = is.readSize(); is >> is.BEGIN_BRACKET;
+        for ( unsigned int i=0; i<size; ++i )
+        {
+            float time = 0.0f;
+            unsigned short d0 = 0, d1 = 0, d2 = 0;
+            is >> time >> d0 >> d1 >> d2;
+            container->push_back( osgAnimation::QuatQuantizedKeyframe(time, osgAnimation::QuatQuantized(d0, d1, d2)) );
+        }
+        is >> is.END_BRACKET;
+    }
+}
+
 #define READ_CHANNEL_FUNC( NAME, CHANNEL, CONTAINER, VALUE ) \
     if ( type==#NAME ) { \
         CHANNEL* ch = new CHANNEL; \
@@ -76,6 +119,16 @@ static void readContainer2( osgDB::InputStream& is, ContainerType* container )
         continue; \
     }
 
+#define READ_QUANTIZED_CHANNEL_FUNC( NAME, CHANNEL ) \
+    if ( type==#NAME ) { \
+        CHANNEL* ch = new CHANNEL; \
+        readChannel( is, ch ); \
+        readQuantizedContainer( is, ch->getOrCreateSampler()->getOrCreateKeyframeContainer() ); \
+        is >> is.END_BRACKET; \
+        if ( ch ) ani.addChannel( ch ); \
+        continue; \
+    }
+
 // writing channel helpers
 
 static void writeChannel( osgDB::OutputStream& os, osgAnimation::Channel* ch )
@@ -120,6 +173,70 @@ static void writeContainer2( osgDB::OutputStream& os, ContainerType* container )
     os << std::endl;
 }
 
+static void writeQuantizedContainer( osgDB::OutputStream& os, osgAnimation::Vec3QuantizedKeyframeContainer* container )
+{
+    os << os.PROPERTY("KeyFrameContainer") << (container!=NULL);
+    if ( container!=NULL )
+    {
+        os << os.PROPERTY("Min") << container->getMin();
+        os << os.PROPERTY("Scale") << container->getScale();
+        os.writeSize(container->size()); os << os.BEGIN_BRACKET << std::endl;
+        for ( unsigned int i=0; i<container->size(); ++i )
+        {
+            const osgAnimation::Vec3Quantized& value = (*container)[i].getValue();
+            os << static_cast<float>((*container)[i].getTime()) << value._data[0] << value._data[1] << value._data[2] << std::endl;
+        }
+        os << os.END_BRACKET;
+    }
+    os << std::endl;
+}
+
+static void writeQuantizedContainer( osgDB::OutputStream& os, osgAnimation::QuatQuantizedKeyframeContainer* container )
+{
+    os << os.PROPERTY("KeyFrameContainer") << (container!=NULL);
+    if ( container!=NULL )
+    {
+        os.writeSize(container->size()); os << os.BEGIN_BRACKET << std::endl;
+        for ( unsigned int i=0; i<container->size(); ++i )
+        {
+            const osgAnimation::QuatQuantized& value = (*container)[i].getValue();
+            os << static_cast<float>((*container)[i].getTime()) << value._data[0] << value._data[1] << value._data[2] << std::endl;
+        }
+        os << os.END_BRACKET;
+    }
+    os << std::endl;
+}
+
+// the quantized channels were added in SOVERSION 161, older versions get the decoded keyframes
+
+static osgAnimation::Vec3KeyframeContainer* uncompressContainer( osgAnimation::Vec3QuantizedKeyframeContainer* container )
+{
+    if ( container==NULL ) return NULL;
+
+    osgAnimation::Vec3KeyframeContainer* result = new osgAnimation::Vec3KeyframeContainer;
+    for ( unsigned int i=0; i<container->size(); ++i )
+    {
+        osg::Vec3 value;
+        (*container)[i].getValue().uncompress( container->getScale(), container->getMin(), value );
+        result->push_back( osgAnimation::Vec3Keyframe((*container)[i].getTime(), value) );
+    }
+    return result;
+}
+
+static osgAnimation::QuatKeyframeContainer* uncompressContainer( osgAnimation::QuatQuantizedKeyframeContainer* container )
+{
+    if ( container==NULL ) return NULL;
+
+    osgAnimation::QuatKeyframeContainer* result = new osgAnimation::QuatKeyframeContainer;
+    for ( unsigned int i=0; i<container->size(); ++i )
+    {
+        osg::Quat value;
+        (*container)[i].getValue().uncompress( value );
+        result->push_back( osgAnimation::QuatKeyframe((*container)[i].getTime(), value) );
+    }
+    return result;
+}
+
 #define WRITE_CHANNEL_FUNC( NAME, CHANNEL, CONTAINER ) \
     CHANNEL* ch_##NAME = dynamic_cast<CHANNEL*>(ch); \
     if ( ch_##NAME ) { \
@@ -140,6 +257,24 @@ static void writeContainer2( osgDB::OutputStream& os, ContainerType* container )
         continue; \
     }
 
+#define WRITE_QUANTIZED_CHANNEL_FUNC( NAME, CHANNEL, UNCOMPRESSED_NAME, UNCOMPRESSED_CONTAINER ) \
+    CHANNEL* ch_##NAME = dynamic_cast<CHANNEL*>(ch); \
+    if ( ch_##NAME && os.getFileVersion()<161 ) { \
+        os << os.PROPERTY("Type") << std::string(#UNCOMPRESSED_NAME) << os.BEGIN_BRACKET << std::endl; \
+        writeChannel( os, ch_##NAME ); \
+        osg::ref_ptr<UNCOMPRESSED_CONTAINER> uncompressed_##NAME = uncompressContainer( ch_##NAME ->getSamplerTyped()->getKeyframeContainerTyped() ); \
+        writeContainer<UNCOMPRESSED_CONTAINER>( os, uncompressed_##NAME.get() ); \
+        os << os.END_BRACKET << std::endl; \
+        continue; \
+    } \
+    if ( ch_##NAME ) { \
+        os << os.PROPERTY("Type") << std::string(#NAME) << os.BEGIN_BRACKET << std::endl; \
+        writeChannel( os, ch_##NAME ); \
+        writeQuantizedContainer( os, ch_##NAME ->getSamplerTyped()->getKeyframeContainerTyped() ); \
+        os << os.END_BRACKET << std::endl; \
+        continue; \
+    }
+
 // _channels
 
 static bool checkChannels( const osgAnimation::Animation& ani )
@@ -185,6 +320,8 @@ static bool readChannels( osgDB::InputStream& is, osgAnimation::Animation& ani )
         READ_CHANNEL_FUNC2( Vec4CubicBezierChannel, osgAnimation::Vec4CubicBezierChannel,
                                                     osgAnimation::Vec4CubicBezierKeyframeContainer,
                                                     osgAnimation::Vec4CubicBezier, osg::Vec4 );
+        READ_QUANTIZED_CHANNEL_FUNC( Vec3QuantizedLinearChannel, osgAnimation::Vec3QuantizedLinearChannel );
+        READ_QUANTIZED_CHANNEL_FUNC( QuatQuantizedSphericalLinearChannel, osgAnimation::QuatQuantizedSphericalLinearChannel );
         is.advanceToCurrentEndBracket();
     }
     is >> is.END_BRACKET;
@@ -224,6 +361,10 @@ static bool writeChannels( osgDB::OutputStream& os, const osgAnimation::Animatio
                                                      osgAnimation::Vec3CubicBezierKeyframeContainer );
         WRITE_CHANNEL_FUNC2( Vec4CubicBezierChannel, osgAnimation::Vec4CubicBezierChannel,
                                                      osgAnimation::Vec4CubicBezierKeyframeContainer );
+        WRITE_QUANTIZED_CHANNEL_FUNC( Vec3QuantizedLinearChannel, osgAnimation::Vec3QuantizedLinearChannel,
+                                      Vec3LinearChannel, osgAnimation::Vec3KeyframeContainer );
+        WRITE_QUANTIZED_CHANNEL_FUNC( QuatQuantizedSphericalLinearChannel, osgAnimation::QuatQuantizedSphericalLinearChannel,
+                                      QuatSphericalLinearChannel, osgAnimation::QuatKeyframeContainer );
 
         os << os.PROPERTY("Type") << std::string("UnknownChannel") << os.BEGIN_BRACKET << std::endl;
         os << os.END_BRACKET << std::endl;